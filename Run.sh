@@ -23,6 +23,12 @@ CompileShader(){
 # compile vertex shader
 CompileShader shader.vert vert.spv
 
+# compile compact vertex shader
+CompileShader shader_compact.vert compact_vert.spv
+
+# compile position only vertex shader for depth only pipelines
+CompileShader shader_depth.vert depth_vert.spv
+
 # compile fragment shader
 CompileShader shader.frag frag.spv
 
@@ -4,13 +4,40 @@
 //shader input
 layout (location = 0) in vec3 inColor;
 layout (location = 1) in vec2 texCoord;
+//atlas tiling of texCoord, see UvTiling in source/mesh.hpp
+layout (location = 2) flat in vec4 uvTiling;
 //output write
 layout (location = 0) out vec4 outFragColor;
 
-layout(set = 1, binding = 0) uniform sampler2D tex1;
+//textures are arrays, textures with an image of their own have a single layer
+layout(set = 1, binding = 0) uniform sampler2DArray tex1;
+
+//push constants block after GPUMeshData of vertex shader, must match GPUMaterialData
+layout( push_constant ) uniform constants
+{
+	layout(offset = 112) uint textureLayer;
+	uint normalMap;
+} PushConstants;
 
 void main()
 {
-	vec3 color = texture(tex1,texCoord).xyz;
+	// tiled coordinates repeat position inside their atlas tile, like repeat addressing on a texture of its own
+	vec2 uv = texCoord;
+	vec2 gradientScale = vec2(1.0f);
+	if (uvTiling.z > 0.0f) {
+		vec2 tile = floor(texCoord / uvTiling.z);
+		vec2 inside = fract(texCoord - tile * uvTiling.z);
+		uv = (tile + inside) * uvTiling.xy;
+		gradientScale = uvTiling.xy;
+	}
+
+	// gradients of unwrapped coordinates, wrapped ones jump at every tile border
+	vec3 color = textureGrad(tex1, vec3(uv, PushConstants.textureLayer), dFdx(texCoord) * gradientScale, dFdy(texCoord) * gradientScale).xyz;
+
+	// two channel normal maps store x and y, z of unit length normal is rebuilt and encoded like x and y
+	if (PushConstants.normalMap != 0) {
+		vec2 normal = color.xy * 2.0f - 1.0f;
+		color.z = sqrt(max(1.0f - dot(normal, normal), 0.0f)) * 0.5f + 0.5f;
+	}
 	outFragColor = vec4(color,1.0f);
 }
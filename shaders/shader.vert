@@ -6,25 +6,32 @@ layout (location = 3) in vec2 vTexCoord;
 
 layout (location = 0) out vec3 outColor;
 layout (location = 1) out vec2 texCoord;
+layout (location = 2) flat out vec4 uvTiling;
 
 
 layout(set = 0, binding = 0) uniform  CameraBuffer{
-	mat4 model;
 	mat4 view;
 	mat4 proj;
 } cameraData;
 
-//push constants block
+//push constants block, must match GPUMeshData
 layout( push_constant ) uniform constants
 {
- vec4 data;
- mat4 render_matrix;
+ mat4 model;
+ vec4 positionOffset;
+ vec4 positionScale;
+ vec4 uvTiling;
 } PushConstants;
 
+// depth prepass writes same depth, see shader_depth.vert
+invariant gl_Position;
+
 void main()
 {
-	gl_Position = cameraData.proj * cameraData.view * cameraData.model * vec4(vPosition, 1.0f);
-	// gl_Position = cameraData.model * cameraData.view * cameraData.proj * vec4(vPosition, 1.0f);
+	// identity for standard meshes, written out so that depth prepass computes same position
+	vec3 position = PushConstants.positionOffset.xyz + vPosition * PushConstants.positionScale.xyz;
+	gl_Position = cameraData.proj * cameraData.view * PushConstants.model * vec4(position, 1.0f);
 	outColor = vColor;
 	texCoord = vTexCoord;
+	uvTiling = PushConstants.uvTiling;
 }
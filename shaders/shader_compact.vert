@@ -0,0 +1,49 @@
+#version 450
+// quantized vertex, see CompactVertex in source/mesh.hpp
+layout (location = 0) in vec4 vPosition;
+layout (location = 1) in vec2 vNormal;
+layout (location = 3) in vec2 vTexCoord;
+
+layout (location = 0) out vec3 outColor;
+layout (location = 1) out vec2 texCoord;
+layout (location = 2) flat out vec4 uvTiling;
+
+
+layout(set = 0, binding = 0) uniform  CameraBuffer{
+	mat4 view;
+	mat4 proj;
+} cameraData;
+
+//push constants block, must match GPUMeshData
+layout( push_constant ) uniform constants
+{
+ mat4 model;
+ vec4 positionOffset;
+ vec4 positionScale;
+ vec4 uvTiling;
+} PushConstants;
+
+// depth prepass writes same depth, see shader_depth.vert
+invariant gl_Position;
+
+// unfold octahedral encoded normal back onto unit sphere
+vec3 OctahedralDecode(vec2 encoded)
+{
+	vec3 n = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	// positions are normalized over mesh bounds
+	vec3 position = PushConstants.positionOffset.xyz + vPosition.xyz * PushConstants.positionScale.xyz;
+
+	gl_Position = cameraData.proj * cameraData.view * PushConstants.model * vec4(position, 1.0f);
+	// color used to be a copy of normal, so decode normal in its place
+	outColor = OctahedralDecode(vNormal);
+	texCoord = vTexCoord;
+	uvTiling = PushConstants.uvTiling;
+}
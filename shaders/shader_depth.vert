@@ -0,0 +1,26 @@
+#version 450
+// position only vertex shader for depth only pipelines, reads binding 0 alone
+// standard meshes push identity offset and scale, so both vertex formats use it
+layout (location = 0) in vec4 vPosition;
+
+layout(set = 0, binding = 0) uniform  CameraBuffer{
+	mat4 view;
+	mat4 proj;
+} cameraData;
+
+//push constants block, must match GPUMeshData
+layout( push_constant ) uniform constants
+{
+ mat4 model;
+ vec4 positionOffset;
+ vec4 positionScale;
+} PushConstants;
+
+// depth must match color pass exactly for LessOrEqual test to pass
+invariant gl_Position;
+
+void main()
+{
+	vec3 position = PushConstants.positionOffset.xyz + vPosition.xyz * PushConstants.positionScale.xyz;
+	gl_Position = cameraData.proj * cameraData.view * PushConstants.model * vec4(position, 1.0f);
+}
@@ -0,0 +1,1075 @@
+#include "block_compression.hpp"
+#include "utils/parallel.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GAMEZERO_BLOCK_SSE2 1
+#endif
+
+using namespace GameZero;
+
+/// subset of every texel for BC7 partitions with 2 subsets, bit i is subset of texel i
+static const uint16_t Partitions2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+    0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+    0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+    0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+    0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+/// subset of every texel for BC7 partitions with 3 subsets, bits 2i and 2i + 1 are subset of texel i
+static const uint32_t Partitions3[64] = {
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+    0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+    0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+    0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+    0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+    0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+    0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+    0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+};
+
+/// texel whose index drops its top bit in second subset of 2 subset partitions
+static const uint8_t Anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+
+/// texel whose index drops its top bit in second subset of 3 subset partitions
+static const uint8_t Anchors3Second[64] = {
+     3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+     3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+     8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+     3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+};
+
+/// texel whose index drops its top bit in third subset of 3 subset partitions
+static const uint8_t Anchors3Third[64] = {
+    15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+    15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+    15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+    15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+};
+
+/// interpolation weights out of 64 for 2, 3 and 4 bit indices
+static const uint8_t Weights2[4] = {0, 21, 43, 64};
+static const uint8_t Weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const uint8_t Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/// layout of one of the 8 BC7 modes
+struct BC7Mode{
+    uint8_t subsetCount;
+    uint8_t partitionBits;
+    uint8_t rotationBits;
+    uint8_t indexSelectionBits;
+    uint8_t colorBits;
+    uint8_t alphaBits;
+    /// p bit per endpoint
+    uint8_t endpointPBits;
+    /// p bit per subset, shared by its two endpoints
+    uint8_t sharedPBits;
+    uint8_t indexBits;
+    /// second index set of modes that store alpha separately
+    uint8_t secondaryIndexBits;
+};
+
+static const BC7Mode BC7Modes[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0}
+};
+
+/// reads bits of a 128 bit block from lowest to highest
+class BlockBitReader{
+public:
+    explicit BlockBitReader(const uint8_t* block){
+        memcpy(&low, block, 8);
+        memcpy(&high, block + 8, 8);
+    }
+
+    uint32_t Read(uint32_t count){
+        if(count == 0) return 0;
+        uint32_t value = uint32_t(low & ((uint64_t(1) << count) - 1));
+        low = (low >> count) | (count == 64 ? 0 : high << (64 - count));
+        high >>= count;
+        return value;
+    }
+
+private:
+    uint64_t low;
+    uint64_t high;
+};
+
+static uint8_t Interpolate(uint32_t e0, uint32_t e1, uint32_t weight){
+    return uint8_t(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+// expand 5 and 6 bit color channels by replicating their high bits
+static void DecodeRGB565(uint16_t color, uint8_t* rgb){
+    uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = uint8_t((r << 3) | (r >> 2));
+    rgb[1] = uint8_t((g << 2) | (g >> 4));
+    rgb[2] = uint8_t((b << 3) | (b >> 2));
+}
+
+// BC1 color block, BC3 always uses the 4 color mode regardless of endpoint order
+static void DecodeColorBlock(const uint8_t* block, uint8_t* texels, bool allowTransparent){
+    uint16_t c0 = uint16_t(block[0] | (block[1] << 8));
+    uint16_t c1 = uint16_t(block[2] | (block[3] << 8));
+
+    uint8_t palette[4][4];
+    DecodeRGB565(c0, palette[0]);
+    DecodeRGB565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+
+    if(c0 > c1 || !allowTransparent){
+        for(int c = 0; c < 3; c++){
+            palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        palette[2][3] = palette[3][3] = 255;
+    }else{
+        for(int c = 0; c < 3; c++){
+            palette[2][c] = uint8_t((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 0;
+    }
+
+    uint32_t indices = uint32_t(block[4]) | (uint32_t(block[5]) << 8) | (uint32_t(block[6]) << 16) | (uint32_t(block[7]) << 24);
+    for(uint32_t i = 0; i < 16; i++){
+        memcpy(texels + i * 4, palette[(indices >> (2 * i)) & 3], 4);
+    }
+}
+
+// 8 alpha values between two endpoints, or 6 plus fully transparent and opaque
+static void DecodeAlphaBlock(const uint8_t* block, uint8_t* texels){
+    uint32_t a0 = block[0], a1 = block[1];
+
+    uint8_t palette[8];
+    palette[0] = uint8_t(a0);
+    palette[1] = uint8_t(a1);
+    if(a0 > a1){
+        for(uint32_t i = 1; i < 7; i++) palette[i + 1] = uint8_t(((7 - i) * a0 + i * a1) / 7);
+    }else{
+        for(uint32_t i = 1; i < 5; i++) palette[i + 1] = uint8_t(((5 - i) * a0 + i * a1) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for(int i = 0; i < 6; i++) indices |= uint64_t(block[2 + i]) << (8 * i);
+    for(uint32_t i = 0; i < 16; i++){
+        texels[i * 4 + 3] = palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+static void DecodeBC7Block(const uint8_t* block, uint8_t* texels){
+    BlockBitReader reader(block);
+
+    // mode is number of zero bits before first set bit
+    uint32_t modeIndex = 0;
+    while(modeIndex < 8 && reader.Read(1) == 0) modeIndex++;
+    if(modeIndex == 8){
+        memset(texels, 0, 64);
+        return;
+    }
+    const BC7Mode& mode = BC7Modes[modeIndex];
+
+    uint32_t partition = reader.Read(mode.partitionBits);
+    uint32_t rotation = reader.Read(mode.rotationBits);
+    uint32_t indexSelection = reader.Read(mode.indexSelectionBits);
+
+    // endpoints of every subset, components stored channel by channel
+    uint32_t endpoints[3][2][4] = {};
+    for(uint32_t c = 0; c < 3; c++){
+        for(uint32_t s = 0; s < mode.subsetCount; s++){
+            endpoints[s][0][c] = reader.Read(mode.colorBits);
+            endpoints[s][1][c] = reader.Read(mode.colorBits);
+        }
+    }
+    for(uint32_t s = 0; s < mode.subsetCount; s++){
+        endpoints[s][0][3] = mode.alphaBits ? reader.Read(mode.alphaBits) : 255;
+        endpoints[s][1][3] = mode.alphaBits ? reader.Read(mode.alphaBits) : 255;
+    }
+
+    // p bits add one low bit to every component of an endpoint
+    uint32_t colorBits = mode.colorBits, alphaBits = mode.alphaBits;
+    if(mode.endpointPBits || mode.sharedPBits){
+        uint32_t pBits[3][2];
+        for(uint32_t s = 0; s < mode.subsetCount; s++){
+            if(mode.endpointPBits){
+                pBits[s][0] = reader.Read(1);
+                pBits[s][1] = reader.Read(1);
+            }else{
+                pBits[s][0] = pBits[s][1] = reader.Read(1);
+            }
+        }
+        for(uint32_t s = 0; s < mode.subsetCount; s++){
+            for(uint32_t e = 0; e < 2; e++){
+                for(uint32_t c = 0; c < (mode.alphaBits ? 4u : 3u); c++){
+                    endpoints[s][e][c] = (endpoints[s][e][c] << 1) | pBits[s][e];
+                }
+            }
+        }
+        colorBits++;
+        if(alphaBits) alphaBits++;
+    }
+
+    // expand to 8 bits by replicating high bits
+    for(uint32_t s = 0; s < mode.subsetCount; s++){
+        for(uint32_t e = 0; e < 2; e++){
+            for(uint32_t c = 0; c < 3; c++){
+                uint32_t v = endpoints[s][e][c] << (8 - colorBits);
+                endpoints[s][e][c] = v | (v >> colorBits);
+            }
+            if(alphaBits){
+                uint32_t v = endpoints[s][e][3] << (8 - alphaBits);
+                endpoints[s][e][3] = v | (v >> alphaBits);
+            }
+        }
+    }
+
+    // subset of every texel and texels whose index is one bit shorter
+    uint32_t subsets[16] = {};
+    bool anchors[16] = {};
+    anchors[0] = true;
+    if(mode.subsetCount == 2){
+        for(uint32_t i = 0; i < 16; i++) subsets[i] = (Partitions2[partition] >> i) & 1;
+        anchors[Anchors2[partition]] = true;
+    }else if(mode.subsetCount == 3){
+        for(uint32_t i = 0; i < 16; i++) subsets[i] = (Partitions3[partition] >> (2 * i)) & 3;
+        anchors[Anchors3Second[partition]] = true;
+        anchors[Anchors3Third[partition]] = true;
+    }
+
+    uint32_t indices[16];
+    for(uint32_t i = 0; i < 16; i++) indices[i] = reader.Read(mode.indexBits - (anchors[i] ? 1 : 0));
+
+    // second index set only has texel 0 as anchor
+    uint32_t secondaryIndices[16] = {};
+    if(mode.secondaryIndexBits){
+        for(uint32_t i = 0; i < 16; i++) secondaryIndices[i] = reader.Read(mode.secondaryIndexBits - (i == 0 ? 1 : 0));
+    }
+
+    const uint8_t* weights = mode.indexBits == 2 ? Weights2 : mode.indexBits == 3 ? Weights3 : Weights4;
+    const uint8_t* secondaryWeights = mode.secondaryIndexBits == 3 ? Weights3 : Weights2;
+
+    for(uint32_t i = 0; i < 16; i++){
+        const uint32_t (*e)[4] = endpoints[subsets[i]];
+        uint8_t* texel = texels + i * 4;
+
+        uint32_t colorWeight = weights[indices[i]];
+        uint32_t alphaWeight = colorWeight;
+        if(mode.secondaryIndexBits){
+            // index selection swaps which set colors and alpha use
+            uint32_t secondaryWeight = secondaryWeights[secondaryIndices[i]];
+            colorWeight = indexSelection ? secondaryWeight : colorWeight;
+            alphaWeight = indexSelection ? weights[indices[i]] : secondaryWeight;
+        }
+
+        for(uint32_t c = 0; c < 3; c++) texel[c] = Interpolate(e[0][c], e[1][c], colorWeight);
+        texel[3] = Interpolate(e[0][3], e[1][3], alphaWeight);
+
+        // rotation swaps alpha with one color channel
+        if(rotation) std::swap(texel[3], texel[rotation - 1]);
+    }
+}
+
+void GameZero::DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* texels){
+    switch(format){
+        case BlockFormat::BC1:
+            DecodeColorBlock(block, texels, true);
+            break;
+        case BlockFormat::BC3:
+            DecodeColorBlock(block + 8, texels, false);
+            DecodeAlphaBlock(block, texels);
+            break;
+        case BlockFormat::BC7:
+            DecodeBC7Block(block, texels);
+            break;
+    }
+}
+
+// blocks at right and bottom edges may be partly outside image
+void GameZero::DecodeBlocks(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* texels){
+    uint32_t blocksX = (width + BlockDimension - 1) / BlockDimension;
+    uint32_t blocksY = (height + BlockDimension - 1) / BlockDimension;
+    size_t blockSize = GetBlockSize(format);
+
+    uint8_t decoded[64];
+    for(uint32_t by = 0; by < blocksY; by++){
+        for(uint32_t bx = 0; bx < blocksX; bx++){
+            DecodeBlock(format, blocks + (size_t(by) * blocksX + bx) * blockSize, decoded);
+
+            uint32_t columns = std::min(BlockDimension, width - bx * BlockDimension);
+            uint32_t rows = std::min(BlockDimension, height - by * BlockDimension);
+            for(uint32_t y = 0; y < rows; y++){
+                size_t row = size_t(by * BlockDimension + y) * width + bx * BlockDimension;
+                memcpy(texels + row * 4, decoded + y * 16, columns * 4);
+            }
+        }
+    }
+}
+
+/// writes bits of a 128 bit block from lowest to highest
+class BlockBitWriter{
+public:
+    void Write(uint32_t value, uint32_t count){
+        if(count == 0) return;
+        if(position < 64){
+            low |= uint64_t(value) << position;
+            if(position + count > 64) high |= uint64_t(value) >> (64 - position);
+        }else{
+            high |= uint64_t(value) << (position - 64);
+        }
+        position += count;
+    }
+
+    void Store(uint8_t* block) const{
+        memcpy(block, &low, 8);
+        memcpy(block + 8, &high, 8);
+    }
+
+private:
+    uint64_t low = 0;
+    uint64_t high = 0;
+    uint32_t position = 0;
+};
+
+/// texels of a block as floats stored channel by channel, so that 4 texels fit in one sse register
+struct alignas(16) BlockTexels{
+    float channels[4][16];
+};
+
+static void LoadBlockTexels(const uint8_t* texels, BlockTexels& block){
+    for(uint32_t i = 0; i < 16; i++){
+        for(uint32_t c = 0; c < 4; c++) block.channels[c][i] = texels[i * 4 + c];
+    }
+}
+
+// nearest palette entry of every texel and its squared error, palette holds at most 16 entries
+template<uint32_t ChannelCount>
+static void FindNearestEntries(const BlockTexels& texels, const float (*palette)[4], uint32_t paletteSize, uint8_t* indices, float* errors){
+#if defined(GAMEZERO_BLOCK_SSE2)
+    for(uint32_t group = 0; group < 16; group += 4){
+        __m128 t[ChannelCount];
+        for(uint32_t c = 0; c < ChannelCount; c++) t[c] = _mm_load_ps(texels.channels[c] + group);
+
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for(uint32_t p = 0; p < paletteSize; p++){
+            __m128 distance = _mm_setzero_ps();
+            for(uint32_t c = 0; c < ChannelCount; c++){
+                __m128 difference = _mm_sub_ps(t[c], _mm_set1_ps(palette[p][c]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+            }
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+            best = _mm_min_ps(distance, best);
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(int32_t(p))), _mm_andnot_si128(closer, bestIndex));
+        }
+
+        alignas(16) int32_t groupIndices[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(groupIndices), bestIndex);
+        _mm_storeu_ps(errors + group, best);
+        for(uint32_t i = 0; i < 4; i++) indices[group + i] = uint8_t(groupIndices[i]);
+    }
+#else
+    for(uint32_t i = 0; i < 16; i++){
+        float best = FLT_MAX;
+        uint32_t bestIndex = 0;
+        for(uint32_t p = 0; p < paletteSize; p++){
+            float distance = 0;
+            for(uint32_t c = 0; c < ChannelCount; c++){
+                float difference = texels.channels[c][i] - palette[p][c];
+                distance += difference * difference;
+            }
+            if(distance < best){
+                best = distance;
+                bestIndex = p;
+            }
+        }
+        indices[i] = uint8_t(bestIndex);
+        errors[i] = best;
+    }
+#endif
+}
+
+static float SumErrors(const float* errors, uint32_t mask){
+    float sum = 0;
+    for(uint32_t i = 0; i < 16; i++){
+        if(mask & (1u << i)) sum += errors[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Fit a line through texels in mask along their principal axis,
+ *        endpoints are placed at the extreme projections onto it.
+ *
+ * @return squared distance of texels from line, used to rank partitions
+ */
+template<uint32_t ChannelCount>
+static float FitEndpoints(const BlockTexels& texels, uint32_t mask, float (*endpoints)[4]){
+    float mean[4] = {};
+    float count = 0;
+    for(uint32_t i = 0; i < 16; i++){
+        if(!(mask & (1u << i))) continue;
+        for(uint32_t c = 0; c < ChannelCount; c++) mean[c] += texels.channels[c][i];
+        count++;
+    }
+    for(uint32_t c = 0; c < ChannelCount; c++) mean[c] /= count;
+
+    float covariance[4][4] = {};
+    float variance = 0;
+    for(uint32_t i = 0; i < 16; i++){
+        if(!(mask & (1u << i))) continue;
+        float d[4];
+        for(uint32_t c = 0; c < ChannelCount; c++) d[c] = texels.channels[c][i] - mean[c];
+        for(uint32_t a = 0; a < ChannelCount; a++){
+            for(uint32_t b = a; b < ChannelCount; b++) covariance[a][b] += d[a] * d[b];
+        }
+    }
+    for(uint32_t a = 0; a < ChannelCount; a++){
+        variance += covariance[a][a];
+        for(uint32_t b = 0; b < a; b++) covariance[a][b] = covariance[b][a];
+    }
+
+    // power iteration from row with largest variance converges to principal axis
+    uint32_t start = 0;
+    for(uint32_t c = 1; c < ChannelCount; c++){
+        if(covariance[c][c] > covariance[start][start]) start = c;
+    }
+    float axis[4];
+    for(uint32_t c = 0; c < ChannelCount; c++) axis[c] = covariance[start][c];
+    for(int iteration = 0; iteration < 6; iteration++){
+        float next[4] = {};
+        float largest = 0;
+        for(uint32_t a = 0; a < ChannelCount; a++){
+            for(uint32_t b = 0; b < ChannelCount; b++) next[a] += covariance[a][b] * axis[b];
+            largest = std::max(largest, std::fabs(next[a]));
+        }
+        if(largest == 0) break;
+        for(uint32_t c = 0; c < ChannelCount; c++) axis[c] = next[c] / largest;
+    }
+
+    float length = 0;
+    for(uint32_t c = 0; c < ChannelCount; c++) length += axis[c] * axis[c];
+    if(length < 1e-12f){
+        for(uint32_t c = 0; c < ChannelCount; c++) endpoints[0][c] = endpoints[1][c] = mean[c];
+        return variance;
+    }
+    length = std::sqrt(length);
+    for(uint32_t c = 0; c < ChannelCount; c++) axis[c] /= length;
+
+    float low = FLT_MAX, high = -FLT_MAX, projected = 0;
+    for(uint32_t i = 0; i < 16; i++){
+        if(!(mask & (1u << i))) continue;
+        float t = 0;
+        for(uint32_t c = 0; c < ChannelCount; c++) t += (texels.channels[c][i] - mean[c]) * axis[c];
+        low = std::min(low, t);
+        high = std::max(high, t);
+        projected += t * t;
+    }
+    for(uint32_t c = 0; c < ChannelCount; c++){
+        endpoints[0][c] = std::min(255.0f, std::max(0.0f, mean[c] + low * axis[c]));
+        endpoints[1][c] = std::min(255.0f, std::max(0.0f, mean[c] + high * axis[c]));
+    }
+    return std::max(0.0f, variance - projected);
+}
+
+/**
+ * @brief Least squares endpoints for texels in mask given their indices,
+ *        weights maps an index to its position between endpoints in [0, 1].
+ *
+ * @return false if indices do not pin down both endpoints
+ */
+template<uint32_t ChannelCount>
+static bool RefitEndpoints(const BlockTexels& texels, uint32_t mask, const uint8_t* indices, const float* weights, float (*endpoints)[4]){
+    float aa = 0, ab = 0, bb = 0;
+    float ax[4] = {}, bx[4] = {};
+    for(uint32_t i = 0; i < 16; i++){
+        if(!(mask & (1u << i))) continue;
+        float b = weights[indices[i]], a = 1 - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for(uint32_t c = 0; c < ChannelCount; c++){
+            ax[c] += a * texels.channels[c][i];
+            bx[c] += b * texels.channels[c][i];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if(std::fabs(determinant) < 1e-6f) return false;
+    for(uint32_t c = 0; c < ChannelCount; c++){
+        endpoints[0][c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+        endpoints[1][c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+    }
+    return true;
+}
+
+/// endpoint refinement passes per quality
+static uint32_t GetRefineIterations(BlockEncodeQuality quality){
+    return quality == BlockEncodeQuality::Fast ? 1 : quality == BlockEncodeQuality::Normal ? 2 : 4;
+}
+
+// nearest 565 color, rounding of each channel is checked against its expanded value
+static uint16_t QuantizeRGB565(const float* color){
+    const uint32_t bits[3] = {5, 6, 5};
+    uint32_t quantized[3];
+    for(uint32_t c = 0; c < 3; c++){
+        int32_t maximum = (1 << bits[c]) - 1;
+        int32_t guess = int32_t(std::lround(color[c] * maximum / 255.0f));
+        float bestError = FLT_MAX;
+        for(int32_t q = std::max(0, guess - 1); q <= std::min(maximum, guess + 1); q++){
+            int32_t expanded = (q << (8 - bits[c])) | (q >> (2 * bits[c] - 8));
+            float error = std::fabs(expanded - color[c]);
+            if(error < bestError){
+                bestError = error;
+                quantized[c] = uint32_t(q);
+            }
+        }
+    }
+    return uint16_t((quantized[0] << 11) | (quantized[1] << 5) | quantized[2]);
+}
+
+// palette exactly as DecodeColorBlock builds it, transparent entry is left out
+static uint32_t BuildColorPalette(uint16_t c0, uint16_t c1, bool fourColors, float (*palette)[4]){
+    uint8_t e[2][3];
+    DecodeRGB565(c0, e[0]);
+    DecodeRGB565(c1, e[1]);
+    for(uint32_t c = 0; c < 3; c++){
+        palette[0][c] = e[0][c];
+        palette[1][c] = e[1][c];
+        if(fourColors){
+            palette[2][c] = float((2 * e[0][c] + e[1][c]) / 3);
+            palette[3][c] = float((e[0][c] + 2 * e[1][c]) / 3);
+        }else{
+            palette[2][c] = float((e[0][c] + e[1][c]) / 2);
+        }
+    }
+    return fourColors ? 4 : 3;
+}
+
+// BC1 color block, texels with alpha below 128 use 3 color mode when transparency is allowed
+static void EncodeColorBlock(const BlockTexels& texels, uint8_t* block, BlockEncodeQuality quality, bool allowTransparent){
+    uint32_t transparentMask = 0;
+    if(allowTransparent){
+        for(uint32_t i = 0; i < 16; i++){
+            if(texels.channels[3][i] < 128) transparentMask |= 1u << i;
+        }
+    }
+    uint32_t opaqueMask = ~transparentMask & 0xFFFF;
+    bool fourColors = transparentMask == 0;
+
+    uint16_t bestColors[2] = {0, 0};
+    uint8_t bestIndices[16] = {};
+    if(opaqueMask){
+        float endpoints[2][4];
+        FitEndpoints<3>(texels, opaqueMask, endpoints);
+
+        static const float FourColorWeights[4] = {0, 1, 1.0f / 3, 2.0f / 3};
+        static const float ThreeColorWeights[3] = {0, 1, 0.5f};
+
+        float bestError = FLT_MAX;
+        for(uint32_t iteration = 0; iteration < GetRefineIterations(quality); iteration++){
+            uint16_t colors[2] = {QuantizeRGB565(endpoints[0]), QuantizeRGB565(endpoints[1])};
+
+            // endpoint order selects mode, 4 color mode needs c0 > c1
+            if(fourColors ? colors[0] < colors[1] : colors[0] > colors[1]){
+                std::swap(colors[0], colors[1]);
+                for(uint32_t c = 0; c < 3; c++) std::swap(endpoints[0][c], endpoints[1][c]);
+            }
+
+            uint8_t indices[16];
+            float errors[16];
+            if(colors[0] == colors[1]){
+                // single color, both modes decode index 0 to c0
+                float palette[1][4];
+                BuildColorPalette(colors[0], colors[1], false, palette);
+                FindNearestEntries<3>(texels, palette, 1, indices, errors);
+            }else{
+                float palette[4][4];
+                uint32_t paletteSize = BuildColorPalette(colors[0], colors[1], fourColors, palette);
+                FindNearestEntries<3>(texels, palette, paletteSize, indices, errors);
+            }
+
+            float error = SumErrors(errors, opaqueMask);
+            if(error < bestError){
+                bestError = error;
+                bestColors[0] = colors[0];
+                bestColors[1] = colors[1];
+                memcpy(bestIndices, indices, 16);
+            }
+            if(error == 0) break;
+
+            if(!RefitEndpoints<3>(texels, opaqueMask, indices, fourColors ? FourColorWeights : ThreeColorWeights, endpoints)) break;
+        }
+    }
+
+    uint32_t indices = 0;
+    for(uint32_t i = 0; i < 16; i++){
+        uint32_t index = (transparentMask & (1u << i)) ? 3 : bestIndices[i];
+        indices |= index << (2 * i);
+    }
+    block[0] = uint8_t(bestColors[0]);
+    block[1] = uint8_t(bestColors[0] >> 8);
+    block[2] = uint8_t(bestColors[1]);
+    block[3] = uint8_t(bestColors[1] >> 8);
+    memcpy(block + 4, &indices, 4);
+}
+
+// BC3 alpha block always uses 8 values between max and min alpha
+static void EncodeAlphaBlock(const uint8_t* texels, uint8_t* block){
+    uint32_t a0 = 0, a1 = 255;
+    for(uint32_t i = 0; i < 16; i++){
+        a0 = std::max<uint32_t>(a0, texels[i * 4 + 3]);
+        a1 = std::min<uint32_t>(a1, texels[i * 4 + 3]);
+    }
+
+    uint32_t palette[8] = {a0, a1};
+    for(uint32_t i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+
+    // equal endpoints select 6 value mode, where index 0 still decodes to a0
+    uint64_t indices = 0;
+    if(a0 != a1){
+        for(uint32_t i = 0; i < 16; i++){
+            uint32_t alpha = texels[i * 4 + 3], best = 0, bestError = 256;
+            for(uint32_t p = 0; p < 8; p++){
+                uint32_t error = alpha > palette[p] ? alpha - palette[p] : palette[p] - alpha;
+                if(error < bestError){
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= uint64_t(best) << (3 * i);
+        }
+    }
+
+    block[0] = uint8_t(a0);
+    block[1] = uint8_t(a1);
+    for(int i = 0; i < 6; i++) block[2 + i] = uint8_t(indices >> (8 * i));
+}
+
+/**
+ * @brief Quantize an endpoint to given bits per channel, optionally followed by a p bit.
+ *
+ * @param endpoint : 8 bit values as floats
+ * @param pBit : appended low bit of every channel, ignored without p bit
+ * @param quantized : receives stored values without p bit
+ * @param expanded : receives values decoder expands them to
+ * @return squared error of quantization
+ */
+template<uint32_t ChannelCount>
+static float QuantizeBC7Endpoint(const float* endpoint, uint32_t bits, bool hasPBit, uint32_t pBit, uint32_t* quantized, float* expanded){
+    uint32_t totalBits = hasPBit ? bits + 1 : bits;
+    int32_t maximum = (1 << bits) - 1;
+    float error = 0;
+    for(uint32_t c = 0; c < ChannelCount; c++){
+        float scaled = endpoint[c] * ((1 << totalBits) - 1) / 255.0f;
+        int32_t guess = int32_t(std::lround(hasPBit ? (scaled - pBit) / 2 : scaled));
+        float bestError = FLT_MAX;
+        for(int32_t q = std::max(0, guess - 1); q <= std::min(maximum, guess + 1); q++){
+            uint32_t value = hasPBit ? (uint32_t(q) << 1) | pBit : uint32_t(q);
+            uint32_t v = value << (8 - totalBits);
+            float e = float(v | (v >> totalBits));
+            float difference = e - endpoint[c];
+            if(difference * difference < bestError){
+                bestError = difference * difference;
+                quantized[c] = uint32_t(q);
+                expanded[c] = e;
+            }
+        }
+        error += bestError;
+    }
+    return error;
+}
+
+/// quantized endpoints of one BC7 subset
+struct BC7Subset{
+    uint32_t endpoints[2][4];
+    uint32_t pBits[2];
+};
+
+static void BuildBC7Palette(const float (*expanded)[4], uint32_t channelCount, const uint8_t* weights, uint32_t paletteSize, float (*palette)[4]){
+    for(uint32_t i = 0; i < paletteSize; i++){
+        for(uint32_t c = 0; c < channelCount; c++){
+            palette[i][c] = Interpolate(uint32_t(expanded[0][c]), uint32_t(expanded[1][c]), weights[i]);
+        }
+    }
+}
+
+// swap endpoints of a subset when its anchor index has top bit set, so that top bit need not be stored
+static void FixBC7Anchor(BC7Subset& subset, uint32_t mask, uint32_t anchor, uint32_t indexBits, uint8_t* indices){
+    uint32_t maximum = (1u << indexBits) - 1;
+    if(indices[anchor] <= maximum >> 1) return;
+    for(uint32_t c = 0; c < 4; c++) std::swap(subset.endpoints[0][c], subset.endpoints[1][c]);
+    std::swap(subset.pBits[0], subset.pBits[1]);
+    for(uint32_t i = 0; i < 16; i++){
+        if(mask & (1u << i)) indices[i] = uint8_t(maximum - indices[i]);
+    }
+}
+
+// mode 6: one subset, 7 bit rgba with p bit per endpoint and 4 bit indices
+static float EncodeBC7Mode6(const BlockTexels& texels, uint8_t* block, BlockEncodeQuality quality, bool opaque){
+    float weights[16];
+    for(uint32_t i = 0; i < 16; i++) weights[i] = Weights4[i] / 64.0f;
+
+    float endpoints[2][4];
+    FitEndpoints<4>(texels, 0xFFFF, endpoints);
+
+    BC7Subset best = {};
+    uint8_t bestIndices[16] = {};
+    float bestError = FLT_MAX;
+    for(uint32_t iteration = 0; iteration < GetRefineIterations(quality); iteration++){
+        // p bit of each endpoint picked on its own, opaque blocks need p bit 1 to keep alpha at 255
+        BC7Subset subset;
+        float expanded[2][4];
+        for(uint32_t e = 0; e < 2; e++){
+            uint32_t quantized[2][4];
+            float values[2][4];
+            float error0 = QuantizeBC7Endpoint<4>(endpoints[e], 7, true, 0, quantized[0], values[0]);
+            float error1 = QuantizeBC7Endpoint<4>(endpoints[e], 7, true, 1, quantized[1], values[1]);
+            uint32_t p = opaque || error1 < error0 ? 1 : 0;
+            memcpy(subset.endpoints[e], quantized[p], sizeof(quantized[p]));
+            memcpy(expanded[e], values[p], sizeof(values[p]));
+            subset.pBits[e] = p;
+        }
+
+        float palette[16][4];
+        BuildBC7Palette(expanded, 4, Weights4, 16, palette);
+
+        uint8_t indices[16];
+        float errors[16];
+        FindNearestEntries<4>(texels, palette, 16, indices, errors);
+        float error = SumErrors(errors, 0xFFFF);
+        if(error < bestError){
+            bestError = error;
+            best = subset;
+            memcpy(bestIndices, indices, 16);
+        }
+        if(error == 0) break;
+
+        if(!RefitEndpoints<4>(texels, 0xFFFF, indices, weights, endpoints)) break;
+    }
+
+    FixBC7Anchor(best, 0xFFFF, 0, 4, bestIndices);
+
+    BlockBitWriter writer;
+    writer.Write(1 << 6, 7);
+    for(uint32_t c = 0; c < 4; c++){
+        writer.Write(best.endpoints[0][c], 7);
+        writer.Write(best.endpoints[1][c], 7);
+    }
+    writer.Write(best.pBits[0], 1);
+    writer.Write(best.pBits[1], 1);
+    for(uint32_t i = 0; i < 16; i++) writer.Write(bestIndices[i], i == 0 ? 3 : 4);
+    writer.Store(block);
+    return bestError;
+}
+
+// refine endpoints without p bits, returns squared error of best iteration over texels in mask
+template<uint32_t ChannelCount>
+static float EncodeBC7Endpoints(const BlockTexels& texels, uint32_t bits, const uint8_t* weights, uint32_t paletteSize, uint32_t iterations,
+                                BC7Subset& best, uint8_t* bestIndices){
+    float fractions[16];
+    for(uint32_t i = 0; i < paletteSize; i++) fractions[i] = weights[i] / 64.0f;
+
+    float endpoints[2][4];
+    FitEndpoints<ChannelCount>(texels, 0xFFFF, endpoints);
+
+    float bestError = FLT_MAX;
+    for(uint32_t iteration = 0; iteration < iterations; iteration++){
+        BC7Subset subset = {};
+        float expanded[2][4];
+        QuantizeBC7Endpoint<ChannelCount>(endpoints[0], bits, false, 0, subset.endpoints[0], expanded[0]);
+        QuantizeBC7Endpoint<ChannelCount>(endpoints[1], bits, false, 0, subset.endpoints[1], expanded[1]);
+
+        float palette[16][4];
+        BuildBC7Palette(expanded, ChannelCount, weights, paletteSize, palette);
+
+        uint8_t indices[16];
+        float errors[16];
+        FindNearestEntries<ChannelCount>(texels, palette, paletteSize, indices, errors);
+        float error = SumErrors(errors, 0xFFFF);
+        if(error < bestError){
+            bestError = error;
+            best = subset;
+            memcpy(bestIndices, indices, 16);
+        }
+        if(error == 0) break;
+
+        if(!RefitEndpoints<ChannelCount>(texels, 0xFFFF, indices, fractions, endpoints)) break;
+    }
+    return bestError;
+}
+
+// mode 5: 7 bit rgb and 8 bit alpha with separate 2 bit indices, so alpha does not have to follow color
+static float EncodeBC7Mode5(const BlockTexels& texels, uint8_t* block, BlockEncodeQuality quality){
+    uint32_t iterations = GetRefineIterations(quality);
+
+    BC7Subset color, alpha;
+    uint8_t colorIndices[16], alphaIndices[16];
+    float error = EncodeBC7Endpoints<3>(texels, 7, Weights2, 4, iterations, color, colorIndices);
+
+    BlockTexels alphaTexels;
+    memcpy(alphaTexels.channels[0], texels.channels[3], sizeof(alphaTexels.channels[0]));
+    error += EncodeBC7Endpoints<1>(alphaTexels, 8, Weights2, 4, iterations, alpha, alphaIndices);
+
+    FixBC7Anchor(color, 0xFFFF, 0, 2, colorIndices);
+    FixBC7Anchor(alpha, 0xFFFF, 0, 2, alphaIndices);
+
+    BlockBitWriter writer;
+    writer.Write(1 << 5, 6);
+    // no rotation
+    writer.Write(0, 2);
+    for(uint32_t c = 0; c < 3; c++){
+        writer.Write(color.endpoints[0][c], 7);
+        writer.Write(color.endpoints[1][c], 7);
+    }
+    writer.Write(alpha.endpoints[0][0], 8);
+    writer.Write(alpha.endpoints[1][0], 8);
+    for(uint32_t i = 0; i < 16; i++) writer.Write(colorIndices[i], i == 0 ? 1 : 2);
+    for(uint32_t i = 0; i < 16; i++) writer.Write(alphaIndices[i], i == 0 ? 1 : 2);
+    writer.Store(block);
+    return error;
+}
+
+// one subset of mode 1: 6 bit rgb with a p bit shared by both endpoints and 3 bit indices
+static float EncodeBC7Mode1Subset(const BlockTexels& texels, uint32_t mask, uint32_t iterations, BC7Subset& best, uint8_t* bestIndices){
+    float weights[8];
+    for(uint32_t i = 0; i < 8; i++) weights[i] = Weights3[i] / 64.0f;
+
+    float endpoints[2][4];
+    FitEndpoints<3>(texels, mask, endpoints);
+
+    float bestError = FLT_MAX;
+    for(uint32_t iteration = 0; iteration < iterations; iteration++){
+        BC7Subset subset = {};
+        float expanded[2][4] = {};
+        float bestQuantizationError = FLT_MAX;
+        for(uint32_t p = 0; p < 2; p++){
+            uint32_t quantized[2][4];
+            float values[2][4];
+            float error = QuantizeBC7Endpoint<3>(endpoints[0], 6, true, p, quantized[0], values[0]) +
+                          QuantizeBC7Endpoint<3>(endpoints[1], 6, true, p, quantized[1], values[1]);
+            if(error < bestQuantizationError){
+                bestQuantizationError = error;
+                memcpy(subset.endpoints, quantized, sizeof(quantized));
+                memcpy(expanded, values, sizeof(values));
+                subset.pBits[0] = subset.pBits[1] = p;
+            }
+        }
+
+        float palette[8][4];
+        BuildBC7Palette(expanded, 3, Weights3, 8, palette);
+
+        uint8_t indices[16];
+        float errors[16];
+        FindNearestEntries<3>(texels, palette, 8, indices, errors);
+        float error = SumErrors(errors, mask);
+        if(error < bestError){
+            bestError = error;
+            best = subset;
+            for(uint32_t i = 0; i < 16; i++){
+                if(mask & (1u << i)) bestIndices[i] = indices[i];
+            }
+        }
+        if(error == 0) break;
+
+        if(!RefitEndpoints<3>(texels, mask, indices, weights, endpoints)) break;
+    }
+    return bestError;
+}
+
+/// sums over texels of a subset, enough to tell how well a line fits them
+struct SubsetMoments{
+    float count;
+    float sums[3];
+    /// sums of rr, rg, rb, gg, gb and bb
+    float products[6];
+};
+
+// squared distance of texels from their principal axis, trace of covariance minus its largest eigenvalue
+static float EstimateLineError(const SubsetMoments& moments){
+    if(moments.count < 2) return 0;
+
+    float mean[3] = {moments.sums[0] / moments.count, moments.sums[1] / moments.count, moments.sums[2] / moments.count};
+    float covariance[3][3];
+    const uint32_t productIndex[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+    for(uint32_t a = 0; a < 3; a++){
+        for(uint32_t b = 0; b < 3; b++) covariance[a][b] = moments.products[productIndex[a][b]] - mean[a] * moments.sums[b];
+    }
+
+    float axis[3] = {1, 1, 1};
+    for(int iteration = 0; iteration < 4; iteration++){
+        float next[3];
+        for(uint32_t a = 0; a < 3; a++) next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+        float largest = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+        if(largest == 0) return 0;
+        for(uint32_t a = 0; a < 3; a++) axis[a] = next[a] / largest;
+    }
+
+    float length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float eigenvalue = 0;
+    for(uint32_t a = 0; a < 3; a++){
+        eigenvalue += axis[a] * (covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2]);
+    }
+    float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+    return std::max(0.0f, trace - eigenvalue / length);
+}
+
+// mode 1: two subsets, partitions are ranked by how well a line fits each subset and best ones are encoded
+static float EncodeBC7Mode1(const BlockTexels& texels, uint8_t* block, BlockEncodeQuality quality){
+    uint32_t candidateCount = quality == BlockEncodeQuality::Slow ? 16 : 4;
+    uint32_t iterations = quality == BlockEncodeQuality::Slow ? 3 : 1;
+
+    // moments of every texel, subset 0 of a partition is whole block minus subset 1
+    SubsetMoments texelMoments[16], whole = {};
+    for(uint32_t i = 0; i < 16; i++){
+        float r = texels.channels[0][i], g = texels.channels[1][i], b = texels.channels[2][i];
+        texelMoments[i] = {1, {r, g, b}, {r * r, r * g, r * b, g * g, g * b, b * b}};
+        whole.count++;
+        for(uint32_t c = 0; c < 3; c++) whole.sums[c] += texelMoments[i].sums[c];
+        for(uint32_t c = 0; c < 6; c++) whole.products[c] += texelMoments[i].products[c];
+    }
+
+    std::pair<float, uint32_t> ranking[64];
+    for(uint32_t partition = 0; partition < 64; partition++){
+        SubsetMoments subsets[2] = {};
+        for(uint32_t i = 0; i < 16; i++){
+            if(!(Partitions2[partition] & (1u << i))) continue;
+            const SubsetMoments& texel = texelMoments[i];
+            subsets[1].count++;
+            for(uint32_t c = 0; c < 3; c++) subsets[1].sums[c] += texel.sums[c];
+            for(uint32_t c = 0; c < 6; c++) subsets[1].products[c] += texel.products[c];
+        }
+        subsets[0].count = whole.count - subsets[1].count;
+        for(uint32_t c = 0; c < 3; c++) subsets[0].sums[c] = whole.sums[c] - subsets[1].sums[c];
+        for(uint32_t c = 0; c < 6; c++) subsets[0].products[c] = whole.products[c] - subsets[1].products[c];
+        ranking[partition] = {EstimateLineError(subsets[0]) + EstimateLineError(subsets[1]), partition};
+    }
+    std::partial_sort(ranking, ranking + candidateCount, ranking + 64);
+
+    uint32_t bestPartition = 0;
+    BC7Subset best[2] = {};
+    uint8_t bestIndices[16] = {};
+    float bestError = FLT_MAX;
+    for(uint32_t candidate = 0; candidate < candidateCount; candidate++){
+        uint32_t partition = ranking[candidate].second;
+        uint32_t mask1 = Partitions2[partition];
+        uint32_t mask0 = ~mask1 & 0xFFFF;
+
+        BC7Subset subsets[2];
+        uint8_t indices[16];
+        float error = EncodeBC7Mode1Subset(texels, mask0, iterations, subsets[0], indices);
+        if(error >= bestError) continue;
+        error += EncodeBC7Mode1Subset(texels, mask1, iterations, subsets[1], indices);
+        if(error < bestError){
+            bestError = error;
+            bestPartition = partition;
+            best[0] = subsets[0];
+            best[1] = subsets[1];
+            memcpy(bestIndices, indices, 16);
+        }
+    }
+
+    uint32_t mask1 = Partitions2[bestPartition];
+    FixBC7Anchor(best[0], ~mask1 & 0xFFFF, 0, 3, bestIndices);
+    FixBC7Anchor(best[1], mask1, Anchors2[bestPartition], 3, bestIndices);
+
+    BlockBitWriter writer;
+    writer.Write(1 << 1, 2);
+    writer.Write(bestPartition, 6);
+    for(uint32_t c = 0; c < 3; c++){
+        for(uint32_t s = 0; s < 2; s++){
+            writer.Write(best[s].endpoints[0][c], 6);
+            writer.Write(best[s].endpoints[1][c], 6);
+        }
+    }
+    writer.Write(best[0].pBits[0], 1);
+    writer.Write(best[1].pBits[0], 1);
+    for(uint32_t i = 0; i < 16; i++){
+        bool anchor = i == 0 || i == Anchors2[bestPartition];
+        writer.Write(bestIndices[i], anchor ? 2 : 3);
+    }
+    writer.Store(block);
+    return bestError;
+}
+
+// mode 6 handles any block, opaque blocks also try mode 1 which keeps apart two colors in one block
+// and blocks with alpha try mode 5 which keeps alpha apart from color
+static void EncodeBC7Block(const BlockTexels& texels, uint8_t* block, BlockEncodeQuality quality){
+    bool opaque = true;
+    for(uint32_t i = 0; i < 16; i++){
+        if(texels.channels[3][i] != 255) opaque = false;
+    }
+
+    float error = EncodeBC7Mode6(texels, block, quality, opaque);
+    if(error == 0) return;
+    if(opaque && quality == BlockEncodeQuality::Fast) return;
+
+    // partition search rarely pays off once mode 6 error is below 4 per texel
+    if(opaque && quality == BlockEncodeQuality::Normal && error <= 16 * 4) return;
+
+    uint8_t candidate[16];
+    float candidateError = opaque ? EncodeBC7Mode1(texels, candidate, quality) : EncodeBC7Mode5(texels, candidate, quality);
+    if(candidateError < error) memcpy(block, candidate, 16);
+}
+
+void GameZero::EncodeBlock(BlockFormat format, const uint8_t* texels, uint8_t* block, BlockEncodeQuality quality){
+    BlockTexels blockTexels;
+    LoadBlockTexels(texels, blockTexels);
+
+    switch(format){
+        case BlockFormat::BC1:
+            EncodeColorBlock(blockTexels, block, quality, true);
+            break;
+        case BlockFormat::BC3:
+            EncodeAlphaBlock(texels, block);
+            EncodeColorBlock(blockTexels, block + 8, quality, false);
+            break;
+        case BlockFormat::BC7:
+            EncodeBC7Block(blockTexels, block, quality);
+            break;
+    }
+}
+
+// every thread encodes whole rows of blocks
+void GameZero::EncodeBlocks(BlockFormat format, const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* blocks,
+                            BlockEncodeQuality quality, uint32_t threadCount){
+    uint32_t blocksX = (width + BlockDimension - 1) / BlockDimension;
+    uint32_t blocksY = (height + BlockDimension - 1) / BlockDimension;
+    size_t blockSize = GetBlockSize(format);
+
+    ParallelFor(blocksY, [&](size_t by){
+        uint8_t gathered[64];
+        for(uint32_t bx = 0; bx < blocksX; bx++){
+            for(uint32_t y = 0; y < BlockDimension; y++){
+                uint32_t row = std::min(uint32_t(by) * BlockDimension + y, height - 1);
+                for(uint32_t x = 0; x < BlockDimension; x++){
+                    uint32_t column = std::min(bx * BlockDimension + x, width - 1);
+                    memcpy(gathered + (y * 4 + x) * 4, texels + (size_t(row) * width + column) * 4, 4);
+                }
+            }
+            EncodeBlock(format, gathered, blocks + (by * blocksX + bx) * blockSize, quality);
+        }
+    }, threadCount);
+}
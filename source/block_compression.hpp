@@ -0,0 +1,103 @@
+/**
+ * @file block_compression.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief BC1, BC3 and BC7 block compressed texel data, decoding and encoding
+ * @version 0.1
+ * @date 2021-07-03
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_BLOCK_COMPRESSION_HPP
+#define GAMEZERO_BLOCK_COMPRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GameZero{
+
+    /// block compressed formats, every block holds 4x4 texels
+    enum class BlockFormat{
+        /// rgb with 1 bit alpha, 8 bytes per block
+        BC1,
+        /// BC1 color with interpolated 8 bit alpha, 16 bytes per block
+        BC3,
+        /// rgba with 8 modes of varying precision and partitions, 16 bytes per block
+        BC7
+    };
+
+    /// width and height of a block in texels
+    constexpr static uint32_t BlockDimension = 4;
+
+    /// bytes per block of a format
+    constexpr size_t GetBlockSize(BlockFormat format){
+        return format == BlockFormat::BC1 ? 8 : 16;
+    }
+
+    /// bytes of a width x height image in given format, partial blocks at edges count as whole blocks
+    constexpr size_t GetBlockCompressedSize(BlockFormat format, uint32_t width, uint32_t height){
+        return size_t((width + BlockDimension - 1) / BlockDimension) * ((height + BlockDimension - 1) / BlockDimension) * GetBlockSize(format);
+    }
+
+    /**
+     * @brief Decode one block to 16 rgba texels in row major order.
+     *        Reserved BC7 modes decode to transparent black, like on gpu.
+     *
+     * @param format : format of block
+     * @param block : GetBlockSize(format) bytes
+     * @param texels : receives 4x4 texels, 4 bytes each
+     */
+    void DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* texels);
+
+    /**
+     * @brief Decode a whole image to tightly packed 8 bit rgba texels,
+     *        used where gpu cannot sample a block compressed format.
+     *
+     * @param format : format of blocks
+     * @param blocks : GetBlockCompressedSize(format, width, height) bytes, blocks in row major order
+     * @param width : image width in texels
+     * @param height : image height in texels
+     * @param texels : receives width * height * 4 bytes
+     */
+    void DecodeBlocks(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* texels);
+
+    /// how hard encoder searches for endpoints, slower settings try more modes and refine more
+    enum class BlockEncodeQuality{
+        /// BC7 mode 6, and mode 5 for blocks with alpha, one endpoint refinement
+        Fast,
+        /// also tries BC7 mode 1 on 4 best partitions of opaque blocks
+        Normal,
+        /// BC7 mode 1 on 16 best partitions and more refinement
+        Slow
+    };
+
+    /**
+     * @brief Encode 16 rgba texels in row major order to one block.
+     *        BC1 uses its 3 color mode with transparent texels for blocks with alpha below 128.
+     *
+     * @param format : format of block
+     * @param texels : 4x4 texels, 4 bytes each
+     * @param block : receives GetBlockSize(format) bytes
+     * @param quality : speed and quality trade off
+     */
+    void EncodeBlock(BlockFormat format, const uint8_t* texels, uint8_t* block, BlockEncodeQuality quality);
+
+    /**
+     * @brief Encode tightly packed 8 bit rgba texels to blocks using multiple threads.
+     *        Texels of partial blocks at edges are repeated from last row and column.
+     *
+     * @param format : format of blocks
+     * @param texels : width * height * 4 bytes
+     * @param width : image width in texels
+     * @param height : image height in texels
+     * @param blocks : receives GetBlockCompressedSize(format, width, height) bytes, blocks in row major order
+     * @param quality : speed and quality trade off
+     * @param threadCount : number of threads to use, 0 means one per core
+     */
+    void EncodeBlocks(BlockFormat format, const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* blocks,
+                      BlockEncodeQuality quality, uint32_t threadCount = 0);
+
+}
+
+#endif//GAMEZERO_BLOCK_COMPRESSION_HPP
@@ -0,0 +1,120 @@
+#include "dynamic_mesh.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace GameZero;
+
+// edits arrive in any order, sort once per upload instead of on every edit
+void GameZero::DirtyRanges::Coalesce(){
+    if(coalesced) return;
+    coalesced = true;
+
+    std::sort(ranges.begin(), ranges.end(), [](const DirtyRange& a, const DirtyRange& b){
+        return a.first < b.first;
+    });
+
+    // merge in place, 64 bit ends so that ranges near the top do not wrap
+    size_t count = 0;
+    for(const DirtyRange& range : ranges){
+        if(count > 0){
+            DirtyRange& last = ranges[count - 1];
+            uint64_t lastEnd = uint64_t(last.first) + last.count;
+            if(uint64_t(range.first) <= lastEnd){
+                uint64_t end = std::max(lastEnd, uint64_t(range.first) + range.count);
+                last.count = uint32_t(end - last.first);
+                continue;
+            }
+        }
+        ranges[count++] = range;
+    }
+    ranges.resize(count);
+}
+
+// position stream is aligned the same way as in geometry buffers
+void GameZero::DynamicMesh::SetCapacity(uint32_t vertexCapacity, uint32_t indexCapacity){
+    vertices.assign(vertexCapacity, Vertex{});
+    indices.assign(indexCapacity, 0);
+    indexCount = 0;
+    attributeOffset = (size_t(vertexCapacity) * sizeof(glm::vec3) + 15) & ~size_t(15);
+
+    for(DynamicMeshFrame& frame : frames){
+        frame.dirtyVertices.Clear();
+        frame.dirtyIndices.Clear();
+        frame.dirtyVertices.Add(0, vertexCapacity);
+        frame.dirtyIndices.Add(0, indexCapacity);
+        frame.indexCount = 0;
+    }
+}
+
+bool GameZero::DynamicMesh::SetVertices(uint32_t first, const Vertex* source, uint32_t count){
+    Vertex* destination = EditVertices(first, count);
+    if(!destination) return false;
+    memcpy(destination, source, count * sizeof(Vertex));
+    return true;
+}
+
+bool GameZero::DynamicMesh::SetIndices(uint32_t first, const uint32_t* source, uint32_t count){
+    uint32_t* destination = EditIndices(first, count);
+    if(!destination) return false;
+    memcpy(destination, source, count * sizeof(uint32_t));
+    return true;
+}
+
+// every copy has to receive the edit, each when its own frame comes around
+Vertex* GameZero::DynamicMesh::EditVertices(uint32_t first, uint32_t count){
+    if(uint64_t(first) + count > vertices.size()) return nullptr;
+    for(DynamicMeshFrame& frame : frames){
+        frame.dirtyVertices.Add(first, count);
+    }
+    return vertices.data() + first;
+}
+
+uint32_t* GameZero::DynamicMesh::EditIndices(uint32_t first, uint32_t count){
+    if(uint64_t(first) + count > indices.size()) return nullptr;
+    for(DynamicMeshFrame& frame : frames){
+        frame.dirtyIndices.Add(first, count);
+    }
+    return indices.data() + first;
+}
+
+bool GameZero::DynamicMesh::SetIndexCount(uint32_t count){
+    if(count > indices.size()) return false;
+    indexCount = count;
+    return true;
+}
+
+// vertices are split into position and attribute streams while being copied, like Mesh::BuildVertexStreams
+DynamicMeshUpload GameZero::DynamicMesh::WriteFrame(size_t frameIndex){
+    DynamicMeshUpload upload;
+    DynamicMeshFrame& frame = frames[frameIndex];
+
+    frame.dirtyVertices.Coalesce();
+    if(frame.vertexData){
+        glm::vec3* positions = reinterpret_cast<glm::vec3*>(frame.vertexData);
+        VertexAttributes* attributes = reinterpret_cast<VertexAttributes*>(frame.vertexData + attributeOffset);
+        for(const DirtyRange& range : frame.dirtyVertices.GetRanges()){
+            const Vertex* source = vertices.data() + range.first;
+            for(uint32_t v = 0; v < range.count; v++){
+                positions[range.first + v] = source[v].position;
+                attributes[range.first + v] = {source[v].normal, source[v].color, source[v].uv};
+            }
+            upload.bytes += uint64_t(range.count) * (sizeof(glm::vec3) + sizeof(VertexAttributes));
+        }
+        upload.vertexRanges = uint32_t(frame.dirtyVertices.GetRanges().size());
+        frame.dirtyVertices.Clear();
+    }
+
+    frame.dirtyIndices.Coalesce();
+    if(frame.indexData){
+        for(const DirtyRange& range : frame.dirtyIndices.GetRanges()){
+            memcpy(frame.indexData + range.first, indices.data() + range.first, range.count * sizeof(uint32_t));
+            upload.bytes += uint64_t(range.count) * sizeof(uint32_t);
+        }
+        upload.indexRanges = uint32_t(frame.dirtyIndices.GetRanges().size());
+        frame.dirtyIndices.Clear();
+    }
+
+    frame.indexCount = indexCount;
+    return upload;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file dynamic_mesh.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief mesh that can be edited every frame, uploading only what changed
+ * @version 0.1
+ * @date 2021-06-30
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_DYNAMIC_MESH_HPP
+#define GAMEZERO_DYNAMIC_MESH_HPP
+
+#include <cstdint>
+#include <vector>
+#include "settings.hpp"
+#include "mesh.hpp"
+
+namespace GameZero{
+
+    /// range of elements [first, first + count)
+    struct DirtyRange{
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    /**
+     * @brief Ranges of elements changed since they were last uploaded.
+     *        Ranges are only appended while editing, sorting and merging
+     *        them is left to Coalesce so that edits stay cheap.
+     */
+    class DirtyRanges{
+    public:
+        /// mark count elements starting at first as changed
+        void Add(uint32_t first, uint32_t count){
+            if(count == 0) return;
+            ranges.push_back({first, count});
+            coalesced = false;
+        }
+
+        /// sort ranges and merge overlapping and touching ones
+        void Coalesce();
+
+        /// forget all ranges
+        void Clear(){
+            ranges.clear();
+            coalesced = true;
+        }
+
+        bool IsEmpty() const{ return ranges.empty(); }
+
+        /// changed ranges, sorted and disjoint after Coalesce
+        const std::vector<DirtyRange>& GetRanges() const{ return ranges; }
+
+    private:
+        std::vector<DirtyRange> ranges;
+        bool coalesced = true;
+    };
+
+    /// gpu copy of a dynamic mesh used by one frame in flight
+    struct DynamicMeshFrame{
+        /// host visible, position stream followed by attribute stream at DynamicMesh::GetAttributeOffset
+        AllocatedBuffer vertexBuffer;
+        AllocatedBuffer indexBuffer;
+
+        /// persistently mapped contents of buffers
+        uint8_t* vertexData = nullptr;
+        uint32_t* indexData = nullptr;
+
+        /// ranges changed since this copy was last written
+        DirtyRanges dirtyVertices;
+        DirtyRanges dirtyIndices;
+
+        /// indices drawn from this copy
+        uint32_t indexCount = 0;
+    };
+
+    /// what DynamicMesh::WriteFrame copied
+    struct DynamicMeshUpload{
+        uint32_t vertexRanges = 0;
+        uint32_t indexRanges = 0;
+        uint64_t bytes = 0;
+    };
+
+    /**
+     * @brief Mesh whose vertices and indices can change every frame, for procedural edits.
+     *        Unlike Mesh, it is not part of a geometry buffer. Each frame in flight has
+     *        its own host visible copy, so a frame writes its copy once its render fence
+     *        is signalled and never waits for the gpu or submits a transfer.
+     *        Edits are tracked as dirty ranges per copy and only those ranges are written.
+     *        Vertices are in VertexFormat::Standard layout, capacity is fixed at creation,
+     *        see Renderer::CreateDynamicMesh. Dynamic meshes are not culled.
+     */
+    class DynamicMesh{
+    public:
+        /// placement of mesh in world
+        glm::mat4 transform = glm::mat4(1.f);
+
+        /// material drawn with, its pipeline must take standard vertices
+        Material* material = nullptr;
+
+        /// one gpu copy per frame in flight, created by renderer
+        DynamicMeshFrame frames[FrameOverlapCount];
+
+        /// set number of vertices and indices mesh can hold, contents are cleared and no indices are drawn
+        void SetCapacity(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+        /// replace count vertices starting at first, false if they do not fit in capacity
+        bool SetVertices(uint32_t first, const Vertex* source, uint32_t count);
+
+        /// replace count indices starting at first, false if they do not fit in capacity
+        bool SetIndices(uint32_t first, const uint32_t* source, uint32_t count);
+
+        /// vertices to edit in place, marked changed, nullptr if they do not fit in capacity
+        Vertex* EditVertices(uint32_t first, uint32_t count);
+
+        /// indices to edit in place, marked changed, nullptr if they do not fit in capacity
+        uint32_t* EditIndices(uint32_t first, uint32_t count);
+
+        /// set number of indices drawn, false if more than capacity
+        bool SetIndexCount(uint32_t count);
+
+        /**
+         * @brief Write ranges changed since copy of given frame was last written
+         *        to its mapped buffers, then forget them.
+         *
+         * @param frame : frame copy, in [0, FrameOverlapCount)
+         * @return DynamicMeshUpload : number of copies and bytes written
+         */
+        DynamicMeshUpload WriteFrame(size_t frame);
+
+        const Vertex* GetVertexData() const{ return vertices.data(); }
+        const uint32_t* GetIndexData() const{ return indices.data(); }
+
+        uint32_t GetVertexCapacity() const{ return uint32_t(vertices.size()); }
+        uint32_t GetIndexCapacity() const{ return uint32_t(indices.size()); }
+
+        /// number of indices drawn
+        uint32_t GetIndexCount() const{ return indexCount; }
+
+        /// byte offset of attribute stream in vertex buffer of a frame copy
+        size_t GetAttributeOffset() const{ return attributeOffset; }
+
+        /// bytes needed by vertex buffer of a frame copy
+        size_t GetVertexBufferSize() const{ return attributeOffset + vertices.size() * sizeof(VertexAttributes); }
+
+        /// bytes needed by index buffer of a frame copy
+        size_t GetIndexBufferSize() const{ return indices.size() * sizeof(uint32_t); }
+
+    private:
+        /// latest contents, copies catch up with them when written
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        uint32_t indexCount = 0;
+        size_t attributeOffset = 0;
+    };
+
+}
+
+#endif//GAMEZERO_DYNAMIC_MESH_HPP
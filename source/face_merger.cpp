@@ -0,0 +1,412 @@
+#include "face_merger.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+using namespace GameZero;
+
+/// stride between tiles in tiled texture coordinates, twice the largest merged quad
+constexpr static float TileStride = float(MaxMergedQuadTiles * 4);
+
+/// how far a corner may be from a tile corner and still count as on it, in tile units
+/// exporters often inset texture coordinates a little to avoid bleeding between tiles
+constexpr static float TileCornerTolerance = 0.05f;
+
+/// an axis aligned quad made of two triangles, with everything needed to merge it
+struct FaceQuad{
+    // merge key : only quads equal in all of these can be merged
+    uint32_t submesh;
+    /// axis of plane normal and side triangles face
+    uint32_t axis;
+    int32_t side;
+    float plane;
+    /// quad size along plane axes a and b
+    float cellA, cellB;
+    /// atlas tile
+    int32_t tileU, tileV;
+    /// position inside tile at quad corner (a0, b0) and its change per cell along a and b
+    int32_t cornerU, cornerV;
+    int32_t uPerA, vPerA, uPerB, vPerB;
+    /// attributes that are not derived from position
+    glm::vec3 normal, color;
+
+    /// cell of quad on its plane grid
+    int32_t cellIndexA, cellIndexB;
+
+    auto Key() const{
+        return std::tie(submesh, axis, side, plane, cellA, cellB, tileU, tileV, cornerU, cornerV, uPerA, vPerA, uPerB, vPerB);
+    }
+};
+
+// rounded value if it is close enough to an integer
+static bool RoundToInteger(float value, float tolerance, int32_t& rounded){
+    rounded = static_cast<int32_t>(std::lround(value));
+    return std::fabs(value - float(rounded)) <= tolerance;
+}
+
+// most common value of a list, used to find atlas tile size from face sizes
+static float MostCommonValue(std::vector<float>& values){
+    std::sort(values.begin(), values.end());
+
+    float best = 0.f;
+    size_t bestCount = 0;
+    for(size_t i = 0; i < values.size();){
+        size_t j = i;
+        while(j < values.size() && values[j] - values[i] <= 1e-5f) j++;
+        if(j - i > bestCount){
+            bestCount = j - i;
+            best = values[(i + j) / 2];
+        }
+        i = j;
+    }
+    return best;
+}
+
+// tile size is taken from the most common face size, atlas must hold a whole number of tiles
+static bool FindAtlasGrid(const Vertex* vertices, const uint32_t* indices, size_t indexCount, uint32_t& tilesU, uint32_t& tilesV){
+    std::vector<float> sizesU, sizesV;
+    sizesU.reserve(indexCount / 3);
+    sizesV.reserve(indexCount / 3);
+
+    for(size_t i = 0; i < indexCount; i += 3){
+        glm::vec2 minimum = vertices[indices[i]].uv, maximum = minimum;
+        for(size_t c = 1; c < 3; c++){
+            minimum = glm::min(minimum, vertices[indices[i + c]].uv);
+            maximum = glm::max(maximum, vertices[indices[i + c]].uv);
+        }
+        if(maximum.x > minimum.x) sizesU.push_back(maximum.x - minimum.x);
+        if(maximum.y > minimum.y) sizesV.push_back(maximum.y - minimum.y);
+    }
+    if(sizesU.empty() || sizesV.empty()) return false;
+
+    // inset coordinates make faces slightly smaller than a tile, rounding count of tiles absorbs that
+    float sizeU = MostCommonValue(sizesU), sizeV = MostCommonValue(sizesV);
+    int32_t countU, countV;
+    if(!RoundToInteger(1.f / sizeU, 0.15f * (1.f / sizeU), countU) || !RoundToInteger(1.f / sizeV, 0.15f * (1.f / sizeV), countV)) return false;
+    if(countU < 1 || countV < 1) return false;
+
+    tilesU = uint32_t(countU);
+    tilesV = uint32_t(countV);
+    return true;
+}
+
+// tile of a triangle from its center, corners on tile borders belong to either side
+static glm::ivec2 GetTriangleTile(const Vertex* vertices, const uint32_t* triangle, const glm::vec2& tileCount){
+    glm::vec2 center = (vertices[triangle[0]].uv + vertices[triangle[1]].uv + vertices[triangle[2]].uv) * (tileCount / 3.f);
+    return glm::ivec2(int32_t(std::floor(center.x)), int32_t(std::floor(center.y)));
+}
+
+// describe a pair of triangles as an axis aligned quad with a tile mapped corner to corner, false if they are not one
+static bool MakeFaceQuad(const Vertex* vertices, const uint32_t* first, const uint32_t* second, const glm::vec2& tileCount, FaceQuad& quad){
+    const Vertex* corners[6];
+    for(int c = 0; c < 3; c++){
+        corners[c] = &vertices[first[c]];
+        corners[3 + c] = &vertices[second[c]];
+    }
+
+    glm::ivec2 tile = GetTriangleTile(vertices, first, tileCount);
+    if(tile != GetTriangleTile(vertices, second, tileCount)) return false;
+
+    uint32_t a = (quad.axis + 1) % 3, b = (quad.axis + 2) % 3;
+    glm::vec3 minimum = corners[0]->position, maximum = minimum;
+    for(const Vertex* corner : corners){
+        minimum = glm::min(minimum, corner->position);
+        maximum = glm::max(maximum, corner->position);
+    }
+    quad.cellA = maximum[a] - minimum[a];
+    quad.cellB = maximum[b] - minimum[b];
+
+    // quad must sit on a grid of its own size, like blocks do
+    if(!RoundToInteger(minimum[a] / quad.cellA, 1e-3f, quad.cellIndexA) || !RoundToInteger(minimum[b] / quad.cellB, 1e-3f, quad.cellIndexB)) return false;
+
+    // position inside tile at each corner, rounded to tile corners
+    int32_t local[2][2][2];
+    bool seen[2][2] = {};
+    for(const Vertex* corner : corners){
+        int32_t i = corner->position[a] > minimum[a] ? 1 : 0;
+        int32_t j = corner->position[b] > minimum[b] ? 1 : 0;
+
+        int32_t u, v;
+        glm::vec2 inside = corner->uv * tileCount - glm::vec2(tile);
+        if(!RoundToInteger(inside.x, TileCornerTolerance, u) || !RoundToInteger(inside.y, TileCornerTolerance, v)) return false;
+        if(u < 0 || u > 1 || v < 0 || v > 1) return false;
+
+        // same corner used by both triangles must agree
+        if(seen[i][j] && (local[i][j][0] != u || local[i][j][1] != v)) return false;
+        local[i][j][0] = u;
+        local[i][j][1] = v;
+        seen[i][j] = true;
+    }
+    if(!seen[0][0] || !seen[0][1] || !seen[1][0] || !seen[1][1]) return false;
+
+    // mapping must be affine : one step along a or b is one step along u or v
+    quad.cornerU = local[0][0][0];
+    quad.cornerV = local[0][0][1];
+    quad.uPerA = local[1][0][0] - quad.cornerU;
+    quad.vPerA = local[1][0][1] - quad.cornerV;
+    quad.uPerB = local[0][1][0] - quad.cornerU;
+    quad.vPerB = local[0][1][1] - quad.cornerV;
+    if(local[1][1][0] != quad.cornerU + quad.uPerA + quad.uPerB || local[1][1][1] != quad.cornerV + quad.vPerA + quad.vPerB) return false;
+    if(std::abs(quad.uPerA) + std::abs(quad.vPerA) != 1 || std::abs(quad.uPerB) + std::abs(quad.vPerB) != 1) return false;
+
+    quad.tileU = tile.x;
+    quad.tileV = tile.y;
+    quad.normal = corners[0]->normal;
+    quad.color = corners[0]->color;
+    return true;
+}
+
+// axis a triangle lies flat on, false if it is not axis aligned
+static bool GetFlatAxis(const Vertex* vertices, const uint32_t* triangle, uint32_t& axis, int32_t& side){
+    const glm::vec3& p0 = vertices[triangle[0]].position;
+    const glm::vec3& p1 = vertices[triangle[1]].position;
+    const glm::vec3& p2 = vertices[triangle[2]].position;
+
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    for(axis = 0; axis < 3; axis++){
+        if(p0[axis] == p1[axis] && p0[axis] == p2[axis] && normal[axis] != 0.f){
+            side = normal[axis] > 0.f ? 1 : -1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// rectangle of a flat triangle on its plane, two triangles of a quad share it
+struct RectangleKey{
+    uint32_t submesh, axis;
+    int32_t side;
+    float plane;
+    float minA, minB, maxA, maxB;
+
+    bool operator==(const RectangleKey& other) const{
+        return std::tie(submesh, axis, side, plane, minA, minB, maxA, maxB) == std::tie(other.submesh, other.axis, other.side, other.plane, other.minA, other.minB, other.maxA, other.maxB);
+    }
+};
+
+struct RectangleKeyHash{
+    size_t operator()(const RectangleKey& key) const{
+        size_t seed = std::hash<uint32_t>()(key.submesh * 6 + key.axis * 2 + (key.side > 0));
+        for(float value : {key.plane, key.minA, key.minB, key.maxA, key.maxB}){
+            seed ^= std::hash<float>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+// tiled coordinate of a point inside a tile
+static glm::vec2 ToTiledUv(int32_t tileU, int32_t tileV, const glm::vec2& inside){
+    return glm::vec2(float(tileU) * TileStride + inside.x, float(tileV) * TileStride + inside.y);
+}
+
+// extend run of cells first along a, then along b while whole rows are free
+static void MergeQuadGroup(const FaceQuad* quads, size_t count, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::unordered_map<Vertex, uint32_t>& uniqueVertices, uint32_t& mergedCount){
+    std::unordered_map<uint64_t, uint32_t> cells;
+    cells.reserve(count);
+    auto CellKey = [](int32_t i, int32_t j){ return (uint64_t(uint32_t(i)) << 32) | uint32_t(j); };
+    for(size_t q = 0; q < count; q++){
+        cells.emplace(CellKey(quads[q].cellIndexA, quads[q].cellIndexB), uint32_t(q));
+    }
+
+    std::vector<bool> used(count, false);
+    auto IsFree = [&](int32_t i, int32_t j){
+        auto it = cells.find(CellKey(i, j));
+        return it != cells.end() && !used[it->second];
+    };
+
+    // quads are sorted along b then a, so runs start at their lowest corner
+    for(size_t q = 0; q < count; q++){
+        if(used[q]) continue;
+        const FaceQuad& quad = quads[q];
+        int32_t i0 = quad.cellIndexA, j0 = quad.cellIndexB;
+
+        int32_t width = 1;
+        while(width < int32_t(MaxMergedQuadTiles) && IsFree(i0 + width, j0)) width++;
+
+        int32_t height = 1;
+        for(; height < int32_t(MaxMergedQuadTiles); height++){
+            bool rowFree = true;
+            for(int32_t i = 0; i < width && rowFree; i++) rowFree = IsFree(i0 + i, j0 + height);
+            if(!rowFree) break;
+        }
+
+        for(int32_t j = 0; j < height; j++){
+            for(int32_t i = 0; i < width; i++) used[cells[CellKey(i0 + i, j0 + j)]] = true;
+        }
+        mergedCount++;
+
+        // corners of merged quad, positions inside tile shifted by whole tiles so none is negative
+        uint32_t a = (quad.axis + 1) % 3, b = (quad.axis + 2) % 3;
+        glm::vec2 inside[4];
+        glm::vec3 positions[4];
+        const int32_t steps[4][2] = {{0, 0}, {width, 0}, {width, height}, {0, height}};
+        glm::vec2 lowest(0.f);
+        for(int c = 0; c < 4; c++){
+            int32_t si = steps[c][0], sj = steps[c][1];
+            inside[c] = glm::vec2(float(quad.cornerU + quad.uPerA * si + quad.uPerB * sj), float(quad.cornerV + quad.vPerA * si + quad.vPerB * sj));
+            lowest = glm::min(lowest, inside[c]);
+
+            positions[c][quad.axis] = quad.plane;
+            positions[c][a] = float(i0 + si) * quad.cellA;
+            positions[c][b] = float(j0 + sj) * quad.cellB;
+        }
+
+        uint32_t quadIndices[4];
+        for(int c = 0; c < 4; c++){
+            Vertex vertex;
+            vertex.position = positions[c];
+            vertex.normal = quad.normal;
+            vertex.color = quad.color;
+            vertex.uv = ToTiledUv(quad.tileU, quad.tileV, inside[c] - lowest);
+
+            auto it = uniqueVertices.find(vertex);
+            if(it == uniqueVertices.end()){
+                it = uniqueVertices.emplace(vertex, uint32_t(vertices.size())).first;
+                vertices.push_back(vertex);
+            }
+            quadIndices[c] = it->second;
+        }
+
+        // corners go counter clockwise around +axis, flip them for faces looking down it
+        const int order[2][6] = {{0, 1, 2, 0, 2, 3}, {0, 2, 1, 0, 3, 2}};
+        const int* triangleOrder = order[quad.side > 0 ? 0 : 1];
+        for(int c = 0; c < 6; c++) indices.push_back(quadIndices[triangleOrder[c]]);
+    }
+}
+
+// pair triangles into quads, merge quads per group and rebuild mesh with tiled coordinates
+FaceMergeStatistics GameZero::MergeCoplanarFaces(Mesh& mesh){
+    auto start = std::chrono::high_resolution_clock::now();
+
+    FaceMergeStatistics statistics;
+    mesh.EnsureSubmeshes();
+    statistics.trianglesBefore = statistics.trianglesAfter = uint32_t(mesh.indices.size() / 3);
+    statistics.verticesBefore = statistics.verticesAfter = uint32_t(mesh.vertices.size());
+
+    const Vertex* vertices = mesh.vertices.data();
+    const uint32_t* indices = mesh.indices.data();
+    if(mesh.indices.empty() || mesh.uvTiling.IsEnabled()) return statistics;
+
+    uint32_t tilesU, tilesV;
+    if(!FindAtlasGrid(vertices, indices, mesh.indices.size(), tilesU, tilesV)) return statistics;
+    glm::vec2 tileCount = glm::vec2(float(tilesU), float(tilesV));
+
+    // every triangle must stay inside its tile, or wrapping inside tiles would change how it looks
+    size_t triangleCount = mesh.indices.size() / 3;
+    for(size_t t = 0; t < triangleCount; t++){
+        glm::ivec2 tile = GetTriangleTile(vertices, &indices[3 * t], tileCount);
+        for(int c = 0; c < 3; c++){
+            glm::vec2 inside = vertices[indices[3 * t + c]].uv * tileCount - glm::vec2(tile);
+            if(inside.x < -TileCornerTolerance || inside.x > 1.f + TileCornerTolerance || inside.y < -TileCornerTolerance || inside.y > 1.f + TileCornerTolerance) return statistics;
+        }
+        if(tile.x < 0 || tile.y < 0 || tile.x >= int32_t(tilesU) || tile.y >= int32_t(tilesV)) return statistics;
+    }
+
+    std::vector<Vertex> mergedVertices;
+    std::vector<uint32_t> mergedIndices;
+    std::unordered_map<Vertex, uint32_t> uniqueVertices;
+    mergedVertices.reserve(mesh.vertices.size());
+    mergedIndices.reserve(mesh.indices.size());
+    uniqueVertices.reserve(mesh.vertices.size());
+
+    std::vector<FaceQuad> quads;
+    std::vector<bool> paired(triangleCount, false);
+    std::unordered_map<RectangleKey, uint32_t, RectangleKeyHash> openRectangles;
+
+    for(uint32_t s = 0; s < mesh.submeshes.size(); s++){
+        Submesh& submesh = mesh.submeshes[s];
+        uint32_t firstTriangle = submesh.lods[0].firstIndex / 3;
+        uint32_t lastTriangle = firstTriangle + submesh.lods[0].indexCount / 3;
+
+        // two triangles of a block face cover the same rectangle
+        quads.clear();
+        openRectangles.clear();
+        for(uint32_t t = firstTriangle; t < lastTriangle; t++){
+            uint32_t axis;
+            int32_t side;
+            if(!GetFlatAxis(vertices, &indices[3 * t], axis, side)) continue;
+
+            uint32_t a = (axis + 1) % 3, b = (axis + 2) % 3;
+            RectangleKey key = {s, axis, side, vertices[indices[3 * t]].position[axis], INFINITY, INFINITY, -INFINITY, -INFINITY};
+            for(int c = 0; c < 3; c++){
+                const glm::vec3& position = vertices[indices[3 * t + c]].position;
+                key.minA = std::min(key.minA, position[a]);
+                key.minB = std::min(key.minB, position[b]);
+                key.maxA = std::max(key.maxA, position[a]);
+                key.maxB = std::max(key.maxB, position[b]);
+            }
+
+            auto it = openRectangles.find(key);
+            if(it == openRectangles.end()){
+                openRectangles.emplace(key, t);
+                continue;
+            }
+
+            FaceQuad quad = {};
+            quad.submesh = s;
+            quad.axis = axis;
+            quad.side = side;
+            quad.plane = key.plane;
+            if(MakeFaceQuad(vertices, &indices[3 * it->second], &indices[3 * t], tileCount, quad)){
+                paired[it->second] = paired[t] = true;
+                quads.push_back(quad);
+            }
+            openRectangles.erase(it);
+        }
+
+        uint32_t firstIndex = uint32_t(mergedIndices.size());
+
+        // triangles that are not part of a quad are kept, only their coordinates become tiled
+        for(uint32_t t = firstTriangle; t < lastTriangle; t++){
+            if(paired[t]) continue;
+
+            glm::ivec2 tile = GetTriangleTile(vertices, &indices[3 * t], tileCount);
+            for(int c = 0; c < 3; c++){
+                Vertex vertex = vertices[indices[3 * t + c]];
+                vertex.uv = ToTiledUv(tile.x, tile.y, glm::clamp(vertex.uv * tileCount - glm::vec2(tile), 0.f, 1.f));
+
+                auto it = uniqueVertices.find(vertex);
+                if(it == uniqueVertices.end()){
+                    it = uniqueVertices.emplace(vertex, uint32_t(mergedVertices.size())).first;
+                    mergedVertices.push_back(vertex);
+                }
+                mergedIndices.push_back(it->second);
+            }
+        }
+
+        // group mergeable quads, rows of cells in each group run along a
+        std::sort(quads.begin(), quads.end(), [](const FaceQuad& x, const FaceQuad& y){
+            return std::tuple_cat(x.Key(), std::tie(x.cellIndexB, x.cellIndexA)) < std::tuple_cat(y.Key(), std::tie(y.cellIndexB, y.cellIndexA));
+        });
+
+        statistics.quadsBefore += uint32_t(quads.size());
+        for(size_t q = 0; q < quads.size();){
+            size_t end = q + 1;
+            while(end < quads.size() && quads[end].Key() == quads[q].Key()) end++;
+            MergeQuadGroup(&quads[q], end - q, mergedVertices, mergedIndices, uniqueVertices, statistics.quadsAfter);
+            q = end;
+        }
+
+        submesh.lods[0].firstIndex = firstIndex;
+        submesh.lods[0].indexCount = uint32_t(mergedIndices.size()) - firstIndex;
+    }
+
+    mesh.vertices = std::move(mergedVertices);
+    mesh.indices = std::move(mergedIndices);
+    mesh.uvTiling.tileSize = glm::vec2(1.f) / tileCount;
+    mesh.uvTiling.stride = TileStride;
+
+    statistics.trianglesAfter = uint32_t(mesh.indices.size() / 3);
+    statistics.verticesAfter = uint32_t(mesh.vertices.size());
+    statistics.tilesU = tilesU;
+    statistics.tilesV = tilesV;
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    statistics.time = std::chrono::duration<float, std::milli>(stop - start).count();
+    return statistics;
+}
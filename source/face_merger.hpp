@@ -0,0 +1,65 @@
+/**
+ * @file face_merger.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief merges coplanar block faces of voxel style meshes into larger quads
+ * @version 0.1
+ * @date 2021-06-29
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_FACE_MERGER_HPP
+#define GAMEZERO_FACE_MERGER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GameZero{
+
+    class Mesh;
+
+    /// tiles of an atlas a merged quad may repeat along each side, must stay below half of UvTiling stride
+    constexpr static uint32_t MaxMergedQuadTiles = 64;
+
+    /// result of MergeCoplanarFaces
+    struct FaceMergeStatistics{
+        uint32_t trianglesBefore = 0;
+        uint32_t trianglesAfter = 0;
+        uint32_t verticesBefore = 0;
+        uint32_t verticesAfter = 0;
+        /// axis aligned quads that were candidates for merging
+        uint32_t quadsBefore = 0;
+        /// quads they were merged into
+        uint32_t quadsAfter = 0;
+        /// atlas tiles per axis that texture coordinates were found to use, 0 when mesh was left alone
+        uint32_t tilesU = 0;
+        uint32_t tilesV = 0;
+        /// time taken in milliseconds
+        float time = 0.f;
+    };
+
+    /**
+     * @brief Greedily merge axis aligned coplanar quads showing same atlas tile into larger quads.
+     *        Meant for voxel maps exported as one quad per block face.
+     *
+     *        Texture coordinates must follow a regular atlas grid, every triangle
+     *        staying inside one tile. Mesh is then switched to tiled texture
+     *        coordinates (see UvTiling), where a merged quad repeats its tile once
+     *        per block it covers, like repeat addressing would on a texture of its own.
+     *        Meshes without such a grid are left unchanged.
+     *
+     *        Must run before OptimizeMesh, BuildMeshlets and BuildMeshLods as it
+     *        rebuilds vertices, indices and submesh ranges. Merged meshes need
+     *        float texture coordinates, so they stay in VertexFormat::Standard.
+     *        Merged quads leave T junctions with neighbours, which can show as
+     *        single pixel cracks.
+     *
+     * @param mesh : mesh with owned vertices and indices, one submesh per material
+     * @return FaceMergeStatistics : triangle and vertex counts before and after
+     */
+    FaceMergeStatistics MergeCoplanarFaces(Mesh& mesh);
+
+}
+
+#endif//GAMEZERO_FACE_MERGER_HPP
@@ -0,0 +1,77 @@
+#include "geometry_buffer.hpp"
+
+#include <algorithm>
+
+// whole range is one free block
+void GameZero::RangeAllocator::Reset(uint64_t newCapacity){
+    freeRanges.clear();
+    capacity = newCapacity;
+    used = 0;
+    if(capacity > 0) freeRanges[0] = capacity;
+}
+
+// new space is freed like any other range so it merges with a free tail
+void GameZero::RangeAllocator::Grow(uint64_t newCapacity){
+    if(newCapacity <= capacity) return;
+
+    uint64_t oldCapacity = capacity;
+    capacity = newCapacity;
+
+    // Free counts the range as used before
+    used += newCapacity - oldCapacity;
+    Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+// first fit, remainder of the chosen range stays free
+bool GameZero::RangeAllocator::Allocate(uint64_t size, uint64_t& offset){
+    if(size == 0) return false;
+
+    for(auto it = freeRanges.begin(); it != freeRanges.end(); ++it){
+        if(it->second < size) continue;
+
+        offset = it->first;
+        uint64_t remaining = it->second - size;
+        freeRanges.erase(it);
+        if(remaining > 0) freeRanges[offset + size] = remaining;
+
+        used += size;
+        return true;
+    }
+
+    return false;
+}
+
+// merge with free neighbours on both sides
+void GameZero::RangeAllocator::Free(uint64_t offset, uint64_t size){
+    if(size == 0) return;
+    used -= size;
+
+    auto next = freeRanges.lower_bound(offset);
+
+    // previous range ends where this one starts
+    if(next != freeRanges.begin()){
+        auto previous = std::prev(next);
+        if(previous->first + previous->second == offset){
+            offset = previous->first;
+            size += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+
+    // next range starts where this one ends
+    if(next != freeRanges.end() && offset + size == next->first){
+        size += next->second;
+        freeRanges.erase(next);
+    }
+
+    freeRanges[offset] = size;
+}
+
+// free ranges are not sorted by size, largest is found by walking all of them
+uint64_t GameZero::RangeAllocator::GetLargestFreeRange() const{
+    uint64_t largest = 0;
+    for(const auto& [offset, size] : freeRanges){
+        largest = std::max(largest, size);
+    }
+    return largest;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file geometry_buffer.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief shared vertex and index buffers that many meshes are sub allocated from
+ * @version 0.1
+ * @date 2021-06-25
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_GEOMETRY_BUFFER_HPP
+#define GAMEZERO_GEOMETRY_BUFFER_HPP
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "vulkan/types.hpp"
+
+namespace GameZero{
+
+    /**
+     * @brief First fit free list allocator over a range of elements.
+     *        Only hands out offsets, memory itself lives elsewhere.
+     *        Freed ranges are merged with their neighbours so that
+     *        the list stays as short as the holes in the range.
+     */
+    class RangeAllocator{
+    public:
+        /// forget all allocations and make whole capacity free
+        void Reset(uint64_t newCapacity);
+
+        /// extend range, new space at the end becomes free
+        void Grow(uint64_t newCapacity);
+
+        /**
+         * @brief Allocate a range of elements
+         *
+         * @param size : number of elements
+         * @param offset : receives first element of allocated range
+         * @return false if no free range is large enough
+         */
+        bool Allocate(uint64_t size, uint64_t& offset);
+
+        /// return a range given by Allocate
+        void Free(uint64_t offset, uint64_t size);
+
+        /// total elements managed
+        uint64_t GetCapacity() const{ return capacity; }
+
+        /// elements currently allocated
+        uint64_t GetUsed() const{ return used; }
+
+        /// number of holes, 1 means free space is not fragmented
+        size_t GetFreeRangeCount() const{ return freeRanges.size(); }
+
+        /// largest allocation that would succeed right now
+        uint64_t GetLargestFreeRange() const;
+
+    private:
+        /// free ranges, offset to size, sorted so that neighbours are found in log time
+        std::map<uint64_t, uint64_t> freeRanges;
+        uint64_t capacity = 0;
+        uint64_t used = 0;
+    };
+
+    /// where a mesh lives inside geometry buffer of its vertex format
+    struct GeometryRange{
+        /// first vertex, given to draws as vertex offset so mesh indices stay local
+        uint32_t vertexOffset = 0;
+        uint32_t vertexCount = 0;
+        /// first index, added to first index of every draw of the mesh
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+
+        /// true once mesh is uploaded
+        bool IsValid() const{ return vertexCount > 0; }
+    };
+
+    /// range of a released mesh, freed once no frame in flight reads it
+    struct RetiredGeometryRange{
+        /// frame that stopped using it
+        uint64_t frame = 0;
+        GeometryRange range;
+    };
+
+    /**
+     * @brief One vertex and one index buffer shared by all meshes of a vertex format.
+     *        Vertex buffer holds position stream of all meshes followed by
+     *        attribute stream of all meshes, both indexed by same vertex offset,
+     *        so all meshes are drawn with a single vertex and index buffer bind.
+     */
+    struct GeometryBuffer{
+        /// position stream in [0, attributeOffset), attribute stream after it
+        AllocatedBuffer vertexBuffer;
+        AllocatedBuffer indexBuffer;
+
+        /// byte offset of attribute stream in vertex buffer
+        vk::DeviceSize attributeOffset = 0;
+        /// bytes per vertex in position stream
+        size_t positionStride = 0;
+        /// bytes per vertex in attribute stream
+        size_t attributeStride = 0;
+
+        /// ranges of vertices, in vertices
+        RangeAllocator vertices;
+        /// ranges of indices, in indices
+        RangeAllocator indices;
+        /// ranges of released meshes waiting for frames in flight
+        std::vector<RetiredGeometryRange> retiredRanges;
+
+        /// true once buffers are created
+        bool IsCreated() const{ return vertices.GetCapacity() > 0; }
+    };
+
+}
+
+#endif//GAMEZERO_GEOMETRY_BUFFER_HPP
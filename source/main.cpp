@@ -11,6 +11,8 @@
 #include "app_state.hpp"
 #include "camera.hpp"
 
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <stdexcept>
 #include <chrono>
@@ -19,6 +21,9 @@
 using namespace GameZero;
 
 int main(){
+    // measure time to first frame, compare cold (no caches) and warm startups with this
+    auto startup_start_time = std::chrono::high_resolution_clock::now();
+
     // create window
     Window window("GameZero - Editor", Vector2u(800, 600));
 
@@ -41,6 +46,49 @@ int main(){
     // create camera
     Camera camera("main camera", window);
 
+    // grid floating over map, rippled and turned every frame so that dynamic meshes are drawn with their own transform
+    constexpr uint32_t waveGridSize = 32;
+    constexpr uint32_t waveRowSize = waveGridSize + 1;
+    DynamicMesh* waves = renderer.CreateDynamicMesh("Waves", waveRowSize * waveRowSize, waveGridSize * waveGridSize * 6);
+    if(waves){
+        uint32_t* indices = waves->EditIndices(0, waves->GetIndexCapacity());
+        for(uint32_t z = 0; z < waveGridSize; z++){
+            for(uint32_t x = 0; x < waveGridSize; x++){
+                uint32_t corner = z * waveRowSize + x;
+                uint32_t quad[6] = {corner, corner + waveRowSize, corner + 1, corner + 1, corner + waveRowSize, corner + waveRowSize + 1};
+                memcpy(indices, quad, sizeof(quad));
+                indices += 6;
+            }
+        }
+        waves->SetIndexCount(waves->GetIndexCapacity());
+    }
+
+    // C toggles meshlet culling, L toggles levels of detail, P toggles depth prepass
+    // M toggles merged map faces and N toggles texture mipmaps, to compare frame time and triangle counts
+    window.RegisterKeyboardEventCallback([&renderer](KeyboardEventInfo& info){
+        if(info.key == Keyboard::KeyC && info.state == KeyState::Down){
+            renderer.enableMeshletCulling = !renderer.enableMeshletCulling;
+            printf("meshlet culling : %s\n", renderer.enableMeshletCulling ? "on" : "off");
+        }
+        if(info.key == Keyboard::KeyL && info.state == KeyState::Down){
+            renderer.enableLod = !renderer.enableLod;
+            printf("levels of detail : %s\n", renderer.enableLod ? "on" : "off");
+        }
+        if(info.key == Keyboard::KeyP && info.state == KeyState::Down){
+            renderer.enableDepthPrepass = !renderer.enableDepthPrepass;
+            printf("depth prepass : %s\n", renderer.enableDepthPrepass ? "on" : "off");
+        }
+        if(info.key == Keyboard::KeyM && info.state == KeyState::Down){
+            renderer.SetMergedFaces(!renderer.enableMergedFaces);
+            printf("merged map faces : %s\n", renderer.enableMergedFaces ? "on" : "off");
+        }
+        if(info.key == Keyboard::KeyN && info.state == KeyState::Down){
+            renderer.SetMipmaps(!renderer.enableMipmaps);
+            printf("texture mipmaps : %s\n", renderer.enableMipmaps ? "on" : "off");
+        }
+        return true;
+    });
+
     // render loop time
     float deltaTime = 0.f;
     // number of frames to averge frame time over
@@ -57,15 +105,49 @@ int main(){
         renderer.cameraData.proj = glm::perspective(glm::radians(camera.fieldOfView), float(window.size.x) / float(window.size.y), 0.1f, 200.f);
         renderer.cameraData.proj[1][1] *= -1; // invert y
 
+        if(waves){
+            float time = renderer.frameNumber * 0.02f;
+            Vertex* vertices = waves->EditVertices(0, waves->GetVertexCapacity());
+            for(uint32_t z = 0; z < waveRowSize; z++){
+                for(uint32_t x = 0; x < waveRowSize; x++){
+                    Vertex& vertex = vertices[z * waveRowSize + x];
+                    vertex.position = glm::vec3(x, std::sin(x * 0.4f + time) * std::cos(z * 0.3f + time), z) - glm::vec3(waveGridSize * 0.5f, 0.f, waveGridSize * 0.5f);
+                    vertex.normal = glm::vec3(0.f, 1.f, 0.f);
+                    vertex.color = vertex.normal;
+                    vertex.uv = glm::vec2(x, z) / float(waveGridSize);
+                }
+            }
+            waves->transform = glm::rotate(glm::translate(glm::mat4(1.f), glm::vec3(0.f, 40.f, 0.f)), time * 0.1f, glm::vec3(0.f, 1.f, 0.f));
+        }
+
         renderer.Draw();
 
+        // show startup time once first frame is submitted
+        if(renderer.frameNumber == 1){
+            auto first_frame_time = std::chrono::high_resolution_clock::now();
+            printf("time to first frame : %fms\n", std::chrono::duration<float, std::milli>(first_frame_time - startup_start_time).count());
+        }
+
         auto loop_stop_time = std::chrono::high_resolution_clock::now();
-        deltaTime += static_cast<float>(std::chrono::duration_cast<std::chrono::milliseconds>(loop_stop_time - loop_start_time).count());
+        deltaTime += std::chrono::duration<float, std::milli>(loop_stop_time - loop_start_time).count();
+        frameNumber++;
     
         // show average frame time
         if((frameNumber % frameSampleCount) == 0){
             deltaTime /= frameSampleCount;
             printf("frame time : %fms\n", deltaTime);
+
+            const FrameStatistics& stats = renderer.frameStatistics;
+            printf("draw calls : %u (+%u depth prepass), pipeline binds : %u, material binds : %u, geometry binds : %u, objects culled : %u, meshlets culled : %u frustum + %u backface of %u, objects at lower detail : %u, triangles drawn : %lu of %lu\n",
+                stats.drawCalls, stats.depthPrepassDrawCalls, stats.pipelineBinds, stats.materialBinds, stats.geometryBinds, stats.culledObjectCount, stats.frustumCulledMeshlets, stats.backfaceCulledMeshlets, stats.meshletCount, stats.lodObjectCount,
+                stats.triangleCount - stats.culledTriangleCount - stats.lodReducedTriangleCount, stats.triangleCount);
+            if(!renderer.dynamicMeshes.empty()){
+                printf("dynamic mesh upload : %.2f KB in %u ranges\n", stats.dynamicMeshUploadBytes / 1024.f, stats.dynamicMeshUploadRanges);
+            }
+            if(!renderer.streamedTextures.empty()){
+                printf("texture memory : %.1f of %.1f MB, streamed levels in : %u out : %u\n", stats.textureBytes / (1024.f * 1024.f),
+                    renderer.textureBudget / (1024.f * 1024.f), stats.streamedInLevels, stats.streamedOutLevels);
+            }
             deltaTime = 0; // reset delta time
             frameNumber = 0; // reset frame number
         }
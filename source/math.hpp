@@ -2,5 +2,6 @@
 #define GAMEZERO_MATH_HPP
 
 #include "math/vector.hpp"
+#include "math/bounds.hpp"
 
 #endif//GAMEZERO_MATH_HPP
\ No newline at end of file
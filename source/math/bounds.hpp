@@ -0,0 +1,47 @@
+#ifndef GAMEZERO_MATH_BOUNDS_HPP
+#define GAMEZERO_MATH_BOUNDS_HPP
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace GameZero{
+
+    /// axis aligned bounding box
+    struct BoundingBox{
+        glm::vec3 min = glm::vec3(0.f);
+        glm::vec3 max = glm::vec3(0.f);
+
+        /// center of box
+        glm::vec3 GetCenter() const{ return (min + max) * 0.5f; }
+        /// half size of box along each axis
+        glm::vec3 GetExtent() const{ return (max - min) * 0.5f; }
+
+        /// smallest axis aligned box containing this box after transform (Arvo)
+        BoundingBox Transform(const glm::mat4& transform) const{
+            glm::vec3 center = glm::vec3(transform * glm::vec4(GetCenter(), 1.f));
+            glm::vec3 extent = GetExtent();
+
+            // each world axis gathers absolute contribution of every local axis
+            glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x
+                                  + glm::abs(glm::vec3(transform[1])) * extent.y
+                                  + glm::abs(glm::vec3(transform[2])) * extent.z;
+
+            return {center - worldExtent, center + worldExtent};
+        }
+    };
+
+    /// bounding sphere
+    struct BoundingSphere{
+        glm::vec3 center = glm::vec3(0.f);
+        float radius = 0.f;
+
+        /// sphere containing this sphere after transform, radius grows with largest axis scale
+        BoundingSphere Transform(const glm::mat4& transform) const{
+            float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+            return {glm::vec3(transform * glm::vec4(center, 1.f)), radius * scale};
+        }
+    };
+
+}
+
+#endif//GAMEZERO_MATH_BOUNDS_HPP
@@ -0,0 +1,53 @@
+#ifndef GAMEZERO_MATH_FRUSTUM_HPP
+#define GAMEZERO_MATH_FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+namespace GameZero{
+
+    /// view frustum as 6 planes facing inwards : left, right, bottom, top, near, far
+    struct Frustum{
+        /// xyz is unit plane normal, w is distance, points inside have dot(xyz, p) + w >= 0
+        glm::vec4 planes[6];
+
+        /**
+         * @brief Extract frustum planes from a projection matrix (Gribb, Hartmann).
+         *        Planes are in the space that matrix transforms from, so passing
+         *        proj * view * model gives planes in model space.
+         */
+        static Frustum FromMatrix(const glm::mat4& matrix) noexcept{
+            // glm matrices are column major, rows are gathered by hand
+            glm::vec4 rows[4];
+            for(int i = 0; i < 4; i++){
+                rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+            }
+
+            Frustum frustum;
+            frustum.planes[0] = rows[3] + rows[0];
+            frustum.planes[1] = rows[3] - rows[0];
+            frustum.planes[2] = rows[3] + rows[1];
+            frustum.planes[3] = rows[3] - rows[1];
+            // -w <= z is looser than vulkan's 0 <= z, which keeps culling conservative
+            frustum.planes[4] = rows[3] + rows[2];
+            frustum.planes[5] = rows[3] - rows[2];
+
+            for(glm::vec4& plane : frustum.planes){
+                float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+                if(length > 0.f) plane = plane * (1.f / length);
+            }
+
+            return frustum;
+        }
+
+        /// check whether a sphere is at least partly inside frustum
+        bool IsSphereVisible(const glm::vec3& center, float radius) const noexcept{
+            for(const glm::vec4& plane : planes){
+                if(plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) return false;
+            }
+            return true;
+        }
+    };
+
+}
+
+#endif//GAMEZERO_MATH_FRUSTUM_HPP
@@ -0,0 +1,76 @@
+#ifndef GAMEZERO_MATH_PACKING_HPP
+#define GAMEZERO_MATH_PACKING_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+namespace GameZero{
+
+    /// convert float to IEEE half float with round to nearest even
+    inline uint16_t PackHalf(float value) noexcept{
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t magnitude = bits & 0x7fffffff;
+
+        // too large for half, or inf/nan
+        if(magnitude >= 0x47800000){
+            return static_cast<uint16_t>(sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00));
+        }
+
+        // too small for a normal half, encode as denormal
+        if(magnitude < 0x38800000){
+            float absolute;
+            memcpy(&absolute, &magnitude, sizeof(absolute));
+            return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(absolute * 16777216.f)));
+        }
+
+        // rebias exponent from 127 to 15 and drop 13 mantissa bits
+        uint32_t half = (magnitude - 0x38000000) >> 13;
+        uint32_t remainder = magnitude & 0x1fff;
+        if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) half++;
+
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    /// quantize value in [0, 1] to 16 bit unsigned normalized integer
+    inline uint16_t PackUnorm16(float value) noexcept{
+        value = value < 0.f ? 0.f : (value > 1.f ? 1.f : value);
+        return static_cast<uint16_t>(value * 65535.f + 0.5f);
+    }
+
+    /// quantize value in [-1, 1] to 16 bit signed normalized integer
+    inline int16_t PackSnorm16(float value) noexcept{
+        value = value < -1.f ? -1.f : (value > 1.f ? 1.f : value);
+        return static_cast<int16_t>(std::round(value * 32767.f));
+    }
+
+    /**
+     * @brief Map a unit vector onto an octahedron unfolded into [-1, 1]^2.
+     *        Two components are enough to store a normal this way.
+     *        Zero vectors map to (0, 0) which decodes to +z.
+     */
+    inline glm::vec2 OctahedralEncode(const glm::vec3& normal) noexcept{
+        float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+        if(sum == 0.f) return glm::vec2(0.f);
+
+        glm::vec2 encoded(normal.x / sum, normal.y / sum);
+
+        // fold lower hemisphere over the diagonals
+        if(normal.z < 0.f){
+            glm::vec2 folded(
+                (1.f - std::fabs(encoded.y)) * (encoded.x >= 0.f ? 1.f : -1.f),
+                (1.f - std::fabs(encoded.x)) * (encoded.y >= 0.f ? 1.f : -1.f)
+            );
+            encoded = folded;
+        }
+
+        return encoded;
+    }
+
+}
+
+#endif//GAMEZERO_MATH_PACKING_HPP
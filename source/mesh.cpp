@@ -1,79 +1,150 @@
 #include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet.hpp"
+#include "mesh_simplifier.hpp"
+#include "face_merger.hpp"
 #include "glm/ext/quaternion_geometric.hpp"
 #include "utils/assert.hpp"
+#include "utils/obj_parser.hpp"
 #include "vulkan/vulkan.hpp"
 #include "vulkan/vulkan_core.h"
 #include "cstring"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <unordered_map>
 
-// get vertex description
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define GAMEZERO_BOUNDS_SSE 1
+#endif
+
+// layouts are static arrays built at compile time, see vertex_layout.hpp
 GameZero::VertexInputDescription GameZero::Vertex::GetVertexDescription(){
-	VertexInputDescription description;
-
-	//we will have just 1 vertex buffer binding, with a per-vertex rate
-	vk::VertexInputBindingDescription mainBinding = {};
-	// this data will be available from binding 0
-	mainBinding.binding = 0;
-	// after what no of bytes do you get next vertex 
-	mainBinding.stride = sizeof(Vertex);
-	// you get a vertex on moving stride number of bytes
-	mainBinding.inputRate = vk::VertexInputRate::eVertex;
-
-	description.bindings.push_back(mainBinding);
-
-	//Position will be stored at Location 0
-	vk::VertexInputAttributeDescription positionAttribute = {};
-	positionAttribute.binding = 0;
-	positionAttribute.location = 0;
-	// vec3
-	positionAttribute.format = vk::Format::eR32G32B32Sfloat;
-	positionAttribute.offset = offsetof(Vertex, position);
-
-	//Normal will be stored at Location 1
-	vk::VertexInputAttributeDescription normalAttribute = {};
-	normalAttribute.binding = 0;
-	normalAttribute.location = 1;
-	// vec3
-	normalAttribute.format = vk::Format::eR32G32B32Sfloat;;
-	normalAttribute.offset = offsetof(Vertex, normal);
-
-	//Color will be stored at Location 2
-	vk::VertexInputAttributeDescription colorAttribute = {};
-	colorAttribute.binding = 0;
-	colorAttribute.location = 2;
-	// vec3
-	colorAttribute.format = vk::Format::eR32G32B32Sfloat;;
-	colorAttribute.offset = offsetof(Vertex, color);
-
-	//UV will be stored at Location 3
-	vk::VertexInputAttributeDescription uvAttribute = {};
-	uvAttribute.binding = 0;
-	uvAttribute.location = 3;
-	uvAttribute.format = vk::Format::eR32G32Sfloat;;
-	uvAttribute.offset = offsetof(Vertex, uv);
-
-	description.attributes.push_back(positionAttribute);
-	description.attributes.push_back(normalAttribute);
-	description.attributes.push_back(colorAttribute);
-	description.attributes.push_back(uvAttribute);
-
-	return description;
+	return VertexFormatLayout<VertexFormat::Standard>::GetDescription();
 }
 
-// load mesh from an obj file
-bool GameZero::Mesh::LoadMeshFromOBJ(const char *filename){
+GameZero::VertexInputDescription GameZero::Vertex::GetPositionDescription(){
+	return VertexFormatPositionLayout<VertexFormat::Standard>::GetDescription();
+}
+
+GameZero::VertexInputDescription GameZero::CompactVertex::GetVertexDescription(){
+	return VertexFormatLayout<VertexFormat::Compact>::GetDescription();
+}
+
+GameZero::VertexInputDescription GameZero::CompactVertex::GetPositionDescription(){
+	return VertexFormatPositionLayout<VertexFormat::Compact>::GetDescription();
+}
+
+// quantize a single vertex
+GameZero::CompactVertex GameZero::CompactVertex::Quantize(const Vertex& vertex, const BoundingBox& bounds){
+	CompactVertex compact;
+
+	// position relative to bounds, flat axes have zero size
+	glm::vec3 size = bounds.max - bounds.min;
+	for (int i = 0; i < 3; i++) {
+		float relative = size[i] > 0.f ? (vertex.position[i] - bounds.min[i]) / size[i] : 0.f;
+		compact.position[i] = PackUnorm16(relative);
+	}
+	compact.position[3] = 0;
+
+	glm::vec2 normal = OctahedralEncode(vertex.normal);
+	compact.normal[0] = PackSnorm16(normal.x);
+	compact.normal[1] = PackSnorm16(normal.y);
+
+	compact.uv[0] = PackHalf(vertex.uv.x);
+	compact.uv[1] = PackHalf(vertex.uv.y);
+
+	return compact;
+}
+
+// quantize all vertices of mesh
+std::vector<GameZero::CompactVertex> GameZero::Mesh::BuildCompactVertices() const{
+	const Vertex* vertexData = GetVertexData();
+	size_t vertexCount = GetVertexCount();
+
+	std::vector<CompactVertex> compactVertices(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		compactVertices[i] = CompactVertex::Quantize(vertexData[i], bounds);
+	}
+
+	return compactVertices;
+}
+
+// split vertices by attribute, loop is specialized per vertex format
+template<GameZero::VertexFormat Format>
+static void WriteFormatVertexStreams(const GameZero::Vertex* vertexData, size_t vertexCount, const GameZero::BoundingBox& bounds,
+                                     uint8_t* positions, uint8_t* attributes){
+	using Traits = GameZero::VertexFormatTraits<Format>;
+
+	for (size_t i = 0; i < vertexCount; i++) {
+		Traits::WriteVertex(vertexData[i], bounds, positions + i * Traits::PositionBinding::stride, attributes + i * Traits::AttributeBinding::stride);
+	}
+}
+
+// pick specialization once per mesh
+void GameZero::Mesh::WriteVertexStreams(uint8_t* positions, uint8_t* attributes) const{
+	using Writer = void (*)(const Vertex*, size_t, const BoundingBox&, uint8_t*, uint8_t*);
+	static constexpr Writer writers[VertexFormatCount] = {
+		WriteFormatVertexStreams<VertexFormat::Standard>,
+		WriteFormatVertexStreams<VertexFormat::Compact>
+	};
+	writers[size_t(vertexFormat)](GetVertexData(), GetVertexCount(), bounds, positions, attributes);
+}
+
+GameZero::VertexStreams GameZero::Mesh::BuildVertexStreams() const{
+	VertexStreams streams;
+	streams.positionStride = VertexFormatInfos[size_t(vertexFormat)].positionStride;
+	streams.attributeStride = VertexFormatInfos[size_t(vertexFormat)].attributeStride;
+
+	// keep attribute stream aligned for its widest component
+	size_t vertexCount = GetVertexCount();
+	streams.attributeOffset = (vertexCount * streams.positionStride + 15) & ~size_t(15);
+	streams.data.resize(streams.attributeOffset + vertexCount * streams.attributeStride);
+
+	WriteVertexStreams(streams.data.data(), streams.data.data() + streams.attributeOffset);
+	return streams;
+}
+
+// dequantization constants for shaders
+GameZero::GPUMeshData GameZero::Mesh::GetGPUMeshData() const{
+	GPUMeshData meshData;
+	// transform is filled in by renderer per object
+	meshData.model = glm::mat4(1.f);
+	if (vertexFormat == VertexFormat::Compact) {
+		meshData.positionOffset = glm::vec4(bounds.min, 0.f);
+		meshData.positionScale = glm::vec4(bounds.max - bounds.min, 0.f);
+	} else {
+		// standard positions are already in mesh space
+		meshData.positionOffset = glm::vec4(0.f);
+		meshData.positionScale = glm::vec4(1.f);
+	}
+	meshData.uvTiling = glm::vec4(uvTiling.tileSize, uvTiling.stride, 0.f);
+	return meshData;
+}
+
+// parse obj file using tinyobj, kept for comparison with native parser
+static bool ParseOBJWithTinyObj(const char *filename, GameZero::ObjData& obj){
 	//attrib will contain the vertex arrays of the file
 	tinyobj::attrib_t attrib;
     //shapes contains the info for each separate object in the file
 	std::vector<tinyobj::shape_t> shapes;
-    //materials contains the information about the material of each shape, but we won't use it.
+    //materials contains the information about the material of each shape
     std::vector<tinyobj::material_t> materials;
 
+	// material libraries and their textures are relative to obj file
+	std::string directory(filename);
+	directory.resize(directory.find_last_of('/') == std::string::npos ? 0 : directory.find_last_of('/') + 1);
+
     //error and warning output from the load function
 	std::string warn;
 	std::string err;
 
     //load the OBJ file
-	tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, "../mesh/");
+	tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, directory.c_str());
     //make sure to output the warnings to the console, in case there are issues with the file
 	if (!warn.empty()) {
 		LOG(WARNING, "%s", warn.c_str());
@@ -87,6 +158,15 @@ bool GameZero::Mesh::LoadMeshFromOBJ(const char *filename){
 
 	LOG(INFO, "OBJ Mesh [%s] has %lu shapes and %lu materials", filename, shapes.size(), materials.size());
 
+	// attribute arrays can be taken as they are
+	obj.positions = std::move(attrib.vertices);
+	obj.normals = std::move(attrib.normals);
+	obj.texcoords = std::move(attrib.texcoords);
+
+	for (const tinyobj::material_t& material : materials) {
+		obj.materials.push_back({material.name, material.diffuse_texname.empty() ? std::string() : directory + material.diffuse_texname});
+	}
+
 	// Loop over shapes
 	for (size_t s = 0; s < shapes.size(); s++) {
 		// Loop over faces(polygon)
@@ -96,43 +176,320 @@ bool GameZero::Mesh::LoadMeshFromOBJ(const char *filename){
             //hardcode loading to triangles
 			int fv = 3;
 
+			// start a new material run whenever face material changes
+			int32_t material = shapes[s].mesh.material_ids[f];
+			if (obj.materialRanges.empty() ? material >= 0 : obj.materialRanges.back().material != material) {
+				obj.materialRanges.push_back({obj.indices.size(), material});
+			}
+
 			// Loop over vertices in the face.
 			for (size_t v = 0; v < fv; v++) {
 				// access to vertex
 				tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                //vertex position
-				tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
-				tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
-				tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
-                //vertex normal
-            	tinyobj::real_t nx = attrib.normals[3 * idx.normal_index + 0];
-				tinyobj::real_t ny = attrib.normals[3 * idx.normal_index + 1];
-				tinyobj::real_t nz = attrib.normals[3 * idx.normal_index + 2];
-
-				// tinyobj::real_t cx = attrib.colors[3 * idx.vertex_index + 0];
-				// tinyobj::real_t cy = attrib.colors[3 * idx.vertex_index + 1];
-				// tinyobj::real_t cz = attrib.colors[3 * idx.vertex_index + 2];
-
-                //copy it into our vertex
-				Vertex new_vert;
-				new_vert.position = glm::vec3(vx, vy, vz);
-				new_vert.normal = glm::vec3(nx, ny, nz);
-                // new_vert.color = glm::vec3(cx, cy, cz);
-				// new_vert.color = glm::normalize(glm::vec3(rand(), rand(), rand()));
-				new_vert.color = new_vert.normal;
-
-				tinyobj::real_t ux = attrib.texcoords[2 * idx.texcoord_index + 0];
-				tinyobj::real_t uy = attrib.texcoords[2 * idx.texcoord_index + 1];
-
-				new_vert.uv.x = ux;
-				new_vert.uv.y = 1-uy;
-
-				vertices.push_back(new_vert);
+				obj.indices.push_back({idx.vertex_index, idx.normal_index, idx.texcoord_index});
 			}
 			index_offset += fv;
 		}
 	}
 
+	return true;
+}
+
+// one submesh for whole mesh, for meshes that were not loaded from a file
+void GameZero::Mesh::EnsureSubmeshes(){
+	if (!submeshes.empty() || mapped.file) return;
+
+	Submesh submesh = {};
+	submesh.material = static_cast<uint32_t>(materials.size());
+	submesh.lods[0] = {0, static_cast<uint32_t>(indices.size()), 0.f};
+	submeshes.push_back(submesh);
+
+	materials.push_back(MeshMaterial{});
+}
+
+// copy obj material into fixed size mesh material
+static GameZero::MeshMaterial ToMeshMaterial(const GameZero::ObjMaterial* material){
+	GameZero::MeshMaterial meshMaterial = {};
+	if (!material) return meshMaterial;
+
+	snprintf(meshMaterial.name, sizeof(meshMaterial.name), "%s", material->name.c_str());
+	if (material->diffuseTexture.size() >= sizeof(meshMaterial.diffuseTexture)) {
+		LOG(WARNING, "Texture path of material [ %s ] is too long and is dropped", material->name.c_str());
+	} else {
+		snprintf(meshMaterial.diffuseTexture, sizeof(meshMaterial.diffuseTexture), "%s", material->diffuseTexture.c_str());
+	}
+
+	return meshMaterial;
+}
+
+// build indexed mesh from parsed obj data
+void GameZero::Mesh::LoadMeshFromOBJData(const ObjData& obj){
+	// cold start : drop any previous cache mapping
+	mapped = MappedMeshData();
+	meshlets.clear();
+	lods.clear();
+	submeshes.clear();
+	materials.clear();
+	renderMaterials.clear();
+	uvTiling = UvTiling();
+
+	// total number of face corners, this is what a non indexed mesh would store
+	size_t faceVertexCount = obj.indices.size();
+	size_t triangleCount = faceVertexCount / 3;
+
+	// material of every triangle, shifted by one so that faces without material are 0
+	std::vector<uint32_t> triangleMaterials(triangleCount, 0);
+	for (size_t r = 0; r < obj.materialRanges.size(); r++) {
+		size_t first = obj.materialRanges[r].firstIndex / 3;
+		size_t last = r + 1 < obj.materialRanges.size() ? obj.materialRanges[r + 1].firstIndex / 3 : triangleCount;
+		std::fill(triangleMaterials.begin() + first, triangleMaterials.begin() + last, static_cast<uint32_t>(obj.materialRanges[r].material + 1));
+	}
+
+	// group triangles by material, keeping file order within a material
+	std::vector<size_t> materialOffsets(obj.materials.size() + 2, 0);
+	for (uint32_t material : triangleMaterials) {
+		materialOffsets[material + 1]++;
+	}
+	for (size_t m = 1; m < materialOffsets.size(); m++) {
+		materialOffsets[m] += materialOffsets[m - 1];
+	}
+
+	std::vector<uint32_t> triangleOrder(triangleCount);
+	std::vector<size_t> materialCursors(materialOffsets.begin(), materialOffsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleOrder[materialCursors[triangleMaterials[t]]++] = static_cast<uint32_t>(t);
+	}
+
+	// only materials used by some triangle become submeshes
+	for (size_t m = 0; m + 1 < materialOffsets.size(); m++) {
+		if (materialOffsets[m + 1] == materialOffsets[m]) continue;
+
+		Submesh submesh = {};
+		submesh.material = static_cast<uint32_t>(materials.size());
+		submesh.lods[0].firstIndex = static_cast<uint32_t>(materialOffsets[m] * 3);
+		submesh.lods[0].indexCount = static_cast<uint32_t>((materialOffsets[m + 1] - materialOffsets[m]) * 3);
+		submeshes.push_back(submesh);
+
+		materials.push_back(ToMeshMaterial(m == 0 ? nullptr : &obj.materials[m - 1]));
+	}
+
+	// map every unique vertex to its index in vertices
+	std::unordered_map<Vertex, uint32_t> uniqueVertices;
+	uniqueVertices.reserve(faceVertexCount / 2);
+
+	vertices.clear();
+	indices.clear();
+	indices.reserve(faceVertexCount);
+
+	for (size_t corner = 0; corner < triangleCount * 3; corner++) {
+		const ObjIndex& idx = obj.indices[3 * triangleOrder[corner / 3] + corner % 3];
+
+		//vertex position
+		float vx = obj.positions[3 * idx.position + 0];
+		float vy = obj.positions[3 * idx.position + 1];
+		float vz = obj.positions[3 * idx.position + 2];
+
+		//copy it into our vertex
+		Vertex new_vert;
+		new_vert.position = glm::vec3(vx, vy, vz);
+
+		//vertex normal, files without normals get a zero normal
+		new_vert.normal = glm::vec3(0.f);
+		if (idx.normal >= 0) {
+			float nx = obj.normals[3 * idx.normal + 0];
+			float ny = obj.normals[3 * idx.normal + 1];
+			float nz = obj.normals[3 * idx.normal + 2];
+			new_vert.normal = glm::vec3(nx, ny, nz);
+		}
+
+		// new_vert.color = glm::normalize(glm::vec3(rand(), rand(), rand()));
+		new_vert.color = new_vert.normal;
+
+		//vertex uv, files without texcoords get a zero uv
+		new_vert.uv = glm::vec2(0.f);
+		if (idx.texcoord >= 0) {
+			float ux = obj.texcoords[2 * idx.texcoord + 0];
+			float uy = obj.texcoords[2 * idx.texcoord + 1];
+
+			new_vert.uv.x = ux;
+			new_vert.uv.y = 1-uy;
+		}
+
+		// reuse vertex if we have already seen it
+		auto it = uniqueVertices.find(new_vert);
+		if (it == uniqueVertices.end()) {
+			it = uniqueVertices.emplace(new_vert, static_cast<uint32_t>(vertices.size())).first;
+			vertices.push_back(new_vert);
+		}
+
+		indices.push_back(it->second);
+	}
+
+	// release extra capacity, vertices are usually far less than face corners
+	vertices.shrink_to_fit();
+
+	// bounds of all vertices
+	bounds = ComputeVertexBounds(vertices.data(), vertices.size());
+	boundingSphere = ComputeBoundingSphere(vertices.data(), vertices.size(), bounds);
+}
+
+// min/max over positions, 4 floats at a time
+GameZero::BoundingBox GameZero::ComputeVertexBounds(const Vertex* vertices, size_t count){
+	BoundingBox box;
+	if (count == 0) return box;
+
+#if defined(GAMEZERO_BOUNDS_SSE)
+	// position is followed by normal, so loading 4 floats never reads past a vertex
+	static_assert(offsetof(Vertex, position) + sizeof(float) * 4 <= sizeof(Vertex), "position load reads past vertex");
+
+	// two accumulators so that consecutive min/max do not wait on each other
+	__m128 min0 = _mm_loadu_ps(&vertices[0].position.x), max0 = min0;
+	__m128 min1 = min0, max1 = min0;
+
+	size_t i = 1;
+	for (; i + 1 < count; i += 2) {
+		__m128 a = _mm_loadu_ps(&vertices[i].position.x);
+		__m128 b = _mm_loadu_ps(&vertices[i + 1].position.x);
+		min0 = _mm_min_ps(min0, a);
+		max0 = _mm_max_ps(max0, a);
+		min1 = _mm_min_ps(min1, b);
+		max1 = _mm_max_ps(max1, b);
+	}
+	if (i < count) {
+		__m128 a = _mm_loadu_ps(&vertices[i].position.x);
+		min0 = _mm_min_ps(min0, a);
+		max0 = _mm_max_ps(max0, a);
+	}
+
+	// w lane holds normal x and is dropped
+	alignas(16) float minimum[4], maximum[4];
+	_mm_store_ps(minimum, _mm_min_ps(min0, min1));
+	_mm_store_ps(maximum, _mm_max_ps(max0, max1));
+	box.min = glm::vec3(minimum[0], minimum[1], minimum[2]);
+	box.max = glm::vec3(maximum[0], maximum[1], maximum[2]);
+#else
+	box.min = box.max = vertices[0].position;
+	for (size_t i = 1; i < count; i++) {
+		box.min = glm::min(box.min, vertices[i].position);
+		box.max = glm::max(box.max, vertices[i].position);
+	}
+#endif
+
+	return box;
+}
+
+// farthest vertex from box center, never larger than half diagonal
+GameZero::BoundingSphere GameZero::ComputeBoundingSphere(const Vertex* vertices, size_t count, const BoundingBox& bounds){
+	BoundingSphere sphere;
+	sphere.center = bounds.GetCenter();
+	float radiusSquared = 0.f;
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 offset = vertices[i].position - sphere.center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	sphere.radius = std::sqrt(radiusSquared);
+	return sphere;
+}
+
+// world bounds follow mesh and transform, so they are only recomputed when one of them is set
+void GameZero::RenderObject::SetTransform(const glm::mat4& newTransform){
+	transform = newTransform;
+	UpdateWorldBounds();
+}
+
+void GameZero::RenderObject::SetMesh(Mesh* newMesh){
+	mesh = newMesh;
+	UpdateWorldBounds();
+}
+
+void GameZero::RenderObject::UpdateWorldBounds(){
+	if (!mesh) return;
+
+	worldBounds = mesh->bounds.Transform(transform);
+	worldSphere = mesh->boundingSphere.Transform(transform);
+}
+
+// load mesh from an obj file
+bool GameZero::Mesh::LoadMeshFromOBJ(const char *filename, ObjParser parser){
+	// warm start : use binary cache if it is still valid
+	auto cache_start_time = std::chrono::high_resolution_clock::now();
+	if (LoadMeshCache(filename, *this)) {
+		auto cache_stop_time = std::chrono::high_resolution_clock::now();
+		float cacheTime = std::chrono::duration<float, std::milli>(cache_stop_time - cache_start_time).count();
+		LOG(INFO, "OBJ Mesh [%s] loaded from cache : %lu vertices, %lu indices in %.2fms", filename, GetVertexCount(), GetIndexCount(), cacheTime);
+		return true;
+	}
+
+	// cold start : parse the obj
+	auto load_start_time = std::chrono::high_resolution_clock::now();
+
+	ObjData obj;
+	bool parsed = parser == ObjParser::Native ? ParseOBJ(filename, obj) : ParseOBJWithTinyObj(filename, obj);
+	if (!parsed) {
+		return false;
+	}
+
+	auto load_stop_time = std::chrono::high_resolution_clock::now();
+	float loadTime = std::chrono::duration<float, std::milli>(load_stop_time - load_start_time).count();
+
+	LOG(INFO, "OBJ Mesh [%s] parsed with %s parser in %.2fms", filename, parser == ObjParser::Native ? "native" : "tinyobj", loadTime);
+
+	auto dedup_start_time = std::chrono::high_resolution_clock::now();
+
+	LoadMeshFromOBJData(obj);
+
+	auto dedup_stop_time = std::chrono::high_resolution_clock::now();
+	float dedupTime = std::chrono::duration<float, std::milli>(dedup_stop_time - dedup_start_time).count();
+
+	// memory this mesh would take without and with indexing
+	size_t flatSize = obj.indices.size() * sizeof(Vertex);
+	size_t indexedSize = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t);
+
+	LOG(INFO, "OBJ Mesh [%s] indexed : %lu unique vertices for %lu indices (%.2f MB -> %.2f MB) deduplicated in %.2fms",
+		filename, vertices.size(), indices.size(), flatSize / (1024.f * 1024.f), indexedSize / (1024.f * 1024.f), dedupTime);
+
+	LOG(INFO, "OBJ Mesh [%s] has %lu submeshes using %lu of %lu materials", filename, submeshes.size(), materials.size(), obj.materials.size());
+
+	// voxel maps store every block face on its own, merge flat areas into larger quads
+	if (mergeCoplanarFaces) {
+		FaceMergeStatistics merge = MergeCoplanarFaces(*this);
+		if (uvTiling.IsEnabled()) {
+			LOG(INFO, "OBJ Mesh [%s] merged %u block faces into %u quads on a %ux%u tile atlas in %.2fms : %u -> %u triangles (%.1f%%), %u -> %u vertices",
+				filename, merge.quadsBefore, merge.quadsAfter, merge.tilesU, merge.tilesV, merge.time, merge.trianglesBefore, merge.trianglesAfter,
+				100.f * merge.trianglesAfter / std::max(merge.trianglesBefore, 1u), merge.verticesBefore, merge.verticesAfter);
+		} else {
+			LOG(WARNING, "OBJ Mesh [%s] texture coordinates do not follow a regular atlas grid, faces are not merged", filename);
+		}
+	}
+
+	// triangle order from obj is arbitrary, reorder for gpu caches
+	MeshOptimizationStatistics optimization = OptimizeMesh(*this);
+
+	LOG(INFO, "OBJ Mesh [%s] optimized in %.2fms : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+		filename, optimization.time, optimization.before.acmr, optimization.after.acmr, optimization.before.atvr, optimization.after.atvr);
+
+	// clusters for culling, keeps optimized order within each meshlet
+	auto meshlet_start_time = std::chrono::high_resolution_clock::now();
+	BuildMeshlets(*this);
+	auto meshlet_stop_time = std::chrono::high_resolution_clock::now();
+	float meshletTime = std::chrono::duration<float, std::milli>(meshlet_stop_time - meshlet_start_time).count();
+
+	LOG(INFO, "OBJ Mesh [%s] split into %lu meshlets in %.2fms", filename, meshlets.size(), meshletTime);
+
+	// coarser levels are appended after full detail indices
+	auto lod_start_time = std::chrono::high_resolution_clock::now();
+	BuildMeshLods(*this);
+	auto lod_stop_time = std::chrono::high_resolution_clock::now();
+	float lodTime = std::chrono::duration<float, std::milli>(lod_stop_time - lod_start_time).count();
+
+	// meshes without indices get no levels at all
+	if(!lods.empty()){
+		LOG(INFO, "OBJ Mesh [%s] has %lu levels of detail, coarsest has %u triangles with error %f, built in %.2fms",
+			filename, lods.size(), lods.back().indexCount / 3, lods.back().error, lodTime);
+	}
+
+	// next load can skip parsing
+	WriteMeshCache(filename, *this);
+
     return true;
 }
@@ -16,42 +16,488 @@
 #include "vulkan/vulkan.hpp"
 #include "vulkan/vulkan_core.h"
 #include "vulkan/types.hpp"
+#include "math/bounds.hpp"
+#include "math/packing.hpp"
+#include "meshlet.hpp"
+#include "geometry_buffer.hpp"
+#include "vertex_layout.hpp"
+#include "mesh_simplifier.hpp"
+#include "utils/hash.hpp"
+#include "utils/mapped_file.hpp"
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
 
 namespace GameZero {
 
-    /// vertex input description describes vertex buffer data
-    struct VertexInputDescription{
-        std::vector<vk::VertexInputBindingDescription> bindings;
-        std::vector<vk::VertexInputAttributeDescription> attributes;
-    
-        vk::PipelineVertexInputStateCreateFlags flags = {};
-    };
+    struct ObjData;
 
     /// vertex
+    /// on gpu, positions are stored in binding 0 and other attributes in binding 1,
+    /// see Mesh::BuildVertexStreams
     struct Vertex{
         glm::vec3 position;
         glm::vec3 normal;
         glm::vec3 color;
         glm::vec2 uv;
 
+        /// full layout, position from binding 0 and VertexAttributes from binding 1
         VertexInputDescription static GetVertexDescription();
+
+        /// position only layout for depth only pipelines, binding 0 only
+        VertexInputDescription static GetPositionDescription();
+
+        /// vertices are same only if all their attributes match bit by bit
+        inline bool operator == (const Vertex& other) const{
+            return memcmp(this, &other, sizeof(Vertex)) == 0;
+        }
+    };
+
+    /// attributes of a Vertex other than position, second vertex stream on gpu
+    struct VertexAttributes{
+        glm::vec3 normal;
+        glm::vec3 color;
+        glm::vec2 uv;
+    };
+
+    /// layouts that mesh vertices can have in gpu memory
+    enum class VertexFormat{
+        /// full float Vertex, 44 bytes
+        Standard,
+        /// quantized CompactVertex, 16 bytes
+        Compact
+    };
+
+    /// number of vertex formats, for arrays indexed by VertexFormat
+    constexpr static size_t VertexFormatCount = 2;
+
+    /**
+     * @brief Quantized vertex, 16 bytes instead of 44.
+     *        Position is 16 bit normalized relative to mesh bounds,
+     *        normal is octahedral encoded in two 16 bit snorms,
+     *        uv is stored as half floats and color is dropped
+     *        because it is always a copy of the normal.
+     *        Decoded in shaders/shader_compact.vert
+     */
+    struct CompactVertex{
+        /// xyz in [0, 1] over mesh bounds, w is unused padding
+        uint16_t position[4];
+        int16_t normal[2];
+        uint16_t uv[2];
+
+        /// full layout, position from binding 0 and CompactVertexAttributes from binding 1
+        VertexInputDescription static GetVertexDescription();
+
+        /// position only layout for depth only pipelines, binding 0 only
+        VertexInputDescription static GetPositionDescription();
+
+        /// quantize a vertex relative to given mesh bounds
+        static CompactVertex Quantize(const Vertex& vertex, const BoundingBox& bounds);
+    };
+
+    /// attributes of a CompactVertex other than position, second vertex stream on gpu
+    struct CompactVertexAttributes{
+        int16_t normal[2];
+        uint16_t uv[2];
+    };
+
+    /// float positions, binding 0 of standard vertices
+    using StandardPositionBinding = VertexBinding<0,
+        VertexAttribute<VertexLocation::Position, vk::Format::eR32G32B32Sfloat, glm::vec3>>;
+
+    /// VertexAttributes, binding 1 of standard vertices
+    using StandardAttributeBinding = VertexBinding<1,
+        VertexAttribute<VertexLocation::Normal, vk::Format::eR32G32B32Sfloat, glm::vec3>,
+        VertexAttribute<VertexLocation::Color, vk::Format::eR32G32B32Sfloat, glm::vec3>,
+        VertexAttribute<VertexLocation::TexCoord, vk::Format::eR32G32Sfloat, glm::vec2>>;
+
+    /// quantized positions, binding 0 of compact vertices
+    /// 3 component 16 bit formats are poorly supported so w is padding
+    using CompactPositionBinding = VertexBinding<0,
+        VertexAttribute<VertexLocation::Position, vk::Format::eR16G16B16A16Unorm, uint16_t[4]>>;
+
+    /// CompactVertexAttributes, binding 1 of compact vertices, color is not stored
+    using CompactAttributeBinding = VertexBinding<1,
+        VertexAttribute<VertexLocation::Normal, vk::Format::eR16G16Snorm, int16_t[2]>,
+        VertexAttribute<VertexLocation::TexCoord, vk::Format::eR16G16Sfloat, uint16_t[2]>>;
+
+    // declared layouts must match structs that fill vertex streams
+    static_assert(StandardPositionBinding::stride == sizeof(Vertex::position), "standard position binding does not match Vertex");
+    static_assert(StandardAttributeBinding::stride == sizeof(VertexAttributes) &&
+                  StandardAttributeBinding::offsets[0] == offsetof(VertexAttributes, normal) &&
+                  StandardAttributeBinding::offsets[1] == offsetof(VertexAttributes, color) &&
+                  StandardAttributeBinding::offsets[2] == offsetof(VertexAttributes, uv), "standard attribute binding does not match VertexAttributes");
+    static_assert(CompactPositionBinding::stride == sizeof(CompactVertex::position), "compact position binding does not match CompactVertex");
+    static_assert(CompactAttributeBinding::stride == sizeof(CompactVertexAttributes) &&
+                  CompactAttributeBinding::offsets[0] == offsetof(CompactVertexAttributes, normal) &&
+                  CompactAttributeBinding::offsets[1] == offsetof(CompactVertexAttributes, uv), "compact attribute binding does not match CompactVertexAttributes");
+
+    /**
+     * @brief Everything that differs between vertex formats, resolved at compile time.
+     *        Code templated on a format gets its layouts, strides and vertex writer
+     *        without branching on format per vertex or per pipeline.
+     */
+    template<VertexFormat Format>
+    struct VertexFormatTraits;
+
+    template<>
+    struct VertexFormatTraits<VertexFormat::Standard>{
+        using PositionBinding = StandardPositionBinding;
+        using AttributeBinding = StandardAttributeBinding;
+
+        constexpr static const char* name = "standard";
+
+        /// inputs of shaders/shader.vert
+        constexpr static uint32_t shaderLocations = VertexLocation::MaskOf(VertexLocation::Position, VertexLocation::Normal, VertexLocation::Color, VertexLocation::TexCoord);
+
+        /// write vertex to its slots in position and attribute streams, mesh bounds are only used by compact vertices
+        static void WriteVertex(const Vertex& vertex, const BoundingBox&, uint8_t* position, uint8_t* attributes){
+            VertexAttributes vertexAttributes = {vertex.normal, vertex.color, vertex.uv};
+            memcpy(position, &vertex.position, sizeof(vertex.position));
+            memcpy(attributes, &vertexAttributes, sizeof(vertexAttributes));
+        }
+    };
+
+    template<>
+    struct VertexFormatTraits<VertexFormat::Compact>{
+        using PositionBinding = CompactPositionBinding;
+        using AttributeBinding = CompactAttributeBinding;
+
+        constexpr static const char* name = "compact";
+
+        /// inputs of shaders/shader_compact.vert
+        constexpr static uint32_t shaderLocations = VertexLocation::MaskOf(VertexLocation::Position, VertexLocation::Normal, VertexLocation::TexCoord);
+
+        /// quantize vertex relative to mesh bounds and write it to its slots in position and attribute streams
+        static void WriteVertex(const Vertex& vertex, const BoundingBox& bounds, uint8_t* position, uint8_t* attributes){
+            CompactVertex compact = CompactVertex::Quantize(vertex, bounds);
+            CompactVertexAttributes compactAttributes;
+            memcpy(compactAttributes.normal, compact.normal, sizeof(compact.normal));
+            memcpy(compactAttributes.uv, compact.uv, sizeof(compact.uv));
+            memcpy(position, compact.position, sizeof(compact.position));
+            memcpy(attributes, &compactAttributes, sizeof(compactAttributes));
+        }
+    };
+
+    /// full layout of a vertex format, position stream in binding 0 and attribute stream in binding 1
+    template<VertexFormat Format>
+    using VertexFormatLayout = VertexLayout<typename VertexFormatTraits<Format>::PositionBinding, typename VertexFormatTraits<Format>::AttributeBinding>;
+
+    /// position only layout of a vertex format for depth only pipelines, binding 0 only
+    template<VertexFormat Format>
+    using VertexFormatPositionLayout = VertexLayout<typename VertexFormatTraits<Format>::PositionBinding>;
+
+    // vertex shaders read exactly what layouts provide, depth shader reads position alone
+    static_assert(VertexFormatLayout<VertexFormat::Standard>::locationMask == VertexFormatTraits<VertexFormat::Standard>::shaderLocations,
+                  "standard layout does not match inputs of shaders/shader.vert");
+    static_assert(VertexFormatLayout<VertexFormat::Compact>::locationMask == VertexFormatTraits<VertexFormat::Compact>::shaderLocations,
+                  "compact layout does not match inputs of shaders/shader_compact.vert");
+    static_assert(VertexFormatPositionLayout<VertexFormat::Standard>::locationMask == VertexLocation::MaskOf(VertexLocation::Position) &&
+                  VertexFormatPositionLayout<VertexFormat::Compact>::locationMask == VertexLocation::MaskOf(VertexLocation::Position),
+                  "position layouts do not match inputs of shaders/shader_depth.vert");
+
+    /// strides and name of a vertex format, for code that only knows format at runtime
+    struct VertexFormatInfo{
+        uint32_t positionStride;
+        uint32_t attributeStride;
+        const char* name;
+    };
+
+    /// info of a vertex format taken from its traits
+    template<VertexFormat Format>
+    constexpr VertexFormatInfo GetVertexFormatInfo(){
+        return {VertexFormatTraits<Format>::PositionBinding::stride, VertexFormatTraits<Format>::AttributeBinding::stride, VertexFormatTraits<Format>::name};
+    }
+
+    /// info of every vertex format, indexed by VertexFormat
+    constexpr static VertexFormatInfo VertexFormatInfos[VertexFormatCount] = {
+        GetVertexFormatInfo<VertexFormat::Standard>(),
+        GetVertexFormatInfo<VertexFormat::Compact>()
+    };
+
+    /**
+     * @brief Vertices split by attribute, as they are uploaded to gpu.
+     *        Tightly packed positions come first so that depth only passes
+     *        fetch nothing else, remaining attributes follow in a second stream.
+     */
+    struct VertexStreams{
+        /// position stream followed by attribute stream
+        std::vector<uint8_t> data;
+        /// byte offset of attribute stream in data, position stream starts at 0
+        size_t attributeOffset = 0;
+        /// bytes per vertex in position stream
+        size_t positionStride = 0;
+        /// bytes per vertex in attribute stream
+        size_t attributeStride = 0;
+    };
+
+    /// maximum length of material name stored in a MeshMaterial, including terminator
+    constexpr static size_t MeshMaterialNameSize = 64;
+    /// maximum length of texture path stored in a MeshMaterial, including terminator
+    constexpr static size_t MeshMaterialPathSize = 192;
+
+    /// material of a mesh as its source file describes it, fixed size so that it can live in mesh cache
+    struct MeshMaterial{
+        /// material name, empty for faces without a material
+        char name[MeshMaterialNameSize];
+        /// diffuse texture path relative to working directory, empty if material has none
+        char diffuseTexture[MeshMaterialPathSize];
+    };
+
+    /**
+     * @brief Part of a mesh drawn with one material.
+     *        Triangles of a submesh are contiguous in every level of detail,
+     *        and its meshlets are contiguous in mesh meshlets.
+     */
+    struct Submesh{
+        /// index into mesh materials
+        uint32_t material;
+        /// first meshlet of submesh in mesh meshlets
+        uint32_t firstMeshlet;
+        /// number of meshlets of submesh
+        uint32_t meshletCount;
+        /// index range of submesh in each level of detail, level 0 is full detail
+        /// only as many levels as mesh has are valid
+        MeshLod lods[MeshMaxLodCount];
+    };
+
+    /**
+     * @brief Atlas tiling of texture coordinates, used by meshes with merged faces.
+     *        Tiled coordinates are tile * stride + position inside tile in tile units,
+     *        fragment shader wraps position inside tile, so one quad can repeat
+     *        an atlas tile many times. Stride 0 means coordinates are plain.
+     */
+    struct UvTiling{
+        /// size of one atlas tile in texture coordinates
+        glm::vec2 tileSize = glm::vec2(0.f);
+        /// tile stride, larger than any position inside a tile
+        float stride = 0.f;
+
+        bool IsEnabled() const{ return stride > 0.f; }
+    };
+
+    /// parsers that can be used to load obj files
+    enum class ObjParser{
+        /// multithreaded parser from utils/obj_parser.hpp
+        Native,
+        /// single threaded tinyobj parser
+        TinyObj
+    };
+
+    /// mesh data that lives inside a memory mapped mesh cache
+    struct MappedMeshData{
+        /// mapping is kept alive as long as any mesh points into it
+        std::shared_ptr<MappedFile> file;
+
+        const Vertex* vertices = nullptr;
+        size_t vertexCount = 0;
+
+        const uint32_t* indices = nullptr;
+        size_t indexCount = 0;
+
+        const Meshlet* meshlets = nullptr;
+        size_t meshletCount = 0;
+
+        const MeshLod* lods = nullptr;
+        size_t lodCount = 0;
+
+        const Submesh* submeshes = nullptr;
+        size_t submeshCount = 0;
+
+        const MeshMaterial* materials = nullptr;
+        size_t materialCount = 0;
+
+        /// vertices and indices decoded from encoded sections, kept alive like file
+        std::shared_ptr<Vertex[]> decodedVertices;
+        std::shared_ptr<uint32_t[]> decodedIndices;
     };
 
     /// mesh
     class Mesh{
     public:
-        /// vertices of this mesh
+        /// vertices of this mesh, empty when mesh is loaded from cache
         std::vector<Vertex> vertices;
 
-        /// allocated buffer containing vertex data of this mesh
-        AllocatedBuffer vertexBuffer;
+        /// indices into vertices, every 3 indices make a triangle
+        /// full detail comes first, followed by each coarser level of detail
+        /// empty when mesh is loaded from cache
+        std::vector<uint32_t> indices;
+
+        /// ranges of indices for each level of detail, see mesh_simplifier.hpp
+        /// empty when mesh is loaded from cache
+        std::vector<MeshLod> lods;
+
+        /// clusters of full detail triangles that can be culled separately, see meshlet.hpp
+        /// empty when mesh is loaded from cache
+        std::vector<Meshlet> meshlets;
+
+        /// parts of mesh drawn with different materials, in material order
+        /// empty when mesh is loaded from cache
+        std::vector<Submesh> submeshes;
+
+        /// materials used by submeshes
+        /// empty when mesh is loaded from cache
+        std::vector<MeshMaterial> materials;
+
+        /// renderer material for each of mesh materials, filled by Renderer::CreateMeshMaterials
+        std::vector<Material*> renderMaterials;
+        /// texture coordinate units per mesh unit of each of mesh materials, filled with renderMaterials
+        /// used to pick which levels of their textures need to be streamed in
+        std::vector<float> materialUvDensities;
+
+        /// vertex and index data when mesh is loaded from cache
+        MappedMeshData mapped;
+
+        /// bounds of mesh in mesh space
+        BoundingBox bounds;
+        /// bounding sphere of mesh in mesh space, usually tighter than sphere around bounds
+        BoundingSphere boundingSphere;
+
+        /// texture coordinates are atlas tiled when coplanar faces were merged
+        UvTiling uvTiling;
+
+        /// merge coplanar block faces when loading, see face_merger.hpp
+        /// set before LoadMeshFromOBJ, merged meshes are cached separately
+        bool mergeCoplanarFaces = false;
+
+        /// layout of vertices when uploaded to gpu
+        VertexFormat vertexFormat = VertexFormat::Standard;
+
+        /// quantize all vertices of this mesh to compact format
+        std::vector<CompactVertex> BuildCompactVertices() const;
+
+        /// split vertices into position and attribute streams in this mesh's vertex format
+        VertexStreams BuildVertexStreams() const;
+
+        /**
+         * @brief Write vertices in this mesh's vertex format straight to their streams, eg in mapped staging memory.
+         *
+         * @param positions : receives GetVertexCount() positions, VertexFormatInfo::positionStride bytes each
+         * @param attributes : receives GetVertexCount() attributes, VertexFormatInfo::attributeStride bytes each
+         */
+        void WriteVertexStreams(uint8_t* positions, uint8_t* attributes) const;
+
+        /// push constants needed by shaders to decode this mesh's vertices
+        /// standard positions get identity offset and scale, so position only shaders work for both formats
+        GPUMeshData GetGPUMeshData() const;
+
+        /// vertex data, either owned by mesh or inside mapped cache
+        const Vertex* GetVertexData() const{
+            return mapped.file ? mapped.vertices : vertices.data();
+        }
+
+        /// number of vertices in mesh
+        size_t GetVertexCount() const{
+            return mapped.file ? mapped.vertexCount : vertices.size();
+        }
+
+        /// index data, either owned by mesh or inside mapped cache
+        const uint32_t* GetIndexData() const{
+            return mapped.file ? mapped.indices : indices.data();
+        }
+
+        /// number of indices in mesh
+        size_t GetIndexCount() const{
+            return mapped.file ? mapped.indexCount : indices.size();
+        }
+
+        /// level of detail data, either owned by mesh or inside mapped cache
+        const MeshLod* GetLodData() const{
+            return mapped.file ? mapped.lods : lods.data();
+        }
+
+        /// number of levels of detail in mesh, zero if levels were not built
+        size_t GetLodCount() const{
+            return mapped.file ? mapped.lodCount : lods.size();
+        }
+
+        /// index range of a level of detail, whole index buffer if levels were not built
+        MeshLod GetLod(size_t level) const{
+            if(level < GetLodCount()) return GetLodData()[level];
+            return {0, static_cast<uint32_t>(GetIndexCount()), 0.f};
+        }
+
+        /// meshlet data, either owned by mesh or inside mapped cache
+        const Meshlet* GetMeshletData() const{
+            return mapped.file ? mapped.meshlets : meshlets.data();
+        }
+
+        /// number of meshlets in mesh, zero if mesh was not split
+        size_t GetMeshletCount() const{
+            return mapped.file ? mapped.meshletCount : meshlets.size();
+        }
+
+        /// submesh data, either owned by mesh or inside mapped cache
+        const Submesh* GetSubmeshData() const{
+            return mapped.file ? mapped.submeshes : submeshes.data();
+        }
+
+        /// number of submeshes in mesh
+        size_t GetSubmeshCount() const{
+            return mapped.file ? mapped.submeshCount : submeshes.size();
+        }
+
+        /// material data, either owned by mesh or inside mapped cache
+        const MeshMaterial* GetMaterialData() const{
+            return mapped.file ? mapped.materials : materials.data();
+        }
+
+        /// number of materials in mesh
+        size_t GetMaterialCount() const{
+            return mapped.file ? mapped.materialCount : materials.size();
+        }
+
+        /// add a single submesh covering all indices with an unnamed material, if mesh has no submeshes
+        void EnsureSubmeshes();
+
+        /// vertices and indices of this mesh inside geometry buffer of its vertex format, set when mesh is uploaded
+        GeometryRange geometry;
 
         /**
-        * @brief load mesh from obj file
+        * @brief load mesh from obj file.
+        *        Vertices shared between faces are deduplicated
+        *        and faces are stored as indices into them.
+        *        Triangles and vertices are reordered for gpu caches,
+        *        split into meshlets and simplified into levels of detail
+        *        before the cache is written, see mesh_optimizer.hpp,
+        *        meshlet.hpp and mesh_simplifier.hpp.
+        *        A binary cache is written beside the obj file on first load
+        *        and is used instead of parsing the obj on later loads.
         * 
         * @param filename : input filename
+        * @param parser : parser to use when there is no valid cache
         */
-        bool LoadMeshFromOBJ(const char* filename);
+        bool LoadMeshFromOBJ(const char* filename, ObjParser parser = ObjParser::Native);
+
+        /**
+        * @brief build mesh from already parsed obj data.
+        *        Vertices are deduplicated, triangles are grouped into
+        *        one submesh per material and bounds are computed,
+        *        no optimization or caching is done.
+        * 
+        * @param obj : parsed obj data
+        */
+        void LoadMeshFromOBJData(const ObjData& obj);
+    };
+
+    /// axis aligned bounds of vertex positions found with 4 wide SIMD min/max where available, zero sized at origin when count is 0
+    BoundingBox ComputeVertexBounds(const Vertex* vertices, size_t count);
+
+    /// sphere centered on given bounds that reaches farthest vertex, never larger than sphere around bounds
+    BoundingSphere ComputeBoundingSphere(const Vertex* vertices, size_t count, const BoundingBox& bounds);
+
+}
+
+namespace std{
+
+    /// hash vertex so that it can be used as a key in unordered containers
+    template<>
+    struct hash<GameZero::Vertex>{
+        size_t operator () (const GameZero::Vertex& vertex) const noexcept{
+            // hash raw bytes, consistent with Vertex::operator ==
+            return GameZero::HashBytes(&vertex, sizeof(GameZero::Vertex));
+        }
     };
 
 }
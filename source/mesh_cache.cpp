@@ -0,0 +1,248 @@
+#include "mesh_cache.hpp"
+#include "mesh.hpp"
+#include "mesh_codec.hpp"
+#include "settings.hpp"
+#include "utils/log.hpp"
+#include "utils/mapped_file.hpp"
+
+#include <cstring>
+#include <vector>
+
+// range [first, first + count) lies inside total elements, without wrapping on corrupt values
+static bool IsRangeInside(uint64_t first, uint64_t count, uint64_t total){
+    return first <= total && count <= total - first;
+}
+
+// everything read from cache is drawn as it is, so a corrupt cache must be caught here before it reaches gpu
+static bool IsMappedMeshValid(const GameZero::MappedMeshData& mapped){
+    using namespace GameZero;
+    // vertex offsets and indices are 32 bit on gpu
+    if(mapped.vertexCount > UINT32_MAX || mapped.indexCount > UINT32_MAX || mapped.indexCount % 3 != 0) return false;
+    for(size_t i = 0; i < mapped.indexCount; i++){
+        if(mapped.indices[i] >= mapped.vertexCount) return false;
+    }
+
+    if(mapped.lodCount > MeshMaxLodCount) return false;
+    for(size_t i = 0; i < mapped.lodCount; i++){
+        if(!IsRangeInside(mapped.lods[i].firstIndex, mapped.lods[i].indexCount, mapped.indexCount)) return false;
+    }
+
+    for(size_t i = 0; i < mapped.meshletCount; i++){
+        if(!IsRangeInside(mapped.meshlets[i].firstIndex, mapped.meshlets[i].indexCount, mapped.indexCount)) return false;
+    }
+
+    // full detail range of submeshes is drawn even by meshes without levels of detail
+    size_t submeshLodCount = mapped.lodCount > 0 ? mapped.lodCount : 1;
+    for(size_t i = 0; i < mapped.submeshCount; i++){
+        const Submesh& submesh = mapped.submeshes[i];
+        if(!IsRangeInside(submesh.firstMeshlet, submesh.meshletCount, mapped.meshletCount)) return false;
+        for(size_t level = 0; level < submeshLodCount; level++){
+            if(!IsRangeInside(submesh.lods[level].firstIndex, submesh.lods[level].indexCount, mapped.indexCount)) return false;
+        }
+    }
+
+    // names and paths are read as strings
+    for(size_t i = 0; i < mapped.materialCount; i++){
+        const MeshMaterial& material = mapped.materials[i];
+        if(!memchr(material.name, 0, sizeof(material.name)) || !memchr(material.diffuseTexture, 0, sizeof(material.diffuseTexture))) return false;
+    }
+    return true;
+}
+
+std::string GameZero::GetMeshCachePath(const char* sourceFilename, bool mergedFaces){
+    return GetCacheFilePath(sourceFilename, mergedFaces ? ".merged.gzmesh" : ".gzmesh");
+}
+
+// load mesh from cache if it is up to date
+bool GameZero::LoadMeshCache(const char* sourceFilename, Mesh& mesh){
+    std::string cachePath = GetMeshCachePath(sourceFilename, mesh.mergeCoplanarFaces);
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if(!OpenCacheFile(sourceFilename, cachePath, MeshCacheMagic, MeshCacheVersion, sizeof(MeshCacheHeader), "Mesh", *file)) return false;
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file->data);
+
+    // section table comes right after header
+    uint64_t sectionTableEnd = sizeof(MeshCacheHeader) + uint64_t(header->sectionCount) * sizeof(MeshCacheSection);
+    if(sectionTableEnd > file->size){
+        LOG(WARNING, "Mesh cache [ %s ] is truncated", cachePath.c_str());
+        return false;
+    }
+    const MeshCacheSection* sections = reinterpret_cast<const MeshCacheSection*>(file->data + sizeof(MeshCacheHeader));
+
+    MappedMeshData mapped;
+    for(uint32_t i = 0; i < header->sectionCount; i++){
+        const MeshCacheSection& section = sections[i];
+
+        // every section must lie completely inside file
+        if(!IsRangeInside(section.offset, section.size, file->size)){
+            LOG(WARNING, "Mesh cache [ %s ] is truncated", cachePath.c_str());
+            return false;
+        }
+
+        // sections used in place must hold all of their elements, encoded ones must be able to
+        auto HoldsElements = [&section](size_t stride){
+            return section.stride == stride && section.count <= section.size / stride;
+        };
+        auto HoldsEncodedElements = [&section](size_t stride){
+            return section.stride == stride && section.count <= GetMaxEncodedCount(section.size, stride);
+        };
+
+        const uint8_t* sectionData = file->data + section.offset;
+        switch(section.type){
+            case MeshCacheSectionType::Vertices:
+                if(!HoldsElements(sizeof(Vertex))) return false;
+                mapped.vertices = reinterpret_cast<const Vertex*>(sectionData);
+                mapped.vertexCount = section.count;
+                break;
+
+            case MeshCacheSectionType::Indices:
+                if(!HoldsElements(sizeof(uint32_t))) return false;
+                mapped.indices = reinterpret_cast<const uint32_t*>(sectionData);
+                mapped.indexCount = section.count;
+                break;
+
+            case MeshCacheSectionType::Meshlets:
+                if(!HoldsElements(sizeof(Meshlet))) return false;
+                mapped.meshlets = reinterpret_cast<const Meshlet*>(sectionData);
+                mapped.meshletCount = section.count;
+                break;
+
+            case MeshCacheSectionType::Lods:
+                if(!HoldsElements(sizeof(MeshLod))) return false;
+                mapped.lods = reinterpret_cast<const MeshLod*>(sectionData);
+                mapped.lodCount = section.count;
+                break;
+
+            case MeshCacheSectionType::Submeshes:
+                if(!HoldsElements(sizeof(Submesh))) return false;
+                mapped.submeshes = reinterpret_cast<const Submesh*>(sectionData);
+                mapped.submeshCount = section.count;
+                break;
+
+            case MeshCacheSectionType::Materials:
+                if(!HoldsElements(sizeof(MeshMaterial))) return false;
+                mapped.materials = reinterpret_cast<const MeshMaterial*>(sectionData);
+                mapped.materialCount = section.count;
+                break;
+
+            case MeshCacheSectionType::EncodedVertices: {
+                if(!HoldsEncodedElements(sizeof(Vertex))) return false;
+                // elements are left uninitialized, decoder writes all of them
+                std::shared_ptr<Vertex[]> decoded(new Vertex[section.count]);
+                if(!DecodeVertexBuffer(decoded.get(), section.count, sizeof(Vertex), sectionData, section.size)){
+                    LOG(WARNING, "Mesh cache [ %s ] has corrupt vertices", cachePath.c_str());
+                    return false;
+                }
+                mapped.decodedVertices = decoded;
+                mapped.vertices = decoded.get();
+                mapped.vertexCount = section.count;
+                break;
+            }
+
+            case MeshCacheSectionType::EncodedIndices: {
+                if(!HoldsEncodedElements(sizeof(uint32_t))) return false;
+                std::shared_ptr<uint32_t[]> decoded(new uint32_t[section.count]);
+                if(!DecodeIndexBuffer(decoded.get(), section.count, sectionData, section.size)){
+                    LOG(WARNING, "Mesh cache [ %s ] has corrupt indices", cachePath.c_str());
+                    return false;
+                }
+                mapped.decodedIndices = decoded;
+                mapped.indices = decoded.get();
+                mapped.indexCount = section.count;
+                break;
+            }
+
+            // sections from newer writers are skipped
+            default:
+                break;
+        }
+    }
+
+    if(!mapped.vertices || !mapped.indices){
+        LOG(WARNING, "Mesh cache [ %s ] is missing geometry", cachePath.c_str());
+        return false;
+    }
+    if(!IsMappedMeshValid(mapped)){
+        LOG(WARNING, "Mesh cache [ %s ] has ranges outside of its geometry and will be rebuilt", cachePath.c_str());
+        return false;
+    }
+
+    // mesh keeps mapping alive as long as it needs the data
+    mapped.file = file;
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.meshlets.clear();
+    mesh.lods.clear();
+    mesh.submeshes.clear();
+    mesh.materials.clear();
+    mesh.renderMaterials.clear();
+    mesh.mapped = mapped;
+    mesh.bounds = header->bounds;
+    mesh.boundingSphere = header->boundingSphere;
+    mesh.uvTiling.tileSize = glm::vec2(header->uvTileSize[0], header->uvTileSize[1]);
+    mesh.uvTiling.stride = header->uvTileStride;
+
+    return true;
+}
+
+// write mesh cache beside source file
+bool GameZero::WriteMeshCache(const char* sourceFilename, const Mesh& mesh){
+    std::string cachePath = GetMeshCachePath(sourceFilename, mesh.mergeCoplanarFaces);
+
+    MeshCacheHeader header = {};
+    if(!MakeCacheFileHeader(sourceFilename, MeshCacheMagic, MeshCacheVersion, header.file)) return false;
+
+    // data blobs to write, in order
+    struct SectionData{
+        MeshCacheSectionType type;
+        uint32_t stride;
+        const void* data;
+        uint64_t count;
+        uint64_t size;
+    };
+
+    SectionData sectionData[] = {
+        {MeshCacheSectionType::Vertices, sizeof(Vertex), mesh.GetVertexData(), mesh.GetVertexCount(), mesh.GetVertexCount() * sizeof(Vertex)},
+        {MeshCacheSectionType::Indices, sizeof(uint32_t), mesh.GetIndexData(), mesh.GetIndexCount(), mesh.GetIndexCount() * sizeof(uint32_t)},
+        {MeshCacheSectionType::Meshlets, sizeof(Meshlet), mesh.GetMeshletData(), mesh.GetMeshletCount(), mesh.GetMeshletCount() * sizeof(Meshlet)},
+        {MeshCacheSectionType::Lods, sizeof(MeshLod), mesh.GetLodData(), mesh.GetLodCount(), mesh.GetLodCount() * sizeof(MeshLod)},
+        {MeshCacheSectionType::Submeshes, sizeof(Submesh), mesh.GetSubmeshData(), mesh.GetSubmeshCount(), mesh.GetSubmeshCount() * sizeof(Submesh)},
+        {MeshCacheSectionType::Materials, sizeof(MeshMaterial), mesh.GetMaterialData(), mesh.GetMaterialCount(), mesh.GetMaterialCount() * sizeof(MeshMaterial)}
+    };
+
+#if defined(GAMEZERO_ENCODE_MESH_CACHE)
+    // geometry is most of the file, encoded data replaces it and must outlive writing
+    std::vector<uint8_t> encodedVertices = EncodeVertexBuffer(mesh.GetVertexData(), mesh.GetVertexCount(), sizeof(Vertex));
+    std::vector<uint8_t> encodedIndices = EncodeIndexBuffer(mesh.GetIndexData(), mesh.GetIndexCount());
+    sectionData[0] = {MeshCacheSectionType::EncodedVertices, sizeof(Vertex), encodedVertices.data(), mesh.GetVertexCount(), encodedVertices.size()};
+    sectionData[1] = {MeshCacheSectionType::EncodedIndices, sizeof(uint32_t), encodedIndices.data(), mesh.GetIndexCount(), encodedIndices.size()};
+#endif
+    constexpr uint32_t sectionCount = sizeof(sectionData) / sizeof(SectionData);
+
+    header.bounds = mesh.bounds;
+    header.boundingSphere = mesh.boundingSphere;
+    header.uvTileSize[0] = mesh.uvTiling.tileSize.x;
+    header.uvTileSize[1] = mesh.uvTiling.tileSize.y;
+    header.uvTileStride = mesh.uvTiling.stride;
+    header.sectionCount = sectionCount;
+
+    // lay out sections one after another, after header and section table
+    MeshCacheSection sections[sectionCount];
+    CacheFileBlob blobs[sectionCount + 2] = {
+        {0, &header, sizeof(header)},
+        {sizeof(header), sections, sizeof(sections)}
+    };
+    uint64_t offset = sizeof(MeshCacheHeader) + sizeof(sections);
+    for(uint32_t i = 0; i < sectionCount; i++){
+        offset = AlignCacheOffset(offset, MeshCacheAlignment);
+        sections[i].type = sectionData[i].type;
+        sections[i].stride = sectionData[i].stride;
+        sections[i].offset = offset;
+        sections[i].count = sectionData[i].count;
+        sections[i].size = sectionData[i].size;
+        blobs[i + 2] = {offset, sectionData[i].data, sectionData[i].size};
+        offset += sectionData[i].size;
+    }
+
+    return WriteCacheFile(cachePath, blobs, sectionCount + 2, "Mesh");
+}
@@ -0,0 +1,122 @@
+/**
+ * @file mesh_cache.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief binary mesh cache written beside source mesh files
+ * @version 0.1
+ * @date 2021-06-25
+ * 
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ * 
+ */
+
+#ifndef GAMEZERO_MESH_CACHE_HPP
+#define GAMEZERO_MESH_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include "math/bounds.hpp"
+#include "utils/cache_file.hpp"
+
+namespace GameZero{
+
+    class Mesh;
+
+    /// "GZMC" in little endian
+    constexpr static uint32_t MeshCacheMagic = 0x434D5A47;
+    /// bump this whenever layout of cache, any of its sections or processing of stored data changes
+    /// 2 : vertices and indices are reordered by mesh optimizer
+    /// 3 : meshlets section is added and indices are grouped by meshlet
+    /// 4 : levels of detail section is added and their indices follow full detail indices
+    /// 5 : submeshes and materials sections are added and indices are grouped by material
+    /// 6 : bounding sphere is added to header
+    /// 7 : uv tiling of merged meshes is added to header
+    /// 8 : sections carry their size in file and vertices and indices can be encoded
+    constexpr static uint32_t MeshCacheVersion = 8;
+
+    /// types of data blobs stored in mesh cache
+    enum class MeshCacheSectionType : uint32_t{
+        Vertices = 0,
+        Indices = 1,
+        Meshlets = 2,
+        Lods = 3,
+        Submeshes = 4,
+        Materials = 5,
+        /// vertices encoded with EncodeVertexBuffer, see mesh_codec.hpp
+        EncodedVertices = 6,
+        /// indices encoded with EncodeIndexBuffer
+        EncodedIndices = 7
+    };
+
+    /// describes where a data blob lives in cache file
+    struct MeshCacheSection{
+        MeshCacheSectionType type;
+        /// size of one element in bytes
+        uint32_t stride;
+        /// offset from start of file in bytes
+        uint64_t offset;
+        /// number of elements
+        uint64_t count;
+        /// bytes in file, count * stride unless section is encoded
+        uint64_t size;
+    };
+
+    /**
+     * @brief Header at the start of every mesh cache file.
+     *        Header is followed by sectionCount number of MeshCacheSection
+     *        and then the data blobs, each aligned to MeshCacheAlignment bytes.
+     */
+    struct MeshCacheHeader{
+        /// format of cache and source it was made from
+        CacheFileHeader file;
+
+        /// mesh bounds
+        BoundingBox bounds;
+        /// mesh bounding sphere
+        BoundingSphere boundingSphere;
+
+        /// atlas tile size and stride of tiled texture coordinates, zero when they are plain
+        float uvTileSize[2];
+        float uvTileStride;
+
+        /// number of sections after header
+        uint32_t sectionCount;
+    };
+
+    /// alignment of each section blob in file
+    constexpr static uint64_t MeshCacheAlignment = 16;
+
+    /**
+     * @brief Get path of cache file for a given source mesh file
+     * 
+     * @param sourceFilename : source mesh file (eg : obj file)
+     * @param mergedFaces : path for mesh with merged coplanar faces, so that both versions can be cached
+     */
+    std::string GetMeshCachePath(const char* sourceFilename, bool mergedFaces = false);
+
+    /**
+     * @brief Load mesh from its cache file if cache is up to date with source.
+     *        Data is not copied, mesh keeps the file mapped and points into it,
+     *        except for encoded vertices and indices which are decoded into
+     *        memory shared the same way.
+     *        Materials are stored as they were when cache was written, so only
+     *        changes to source file itself make the cache stale.
+     * 
+     * @param sourceFilename : source mesh file (eg : obj file)
+     * @param mesh : mesh to load into
+     * @return true if cache was valid and loaded
+     */
+    bool LoadMeshCache(const char* sourceFilename, Mesh& mesh);
+
+    /**
+     * @brief Write mesh cache beside source mesh file.
+     *        Vertices and indices are encoded when GAMEZERO_ENCODE_MESH_CACHE is set.
+     * 
+     * @param sourceFilename : source mesh file that mesh was loaded from
+     * @param mesh : mesh to write
+     * @return true on success
+     */
+    bool WriteMeshCache(const char* sourceFilename, const Mesh& mesh);
+
+}
+
+#endif//GAMEZERO_MESH_CACHE_HPP
@@ -0,0 +1,291 @@
+#include "mesh_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define GAMEZERO_CODEC_SSE2 1
+#endif
+
+using namespace GameZero;
+
+/// bytes a group takes for each of the 4 bit widths 0, 2, 4 and 8
+static const size_t GroupDataSize[4] = {0, 4, 8, 16};
+
+static uint32_t ZigzagEncode(uint32_t value){
+    return (value << 1) ^ uint32_t(int32_t(value) >> 31);
+}
+
+#if !defined(GAMEZERO_CODEC_SSE2)
+// sse2 decoding undoes zigzag 4 words at a time instead
+static uint32_t ZigzagDecode(uint32_t value){
+    return (value >> 1) ^ (0u - (value & 1));
+}
+#endif
+
+// smallest bit width that holds every byte of a group, as index into GroupDataSize
+static uint32_t GetGroupMode(const uint8_t* bytes){
+    uint8_t largest = 0;
+    for(size_t i = 0; i < MeshCodecGroupSize; i++) largest = std::max(largest, bytes[i]);
+    if(largest == 0) return 0;
+    if(largest < 4) return 1;
+    if(largest < 16) return 2;
+    return 3;
+}
+
+// first value goes to highest bits of each byte
+static void PackGroup(const uint8_t* bytes, uint32_t mode, std::vector<uint8_t>& output){
+    switch(mode){
+        case 1:
+            for(size_t i = 0; i < MeshCodecGroupSize; i += 4){
+                output.push_back(uint8_t((bytes[i] << 6) | (bytes[i + 1] << 4) | (bytes[i + 2] << 2) | bytes[i + 3]));
+            }
+            break;
+        case 2:
+            for(size_t i = 0; i < MeshCodecGroupSize; i += 2){
+                output.push_back(uint8_t((bytes[i] << 4) | bytes[i + 1]));
+            }
+            break;
+        case 3:
+            output.insert(output.end(), bytes, bytes + MeshCodecGroupSize);
+            break;
+        default:
+            break;
+    }
+}
+
+// 2 bit mode of every group of a plane, 4 groups per byte, followed by packed groups
+static void EncodePlane(const uint8_t* bytes, size_t groupCount, std::vector<uint8_t>& output){
+    size_t headerOffset = output.size();
+    output.resize(headerOffset + (groupCount + 3) / 4, 0);
+
+    for(size_t g = 0; g < groupCount; g++){
+        uint32_t mode = GetGroupMode(bytes + g * MeshCodecGroupSize);
+        output[headerOffset + g / 4] |= uint8_t(mode << ((g % 4) * 2));
+        PackGroup(bytes + g * MeshCodecGroupSize, mode, output);
+    }
+}
+
+std::vector<uint8_t> GameZero::EncodeVertexBuffer(const void* vertices, size_t count, size_t stride){
+    std::vector<uint8_t> output;
+    if(stride == 0 || stride % 4 != 0 || stride > MeshCodecMaxStride) return output;
+
+    const uint8_t* source = static_cast<const uint8_t*>(vertices);
+    const size_t columnCount = stride / 4;
+
+    // differences carry on from block to block
+    uint32_t last[MeshCodecMaxStride / 4] = {};
+    uint8_t planes[4][MeshCodecBlockSize];
+
+    for(size_t first = 0; first < count; first += MeshCodecBlockSize){
+        size_t blockCount = std::min(MeshCodecBlockSize, count - first);
+        size_t groupCount = (blockCount + MeshCodecGroupSize - 1) / MeshCodecGroupSize;
+
+        for(size_t c = 0; c < columnCount; c++){
+            // padding after last vertex repeats it, so its differences are 0
+            memset(planes, 0, sizeof(planes));
+            for(size_t v = 0; v < blockCount; v++){
+                uint32_t word;
+                memcpy(&word, source + (first + v) * stride + c * 4, 4);
+                uint32_t delta = ZigzagEncode(word - last[c]);
+                last[c] = word;
+
+                planes[0][v] = uint8_t(delta);
+                planes[1][v] = uint8_t(delta >> 8);
+                planes[2][v] = uint8_t(delta >> 16);
+                planes[3][v] = uint8_t(delta >> 24);
+            }
+
+            for(size_t p = 0; p < 4; p++) EncodePlane(planes[p], groupCount, output);
+        }
+    }
+
+    return output;
+}
+
+// unpack groups of a plane, false if plane runs past end of data
+static bool DecodePlane(const uint8_t*& data, const uint8_t* end, size_t groupCount, uint8_t* bytes){
+    size_t headerSize = (groupCount + 3) / 4;
+    if(size_t(end - data) < headerSize) return false;
+    const uint8_t* header = data;
+    data += headerSize;
+
+    for(size_t g = 0; g < groupCount; g++){
+        uint32_t mode = (header[g / 4] >> ((g % 4) * 2)) & 3;
+        size_t dataSize = GroupDataSize[mode];
+        if(size_t(end - data) < dataSize) return false;
+
+        uint8_t* group = bytes + g * MeshCodecGroupSize;
+#if defined(GAMEZERO_CODEC_SSE2)
+        // spread packed bits over 16 bytes, interleaving so that first value lands in first byte
+        __m128i values;
+        switch(mode){
+            case 1: {
+                int32_t packed;
+                memcpy(&packed, data, 4);
+                __m128i x = _mm_cvtsi32_si128(packed);
+                __m128i mask = _mm_set1_epi8(3);
+                __m128i a = _mm_and_si128(_mm_srli_epi16(x, 6), mask);
+                __m128i b = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+                __m128i c = _mm_and_si128(_mm_srli_epi16(x, 2), mask);
+                __m128i d = _mm_and_si128(x, mask);
+                values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+                break;
+            }
+            case 2: {
+                __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+                __m128i mask = _mm_set1_epi8(15);
+                values = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x, 4), mask), _mm_and_si128(x, mask));
+                break;
+            }
+            case 3:
+                values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                break;
+            default:
+                values = _mm_setzero_si128();
+                break;
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(group), values);
+#else
+        switch(mode){
+            case 1:
+                for(size_t i = 0; i < MeshCodecGroupSize; i++) group[i] = (data[i / 4] >> (6 - (i % 4) * 2)) & 3;
+                break;
+            case 2:
+                for(size_t i = 0; i < MeshCodecGroupSize; i++) group[i] = (data[i / 2] >> (i % 2 == 0 ? 4 : 0)) & 15;
+                break;
+            case 3:
+                memcpy(group, data, MeshCodecGroupSize);
+                break;
+            default:
+                memset(group, 0, MeshCodecGroupSize);
+                break;
+        }
+#endif
+        data += dataSize;
+    }
+
+    return true;
+}
+
+// rebuild words from byte planes, undo zigzag and sum differences, carrying last word across groups
+static uint32_t DecodeWords(const uint8_t (*planes)[MeshCodecBlockSize], size_t groupCount, uint32_t last, uint32_t* words){
+#if defined(GAMEZERO_CODEC_SSE2)
+    __m128i carry = _mm_set1_epi32(int32_t(last));
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+
+    for(size_t g = 0; g < groupCount; g++){
+        size_t offset = g * MeshCodecGroupSize;
+        __m128i p0 = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[0] + offset));
+        __m128i p1 = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[1] + offset));
+        __m128i p2 = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[2] + offset));
+        __m128i p3 = _mm_load_si128(reinterpret_cast<const __m128i*>(planes[3] + offset));
+
+        // low and high halves of 16 bit words, then whole 32 bit words, 4 at a time
+        __m128i low01 = _mm_unpacklo_epi8(p0, p1), high01 = _mm_unpackhi_epi8(p0, p1);
+        __m128i low23 = _mm_unpacklo_epi8(p2, p3), high23 = _mm_unpackhi_epi8(p2, p3);
+        __m128i quads[4] = {
+            _mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+            _mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23)
+        };
+
+        for(__m128i x : quads){
+            x = _mm_xor_si128(_mm_srli_epi32(x, 1), _mm_sub_epi32(zero, _mm_and_si128(x, one)));
+
+            // prefix sum inside register, then add everything before it
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi32(x, carry);
+            carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(words + offset), x);
+            offset += 4;
+        }
+    }
+
+    return uint32_t(_mm_cvtsi128_si32(carry));
+#else
+    for(size_t v = 0; v < groupCount * MeshCodecGroupSize; v++){
+        uint32_t delta = uint32_t(planes[0][v]) | (uint32_t(planes[1][v]) << 8) | (uint32_t(planes[2][v]) << 16) | (uint32_t(planes[3][v]) << 24);
+        last += ZigzagDecode(delta);
+        words[v] = last;
+    }
+    return last;
+#endif
+}
+
+// put decoded words of up to 4 neighbouring columns back into their vertices
+static void StoreColumns(const uint32_t (*words)[MeshCodecBlockSize], size_t columns, size_t count, uint8_t* output, size_t stride){
+    // tightly packed single column is a plain copy
+    if(columns == 1 && stride == 4){
+        memcpy(output, words[0], count * 4);
+        return;
+    }
+
+    size_t v = 0;
+#if defined(GAMEZERO_CODEC_SSE2)
+    // 4 words of 4 columns are transposed into 4 vertices, each written with one store
+    if(columns == 4){
+        for(; v + 4 <= count; v += 4){
+            __m128 row0 = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(words[0] + v)));
+            __m128 row1 = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(words[1] + v)));
+            __m128 row2 = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(words[2] + v)));
+            __m128 row3 = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(words[3] + v)));
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            _mm_storeu_ps(reinterpret_cast<float*>(output + (v + 0) * stride), row0);
+            _mm_storeu_ps(reinterpret_cast<float*>(output + (v + 1) * stride), row1);
+            _mm_storeu_ps(reinterpret_cast<float*>(output + (v + 2) * stride), row2);
+            _mm_storeu_ps(reinterpret_cast<float*>(output + (v + 3) * stride), row3);
+        }
+    }
+#endif
+    for(; v < count; v++){
+        for(size_t c = 0; c < columns; c++){
+            memcpy(output + v * stride + c * 4, &words[c][v], 4);
+        }
+    }
+}
+
+bool GameZero::DecodeVertexBuffer(void* destination, size_t count, size_t stride, const uint8_t* data, size_t size){
+    if(stride == 0 || stride % 4 != 0 || stride > MeshCodecMaxStride) return false;
+
+    uint8_t* output = static_cast<uint8_t*>(destination);
+    const uint8_t* end = data + size;
+    const size_t columnCount = stride / 4;
+
+    uint32_t last[MeshCodecMaxStride / 4] = {};
+    alignas(16) uint8_t planes[4][MeshCodecBlockSize];
+    alignas(16) uint32_t words[4][MeshCodecBlockSize];
+
+    for(size_t first = 0; first < count; first += MeshCodecBlockSize){
+        size_t blockCount = std::min(MeshCodecBlockSize, count - first);
+        size_t groupCount = (blockCount + MeshCodecGroupSize - 1) / MeshCodecGroupSize;
+
+        // columns are decoded 4 at a time so that they can be stored a vertex at a time
+        for(size_t c = 0; c < columnCount; c += 4){
+            size_t columns = std::min<size_t>(4, columnCount - c);
+            for(size_t k = 0; k < columns; k++){
+                for(size_t p = 0; p < 4; p++){
+                    if(!DecodePlane(data, end, groupCount, planes[p])) return false;
+                }
+                last[c + k] = DecodeWords(planes, groupCount, last[c + k], words[k]);
+            }
+            StoreColumns(words, columns, blockCount, output + first * stride + c * 4, stride);
+        }
+    }
+
+    // trailing data means count or stride do not match what was encoded
+    return data == end;
+}
+
+// indices are a single column of words, each is differenced against index before it
+// after vertex cache optimization triangles follow each other like a strip, so these differences stay small
+std::vector<uint8_t> GameZero::EncodeIndexBuffer(const uint32_t* indices, size_t count){
+    return EncodeVertexBuffer(indices, count, sizeof(uint32_t));
+}
+
+bool GameZero::DecodeIndexBuffer(uint32_t* destination, size_t count, const uint8_t* data, size_t size){
+    return DecodeVertexBuffer(destination, count, sizeof(uint32_t), data, size);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file mesh_codec.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief lossless compression of vertex and index buffers for mesh caches
+ * @version 0.1
+ * @date 2021-07-01
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_MESH_CODEC_HPP
+#define GAMEZERO_MESH_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GameZero{
+
+    /// vertices encoded and decoded together, bounds scratch memory of decoder
+    constexpr static size_t MeshCodecBlockSize = 256;
+
+    /// values that share one bit width inside a byte plane
+    constexpr static size_t MeshCodecGroupSize = 16;
+
+    /// largest vertex stride codec accepts
+    constexpr static size_t MeshCodecMaxStride = 256;
+
+    /**
+     * @brief Encode vertices losslessly.
+     *        Every 32 bit word of a vertex is stored as zigzag encoded difference
+     *        to same word of previous vertex, so that close attribute values give small numbers.
+     *        Differences of a block of vertices are split into 4 byte planes and every group
+     *        of 16 bytes in a plane is packed with 0, 2, 4 or 8 bits per byte, whichever fits.
+     *        Works best on vertices in the order mesh optimizer leaves them.
+     *
+     * @param vertices : vertex data
+     * @param count : number of vertices
+     * @param stride : size of a vertex in bytes, multiple of 4 and at most MeshCodecMaxStride
+     * @return std::vector<uint8_t> : encoded data, empty if stride is not supported
+     */
+    std::vector<uint8_t> EncodeVertexBuffer(const void* vertices, size_t count, size_t stride);
+
+    /**
+     * @brief Decode vertices encoded with EncodeVertexBuffer, with SSE2 where available
+     *
+     * @param destination : receives count vertices
+     * @param count : number of vertices that were encoded
+     * @param stride : vertex stride that was encoded with
+     * @param data : encoded data
+     * @param size : size of encoded data in bytes
+     * @return false if data is malformed or does not hold count vertices
+     */
+    bool DecodeVertexBuffer(void* destination, size_t count, size_t stride, const uint8_t* data, size_t size);
+
+    /**
+     * @brief Encode triangle indices losslessly.
+     *        Optimized triangles walk the mesh like a strip, so every index is stored
+     *        as difference to index before it, which stays small, and goes through
+     *        same zigzag and byte plane packing as vertices.
+     *
+     * @param indices : index data
+     * @param count : number of indices
+     * @return std::vector<uint8_t> : encoded data
+     */
+    std::vector<uint8_t> EncodeIndexBuffer(const uint32_t* indices, size_t count);
+
+    /// decode indices encoded with EncodeIndexBuffer, false if data is malformed
+    bool DecodeIndexBuffer(uint32_t* destination, size_t count, const uint8_t* data, size_t size);
+
+    /// most elements size bytes of encoded data can hold, so that counts read from a file can be checked before allocating
+    /// each byte plane spends at least 2 bits on every group of 16 elements, so 64 elements take at least stride bytes
+    inline size_t GetMaxEncodedCount(size_t size, size_t stride){ return stride ? size / stride * 64 + 64 : 0; }
+
+}
+
+#endif//GAMEZERO_MESH_CODEC_HPP
@@ -0,0 +1,329 @@
+#include "mesh_optimizer.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace GameZero;
+
+// vertex is in a FIFO cache if fewer than cacheSize vertices were added after it
+static bool IsInCache(uint32_t timeStamp, uint32_t time, uint32_t cacheSize){
+    return time - timeStamp <= cacheSize;
+}
+
+// add triangle to simulated FIFO cache, returns number of misses
+static uint32_t UpdateCache(const uint32_t* triangle, std::vector<uint32_t>& timeStamps, uint32_t& time, uint32_t cacheSize){
+    uint32_t misses = 0;
+    for(uint32_t i = 0; i < 3; i++){
+        uint32_t vertex = triangle[i];
+        if(!IsInCache(timeStamps[vertex], time, cacheSize)){
+            timeStamps[vertex] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+// counting sort of triangles by vertex
+void GameZero::BuildTriangleAdjacency(TriangleAdjacency& adjacency, const uint32_t* indices, size_t indexCount, size_t vertexCount){
+    adjacency.counts.assign(vertexCount, 0);
+    adjacency.offsets.resize(vertexCount);
+    adjacency.triangles.resize(indexCount);
+
+    for(size_t i = 0; i < indexCount; i++){
+        adjacency.counts[indices[i]]++;
+    }
+
+    uint32_t offset = 0;
+    for(size_t v = 0; v < vertexCount; v++){
+        adjacency.offsets[v] = offset;
+        offset += adjacency.counts[v];
+    }
+
+    // offsets are used as write cursors and restored afterwards
+    for(size_t i = 0; i < indexCount; i++){
+        adjacency.triangles[adjacency.offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    for(size_t v = 0; v < vertexCount; v++){
+        adjacency.offsets[v] -= adjacency.counts[v];
+    }
+}
+
+// simulate FIFO cache over whole index buffer
+VertexCacheStatistics GameZero::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize){
+    VertexCacheStatistics statistics;
+    if(indexCount < 3) return statistics;
+
+    // a zero time stamp must never look cached
+    std::vector<uint32_t> timeStamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    std::vector<bool> referenced(vertexCount, false);
+    size_t referencedCount = 0;
+
+    for(size_t i = 0; i + 2 < indexCount; i += 3){
+        statistics.vertexTransforms += UpdateCache(indices + i, timeStamps, time, cacheSize);
+
+        for(size_t j = i; j < i + 3; j++){
+            if(!referenced[indices[j]]){
+                referenced[indices[j]] = true;
+                referencedCount++;
+            }
+        }
+    }
+
+    statistics.acmr = float(statistics.vertexTransforms) / float(indexCount / 3);
+    statistics.atvr = float(statistics.vertexTransforms) / float(referencedCount);
+    return statistics;
+}
+
+// tipsify, emits all remaining triangles around one vertex at a time
+void GameZero::OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize){
+    TriangleAdjacency adjacency;
+    BuildTriangleAdjacency(adjacency, indices, indexCount, vertexCount);
+
+    // number of triangles not yet emitted around each vertex
+    std::vector<uint32_t> liveTriangles = adjacency.counts;
+    std::vector<uint32_t> timeStamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    std::vector<bool> emitted(indexCount / 3, false);
+
+    // recently used vertices to restart from when fanning runs into a dead end
+    std::vector<uint32_t> deadEnds;
+    // vertices of triangles emitted in current fan
+    std::vector<uint32_t> candidates;
+
+    size_t outputIndex = 0;
+    uint32_t cursor = 0;
+
+    // first vertex that still has triangles
+    while(cursor < vertexCount && liveTriangles[cursor] == 0) cursor++;
+    int64_t fanning = cursor < vertexCount ? cursor : -1;
+
+    while(fanning >= 0){
+        uint32_t vertex = static_cast<uint32_t>(fanning);
+        candidates.clear();
+
+        const uint32_t* neighbours = adjacency.triangles.data() + adjacency.offsets[vertex];
+        for(uint32_t n = 0; n < adjacency.counts[vertex]; n++){
+            uint32_t triangle = neighbours[n];
+            if(emitted[triangle]) continue;
+            emitted[triangle] = true;
+
+            const uint32_t* corners = indices + 3 * triangle;
+            for(uint32_t c = 0; c < 3; c++){
+                uint32_t corner = corners[c];
+                destination[outputIndex++] = corner;
+
+                deadEnds.push_back(corner);
+                candidates.push_back(corner);
+                liveTriangles[corner]--;
+
+                if(!IsInCache(timeStamps[corner], time, cacheSize)){
+                    timeStamps[corner] = time++;
+                }
+            }
+        }
+
+        // prefer the oldest candidate that will still be in cache after its fan is emitted
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for(uint32_t candidate : candidates){
+            if(liveTriangles[candidate] == 0) continue;
+
+            int64_t priority = 0;
+            if(time - timeStamps[candidate] + 2 * liveTriangles[candidate] <= cacheSize){
+                priority = time - timeStamps[candidate];
+            }
+
+            if(priority > bestPriority){
+                bestPriority = priority;
+                fanning = candidate;
+            }
+        }
+
+        if(fanning >= 0) continue;
+
+        // dead end, restart from a recently used vertex
+        while(!deadEnds.empty()){
+            uint32_t deadEnd = deadEnds.back();
+            deadEnds.pop_back();
+            if(liveTriangles[deadEnd] > 0){
+                fanning = deadEnd;
+                break;
+            }
+        }
+
+        if(fanning >= 0) continue;
+
+        // nothing recent is left, continue with next vertex in input order
+        while(cursor < vertexCount && liveTriangles[cursor] == 0) cursor++;
+        if(cursor < vertexCount) fanning = cursor;
+    }
+}
+
+// clusters are drawn in order of how much they face away from mesh center
+void GameZero::OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold, uint32_t cacheSize){
+    size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0) return;
+
+    std::vector<uint32_t> timeStamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    // hard boundaries : triangles where cache optimizer had to restart and nothing was cached
+    std::vector<uint32_t> hardClusters;
+    for(size_t t = 0; t < triangleCount; t++){
+        if(UpdateCache(indices + 3 * t, timeStamps, time, cacheSize) == 3){
+            hardClusters.push_back(static_cast<uint32_t>(t));
+        }
+    }
+    if(hardClusters.empty() || hardClusters.front() != 0) hardClusters.insert(hardClusters.begin(), 0);
+
+    // soft boundaries : split hard clusters further while their acmr stays close to input
+    // cache is flushed at every split, since clusters will not be drawn in this order anymore
+    std::vector<uint32_t> clusters;
+    for(size_t c = 0; c < hardClusters.size(); c++){
+        size_t start = hardClusters[c];
+        size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+
+        time += cacheSize + 1;
+        uint32_t clusterMisses = 0;
+        for(size_t t = start; t < end; t++){
+            clusterMisses += UpdateCache(indices + 3 * t, timeStamps, time, cacheSize);
+        }
+        float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+        clusters.push_back(static_cast<uint32_t>(start));
+
+        time += cacheSize + 1;
+        size_t softStart = start;
+        uint32_t softMisses = 0;
+        for(size_t t = start; t < end; t++){
+            softMisses += UpdateCache(indices + 3 * t, timeStamps, time, cacheSize);
+
+            if(t + 1 < end && float(softMisses) <= clusterThreshold * float(t + 1 - softStart)){
+                clusters.push_back(static_cast<uint32_t>(t + 1));
+                softStart = t + 1;
+                softMisses = 0;
+                time += cacheSize + 1;
+            }
+        }
+    }
+
+    // mesh centroid
+    glm::vec3 meshCentroid(0.f);
+    for(size_t v = 0; v < vertexCount; v++){
+        meshCentroid += vertices[v].position;
+    }
+    meshCentroid /= float(vertexCount > 0 ? vertexCount : 1);
+
+    // sort key : how far cluster lies in front of mesh center along its own normal
+    // such clusters are likely to occlude others and are drawn first
+    size_t clusterCount = clusters.size();
+    std::vector<float> sortKeys(clusterCount);
+    for(size_t c = 0; c < clusterCount; c++){
+        size_t start = clusters[c];
+        size_t end = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid(0.f);
+        glm::vec3 averageCentroid(0.f);
+        glm::vec3 normal(0.f);
+        float area = 0.f;
+
+        for(size_t t = start; t < end; t++){
+            const glm::vec3& p0 = vertices[indices[3 * t + 0]].position;
+            const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+            const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+
+            // cross product length is twice the triangle area
+            glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(triangleNormal);
+            glm::vec3 triangleCentroid = (p0 + p1 + p2) / 3.f;
+
+            centroid += triangleCentroid * triangleArea;
+            averageCentroid += triangleCentroid;
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        // degenerate clusters fall back to plain average
+        centroid = area > 0.f ? centroid / area : averageCentroid / float(end - start);
+        float normalLength = glm::length(normal);
+        normal = normalLength > 0.f ? normal / normalLength : glm::vec3(0.f);
+
+        sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for(size_t c = 0; c < clusterCount; c++) order[c] = static_cast<uint32_t>(c);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b){
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    size_t outputIndex = 0;
+    for(uint32_t c : order){
+        size_t start = clusters[c];
+        size_t end = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+        for(size_t i = 3 * start; i < 3 * end; i++){
+            destination[outputIndex++] = indices[i];
+        }
+    }
+}
+
+// vertices are renumbered in order of first use
+size_t GameZero::OptimizeVertexFetch(Vertex* destination, uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount){
+    constexpr uint32_t Unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, Unused);
+
+    uint32_t nextVertex = 0;
+    for(size_t i = 0; i < indexCount; i++){
+        uint32_t& index = remap[indices[i]];
+        if(index == Unused){
+            index = nextVertex++;
+            destination[index] = vertices[indices[i]];
+        }
+        indices[i] = index;
+    }
+
+    return nextVertex;
+}
+
+// run all passes on an owned mesh
+MeshOptimizationStatistics GameZero::OptimizeMesh(Mesh& mesh){
+    MeshOptimizationStatistics statistics;
+
+    // cached meshes were optimized before they were written
+    if(mesh.mapped.file || mesh.indices.empty()) return statistics;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    size_t indexCount = mesh.indices.size();
+    size_t vertexCount = mesh.vertices.size();
+
+    statistics.before = AnalyzeVertexCache(mesh.indices.data(), indexCount, vertexCount);
+
+    // triangles are reordered within their submesh only, so materials stay grouped
+    mesh.EnsureSubmeshes();
+
+    std::vector<uint32_t> cacheOptimized(indexCount);
+    for(const Submesh& submesh : mesh.submeshes){
+        uint32_t first = submesh.lods[0].firstIndex;
+        uint32_t count = submesh.lods[0].indexCount;
+
+        OptimizeVertexCache(cacheOptimized.data() + first, mesh.indices.data() + first, count, vertexCount);
+        OptimizeOverdraw(mesh.indices.data() + first, cacheOptimized.data() + first, count, mesh.vertices.data(), vertexCount);
+    }
+
+    std::vector<Vertex> fetchOptimized(vertexCount);
+    fetchOptimized.resize(OptimizeVertexFetch(fetchOptimized.data(), mesh.indices.data(), indexCount, mesh.vertices.data(), vertexCount));
+    mesh.vertices.swap(fetchOptimized);
+
+    statistics.after = AnalyzeVertexCache(mesh.indices.data(), indexCount, mesh.vertices.size());
+
+    auto stop_time = std::chrono::high_resolution_clock::now();
+    statistics.time = std::chrono::duration<float, std::milli>(stop_time - start_time).count();
+
+    return statistics;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file mesh_optimizer.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief reorders mesh triangles and vertices for faster gpu processing
+ * @version 0.1
+ * @date 2021-06-27
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_MESH_OPTIMIZER_HPP
+#define GAMEZERO_MESH_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GameZero{
+
+    struct Vertex;
+    class Mesh;
+
+    /// size of the simulated post transform vertex cache
+    constexpr static uint32_t VertexCacheSize = 16;
+
+    /// how well an index buffer uses the post transform vertex cache
+    struct VertexCacheStatistics{
+        /// number of vertex shader invocations
+        uint32_t vertexTransforms = 0;
+        /// average cache miss ratio : transforms per triangle, 0.5 is ideal, 3 is worst
+        float acmr = 0.f;
+        /// average transform to vertex ratio : transforms per vertex, 1 is ideal
+        float atvr = 0.f;
+    };
+
+    /// triangles that use each vertex, stored as one flat array
+    struct TriangleAdjacency{
+        /// number of triangles using each vertex
+        std::vector<uint32_t> counts;
+        /// where triangles of each vertex start in triangles
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    /// find triangles that use each vertex of a triangle list
+    void BuildTriangleAdjacency(TriangleAdjacency& adjacency, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+    /// result of OptimizeMesh
+    struct MeshOptimizationStatistics{
+        VertexCacheStatistics before;
+        VertexCacheStatistics after;
+        /// time taken by all passes in milliseconds
+        float time = 0.f;
+    };
+
+    /**
+     * @brief Simulate a FIFO post transform cache over an index buffer
+     *
+     * @param indices : triangle list
+     * @param indexCount : number of indices
+     * @param vertexCount : number of vertices indices refer to
+     * @param cacheSize : number of vertices cache can hold
+     */
+    VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = VertexCacheSize);
+
+    /**
+     * @brief Reorder triangles so that vertices are reused while still in cache.
+     *        Tipsify : Sander, Nehab, Barczak - Fast Triangle Reordering for
+     *        Vertex Locality and Reduced Overdraw (2007)
+     *
+     * @param destination : reordered triangle list, must not alias indices
+     * @param indices : triangle list
+     * @param indexCount : number of indices
+     * @param vertexCount : number of vertices indices refer to
+     * @param cacheSize : number of vertices cache can hold
+     */
+    void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = VertexCacheSize);
+
+    /**
+     * @brief Reorder clusters of a cache optimized triangle list so that
+     *        outward facing triangles are drawn first and occlude the rest.
+     *        Clusters are split further as long as cache efficiency stays
+     *        within threshold of the input.
+     *
+     * @param destination : reordered triangle list, must not alias indices
+     * @param indices : cache optimized triangle list
+     * @param indexCount : number of indices
+     * @param vertices : vertices indices refer to
+     * @param vertexCount : number of vertices
+     * @param threshold : allowed acmr increase, 1.05 allows 5 percent
+     * @param cacheSize : number of vertices cache can hold
+     */
+    void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f, uint32_t cacheSize = VertexCacheSize);
+
+    /**
+     * @brief Reorder vertices in order of first use by triangles, so that vertex
+     *        fetches walk memory linearly. Unused vertices are dropped.
+     *        Indices are remapped in place.
+     *
+     * @param destination : reordered vertices, must not alias vertices
+     * @param indices : triangle list, remapped in place
+     * @param indexCount : number of indices
+     * @param vertices : vertices indices refer to
+     * @param vertexCount : number of vertices
+     * @return size_t : number of vertices written to destination
+     */
+    size_t OptimizeVertexFetch(Vertex* destination, uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount);
+
+    /**
+     * @brief Run vertex cache, overdraw and vertex fetch optimizations on a
+     *        mesh that owns its vertices and indices.
+     *        Triangles are only reordered within their submesh.
+     *        Meshes loaded from cache are already optimized and are left as they are.
+     *
+     * @param mesh : mesh to optimize
+     * @return MeshOptimizationStatistics : cache statistics before and after
+     */
+    MeshOptimizationStatistics OptimizeMesh(Mesh& mesh);
+
+}
+
+#endif//GAMEZERO_MESH_OPTIMIZER_HPP
@@ -0,0 +1,367 @@
+#include "mesh_simplifier.hpp"
+#include "mesh.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace GameZero;
+
+// symmetric 4x4 matrix measuring squared distance to a set of planes
+struct Quadric{
+    double xx = 0, xy = 0, xz = 0, xw = 0;
+    double yy = 0, yz = 0, yw = 0;
+    double zz = 0, zw = 0;
+    double ww = 0;
+
+    void AddPlane(const glm::vec3& normal, float distance){
+        double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        xx += a * a; xy += a * b; xz += a * c; xw += a * d;
+        yy += b * b; yz += b * c; yw += b * d;
+        zz += c * c; zw += c * d;
+        ww += d * d;
+    }
+
+    void Add(const Quadric& other){
+        xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+        yy += other.yy; yz += other.yz; yw += other.yw;
+        zz += other.zz; zw += other.zw;
+        ww += other.ww;
+    }
+
+    // sum of squared distances of point to all planes
+    double Evaluate(const glm::vec3& point) const{
+        double x = point.x, y = point.y, z = point.z;
+        double error = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+                     + yy * y * y + 2 * yz * y * z + 2 * yw * y
+                     + zz * z * z + 2 * zw * z
+                     + ww;
+        // rounding can make it slightly negative
+        return error > 0 ? error : 0;
+    }
+};
+
+// edge collapse candidate, from is moved onto to
+struct Collapse{
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+// normals closer than this are treated as same for hard edge detection
+constexpr static float SimilarNormalCosine = 0.95f;
+
+static bool AreNormalsSimilar(const glm::vec3& a, const glm::vec3& b){
+    float lengths = glm::length(a) * glm::length(b);
+    if(lengths == 0.f) return glm::length(a) == glm::length(b);
+    return glm::dot(a, b) >= SimilarNormalCosine * lengths;
+}
+
+// key of an undirected edge
+static uint64_t GetEdgeKey(uint32_t a, uint32_t b){
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+// quadric edge collapse on vertices welded by position
+size_t GameZero::SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float& resultError){
+    resultError = 0.f;
+    size_t triangleCount = indexCount / 3;
+
+    // weld vertices by position, vertices with same position (wedges) are contiguous in sorted order
+    std::vector<uint32_t> sortedVertices(vertexCount);
+    for(uint32_t v = 0; v < vertexCount; v++) sortedVertices[v] = v;
+    std::sort(sortedVertices.begin(), sortedVertices.end(), [vertices](uint32_t a, uint32_t b){
+        return memcmp(&vertices[a].position, &vertices[b].position, sizeof(glm::vec3)) < 0;
+    });
+
+    std::vector<uint32_t> positionIds(vertexCount);
+    std::vector<uint32_t> wedgeOffsets;
+    std::vector<glm::vec3> positions;
+    for(size_t i = 0; i < vertexCount; i++){
+        uint32_t vertex = sortedVertices[i];
+        if(i == 0 || memcmp(&vertices[vertex].position, &vertices[sortedVertices[i - 1]].position, sizeof(glm::vec3)) != 0){
+            wedgeOffsets.push_back(static_cast<uint32_t>(i));
+            positions.push_back(vertices[vertex].position);
+        }
+        positionIds[vertex] = static_cast<uint32_t>(positions.size() - 1);
+    }
+    size_t positionCount = positions.size();
+    wedgeOffsets.push_back(static_cast<uint32_t>(vertexCount));
+
+    // triangles by position, and original corners which decide attributes of output
+    std::vector<uint32_t> triangles(3 * triangleCount);
+    std::vector<uint32_t> corners(indices, indices + 3 * triangleCount);
+    for(size_t i = 0; i < 3 * triangleCount; i++){
+        triangles[i] = positionIds[indices[i]];
+    }
+
+    // every vertex gets planes of triangles around it
+    std::vector<Quadric> quadrics(positionCount);
+    for(size_t t = 0; t < triangleCount; t++){
+        const glm::vec3& p0 = positions[triangles[3 * t + 0]];
+        const glm::vec3& p1 = positions[triangles[3 * t + 1]];
+        const glm::vec3& p2 = positions[triangles[3 * t + 2]];
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if(length == 0.f) continue;
+        normal /= length;
+
+        Quadric plane;
+        plane.AddPlane(normal, -glm::dot(normal, p0));
+        for(uint32_t c = 0; c < 3; c++) quadrics[triangles[3 * t + c]].Add(plane);
+    }
+
+    // borders and non manifold edges are not used by exactly two triangles, their vertices never move
+    std::vector<bool> locked(positionCount, false);
+    std::vector<uint64_t> edges;
+    edges.reserve(3 * triangleCount);
+    for(size_t t = 0; t < triangleCount; t++){
+        for(uint32_t c = 0; c < 3; c++){
+            edges.push_back(GetEdgeKey(triangles[3 * t + c], triangles[3 * t + (c + 1) % 3]));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for(size_t i = 0; i < edges.size();){
+        size_t j = i;
+        while(j < edges.size() && edges[j] == edges[i]) j++;
+        if(j - i != 2){
+            locked[uint32_t(edges[i] >> 32)] = true;
+            locked[uint32_t(edges[i])] = true;
+        }
+        i = j;
+    }
+
+    // hard edges : every wedge of from needs a wedge with similar normal at to
+    auto CanCollapse = [&](uint32_t from, uint32_t to){
+        for(uint32_t i = wedgeOffsets[from]; i < wedgeOffsets[from + 1]; i++){
+            bool found = false;
+            for(uint32_t j = wedgeOffsets[to]; j < wedgeOffsets[to + 1] && !found; j++){
+                found = AreNormalsSimilar(vertices[sortedVertices[i]].normal, vertices[sortedVertices[j]].normal);
+            }
+            if(!found) return false;
+        }
+        return true;
+    };
+
+    double errorLimit = double(targetError) * double(targetError);
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(positionCount);
+    std::vector<bool> touched(positionCount);
+    TriangleAdjacency adjacency;
+
+    // collapse in passes, each pass collapses cheapest independent edges
+    while(3 * triangleCount > targetIndexCount){
+        // unique edges of current triangles
+        edges.clear();
+        for(size_t t = 0; t < triangleCount; t++){
+            for(uint32_t c = 0; c < 3; c++){
+                edges.push_back(GetEdgeKey(triangles[3 * t + c], triangles[3 * t + (c + 1) % 3]));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        // cheaper direction of every edge that can be collapsed
+        collapses.clear();
+        for(uint64_t edge : edges){
+            uint32_t a = uint32_t(edge >> 32);
+            uint32_t b = uint32_t(edge);
+
+            Quadric merged = quadrics[a];
+            merged.Add(quadrics[b]);
+
+            Collapse best = {0, 0, -1.0};
+            if(!locked[a] && CanCollapse(a, b)) best = {a, b, merged.Evaluate(positions[b])};
+            if(!locked[b] && CanCollapse(b, a)){
+                double error = merged.Evaluate(positions[a]);
+                if(best.error < 0 || error < best.error) best = {b, a, error};
+            }
+
+            if(best.error >= 0 && best.error <= errorLimit) collapses.push_back(best);
+        }
+        if(collapses.empty()) break;
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b){
+            return a.error < b.error;
+        });
+
+        BuildTriangleAdjacency(adjacency, triangles.data(), 3 * triangleCount, positionCount);
+        for(uint32_t p = 0; p < positionCount; p++) remap[p] = p;
+        std::fill(touched.begin(), touched.end(), false);
+
+        // each collapse removes about two triangles
+        size_t wantedCollapses = (triangleCount - targetIndexCount / 3) / 2 + 1;
+        size_t collapseCount = 0;
+
+        for(const Collapse& collapse : collapses){
+            // triangles around touched vertices already changed this pass
+            if(touched[collapse.from] || touched[collapse.to]) continue;
+
+            // moving from onto to must not flip any remaining triangle
+            bool flips = false;
+            const uint32_t* neighbours = adjacency.triangles.data() + adjacency.offsets[collapse.from];
+            for(uint32_t n = 0; n < adjacency.counts[collapse.from] && !flips; n++){
+                const uint32_t* triangle = triangles.data() + 3 * neighbours[n];
+                if(triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) continue;
+
+                glm::vec3 before[3], after[3];
+                for(uint32_t c = 0; c < 3; c++){
+                    before[c] = positions[triangle[c]];
+                    after[c] = triangle[c] == collapse.from ? positions[collapse.to] : before[c];
+                }
+
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flips = glm::dot(normalBefore, normalAfter) <= 0.f;
+            }
+            if(flips) continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            resultError = std::max(resultError, float(collapse.error));
+
+            for(uint32_t n = 0; n < adjacency.counts[collapse.from]; n++){
+                const uint32_t* triangle = triangles.data() + 3 * neighbours[n];
+                for(uint32_t c = 0; c < 3; c++) touched[triangle[c]] = true;
+            }
+
+            if(++collapseCount >= wantedCollapses) break;
+        }
+        if(collapseCount == 0) break;
+
+        // apply collapses and drop triangles that became degenerate
+        size_t kept = 0;
+        for(size_t t = 0; t < triangleCount; t++){
+            uint32_t a = remap[triangles[3 * t + 0]];
+            uint32_t b = remap[triangles[3 * t + 1]];
+            uint32_t c = remap[triangles[3 * t + 2]];
+            if(a == b || b == c || c == a) continue;
+
+            triangles[3 * kept + 0] = a;
+            triangles[3 * kept + 1] = b;
+            triangles[3 * kept + 2] = c;
+            for(uint32_t i = 0; i < 3; i++) corners[3 * kept + i] = corners[3 * t + i];
+            kept++;
+        }
+        triangleCount = kept;
+    }
+
+    // corner whose position moved takes the wedge of new position closest in attributes
+    for(size_t i = 0; i < 3 * triangleCount; i++){
+        uint32_t vertex = corners[i];
+        uint32_t position = triangles[i];
+        if(positionIds[vertex] == position){
+            destination[i] = vertex;
+            continue;
+        }
+
+        float bestScore = -2.f;
+        uint32_t bestVertex = sortedVertices[wedgeOffsets[position]];
+        for(uint32_t w = wedgeOffsets[position]; w < wedgeOffsets[position + 1]; w++){
+            const Vertex& wedge = vertices[sortedVertices[w]];
+            glm::vec2 uvOffset = wedge.uv - vertices[vertex].uv;
+            float score = glm::dot(wedge.normal, vertices[vertex].normal) - 1e-3f * glm::dot(uvOffset, uvOffset);
+            if(score > bestScore){
+                bestScore = score;
+                bestVertex = sortedVertices[w];
+            }
+        }
+        destination[i] = bestVertex;
+    }
+
+    resultError = std::sqrt(resultError);
+    return 3 * triangleCount;
+}
+
+// chain of levels, each simplified from previous one
+void GameZero::BuildMeshLods(Mesh& mesh){
+    // cached meshes already have their levels
+    if(mesh.mapped.file || mesh.indices.empty()) return;
+
+    mesh.EnsureSubmeshes();
+    mesh.lods.clear();
+    mesh.lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.f});
+
+    // allowed error grows with level, relative to mesh size
+    float meshSize = glm::length(mesh.bounds.max - mesh.bounds.min);
+    float levelError = meshSize * 0.01f;
+    float error = 0.f;
+
+    std::vector<uint32_t> levelIndices;
+    std::vector<uint32_t> simplified;
+    std::vector<uint32_t> optimized;
+
+    for(uint32_t level = 1; level < MeshMaxLodCount; level++){
+        MeshLod previous = mesh.lods.back();
+        uint32_t levelFirstIndex = static_cast<uint32_t>(mesh.indices.size());
+        levelIndices.clear();
+
+        // each submesh is simplified alone, so material borders stay in place
+        float lodError = 0.f;
+        for(Submesh& submesh : mesh.submeshes){
+            const MeshLod& source = submesh.lods[level - 1];
+            const uint32_t* sourceIndices = mesh.indices.data() + source.firstIndex;
+            size_t targetIndexCount = (source.indexCount / 6) * 3;
+
+            simplified.resize(source.indexCount);
+            float submeshError = 0.f;
+            size_t indexCount = SimplifyMesh(simplified.data(), sourceIndices, source.indexCount, mesh.vertices.data(), mesh.vertices.size(), targetIndexCount, levelError, submeshError);
+
+            // submeshes that cannot be simplified further keep their previous triangles
+            if(indexCount == 0){
+                simplified.assign(sourceIndices, sourceIndices + source.indexCount);
+                indexCount = source.indexCount;
+                submeshError = 0.f;
+            }
+
+            optimized.resize(indexCount);
+            OptimizeVertexCache(optimized.data(), simplified.data(), indexCount, mesh.vertices.size());
+
+            submesh.lods[level] = {levelFirstIndex + static_cast<uint32_t>(levelIndices.size()), static_cast<uint32_t>(indexCount), 0.f};
+            levelIndices.insert(levelIndices.end(), optimized.begin(), optimized.end());
+            lodError = std::max(lodError, submeshError);
+        }
+
+        // level is not worth its memory if it barely removes anything
+        if(levelIndices.size() > previous.indexCount * size_t(9) / 10) break;
+
+        // errors of a chain add up
+        error += lodError;
+        for(Submesh& submesh : mesh.submeshes){
+            submesh.lods[level].error = error;
+        }
+        mesh.lods.push_back({levelFirstIndex, static_cast<uint32_t>(levelIndices.size()), error});
+        mesh.indices.insert(mesh.indices.end(), levelIndices.begin(), levelIndices.end());
+
+        levelError *= 2.f;
+    }
+}
+
+// coarsest level that stays under threshold pixels of error
+uint32_t GameZero::SelectMeshLod(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition, float projectionScale, float threshold){
+    size_t lodCount = mesh.GetLodCount();
+    if(lodCount <= 1) return 0;
+
+    // largest axis scale of transform, errors and radius grow with it
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+    glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.boundingSphere.center, 1.f));
+    float radius = mesh.boundingSphere.radius * scale;
+
+    // distance to closest point of bounding sphere, camera inside needs full detail
+    float distance = glm::length(center - cameraPosition) - radius;
+    if(distance <= 0.f) return 0;
+
+    const MeshLod* lods = mesh.GetLodData();
+    uint32_t selected = 0;
+    for(uint32_t level = 1; level < lodCount; level++){
+        float screenError = lods[level].error * scale * projectionScale / distance;
+        if(screenError > threshold) break;
+        selected = level;
+    }
+
+    return selected;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file mesh_simplifier.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief builds and selects levels of detail for meshes
+ * @version 0.1
+ * @date 2021-06-29
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_MESH_SIMPLIFIER_HPP
+#define GAMEZERO_MESH_SIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace GameZero{
+
+    struct Vertex;
+    class Mesh;
+
+    /// maximum number of levels of detail of a mesh, including full detail
+    constexpr static uint32_t MeshMaxLodCount = 5;
+
+    /// one level of detail, a range of mesh index buffer
+    struct MeshLod{
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        /// largest distance in mesh space between this level and full detail surface
+        float error;
+    };
+
+    /**
+     * @brief Simplify a triangle list by collapsing edges in order of
+     *        quadric error (Garland, Heckbert - Surface Simplification
+     *        Using Quadric Error Metrics, 1997).
+     *        Vertices are only moved onto other existing vertices, so no new
+     *        vertices are made. Vertices sharing a position are moved together
+     *        and only onto positions having vertices with similar normals,
+     *        which keeps hard edges intact. Mesh borders are kept in place.
+     *
+     * @param destination : simplified triangle list, must have space for indexCount indices
+     * @param indices : triangle list
+     * @param indexCount : number of indices
+     * @param vertices : vertices indices refer to
+     * @param vertexCount : number of vertices
+     * @param targetIndexCount : stop when triangle list gets this small
+     * @param targetError : never make a collapse with error larger than this, in mesh space units
+     * @param resultError : largest error of any collapse made
+     * @return size_t : number of indices written to destination
+     */
+    size_t SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float& resultError);
+
+    /**
+     * @brief Build up to MeshMaxLodCount levels of detail, each with about half
+     *        the triangles of previous one. Simplified index lists are cache
+     *        optimized and appended to mesh indices after full detail level.
+     *        Submeshes are simplified separately and stay contiguous in every level.
+     *        Stops early when a mesh cannot be simplified any further.
+     *        Meshes loaded from cache already have their levels.
+     *
+     * @param mesh : mesh to build levels for, must own its vertices and indices
+     */
+    void BuildMeshLods(Mesh& mesh);
+
+    /**
+     * @brief Pick coarsest level of detail whose error projected on screen stays
+     *        below threshold, using mesh bounds as distance estimate.
+     *
+     * @param mesh : mesh to pick level for
+     * @param transform : mesh to world transform
+     * @param cameraPosition : camera position in world space
+     * @param projectionScale : pixels covered by one world unit at unit distance,
+     *                          half viewport height times proj[1][1]
+     * @param threshold : largest allowed error in pixels
+     * @return uint32_t : level of detail, 0 is full detail
+     */
+    uint32_t SelectMeshLod(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition, float projectionScale, float threshold);
+
+}
+
+#endif//GAMEZERO_MESH_SIMPLIFIER_HPP
@@ -0,0 +1,234 @@
+#include "meshlet.hpp"
+#include "mesh.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace GameZero;
+
+// unit normal of a triangle, zero for degenerate triangles
+static glm::vec3 GetTriangleNormal(const Vertex* vertices, const uint32_t* triangle){
+    const glm::vec3& p0 = vertices[triangle[0]].position;
+    const glm::vec3& p1 = vertices[triangle[1]].position;
+    const glm::vec3& p2 = vertices[triangle[2]].position;
+
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float length = glm::length(normal);
+    return length > 0.f ? normal / length : glm::vec3(0.f);
+}
+
+// bounding sphere and normal cone of a meshlet
+static void ComputeMeshletBounds(Meshlet& meshlet, const Vertex* vertices, const uint32_t* indices){
+    const uint32_t* meshletIndices = indices + meshlet.firstIndex;
+
+    // sphere around box center, not minimal but cheap and tight enough for small clusters
+    glm::vec3 minimum = vertices[meshletIndices[0]].position;
+    glm::vec3 maximum = minimum;
+    for(uint32_t i = 1; i < meshlet.indexCount; i++){
+        minimum = glm::min(minimum, vertices[meshletIndices[i]].position);
+        maximum = glm::max(maximum, vertices[meshletIndices[i]].position);
+    }
+
+    meshlet.center = (minimum + maximum) * 0.5f;
+    float radiusSquared = 0.f;
+    for(uint32_t i = 0; i < meshlet.indexCount; i++){
+        glm::vec3 offset = vertices[meshletIndices[i]].position - meshlet.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // cone axis is average normal, cone must contain every triangle normal
+    glm::vec3 axis(0.f);
+    for(uint32_t i = 0; i < meshlet.indexCount; i += 3){
+        axis += GetTriangleNormal(vertices, meshletIndices + i);
+    }
+
+    meshlet.coneAxis = glm::vec3(0.f);
+    meshlet.coneCutoff = 1.f;
+
+    float axisLength = glm::length(axis);
+    if(axisLength == 0.f) return;
+    axis /= axisLength;
+
+    float minimumDot = 1.f;
+    for(uint32_t i = 0; i < meshlet.indexCount; i += 3){
+        glm::vec3 normal = GetTriangleNormal(vertices, meshletIndices + i);
+        if(normal == glm::vec3(0.f)) continue;
+        minimumDot = std::min(minimumDot, glm::dot(axis, normal));
+    }
+
+    meshlet.coneAxis = axis;
+
+    // cones close to or wider than a hemisphere can almost never be culled
+    if(minimumDot > 0.1f){
+        meshlet.coneCutoff = std::sqrt(1.f - minimumDot * minimumDot);
+    }
+}
+
+// grow meshlets triangle by triangle through shared vertices
+void GameZero::BuildMeshlets(Mesh& mesh){
+    // cached meshes already have meshlets
+    if(mesh.mapped.file || mesh.indices.empty()) return;
+
+    const Vertex* vertices = mesh.vertices.data();
+    const uint32_t* indices = mesh.indices.data();
+    size_t vertexCount = mesh.vertices.size();
+    size_t indexCount = mesh.indices.size();
+    size_t triangleCount = indexCount / 3;
+
+    TriangleAdjacency adjacency;
+    BuildTriangleAdjacency(adjacency, indices, indexCount, vertexCount);
+
+    std::vector<glm::vec3> triangleNormals(triangleCount);
+    for(size_t t = 0; t < triangleCount; t++){
+        triangleNormals[t] = GetTriangleNormal(vertices, indices + 3 * t);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    // vertex belongs to current meshlet if its stamp matches meshlet count
+    std::vector<uint32_t> vertexStamps(vertexCount, 0);
+    // unemitted triangles sharing a vertex with current meshlet
+    std::vector<uint32_t> candidates;
+
+    std::vector<uint32_t> meshletIndices;
+    meshletIndices.reserve(indexCount);
+    mesh.meshlets.clear();
+
+    // meshlets never cross submeshes, so each one has a single material
+    mesh.EnsureSubmeshes();
+    for(Submesh& submesh : mesh.submeshes){
+        size_t firstTriangle = submesh.lods[0].firstIndex / 3;
+        size_t lastTriangle = firstTriangle + submesh.lods[0].indexCount / 3;
+        submesh.firstMeshlet = static_cast<uint32_t>(mesh.meshlets.size());
+
+        // input order is cache optimized, so it is a good fallback when a meshlet runs out of neighbours
+        size_t cursor = firstTriangle;
+        size_t emittedCount = 0;
+
+        while(emittedCount < lastTriangle - firstTriangle){
+            Meshlet meshlet = {};
+            meshlet.firstIndex = static_cast<uint32_t>(meshletIndices.size());
+
+            uint32_t stamp = static_cast<uint32_t>(mesh.meshlets.size() + 1);
+            uint32_t meshletVertexCount = 0;
+            uint32_t meshletTriangleCount = 0;
+            glm::vec3 normalSum(0.f);
+            candidates.clear();
+
+            while(meshletTriangleCount < MeshletMaxTriangles){
+                glm::vec3 axis = glm::length(normalSum) > 0.f ? glm::normalize(normalSum) : glm::vec3(0.f);
+
+                // pick candidate adding fewest new vertices, ties broken by facing same way as meshlet
+                int64_t best = -1;
+                float bestScore = std::numeric_limits<float>::max();
+                size_t liveCandidates = 0;
+                for(size_t c = 0; c < candidates.size(); c++){
+                    uint32_t triangle = candidates[c];
+                    if(emitted[triangle]) continue;
+                    candidates[liveCandidates++] = triangle;
+
+                    uint32_t newVertices = 0;
+                    for(uint32_t i = 0; i < 3; i++){
+                        newVertices += vertexStamps[indices[3 * triangle + i]] != stamp;
+                    }
+                    if(meshletVertexCount + newVertices > MeshletMaxVertices) continue;
+
+                    float score = float(newVertices) + (1.f - glm::dot(axis, triangleNormals[triangle])) * 2.f;
+                    if(score < bestScore){
+                        bestScore = score;
+                        best = triangle;
+                    }
+                }
+                candidates.resize(liveCandidates);
+
+                // neighbours left but none fit, meshlet is full
+                if(best < 0 && !candidates.empty()) break;
+
+                // no neighbours left, continue with next triangle in input order if it fits
+                if(best < 0){
+                    while(cursor < lastTriangle && emitted[cursor]) cursor++;
+                    if(cursor == lastTriangle) break;
+
+                    uint32_t newVertices = 0;
+                    for(uint32_t i = 0; i < 3; i++){
+                        newVertices += vertexStamps[indices[3 * cursor + i]] != stamp;
+                    }
+                    if(meshletVertexCount + newVertices > MeshletMaxVertices) break;
+
+                    best = cursor;
+                }
+
+                uint32_t triangle = static_cast<uint32_t>(best);
+                emitted[triangle] = true;
+                emittedCount++;
+                meshletTriangleCount++;
+                normalSum += triangleNormals[triangle];
+
+                for(uint32_t i = 0; i < 3; i++){
+                    uint32_t vertex = indices[3 * triangle + i];
+                    meshletIndices.push_back(vertex);
+
+                    if(vertexStamps[vertex] == stamp) continue;
+                    vertexStamps[vertex] = stamp;
+                    meshletVertexCount++;
+
+                    // triangles around new vertex become candidates
+                    const uint32_t* neighbours = adjacency.triangles.data() + adjacency.offsets[vertex];
+                    for(uint32_t n = 0; n < adjacency.counts[vertex]; n++){
+                        uint32_t neighbour = neighbours[n];
+                        if(!emitted[neighbour] && neighbour >= firstTriangle && neighbour < lastTriangle) candidates.push_back(neighbour);
+                    }
+                }
+            }
+
+            meshlet.indexCount = static_cast<uint32_t>(meshletIndices.size()) - meshlet.firstIndex;
+            mesh.meshlets.push_back(meshlet);
+        }
+
+        submesh.meshletCount = static_cast<uint32_t>(mesh.meshlets.size()) - submesh.firstMeshlet;
+    }
+
+    // meshlet order changed first use of vertices, restore linear vertex fetch
+    std::vector<Vertex> reordered(vertexCount);
+    reordered.resize(OptimizeVertexFetch(reordered.data(), meshletIndices.data(), meshletIndices.size(), vertices, vertexCount));
+    mesh.vertices.swap(reordered);
+    mesh.indices.swap(meshletIndices);
+
+    for(Meshlet& meshlet : mesh.meshlets){
+        ComputeMeshletBounds(meshlet, mesh.vertices.data(), mesh.indices.data());
+    }
+}
+
+// merge runs of visible meshlets so that draw count stays low
+MeshletCullStatistics GameZero::CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<MeshletDrawRange>& ranges){
+    MeshletCullStatistics statistics;
+    ranges.clear();
+
+    for(size_t i = 0; i < meshletCount; i++){
+        const Meshlet& meshlet = meshlets[i];
+
+        if(!frustum.IsSphereVisible(meshlet.center, meshlet.radius)){
+            statistics.frustumCulled++;
+            statistics.culledTriangles += meshlet.indexCount / 3;
+            continue;
+        }
+
+        if(meshlet.IsBackfacing(cameraPosition)){
+            statistics.backfaceCulled++;
+            statistics.culledTriangles += meshlet.indexCount / 3;
+            continue;
+        }
+
+        // meshlet continues last range
+        if(!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex){
+            ranges.back().indexCount += meshlet.indexCount;
+            continue;
+        }
+
+        ranges.push_back({meshlet.firstIndex, meshlet.indexCount});
+    }
+
+    return statistics;
+}
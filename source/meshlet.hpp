@@ -0,0 +1,106 @@
+/**
+ * @file meshlet.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief splits meshes into small clusters that can be culled separately
+ * @version 0.1
+ * @date 2021-06-28
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_MESHLET_HPP
+#define GAMEZERO_MESHLET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "math/frustum.hpp"
+
+namespace GameZero{
+
+    class Mesh;
+
+    /// maximum number of unique vertices in a meshlet
+    constexpr static uint32_t MeshletMaxVertices = 64;
+    /// maximum number of triangles in a meshlet
+    constexpr static uint32_t MeshletMaxTriangles = 124;
+
+    /**
+     * @brief A small cluster of triangles of a mesh.
+     *        Triangles of a meshlet are contiguous in mesh index buffer,
+     *        so a meshlet or a run of neighbouring meshlets is one draw.
+     */
+    struct Meshlet{
+        /// first index of meshlet in mesh index buffer
+        uint32_t firstIndex;
+        /// number of indices in meshlet
+        uint32_t indexCount;
+
+        /// bounding sphere in mesh space
+        glm::vec3 center;
+        float radius;
+
+        /// all triangle normals lie within cutoff of axis.
+        /// cutoff is sine of cone angle, 1 means cone is too wide to be used
+        glm::vec3 coneAxis;
+        float coneCutoff;
+
+        /**
+         * @brief check whether all triangles face away from camera.
+         *        Conservative for any point of bounding sphere, so it holds
+         *        for every triangle (Kapoulkine, meshoptimizer).
+         *
+         * @param cameraPosition : camera position in mesh space
+         */
+        bool IsBackfacing(const glm::vec3& cameraPosition) const noexcept{
+            glm::vec3 direction = center - cameraPosition;
+            return glm::dot(direction, coneAxis) >= coneCutoff * glm::length(direction) + radius;
+        }
+    };
+
+    /// range of mesh index buffer covering one or more neighbouring visible meshlets
+    struct MeshletDrawRange{
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+
+    /// what CullMeshlets removed
+    struct MeshletCullStatistics{
+        uint32_t frustumCulled = 0;
+        uint32_t backfaceCulled = 0;
+        uint64_t culledTriangles = 0;
+    };
+
+    /**
+     * @brief Cull meshlets against a frustum and by their normal cones.
+     *        Visible meshlets that follow each other in index buffer
+     *        are merged into a single draw range.
+     *
+     * @param meshlets : meshlets of a mesh
+     * @param meshletCount : number of meshlets
+     * @param frustum : view frustum in mesh space
+     * @param cameraPosition : camera position in mesh space
+     * @param ranges : cleared and filled with ranges to draw
+     * @return MeshletCullStatistics : number of culled meshlets and triangles
+     */
+    MeshletCullStatistics CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const Frustum& frustum, const glm::vec3& cameraPosition, std::vector<MeshletDrawRange>& ranges);
+
+    /**
+     * @brief Split mesh into meshlets of at most MeshletMaxVertices vertices
+     *        and MeshletMaxTriangles triangles.
+     *        Meshlets grow through shared vertices, preferring triangles facing
+     *        the same way so that normal cones stay narrow.
+     *        Meshlets do not cross submeshes, meshlets of each submesh are contiguous.
+     *        Index buffer is reordered so that meshlets are contiguous and
+     *        vertices are reordered again to match new first use order.
+     *        Meshes loaded from cache already have meshlets and are left as they are.
+     *
+     * @param mesh : mesh to split, must own its vertices and indices
+     */
+    void BuildMeshlets(Mesh& mesh);
+
+}
+
+#endif//GAMEZERO_MESHLET_HPP
@@ -7,6 +7,11 @@
 #include "vulkan/vulkan.hpp"
 #include "vulkan/vulkan_core.h"
 #include "shader.hpp"
+#include "utils/mapped_file.hpp"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <unordered_set>
 
 
 GameZero::Renderer::Renderer(GameZero::Window& window) : window(window){
@@ -46,6 +51,7 @@ void GameZero::Renderer::Initialize(){
     InitDescriptors();
     InitPipelineLayouts();
     InitPipelines();
+    InitGeometryBuffers();
     InitMesh();
     LoadImages();
     InitScene();
@@ -272,6 +278,18 @@ void GameZero::Renderer::Draw(){
     // then reset render fence
     device.logical.resetFences({frame.renderFence});
 
+    // meshes released a few frames ago are no longer read by any frame in flight
+    ReleaseRetiredGeometry(false);
+
+    // gpu is done with copies of this frame, so dynamic meshes can write their edits to them
+    DynamicMeshUpload dynamicUpload = UpdateDynamicMeshes();
+
+    // camera buffer of this frame is no longer read either, it is written once and objects push their transforms
+    void* cameraBufferData;
+    CHECK_VK_RESULT(device.allocator.mapMemory(frame.cameraBuffer.allocation, &cameraBufferData), "Failed to map memory");
+    memcpy(cameraBufferData, &cameraData, sizeof(GPUCameraData));
+    device.allocator.unmapMemory(frame.cameraBuffer.allocation);
+
     // get next image to render to from swapchain
     // swapchain will signal present semaphore when it is done presenting it
     uint32_t nextImageIndex = device.logical.acquireNextImageKHR(swapchain.swapchain, 1e9, frame.presentSemaphore).value;
@@ -288,6 +306,10 @@ void GameZero::Renderer::Draw(){
     );
     cmd.begin(cmdBeginInfo);
 
+    // copies of streamed texture levels are recorded before render pass that samples them
+    FrameStatistics textureStatistics;
+    UpdateTextureStreaming(cmd, textureStatistics);
+
     // clear value for color attachment on renderpass begin
     vk::ClearValue colorClear(std::array<float, 4>{0.f, 0.f, 0.f, 1.f});
 
@@ -311,8 +333,29 @@ void GameZero::Renderer::Draw(){
     // begin renderpass
     cmd.beginRenderPass(rpBeginInfo, vk::SubpassContents::eInline);
 
+    // fill depth first so that color pass shades each pixel once
+    // only its draw calls are kept, culling statistics come from color pass
+    uint32_t depthPrepassDrawCalls = 0;
+    uint32_t depthPrepassPipelineBinds = 0;
+    if(enableDepthPrepass){
+        frameStatistics = FrameStatistics();
+        DrawObjects(cmd, renderables.data(), renderables.size(), true);
+        DrawDynamicMeshes(cmd, true);
+        depthPrepassDrawCalls = frameStatistics.drawCalls;
+        depthPrepassPipelineBinds = frameStatistics.pipelineBinds;
+    }
+
     // draw objects
+    frameStatistics = FrameStatistics();
     DrawObjects(cmd, renderables.data(), renderables.size());
+    DrawDynamicMeshes(cmd, false);
+    frameStatistics.depthPrepassDrawCalls = depthPrepassDrawCalls;
+    frameStatistics.pipelineBinds += depthPrepassPipelineBinds;
+    frameStatistics.dynamicMeshUploadBytes = dynamicUpload.bytes;
+    frameStatistics.dynamicMeshUploadRanges = dynamicUpload.vertexRanges + dynamicUpload.indexRanges;
+    frameStatistics.textureBytes = textureStatistics.textureBytes;
+    frameStatistics.streamedInLevels = textureStatistics.streamedInLevels;
+    frameStatistics.streamedOutLevels = textureStatistics.streamedOutLevels;
 
     // end renderpass
     cmd.endRenderPass();
@@ -356,13 +399,27 @@ void GameZero::Renderer::Draw(){
 void GameZero::Renderer::InitPipelineLayouts(){
     vk::DescriptorSetLayout setLayouts[] = {descriptorSetLayout, singleTextureSetLayout};
 
+    // per mesh data is pushed to vertex shader, and per material data after it to fragment shader
+    vk::PushConstantRange pushConstantRanges[2] = {
+        vk::PushConstantRange(
+            vk::ShaderStageFlagBits::eVertex, /* stage */
+            0, /* offset */
+            sizeof(GPUMeshData) /* size */
+        ),
+        vk::PushConstantRange(
+            vk::ShaderStageFlagBits::eFragment, /* stage */
+            sizeof(GPUMeshData), /* offset */
+            sizeof(GPUMaterialData) /* size */
+        )
+    };
+
     // pipeline layout create info
     vk::PipelineLayoutCreateInfo layoutInfo(
         {}, /* flags */
         2, /* set layout count*/
         setLayouts, /* sey layouts */
-        0, /* push constant range count */
-        nullptr /* push constant ranges */
+        2, /* push constant range count */
+        pushConstantRanges /* push constant ranges */
     );
 
     pipelineLayout = device.logical.createPipelineLayout(layoutInfo);
@@ -376,8 +433,31 @@ void GameZero::Renderer::InitPipelineLayouts(){
 void GameZero::Renderer::InitPipelines(){
     // create shader modules
     vk::ShaderModule vertShader = LoadShaderModule(device, "shaders/vert.spv");
+    vk::ShaderModule compactVertShader = LoadShaderModule(device, "shaders/compact_vert.spv");
     vk::ShaderModule fragShader = LoadShaderModule(device, "shaders/frag.spv");
+    vk::ShaderModule depthVertShader = LoadShaderModule(device, "shaders/depth_vert.spv");
+
+    // one pipeline per vertex format, both share fragment shader
+    pipeline = CreatePipeline(vertShader, fragShader, Vertex::GetVertexDescription());
+    compactPipeline = CreatePipeline(compactVertShader, fragShader, CompactVertex::GetVertexDescription());
+
+    // depth only pipelines read position stream alone and share one vertex shader
+    depthPipeline = CreatePipeline(depthVertShader, nullptr, Vertex::GetPositionDescription());
+    compactDepthPipeline = CreatePipeline(depthVertShader, nullptr, CompactVertex::GetPositionDescription());
+
+    // we dont need shader modules anymore
+    device.logical.destroyShaderModule(vertShader);
+    device.logical.destroyShaderModule(compactVertShader);
+    device.logical.destroyShaderModule(fragShader);
+    device.logical.destroyShaderModule(depthVertShader);
 
+    // create default materials
+    CreateMaterial(pipeline, pipelineLayout, "default");
+    CreateMaterial(compactPipeline, pipelineLayout, "default_compact");
+}
+
+// create a graphics pipeline with default state for given shaders and vertex layout
+vk::Pipeline GameZero::Renderer::CreatePipeline(vk::ShaderModule vertShader, vk::ShaderModule fragShader, const VertexInputDescription& vertexDescription){
     // vertex shader stage
     vk::PipelineShaderStageCreateInfo vertShaderStageInfo(
         {}, /* flags */
@@ -396,20 +476,19 @@ void GameZero::Renderer::InitPipelines(){
         nullptr /* specitalization info */
     );
     
+    // depth only pipelines have no fragment stage
     vk::PipelineShaderStageCreateInfo shaderStages[2] = {
-        fragShaderStageInfo, vertShaderStageInfo
+        vertShaderStageInfo, fragShaderStageInfo
     };
-
-    // get vertex description
-    VertexInputDescription vertexDescription = Vertex::GetVertexDescription();
+    const uint32_t stageCount = fragShader ? 2 : 1;
 
     // vertex input state
     vk::PipelineVertexInputStateCreateInfo vertexInput(
         vertexDescription.flags, /* flags */
-        vertexDescription.bindings.size(), /* binding count */
-        vertexDescription.bindings.data(), /* bindings */
-        vertexDescription.attributes.size(), /* attribute count */
-        vertexDescription.attributes.data() /* attributes */
+        vertexDescription.bindingCount, /* binding count */
+        vertexDescription.bindings, /* bindings */
+        vertexDescription.attributeCount, /* attribute count */
+        vertexDescription.attributes /* attributes */
     );
 
     // input assembly
@@ -461,6 +540,8 @@ void GameZero::Renderer::InitPipelines(){
                                             vk::ColorComponentFlagBits::eR |
                                             vk::ColorComponentFlagBits::eG |
                                             vk::ColorComponentFlagBits::eB;
+    // nothing is written to color attachment without a fragment shader
+    if(!fragShader) colorBlendAttachment.colorWriteMask = {};
     colorBlendAttachment.blendEnable = false;
     
     // color blend sate
@@ -490,7 +571,7 @@ void GameZero::Renderer::InitPipelines(){
     viewportState.pScissors = &scissor;
 
     vk::GraphicsPipelineCreateInfo graphicsPipelineInfo;
-    graphicsPipelineInfo.stageCount = 2;
+    graphicsPipelineInfo.stageCount = stageCount;
     graphicsPipelineInfo.pStages = shaderStages;
     graphicsPipelineInfo.pVertexInputState = &vertexInput;
     graphicsPipelineInfo.pInputAssemblyState = &inputAssembly;
@@ -503,25 +584,182 @@ void GameZero::Renderer::InitPipelines(){
     graphicsPipelineInfo.renderPass =  renderPass.renderPass;
     graphicsPipelineInfo.subpass = 0;
 
-    pipeline = device.logical.createGraphicsPipeline({}, graphicsPipelineInfo).value;
+    vk::Pipeline newPipeline = device.logical.createGraphicsPipeline({}, graphicsPipelineInfo).value;
     // deletor
     PushFunction([=](){
-        device.logical.destroyPipeline(pipeline);
+        device.logical.destroyPipeline(newPipeline);
     });
 
-    // we dont need shader modules anymore
-    device.logical.destroyShaderModule(vertShader);
-    device.logical.destroyShaderModule(fragShader);
-
-    // create default material
-    CreateMaterial(pipeline, pipelineLayout, "default");
+    return newPipeline;
 }
 
 void GameZero::Renderer::InitMesh(){
-    // TODO : DO SOMETHING ABOUT THIS PATH
-    mesh.LoadMeshFromOBJ("../mesh/lost_empire.obj");
-    UploadMeshToGPU(&mesh, device.allocator);
-    meshes["TestMesh"] = mesh;
+    // only version of map being drawn is loaded, M loads the other one in its place
+    LoadMapMesh(enableMergedFaces);
+}
+
+// TODO : DO SOMETHING ABOUT THIS PATH
+// meshes are loaded in place, map nodes dont move so mesh pointers stay valid
+GameZero::Mesh* GameZero::Renderer::LoadMapMesh(bool mergedFaces){
+    const char* name = mergedFaces ? "TestMesh" : "TestMeshBlocks";
+    Mesh& mesh = meshes[name];
+
+    // voxel map with coplanar block faces merged, tiled texture coordinates need standard vertices
+    // with one quad per block face it is a large static map, quantized vertices take less than half the memory
+    mesh.mergeCoplanarFaces = mergedFaces;
+    if(!mesh.LoadMeshFromOBJ("../mesh/lost_empire.obj")){
+        meshes.erase(name);
+        return nullptr;
+    }
+    if(!mergedFaces) mesh.vertexFormat = VertexFormat::Compact;
+    UploadMeshToGPU(&mesh);
+
+    LOG(INFO, "Map loaded %s merged faces : %u triangles", mergedFaces ? "with" : "without", mesh.GetLod(0).indexCount / 3);
+    return &mesh;
+}
+
+// swap map between merged and per block face versions, old version is unloaded
+void GameZero::Renderer::SetMergedFaces(bool enable){
+    if(enable == enableMergedFaces) return;
+    const char* fromName = enable ? "TestMeshBlocks" : "TestMesh";
+    Mesh* from = GetMesh(fromName);
+    if(!from) return;
+
+    Mesh* to = LoadMapMesh(enable);
+    if(!to) return;
+    CreateMeshMaterials(*to);
+    enableMergedFaces = enable;
+
+    for(RenderObject& object : renderables){
+        if(object.mesh != from) continue;
+
+        // material pipeline must match mesh vertex format
+        object.SetMesh(to);
+        object.material = GetMaterial(to->vertexFormat == VertexFormat::Compact ? "default_compact" : "default");
+    }
+
+    // frames in flight may still draw old version, its ranges are freed after them
+    ReleaseMeshFromGPU(from);
+    meshes.erase(fromName);
+}
+
+// texture sets are written in place, so no frame in flight may be using them
+void GameZero::Renderer::SetMipmaps(bool enable){
+    enableMipmaps = enable;
+    device.logical.waitIdle();
+
+    for(auto& [name, material] : materials){
+        if(material.textureSet) UpdateTextureSet(material);
+    }
+}
+
+// one host visible copy per frame in flight, written in place by cpu and read in place by gpu
+GameZero::DynamicMesh* GameZero::Renderer::CreateDynamicMesh(const std::string& name, uint32_t vertexCapacity, uint32_t indexCapacity){
+    if(dynamicMeshes.find(name) != dynamicMeshes.end()){
+        LOG(ERROR, "Dynamic mesh %s already exists", name.c_str());
+        return nullptr;
+    }
+    if(vertexCapacity == 0 || indexCapacity == 0) return nullptr;
+
+    // map nodes dont move, so mesh pointer stays valid for deletor
+    DynamicMesh* mesh = &dynamicMeshes[name];
+    mesh->SetCapacity(vertexCapacity, indexCapacity);
+    mesh->material = GetMaterial("default");
+
+    // coherent memory needs no flush after writing ranges
+    vma::AllocationCreateInfo allocInfo;
+    allocInfo.usage = vma::MemoryUsage::eCpuToGpu;
+    allocInfo.requiredFlags = vk::MemoryPropertyFlagBits::eHostCoherent;
+
+    for(DynamicMeshFrame& frame : mesh->frames){
+        vk::BufferCreateInfo bufferInfo;
+        bufferInfo.size = mesh->GetVertexBufferSize();
+        bufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer;
+        CHECK_VK_RESULT(device.allocator.createBuffer(&bufferInfo, &allocInfo, &frame.vertexBuffer.buffer, &frame.vertexBuffer.allocation, nullptr), "Failed to create dynamic vertex buffer");
+
+        bufferInfo.size = mesh->GetIndexBufferSize();
+        bufferInfo.usage = vk::BufferUsageFlagBits::eIndexBuffer;
+        CHECK_VK_RESULT(device.allocator.createBuffer(&bufferInfo, &allocInfo, &frame.indexBuffer.buffer, &frame.indexBuffer.allocation, nullptr), "Failed to create dynamic index buffer");
+
+        // mapped for as long as mesh lives, edits are written every frame
+        void* data;
+        CHECK_VK_RESULT(device.allocator.mapMemory(frame.vertexBuffer.allocation, &data), "Failed to map memory");
+        frame.vertexData = static_cast<uint8_t*>(data);
+        CHECK_VK_RESULT(device.allocator.mapMemory(frame.indexBuffer.allocation, &data), "Failed to map memory");
+        frame.indexData = static_cast<uint32_t*>(data);
+    }
+
+    LOG(INFO, "Dynamic mesh %s : %u vertices, %u indices, %.2f MB for %lu frame copies", name.c_str(), vertexCapacity, indexCapacity,
+        FrameOverlapCount * (mesh->GetVertexBufferSize() + mesh->GetIndexBufferSize()) / (1024.f * 1024.f), FrameOverlapCount);
+
+    PushFunction([=](){
+        for(DynamicMeshFrame& frame : mesh->frames){
+            device.allocator.unmapMemory(frame.vertexBuffer.allocation);
+            device.allocator.unmapMemory(frame.indexBuffer.allocation);
+            device.allocator.destroyBuffer(frame.vertexBuffer.buffer, frame.vertexBuffer.allocation);
+            device.allocator.destroyBuffer(frame.indexBuffer.buffer, frame.indexBuffer.allocation);
+        }
+    });
+
+    return mesh;
+}
+
+// get dynamic mesh using name, nullptr if not found
+GameZero::DynamicMesh* GameZero::Renderer::GetDynamicMesh(const std::string& name){
+    auto it = dynamicMeshes.find(name);
+    if(it == dynamicMeshes.end()) return nullptr;
+    return &it->second;
+}
+
+// copy of current frame catches up with every edit made since it was last drawn
+GameZero::DynamicMeshUpload GameZero::Renderer::UpdateDynamicMeshes(){
+    DynamicMeshUpload total;
+    for(auto& [name, mesh] : dynamicMeshes){
+        DynamicMeshUpload upload = mesh.WriteFrame(frameNumber % FrameOverlapCount);
+        total.vertexRanges += upload.vertexRanges;
+        total.indexRanges += upload.indexRanges;
+        total.bytes += upload.bytes;
+    }
+    return total;
+}
+
+// each dynamic mesh has buffers of its own, so everything is bound per mesh
+void GameZero::Renderer::DrawDynamicMeshes(vk::CommandBuffer cmd, bool depthOnly){
+    for(auto& [name, mesh] : dynamicMeshes){
+        const DynamicMeshFrame& frame = mesh.frames[frameNumber % FrameOverlapCount];
+        if(frame.indexCount == 0 || !mesh.material) continue;
+
+        // vertices are always standard
+        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, depthOnly ? depthPipeline : mesh.material->pipeline);
+        frameStatistics.pipelineBinds++;
+
+        // position stream to binding 0 and attribute stream to binding 1, like geometry buffers
+        vk::Buffer vertexBuffers[2] = { frame.vertexBuffer.buffer, frame.vertexBuffer.buffer };
+        vk::DeviceSize offsets[2] = { 0, mesh.GetAttributeOffset() };
+        cmd.bindVertexBuffers(0, depthOnly ? 1 : 2, vertexBuffers, offsets);
+        cmd.bindIndexBuffer(frame.indexBuffer.buffer, 0, vk::IndexType::eUint32);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &GetCurrentFrame().descriptorSet, 0, nullptr);
+        frameStatistics.geometryBinds++;
+
+        // standard positions and plain texture coordinates need nothing to decode
+        GPUMeshData meshData;
+        meshData.model = mesh.transform;
+        meshData.positionOffset = glm::vec4(0.f);
+        meshData.positionScale = glm::vec4(1.f);
+        meshData.uvTiling = glm::vec4(0.f);
+        cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(GPUMeshData), &meshData);
+
+        if(!depthOnly && mesh.material->textureSet){
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, 1, &mesh.material->textureSet, 0, nullptr);
+            GPUMaterialData materialData = mesh.material->GetGPUMaterialData();
+            cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eFragment, sizeof(GPUMeshData), sizeof(GPUMaterialData), &materialData);
+            frameStatistics.materialBinds++;
+        }
+
+        cmd.drawIndexed(frame.indexCount, 1, 0, 0, 0);
+        frameStatistics.drawCalls++;
+        frameStatistics.triangleCount += frame.indexCount / 3;
+    }
 }
 
 // create a new material for renderer
@@ -557,84 +795,289 @@ GameZero::Mesh* GameZero::Renderer::GetMesh(const std::string &name){
 }
 
 // draw multiple objects
-void GameZero::Renderer::DrawObjects(vk::CommandBuffer cmd, RenderObject *firstObject, uint32_t count){
-	Mesh* lastMesh = nullptr;
-	Material* lastMaterial = nullptr;
-	for (int i = 0; i < count; i++)
+void GameZero::Renderer::DrawObjects(vk::CommandBuffer cmd, RenderObject *firstObject, uint32_t count, bool depthOnly){
+	// level of detail selection needs camera position and how large a unit looks on screen
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(cameraData.view)[3]);
+	float projectionScale = std::fabs(cameraData.proj[1][1]) * window.GetExtent().height * 0.5f;
+
+	// whole objects are culled in world space with bounds kept by RenderObject::SetTransform and SetMesh
+	Frustum worldFrustum = Frustum::FromMatrix(cameraData.proj * cameraData.view);
+
+	// collect visible ranges of all submeshes first, so that they can be grouped by state
+	drawCommands.clear();
+	for (uint32_t i = 0; i < count; i++)
 	{
-		RenderObject& object = firstObject[i];
+		const RenderObject& object = firstObject[i];
+		const Mesh* mesh = object.mesh;
+
+		// nothing to draw until mesh is in a geometry buffer
+		if (!mesh || !mesh->geometry.IsValid()) continue;
+
+		MeshLod fullDetail = mesh->GetLod(0);
+		frameStatistics.triangleCount += fullDetail.indexCount / 3;
+
+		if (!worldFrustum.IsSphereVisible(object.worldSphere.center, object.worldSphere.radius)) {
+			frameStatistics.culledObjectCount++;
+			frameStatistics.culledTriangleCount += fullDetail.indexCount / 3;
+			continue;
+		}
+
+		// full detail is culled per meshlet and coarser levels are drawn whole
+		uint32_t lod = enableLod ? SelectMeshLod(*mesh, object.GetTransform(), cameraPosition, projectionScale, lodErrorThreshold) : 0;
+
+		if (lod == 0) {
+			frameStatistics.meshletCount += mesh->GetMeshletCount();
+		} else {
+			MeshLod range = mesh->GetLod(lod);
+			frameStatistics.lodObjectCount++;
+			frameStatistics.lodReducedTriangleCount += (fullDetail.indexCount - range.indexCount) / 3;
+		}
+
+		// bring frustum and camera to mesh space instead of moving every meshlet to world space
+		glm::mat4 modelView = cameraData.view * object.GetTransform();
+		Frustum frustum = Frustum::FromMatrix(cameraData.proj * modelView);
+		glm::vec3 meshCameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+
+		const Submesh* submeshes = mesh->GetSubmeshData();
+		for (size_t s = 0; s < mesh->GetSubmeshCount(); s++) {
+			const Submesh& submesh = submeshes[s];
+
+			DrawCommand draw;
+			draw.object = &object;
+			draw.material = submesh.material < mesh->renderMaterials.size() ? mesh->renderMaterials[submesh.material] : nullptr;
+			if (!draw.material) draw.material = object.material;
+			draw.pipeline = draw.material->pipeline;
+
+			// depth only pipeline depends on mesh vertex format and binds no textures
+			if (depthOnly) {
+				draw.pipeline = mesh->vertexFormat == VertexFormat::Compact ? compactDepthPipeline : depthPipeline;
+				draw.material = nullptr;
+			}
+
+			if (lod == 0) {
+				AddMeshletDraws(draw, submesh, frustum, meshCameraPosition);
+				continue;
+			}
+
+			draw.firstIndex = submesh.lods[lod].firstIndex;
+			draw.indexCount = submesh.lods[lod].indexCount;
+			if (draw.indexCount > 0) drawCommands.push_back(draw);
+		}
+	}
 
+	// fewest state changes : pipeline, then texture set, then material layer, then mesh and object constants
+	// pipeline decides vertex format, so geometry buffers are bound once per format
+	// materials of one texture array share its texture set, so their draws follow each other
+	auto textureSet = [](const DrawCommand& draw){ return draw.material ? draw.material->textureSet : vk::DescriptorSet(); };
+	std::sort(drawCommands.begin(), drawCommands.end(), [&](const DrawCommand& a, const DrawCommand& b){
+		return std::make_tuple(a.pipeline, textureSet(a), a.material, a.object->mesh, a.object, a.firstIndex) <
+		       std::make_tuple(b.pipeline, textureSet(b), b.material, b.object->mesh, b.object, b.firstIndex);
+	});
+
+	vk::Pipeline lastPipeline;
+	const Material* lastMaterial = nullptr;
+	vk::DescriptorSet lastTextureSet;
+	GPUMaterialData lastMaterialData = { ~0u, ~0u };
+	const GeometryBuffer* lastGeometry = nullptr;
+	const RenderObject* lastObject = nullptr;
+
+	for (const DrawCommand& draw : drawCommands)
+	{
 		//only bind the pipeline if it doesn't match with the already bound one
-		if (object.material != lastMaterial) {
-			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipeline);
-			lastMaterial = object.material;
+		if (draw.pipeline != lastPipeline) {
+			cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, draw.pipeline);
+			lastPipeline = draw.pipeline;
+			frameStatistics.pipelineBinds++;
 		}
 
-        // update camera data
-        cameraData.model = object.transform;
+		//all meshes of a vertex format share one geometry buffer, so it is bound once per format
+		const Mesh* mesh = draw.object->mesh;
+		const GeometryBuffer* geometry = &geometryBuffers[size_t(mesh->vertexFormat)];
+		if (geometry != lastGeometry) {
+			//bind position stream to binding 0 and attribute stream to binding 1
+			//depth only pipelines read positions alone
+			vk::Buffer vertexBuffers[2] = { geometry->vertexBuffer.buffer, geometry->vertexBuffer.buffer };
+			vk::DeviceSize offsets[2] = { 0, geometry->attributeOffset };
+			cmd.bindVertexBuffers(0, depthOnly ? 1 : 2, vertexBuffers, offsets);
+			//and index buffer with it
+			cmd.bindIndexBuffer(geometry->indexBuffer.buffer, 0, vk::IndexType::eUint32);
+			cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &GetCurrentFrame().descriptorSet, 0, nullptr);
+			lastGeometry = geometry;
+			frameStatistics.geometryBinds++;
+		}
 
-        //and copy it to the buffer
-        void* data;
-        CHECK_VK_RESULT(device.allocator.mapMemory(GetCurrentFrame().cameraBuffer.allocation, &data), "Failed to map memory");
-        memcpy(data, &cameraData, sizeof(GPUCameraData));
-        device.allocator.unmapMemory(GetCurrentFrame().cameraBuffer.allocation);
-
-		//only bind the mesh if it's a different one from last bind
-		if (object.mesh != lastMesh) {
-			//bind the mesh vertex buffer with offset 0
-			vk::DeviceSize offset = 0;
-			cmd.bindVertexBuffers(0, 1, &object.mesh->vertexBuffer.buffer, &offset);
-            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, object.material->pipelineLayout, 0, 1, &GetCurrentFrame().descriptorSet, 0, nullptr);
-            lastMesh = object.mesh;
+		//transform is pushed with draws of its object, compact vertices need mesh bounds to be decoded with it
+		if (draw.object != lastObject) {
+			GPUMeshData meshData = mesh->GetGPUMeshData();
+			meshData.model = draw.object->GetTransform();
+			cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(GPUMeshData), &meshData);
+			lastObject = draw.object;
 		}
 
-        // bind texture pipeline only if there is a texture set in current object's material 
-        if(object.material->textureSet){
-            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, object.material->pipelineLayout, 1, 1, &object.material->textureSet, 0, nullptr);
-        }
+		// bind texture set only when it changes, materials sharing it differ by texture layer alone
+		if (draw.material != lastMaterial) {
+			if (draw.material && draw.material->textureSet) {
+				if (draw.material->textureSet != lastTextureSet) {
+					cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, 1, &draw.material->textureSet, 0, nullptr);
+					lastTextureSet = draw.material->textureSet;
+					frameStatistics.materialBinds++;
+				}
+				GPUMaterialData materialData = draw.material->GetGPUMaterialData();
+				if (materialData.textureLayer != lastMaterialData.textureLayer || materialData.normalMap != lastMaterialData.normalMap) {
+					cmd.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eFragment, sizeof(GPUMeshData), sizeof(GPUMaterialData), &materialData);
+					lastMaterialData = materialData;
+				}
+			}
+			lastMaterial = draw.material;
+		}
 
-		//we can now draw
-		vkCmdDraw(cmd, object.mesh->vertices.size(), 1, 0, 0);
-	}   
+		//mesh indices are local to mesh, vertex offset moves them to its vertices
+		cmd.drawIndexed(draw.indexCount, 1, mesh->geometry.firstIndex + draw.firstIndex, int32_t(mesh->geometry.vertexOffset), 0);
+		frameStatistics.drawCalls++;
+	}
 }
 
-void GameZero::Renderer::InitScene(){
-    vk::SamplerCreateInfo samplerInfo;
-    samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
-    samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
-    samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
-    samplerInfo.magFilter = vk::Filter::eNearest;
-    samplerInfo.minFilter = vk::Filter::eNearest;
+// cull meshlets of a submesh in mesh space and add draws for what is left
+void GameZero::Renderer::AddMeshletDraws(DrawCommand draw, const Submesh& submesh, const Frustum& frustum, const glm::vec3& cameraPosition){
+    // submeshes without meshlets are drawn whole
+    if(submesh.meshletCount == 0 || !enableMeshletCulling){
+        draw.firstIndex = submesh.lods[0].firstIndex;
+        draw.indexCount = submesh.lods[0].indexCount;
+        drawCommands.push_back(draw);
+        return;
+    }
 
-    vk::Sampler blockySampler;
-    CHECK_VK_RESULT(device.logical.createSampler(&samplerInfo, nullptr, &blockySampler), "Failed to create sampler")
-    PushFunction([=](){
-        device.logical.destroySampler(blockySampler);
-    });
+    const Meshlet* meshlets = draw.object->mesh->GetMeshletData() + submesh.firstMeshlet;
+    MeshletCullStatistics culled = CullMeshlets(meshlets, submesh.meshletCount, frustum, cameraPosition, meshletDrawRanges);
+    frameStatistics.frustumCulledMeshlets += culled.frustumCulled;
+    frameStatistics.backfaceCulledMeshlets += culled.backfaceCulled;
+    frameStatistics.culledTriangleCount += culled.culledTriangles;
 
-    RenderObject object;
-    object.mesh = GetMesh("TestMesh");
-    if(!object.mesh) LOG(DEBUG, "Failed to Get Mesh");
+    for(const MeshletDrawRange& range : meshletDrawRanges){
+        draw.firstIndex = range.firstIndex;
+        draw.indexCount = range.indexCount;
+        drawCommands.push_back(draw);
+    }
+}
 
-    object.material = GetMaterial("default");
-    if(!object.material) LOG(DEBUG, "Failed to Get Material");
+// find texture file, textures named by material files are searched beside them first and then in assets
+static std::string FindTextureFile(const char* filename){
+    GameZero::FileInfo info;
+    if(GameZero::GetFileInfo(filename, info)) return filename;
+
+    std::string name(filename);
+    size_t slash = name.find_last_of('/');
+    if(slash != std::string::npos) name = name.substr(slash + 1);
+
+    std::string assetPath = "../assets/textures/" + name;
+    if(GameZero::GetFileInfo(assetPath.c_str(), info)) return assetPath;
+
+    return std::string();
+}
+
+// create renderer materials for all materials of a mesh
+void GameZero::Renderer::CreateMeshMaterials(Mesh& mesh){
+    bool compact = mesh.vertexFormat == VertexFormat::Compact;
+    const MeshMaterial* meshMaterials = mesh.GetMaterialData();
+    size_t materialCount = mesh.GetMaterialCount();
+
+    mesh.renderMaterials.assign(materialCount, nullptr);
+    mesh.materialUvDensities.assign(materialCount, 0.f);
+    std::unordered_set<std::string> missingTextures;
+
+    for(size_t i = 0; i < materialCount; i++){
+        const MeshMaterial& meshMaterial = meshMaterials[i];
+
+        // untextured materials and materials with missing textures are drawn with object material
+        if(!meshMaterial.diffuseTexture[0]) continue;
+
+        std::string texturePath = FindTextureFile(meshMaterial.diffuseTexture);
+        Texture* texture = texturePath.empty() ? nullptr : LoadTexture(texturePath);
+        if(!texture){
+            // warn once per texture, many materials may share it
+            if(missingTextures.insert(meshMaterial.diffuseTexture).second){
+                LOG(WARNING, "Texture [ %s ] of material [ %s ] was not loaded, object material is used instead", meshMaterial.diffuseTexture, meshMaterial.name);
+            }
+            continue;
+        }
+
+        // materials differing only by name share a renderer material, so they share binds too
+        std::string materialName = texturePath + (compact ? "_compact" : "");
+        Material* material = GetMaterial(materialName);
+        if(!material){
+            // new material needs a texture set of its own unless its texture array has one already
+            bool sharedSet = texture->arrayIndex >= 0 && textureArrays[texture->arrayIndex].textureSet;
+            if(!sharedSet && materialTextureSetCount >= MaxMaterialCount){
+                if(missingTextures.insert(meshMaterial.diffuseTexture).second){
+                    LOG(WARNING, "Texture [ %s ] of material [ %s ] has no texture set left, all %u are used, object material is used instead",
+                        meshMaterial.diffuseTexture, meshMaterial.name, MaxMaterialCount);
+                }
+                continue;
+            }
+
+            material = CreateMaterial(compact ? compactPipeline : pipeline, pipelineLayout, materialName);
+            WriteTextureSet(*material, *texture);
+        }
+
+        mesh.renderMaterials[i] = material;
+    }
+
+    // texture coordinate density of each material picks mip levels its texture is streamed at
+    const Submesh* submeshes = mesh.GetSubmeshData();
+    for(size_t s = 0; s < mesh.GetSubmeshCount(); s++){
+        const Submesh& submesh = submeshes[s];
+        if(submesh.material >= materialCount || !mesh.renderMaterials[submesh.material]) continue;
+
+        float density = ComputeUvDensity(mesh.GetVertexData(), mesh.GetIndexData() + submesh.lods[0].firstIndex, submesh.lods[0].indexCount);
+        // tiled coordinates count tiles, one tile is tileSize of texture
+        if(mesh.uvTiling.IsEnabled()) density *= std::sqrt(mesh.uvTiling.tileSize.x * mesh.uvTiling.tileSize.y);
+        mesh.materialUvDensities[submesh.material] = std::max(mesh.materialUvDensities[submesh.material], density);
+    }
+
+    std::unordered_set<Material*> uniqueMaterials(mesh.renderMaterials.begin(), mesh.renderMaterials.end());
+    uniqueMaterials.erase(nullptr);
+    LOG(INFO, "Mesh has %lu materials drawn with %lu textured materials", materialCount, uniqueMaterials.size());
+}
+
+// allocate texture set of a material and point it to a texture
+// materials of layers of one texture array share a set, so that their draws bind it once
+void GameZero::Renderer::WriteTextureSet(Material& material, const Texture& texture){
+    material.texture = &texture;
+    material.textureView = texture.image.view;
+    material.textureLayer = texture.layer;
+    material.normalMap = texture.image.format == vk::Format::eR8G8Unorm;
+
+    TextureArray* array = texture.arrayIndex >= 0 ? &textureArrays[texture.arrayIndex] : nullptr;
+    if(array && array->textureSet){
+        material.textureSet = array->textureSet;
+        return;
+    }
+
+    // sets replacing one a material already has are retired by caller and do not count against MaxMaterialCount
+    if(!material.textureSet) materialTextureSetCount++;
 
     vk::DescriptorSetAllocateInfo allocInfo;
 	allocInfo.descriptorPool = descriptorPool;
 	allocInfo.descriptorSetCount = 1;
 	allocInfo.pSetLayouts = &singleTextureSetLayout;
 
-    CHECK_VK_RESULT(device.logical.allocateDescriptorSets(  &allocInfo, &object.material->textureSet), "Failed to allocate Descriptor Set");
+    CHECK_VK_RESULT(device.logical.allocateDescriptorSets(  &allocInfo, &material.textureSet), "Failed to allocate Descriptor Set");
+
+    if(array) array->textureSet = material.textureSet;
+    UpdateTextureSet(material);
+}
 
+// point texture set of a material to its texture with sampler of current mipmap setting
+void GameZero::Renderer::UpdateTextureSet(const Material& material){
     vk::DescriptorImageInfo imageBufferInfo;
-	imageBufferInfo.sampler = blockySampler;
-	imageBufferInfo.imageView = textures["empire_diffuse"].image.view;
+	imageBufferInfo.sampler = enableMipmaps ? blockySampler : blockyBaseLevelSampler;
+	imageBufferInfo.imageView = material.textureView;
 	imageBufferInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
     vk::WriteDescriptorSet textureWrite;
     textureWrite.descriptorCount = 1;
     textureWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-    textureWrite.dstSet = object.material->textureSet;
+    textureWrite.dstSet = material.textureSet;
     textureWrite.dstBinding = 0;
     textureWrite.pImageInfo = &imageBufferInfo;
     
@@ -645,6 +1088,25 @@ void GameZero::Renderer::InitScene(){
         0, /* descriptor copy count */
         nullptr /* descriptor copies */
     );
+}
+
+void GameZero::Renderer::InitScene(){
+    // materials sharing a texture share a renderer material across all meshes
+    for(auto& [name, mesh] : meshes){
+        CreateMeshMaterials(mesh);
+    }
+
+    // object stays at origin, its world bounds are computed with its mesh
+    RenderObject object;
+    object.SetMesh(GetMesh(enableMergedFaces ? "TestMesh" : "TestMeshBlocks"));
+    if(!object.mesh){
+        LOG(WARNING, "Map mesh is not loaded, scene has nothing to draw");
+        return;
+    }
+
+    // used for submeshes that have no renderer material, pipeline must match mesh vertex format
+    object.material = GetMaterial(object.mesh->vertexFormat == VertexFormat::Compact ? "default_compact" : "default");
+    if(!object.material) LOG(DEBUG, "Failed to Get Material");
 
     // add renderable
     renderables.push_back(object);
@@ -652,14 +1114,17 @@ void GameZero::Renderer::InitScene(){
 
 void GameZero::Renderer::InitDescriptors(){
     //create a descriptor pool that will hold 10 uniform buffers
+    //and a texture set for each material, plus sets replaced by texture streaming while frames in flight read them
+    constexpr uint32_t textureSetCount = MaxMaterialCount * (FrameOverlapCount + 1);
 	std::vector<vk::DescriptorPoolSize> sizes =
 	{
 		{ vk::DescriptorType::eUniformBuffer, 10 },
-        { vk::DescriptorType::eCombinedImageSampler, 10}
+        { vk::DescriptorType::eCombinedImageSampler, textureSetCount}
 	};
 
 	vk::DescriptorPoolCreateInfo pool_info;
-	pool_info.maxSets = 10;
+	pool_info.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+	pool_info.maxSets = 10 + textureSetCount;
 	pool_info.poolSizeCount = (uint32_t)sizes.size();
 	pool_info.pPoolSizes = sizes.data();
 
@@ -802,104 +1267,456 @@ void GameZero::Renderer::ImmediateSubmit(std::function<void (vk::CommandBuffer)>
     device.logical.resetCommandPool(uploadContext.commandPool);
 }
 
-void GameZero::Renderer::UploadMeshToGPU(Mesh* mesh, bool useStaging){
-	// no staging buffer
-	if(!useStaging){
-		vk::BufferCreateInfo  bufferInfo;
-		bufferInfo.size = mesh->vertices.size() * sizeof(Vertex);
-		bufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer;
+// geometry buffers start small enough for a few meshes and grow when they fill up
+void GameZero::Renderer::InitGeometryBuffers(){
+    for(size_t i = 0; i < VertexFormatCount; i++){
+        ResizeGeometryBuffer(VertexFormat(i), GeometryBufferVertexCapacity, GeometryBufferIndexCapacity);
+    }
 
-		// cpu to gpu read is slow
-		vma::AllocationCreateInfo allocInfo({}, vma::MemoryUsage::eCpuToGpu);
+    // buffers are replaced when they grow, so destroy whatever they are at shutdown
+    PushFunction([=](){
+        for(GeometryBuffer& geometry : geometryBuffers){
+            if(!geometry.IsCreated()) continue;
+            device.allocator.destroyBuffer(geometry.vertexBuffer.buffer, geometry.vertexBuffer.allocation);
+            device.allocator.destroyBuffer(geometry.indexBuffer.buffer, geometry.indexBuffer.allocation);
+        }
+    });
+}
 
-		// create buffer
-		CHECK_VK_RESULT(device.allocator.createBuffer(&bufferInfo, &allocInfo, &mesh->vertexBuffer.buffer, &mesh->vertexBuffer.allocation, nullptr), "Failed to create vertex buffer");
-        // deletor
-        PushFunction([=](){
-            device.allocator.destroyBuffer(mesh->vertexBuffer.buffer, mesh->vertexBuffer.allocation);
-        });
+// create new buffers and copy old contents to them, ranges handed out so far stay valid
+void GameZero::Renderer::ResizeGeometryBuffer(VertexFormat format, uint32_t vertexCapacity, uint32_t indexCapacity){
+    GeometryBuffer& geometry = geometryBuffers[size_t(format)];
 
-		// copy vertex data
-		void* data;
-		device.allocator.mapMemory(mesh->vertexBuffer.allocation, &data);
-		memcpy(data, mesh->vertices.data(), mesh->vertices.size() * sizeof(Vertex));
-		device.allocator.unmapMemory(mesh->vertexBuffer.allocation);
-	}else{
-		// use staging buffer
-		// staging buffer is basically a cpu only buffer copied to gpu only buffer
-		// that gpu only buffer is called staged buffer
-		const size_t bufferSize = mesh->vertices.size() * sizeof(Vertex);
-		// allocate staging buffer
-		vk::BufferCreateInfo stagingBufferInfo;
-		stagingBufferInfo.size = bufferSize;
-		// this is source of transfer
-		stagingBufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
-
-		// we want this data to be cpu readble only
-		vma::AllocationCreateInfo allocInfo;
-		allocInfo.usage = vma::MemoryUsage::eCpuOnly;
-		
-		AllocatedBuffer stagingBuffer;
-
-		// allocate buffer
-		CHECK_VK_RESULT(device.allocator.createBuffer(&stagingBufferInfo, &allocInfo, &stagingBuffer.buffer, &stagingBuffer.allocation, nullptr), "Failed to create Staging Buffer");
-
-		// copy data to staging buffer
-		void *data;
-		device.allocator.mapMemory(stagingBuffer.allocation, &data);
-		memcpy(data, mesh->vertices.data(), bufferSize);
-		device.allocator.unmapMemory(stagingBuffer.allocation);
-
-		// create staged buffer
-		vk::BufferCreateInfo stagedBufferInfo;
-		stagedBufferInfo.size = bufferSize;
-		// this is destination of a transfer operation and also a vertex buffer at the same time
-		stagedBufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer  | vk::BufferUsageFlagBits::eTransferDst;
-
-		// this buffer will be gpu only
-		allocInfo.usage = vma::MemoryUsage::eGpuOnly;
-
-		// allocate buffer
-		CHECK_VK_RESULT(device.allocator.createBuffer(&stagedBufferInfo, &allocInfo, &mesh->vertexBuffer.buffer, &mesh->vertexBuffer.allocation, nullptr), "Failed to create Staged Buffer");
-        // deletor
-        PushFunction([=](){
-            device.allocator.destroyBuffer(mesh->vertexBuffer.buffer, mesh->vertexBuffer.allocation);
-        });
+    const VertexFormatInfo& formatInfo = VertexFormatInfos[size_t(format)];
 
-		// perform an immediate copy operation
-        ImmediateSubmit([=](vk::CommandBuffer cmd){
-            vk::BufferCopy copy(0, 0, bufferSize);
-            cmd.copyBuffer(stagingBuffer.buffer, mesh->vertexBuffer.buffer, 1, &copy);
-        });
+    GeometryBuffer resized;
+    resized.positionStride = formatInfo.positionStride;
+    resized.attributeStride = formatInfo.attributeStride;
 
-        // after copy, destroy staging buffer as we dont need it anymore
-        device.allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
-	}
+    // keep attribute stream aligned for its widest component, same as VertexStreams
+    resized.attributeOffset = (vk::DeviceSize(vertexCapacity) * resized.positionStride + 15) & ~vk::DeviceSize(15);
+    vk::DeviceSize vertexBufferSize = resized.attributeOffset + vk::DeviceSize(vertexCapacity) * resized.attributeStride;
+    vk::DeviceSize indexBufferSize = vk::DeviceSize(indexCapacity) * sizeof(uint32_t);
+
+    // gpu only, filled by transfers from staging buffers and from old buffers when growing
+    vk::BufferCreateInfo bufferInfo;
+    bufferInfo.size = vertexBufferSize;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc;
+
+    vma::AllocationCreateInfo allocInfo;
+    allocInfo.usage = vma::MemoryUsage::eGpuOnly;
+
+    CHECK_VK_RESULT(device.allocator.createBuffer(&bufferInfo, &allocInfo, &resized.vertexBuffer.buffer, &resized.vertexBuffer.allocation, nullptr), "Failed to create geometry vertex buffer");
+
+    bufferInfo.size = indexBufferSize;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc;
+
+    CHECK_VK_RESULT(device.allocator.createBuffer(&bufferInfo, &allocInfo, &resized.indexBuffer.buffer, &resized.indexBuffer.allocation, nullptr), "Failed to create geometry index buffer");
+
+    LOG(INFO, "Geometry buffer for %s vertices : %u vertices (%.2f MB), %u indices (%.2f MB)",
+        formatInfo.name, vertexCapacity, vertexBufferSize / (1024.f * 1024.f), indexCapacity, indexBufferSize / (1024.f * 1024.f));
+
+    if(!geometry.IsCreated()){
+        resized.vertices.Reset(vertexCapacity);
+        resized.indices.Reset(indexCapacity);
+        geometry = resized;
+        return;
+    }
+
+    // streams keep their offsets, only attribute stream moves as position stream got longer
+    vk::DeviceSize oldVertexCount = geometry.vertices.GetCapacity();
+    vk::DeviceSize oldIndexCount = geometry.indices.GetCapacity();
+    ImmediateSubmit([&](vk::CommandBuffer cmd){
+        vk::BufferCopy positionCopy(0, 0, oldVertexCount * geometry.positionStride);
+        vk::BufferCopy attributeCopy(geometry.attributeOffset, resized.attributeOffset, oldVertexCount * geometry.attributeStride);
+        vk::BufferCopy copies[2] = {positionCopy, attributeCopy};
+        cmd.copyBuffer(geometry.vertexBuffer.buffer, resized.vertexBuffer.buffer, 2, copies);
+
+        vk::BufferCopy indexCopy(0, 0, oldIndexCount * sizeof(uint32_t));
+        cmd.copyBuffer(geometry.indexBuffer.buffer, resized.indexBuffer.buffer, 1, &indexCopy);
+    });
+
+    // frames in flight may still read old buffers
+    device.logical.waitIdle();
+    device.allocator.destroyBuffer(geometry.vertexBuffer.buffer, geometry.vertexBuffer.allocation);
+    device.allocator.destroyBuffer(geometry.indexBuffer.buffer, geometry.indexBuffer.allocation);
+
+    resized.vertices = geometry.vertices;
+    resized.indices = geometry.indices;
+    resized.vertices.Grow(vertexCapacity);
+    resized.indices.Grow(indexCapacity);
+    resized.retiredRanges = std::move(geometry.retiredRanges);
+    geometry = std::move(resized);
+
+    // device is idle, so released ranges can be reused right away
+    ReleaseRetiredGeometry(true);
+}
+
+bool GameZero::Renderer::UploadMeshToGPU(Mesh* mesh){
+    uint32_t vertexCount = static_cast<uint32_t>(mesh->GetVertexCount());
+    uint32_t indexCount = static_cast<uint32_t>(mesh->GetIndexCount());
+    if(vertexCount == 0 || indexCount == 0) return false;
+
+    // uploading again replaces old ranges
+    if(mesh->geometry.IsValid()) ReleaseMeshFromGPU(mesh);
+
+    GeometryBuffer& geometry = geometryBuffers[size_t(mesh->vertexFormat)];
+
+    // grow until mesh fits, doubling keeps number of moves logarithmic
+    uint64_t vertexOffset = 0, firstIndex = 0;
+    while(!geometry.vertices.Allocate(vertexCount, vertexOffset)){
+        ResizeGeometryBuffer(mesh->vertexFormat, uint32_t(std::max<uint64_t>(geometry.vertices.GetCapacity() * 2, geometry.vertices.GetCapacity() + vertexCount)), uint32_t(geometry.indices.GetCapacity()));
+    }
+    while(!geometry.indices.Allocate(indexCount, firstIndex)){
+        ResizeGeometryBuffer(mesh->vertexFormat, uint32_t(geometry.vertices.GetCapacity()), uint32_t(std::max<uint64_t>(geometry.indices.GetCapacity() * 2, geometry.indices.GetCapacity() + indexCount)));
+    }
+
+    mesh->geometry.vertexOffset = uint32_t(vertexOffset);
+    mesh->geometry.vertexCount = vertexCount;
+    mesh->geometry.firstIndex = uint32_t(firstIndex);
+    mesh->geometry.indexCount = indexCount;
+
+    // positions and remaining attributes go in separate streams of geometry buffer
+    const size_t positionSize = vertexCount * geometry.positionStride;
+    const size_t attributeSize = vertexCount * geometry.attributeStride;
+    const size_t indexSize = indexCount * sizeof(uint32_t);
+
+    LOG(INFO, "Uploading mesh : %.2f MB vertices (%lu + %lu bytes per vertex) at vertex %u, %.2f MB indices at index %u",
+        (positionSize + attributeSize) / (1024.f * 1024.f), geometry.positionStride, geometry.attributeStride, mesh->geometry.vertexOffset,
+        indexSize / (1024.f * 1024.f), mesh->geometry.firstIndex);
+
+    // staging buffer is basically a cpu only buffer copied to gpu only geometry buffer
+    // positions, attributes and indices share one staging buffer, placed one after another
+    vk::BufferCreateInfo stagingBufferInfo;
+    stagingBufferInfo.size = positionSize + attributeSize + indexSize;
+    // this is source of transfer
+    stagingBufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+
+    // we want this data to be cpu readble only
+    vma::AllocationCreateInfo allocInfo;
+    allocInfo.usage = vma::MemoryUsage::eCpuOnly;
+
+    AllocatedBuffer stagingBuffer;
+    CHECK_VK_RESULT(device.allocator.createBuffer(&stagingBufferInfo, &allocInfo, &stagingBuffer.buffer, &stagingBuffer.allocation, nullptr), "Failed to create Staging Buffer");
+
+    // vertices are split into their streams straight in staging buffer
+    void *data;
+    device.allocator.mapMemory(stagingBuffer.allocation, &data);
+    uint8_t* staging = static_cast<uint8_t*>(data);
+    mesh->WriteVertexStreams(staging, staging + positionSize);
+    memcpy(staging + positionSize + attributeSize, mesh->GetIndexData(), indexSize);
+    device.allocator.unmapMemory(stagingBuffer.allocation);
+
+    // perform an immediate copy operation, all copies go in same submission
+    ImmediateSubmit([&](vk::CommandBuffer cmd){
+        vk::BufferCopy positionCopy(0, vertexOffset * geometry.positionStride, positionSize);
+        vk::BufferCopy attributeCopy(positionSize, geometry.attributeOffset + vertexOffset * geometry.attributeStride, attributeSize);
+        vk::BufferCopy vertexCopies[2] = {positionCopy, attributeCopy};
+        cmd.copyBuffer(stagingBuffer.buffer, geometry.vertexBuffer.buffer, 2, vertexCopies);
+
+        vk::BufferCopy indexCopy(positionSize + attributeSize, firstIndex * sizeof(uint32_t), indexSize);
+        cmd.copyBuffer(stagingBuffer.buffer, geometry.indexBuffer.buffer, 1, &indexCopy);
+    });
+
+    // after copy, destroy staging buffer as we dont need it anymore
+    device.allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+    return true;
+}
+
+// frames in flight may still draw mesh, so its ranges become free for next uploads only after their fences,
+// see ReleaseRetiredGeometry
+void GameZero::Renderer::ReleaseMeshFromGPU(Mesh* mesh){
+    if(!mesh->geometry.IsValid()) return;
+
+    RetiredGeometryRange retired;
+    retired.frame = frameNumber;
+    retired.range = mesh->geometry;
+    geometryBuffers[size_t(mesh->vertexFormat)].retiredRanges.push_back(retired);
+    mesh->geometry = GeometryRange();
+}
+
+// ranges released at least FrameOverlapCount frames ago were last read by a frame whose fence was waited on
+void GameZero::Renderer::ReleaseRetiredGeometry(bool all){
+    for(GeometryBuffer& geometry : geometryBuffers){
+        size_t kept = 0;
+        for(const RetiredGeometryRange& retired : geometry.retiredRanges){
+            if(!all && retired.frame + FrameOverlapCount > frameNumber){
+                geometry.retiredRanges[kept++] = retired;
+                continue;
+            }
+            geometry.vertices.Free(retired.range.vertexOffset, retired.range.vertexCount);
+            geometry.indices.Free(retired.range.firstIndex, retired.range.indexCount);
+        }
+        geometry.retiredRanges.resize(kept);
+    }
 }
 
 void GameZero::Renderer::LoadImages(){
-    Texture texture;
-    LoadImageFromFile(this, "../assets/textures/lost_empire-RGBA.png", texture.image);
-    
+    vk::SamplerCreateInfo samplerInfo;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.magFilter = vk::Filter::eNearest;
+    samplerInfo.minFilter = vk::Filter::eNearest;
+    // texels stay blocky up close, far away levels are blended so that level changes dont show as lines
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    samplerInfo.minLod = 0.f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    CHECK_VK_RESULT(device.logical.createSampler(&samplerInfo, nullptr, &blockySampler), "Failed to create sampler")
+
+    // same sampler clamped to full size level, to compare with mipmaps off
+    samplerInfo.maxLod = 0.f;
+    CHECK_VK_RESULT(device.logical.createSampler(&samplerInfo, nullptr, &blockyBaseLevelSampler), "Failed to create sampler")
+
+    PushFunction([=](){
+        device.logical.destroySampler(blockySampler);
+        device.logical.destroySampler(blockyBaseLevelSampler);
+    });
+
+    // textures of all meshes are loaded together, so that CreateMeshMaterials finds them loaded
+    std::vector<std::string> filenames = {"../assets/textures/lost_empire-RGBA.png"};
+    for(auto& [name, mesh] : meshes){
+        const MeshMaterial* meshMaterials = mesh.GetMaterialData();
+        for(size_t i = 0; i < mesh.GetMaterialCount(); i++){
+            if(!meshMaterials[i].diffuseTexture[0]) continue;
+            std::string texturePath = FindTextureFile(meshMaterials[i].diffuseTexture);
+            if(!texturePath.empty()) filenames.push_back(texturePath);
+        }
+    }
+    // streamed textures are loaded with their coarse levels, finer ones come in while drawing
+    textureStreamWorker.Start();
+    PushFunction([=](){
+        for(TextureStreamUpload& upload : textureStreamWorker.Stop()) ReleaseTextureStreamUpload(this, upload);
+        ReleaseRetiredTextures(true);
+        for(Texture* texture : streamedTextures){
+            device.logical.destroyImageView(texture->image.view);
+            device.allocator.destroyImage(texture->image.image, texture->image.allocation);
+        }
+    });
+    LoadTextures(filenames);
+
+    // default materials are used by submeshes without a texture of their own
+    Texture* texture = LoadTexture(filenames.front());
+    if(!texture) return;
+
+    for(const char* name : {"default", "default_compact"}){
+        Material* material = GetMaterial(name);
+        if(material) WriteTextureSet(*material, *texture);
+    }
+}
+
+// texture baked by GameZeroTextureBaker beside an image, used while it is not older than the image
+static std::string FindBakedTexture(const std::string& filename){
+    size_t dot = filename.find_last_of('.');
+    if(dot == std::string::npos || filename.compare(dot, std::string::npos, ".ktx2") == 0) return filename;
+
+    std::string bakedPath = filename.substr(0, dot) + ".ktx2";
+    GameZero::FileInfo sourceInfo, bakedInfo;
+    if(!GameZero::GetFileInfo(bakedPath.c_str(), bakedInfo)) return filename;
+    if(GameZero::GetFileInfo(filename.c_str(), sourceInfo) && sourceInfo.modifiedTime > bakedInfo.modifiedTime) return filename;
+    return bakedPath;
+}
+
+// textures are sampled as arrays, so that textures with an image of their own and texture arrays share shaders
+vk::ImageView GameZero::Renderer::CreateTextureView(const AllocatedImage& image){
     vk::ImageViewCreateInfo imageViewInfo;
-    imageViewInfo.format = vk::Format::eR8G8B8A8Srgb;
-    imageViewInfo.image = texture.image.image;
-    imageViewInfo.viewType = vk::ImageViewType::e2D;
-    imageViewInfo.components.r = vk::ComponentSwizzle::eIdentity;
-    imageViewInfo.components.g = vk::ComponentSwizzle::eIdentity;
-    imageViewInfo.components.b = vk::ComponentSwizzle::eIdentity;
-    imageViewInfo.components.a = vk::ComponentSwizzle::eIdentity;
+    imageViewInfo.format = image.format;
+    imageViewInfo.image = image.image;
+    imageViewInfo.viewType = vk::ImageViewType::e2DArray;
+    // narrow formats read like rgba
+    imageViewInfo.components = GetTextureSwizzle(image.format);
     imageViewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
     imageViewInfo.subresourceRange.baseArrayLayer = 0;
     imageViewInfo.subresourceRange.baseMipLevel = 0;
-    imageViewInfo.subresourceRange.layerCount = 1;
-    imageViewInfo.subresourceRange.levelCount = 1;
+    imageViewInfo.subresourceRange.layerCount = image.arrayLayers;
+    imageViewInfo.subresourceRange.levelCount = image.mipLevels;
 
     // create image view
-    texture.image.view = device.logical.createImageView(imageViewInfo);
-    PushFunction([=](){
-        device.logical.destroyImageView(texture.image.view);
-    });
+    return device.logical.createImageView(imageViewInfo);
+}
+
+// create image view of a loaded texture and keep it, streamed textures start at their startup levels
+// layers of texture arrays use view of their array
+GameZero::Texture* GameZero::Renderer::AddTexture(const std::string& filename, const Texture& loaded){
+    Texture* texture = &(textures[filename] = loaded);
+    if(texture->arrayIndex >= 0){
+        fixedTextureBytes += texture->size;
+        return texture;
+    }
+
+    texture->image.view = CreateTextureView(texture->image);
+    if(!texture->file){
+        AllocatedImage image = texture->image;
+        PushFunction([=](){
+            device.logical.destroyImageView(image.view);
+            device.allocator.destroyImage(image.image, image.allocation);
+        });
+        fixedTextureBytes += texture->size;
+        return texture;
+    }
+
+    StreamedTextureState state;
+    state.levelCount = texture->levelCount;
+    for(uint32_t level = 0; level < state.levelCount; level++) state.levelSizes[level] = GetStagingLevelSize(texture->levels[level].size);
+    state.minResidentLevel = texture->residentLevel;
+    state.residentLevel = texture->residentLevel;
+    state.requestedLevel = texture->levelCount;
+
+    texture->streamIndex = static_cast<int32_t>(streamedTextures.size());
+    streamedTextures.push_back(texture);
+    streamedTextureStates.push_back(state);
+    return texture;
+}
+
+// load texture once and return the already loaded one on later calls
+GameZero::Texture* GameZero::Renderer::LoadTexture(const std::string& filename, ImageUsage usage){
+    auto it = textures.find(filename);
+    if(it != textures.end()) return &it->second;
+
+    if(LoadTextures({filename}, {usage}) == 0) return nullptr;
+    return &textures[filename];
+}
+
+// load all textures not loaded yet in one decode and upload pipeline
+uint32_t GameZero::Renderer::LoadTextures(const std::vector<std::string>& filenames, const std::vector<ImageUsage>& usages){
+    std::vector<std::string> pending, files;
+    std::vector<ImageUsage> fileUsages;
+    std::unordered_set<std::string> seen;
+    for(size_t i = 0; i < filenames.size(); i++){
+        const std::string& filename = filenames[i];
+        if(textures.count(filename) || !seen.insert(filename).second) continue;
+        pending.push_back(filename);
+        files.push_back(FindBakedTexture(filename));
+        fileUsages.push_back(i < usages.size() ? usages[i] : ImageUsage::Color);
+    }
+
+    // streamed levels are kept within MaxStreamedLevelCount levels, larger textures are loaded whole
+    // small textures that stay whole are loaded straight into texture arrays, streamed textures keep images of their own
+    // so that their levels can change alone
+    std::vector<Texture> loaded;
+    size_t firstArray = textureArrays.size();
+    uint32_t loadedCount = LoadTexturesFromFiles(this, files, loaded, TextureStreamingStartupSize, 0, fileUsages, &textureArrays);
+    for(size_t i = firstArray; i < textureArrays.size(); i++){
+        TextureArray& array = textureArrays[i];
+        array.image.view = CreateTextureView(array.image);
+
+        AllocatedImage image = array.image;
+        PushFunction([=](){
+            device.logical.destroyImageView(image.view);
+            device.allocator.destroyImage(image.image, image.allocation);
+        });
+    }
+
+    for(size_t i = 0; i < pending.size(); i++){
+        if(loaded[i].arrayIndex >= 0) loaded[i].image = textureArrays[loaded[i].arrayIndex].image;
+        if(!loaded[i].image.image) continue;
+        AddTexture(pending[i], loaded[i]);
+    }
+    return loadedCount;
+}
+
+// images replaced at least FrameOverlapCount frames ago were last read by a frame whose fence was waited on
+void GameZero::Renderer::ReleaseRetiredTextures(bool all){
+    size_t kept = 0;
+    for(RetiredTexture& retired : retiredTextures){
+        if(!all && retired.frame + FrameOverlapCount > frameNumber){
+            retiredTextures[kept++] = std::move(retired);
+            continue;
+        }
+
+        device.logical.destroyImageView(retired.image.view);
+        device.allocator.destroyImage(retired.image.image, retired.image.allocation);
+        if(!retired.textureSets.empty()){
+            device.logical.freeDescriptorSets(descriptorPool, static_cast<uint32_t>(retired.textureSets.size()), retired.textureSets.data());
+        }
+        ReleaseTextureStreamUpload(this, retired.upload);
+        retiredTextureBytes -= retired.size;
+    }
+    retiredTextures.resize(kept);
+}
+
+// land levels worker has copied, then pick levels drawn objects need and start loading them
+void GameZero::Renderer::UpdateTextureStreaming(vk::CommandBuffer cmd, FrameStatistics& statistics){
+    if(streamedTextures.empty()) return;
+    ReleaseRetiredTextures(false);
+
+    // new images are filled by this frame's command buffer before its render pass reads them,
+    // old images and texture sets may still be read by frames in flight, so they are retired
+    std::vector<TextureStreamUpload> finished;
+    textureStreamWorker.TakeFinished(finished);
+    for(TextureStreamUpload& upload : finished){
+        Texture& texture = *upload.texture;
+        pendingTextureUploads--;
+        streamedTextureStates[texture.streamIndex].pending = false;
+
+        RetiredTexture retired;
+        retired.frame = frameNumber;
+        retired.image = texture.image;
+        retired.size = texture.size;
+
+        AllocatedImage image;
+        if(!RecordTextureStreamUpload(this, cmd, upload, image)){
+            ReleaseTextureStreamUpload(this, upload);
+            streamedTextureStates[texture.streamIndex].residentLevel = texture.residentLevel;
+            continue;
+        }
+
+        texture.image = image;
+        texture.residentLevel = upload.level;
+        texture.size = upload.size;
+        texture.image.view = CreateTextureView(texture.image);
+
+        for(auto& [name, material] : materials){
+            if(material.texture != &texture) continue;
+            retired.textureSets.push_back(material.textureSet);
+            WriteTextureSet(material, texture);
+        }
+
+        retired.upload = std::move(upload);
+        retiredTextureBytes += retired.size;
+        retiredTextures.push_back(std::move(retired));
+    }
+
+    // finest level each texture is drawn at, textures not drawn this frame need none of their streamed levels
+    for(StreamedTextureState& state : streamedTextureStates) state.requestedLevel = state.levelCount;
+
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(cameraData.view)[3]);
+    float projectionScale = std::fabs(cameraData.proj[1][1]) * window.GetExtent().height * 0.5f;
+    Frustum worldFrustum = Frustum::FromMatrix(cameraData.proj * cameraData.view);
+
+    for(const RenderObject& object : renderables){
+        const Mesh* mesh = object.mesh;
+        if(!mesh || !worldFrustum.IsSphereVisible(object.worldSphere.center, object.worldSphere.radius)) continue;
+
+        const Submesh* submeshes = mesh->GetSubmeshData();
+        for(size_t s = 0; s < mesh->GetSubmeshCount(); s++){
+            uint32_t materialIndex = submeshes[s].material;
+            const Material* material = materialIndex < mesh->renderMaterials.size() ? mesh->renderMaterials[materialIndex] : nullptr;
+            if(!material) material = object.material;
+            if(!material || !material->texture || material->texture->streamIndex < 0) continue;
+
+            const Texture& texture = *material->texture;
+            StreamedTextureState& state = streamedTextureStates[texture.streamIndex];
+            float uvDensity = materialIndex < mesh->materialUvDensities.size() ? mesh->materialUvDensities[materialIndex] : 0.f;
+            float texelDensity = uvDensity * static_cast<float>(std::max(texture.width, texture.height));
+
+            uint32_t level = SelectTextureMipLevel(*mesh, object.GetTransform(), cameraPosition, projectionScale, texelDensity, texture.levelCount);
+            state.requestedLevel = std::min(state.requestedLevel, level);
+            state.lastUsedFrame = frameNumber;
+        }
+    }
+
+    // images not released yet still hold memory, so they count against budget until they are
+    PlanTextureResidency(streamedTextureStates, fixedTextureBytes + retiredTextureBytes, textureBudget, TextureStreamingUploadLimit, textureResidencyPlan);
+    for(const TextureResidencyChange& change : textureResidencyPlan.changes){
+        TextureStreamUpload upload;
+        BeginTextureStreamUpload(this, *streamedTextures[change.texture], change.level, upload);
+        textureStreamWorker.Push(std::move(upload));
+        pendingTextureUploads++;
+    }
 
-    textures["empire_diffuse"] = texture;
+    statistics.textureBytes = textureResidencyPlan.residentBytes;
+    statistics.streamedInLevels = textureResidencyPlan.loadedLevels;
+    statistics.streamedOutLevels = textureResidencyPlan.evictedLevels;
 }
@@ -8,10 +8,12 @@
 #include "vulkan/device.hpp"
 #include "vulkan/swapchain.hpp"
 #include "mesh.hpp"
+#include "dynamic_mesh.hpp"
 #include <string>
 #include <unordered_map>
 #include <functional>
 #include "texture.hpp"
+#include "texture_streaming.hpp"
 
 namespace GameZero{
 
@@ -20,6 +22,45 @@ namespace GameZero{
         std::vector<vk::Framebuffer> framebuffers;
     };
 
+    /// what renderer did in last frame
+    struct FrameStatistics{
+        /// number of draw calls recorded
+        uint32_t drawCalls = 0;
+        /// objects whose world bounds are outside view frustum
+        uint32_t culledObjectCount = 0;
+        /// meshlets of all drawn objects, culled or not
+        uint32_t meshletCount = 0;
+        /// meshlets outside view frustum
+        uint32_t frustumCulledMeshlets = 0;
+        /// meshlets facing away from camera
+        uint32_t backfaceCulledMeshlets = 0;
+        /// triangles of all drawn objects, culled or not
+        uint64_t triangleCount = 0;
+        /// triangles skipped by culling
+        uint64_t culledTriangleCount = 0;
+        /// objects drawn with a coarser level of detail
+        uint32_t lodObjectCount = 0;
+        /// triangles skipped by drawing coarser levels of detail
+        uint64_t lodReducedTriangleCount = 0;
+        /// draw calls recorded by depth prepass, not included in drawCalls
+        uint32_t depthPrepassDrawCalls = 0;
+        /// pipeline binds recorded, including depth prepass
+        uint32_t pipelineBinds = 0;
+        /// texture set binds recorded
+        uint32_t materialBinds = 0;
+        /// geometry buffer binds recorded, one per vertex format drawn
+        uint32_t geometryBinds = 0;
+        /// bytes of dynamic meshes written to copies of this frame
+        uint64_t dynamicMeshUploadBytes = 0;
+        /// vertex and index ranges those bytes were written in
+        uint32_t dynamicMeshUploadRanges = 0;
+        /// bytes of texture images on gpu, including replaced images not released yet
+        uint64_t textureBytes = 0;
+        /// mip levels of streamed textures that started loading and were evicted this frame
+        uint32_t streamedInLevels = 0;
+        uint32_t streamedOutLevels = 0;
+    };
+
     class Renderer{
         /// initialize renderer
         void Initialize();
@@ -43,12 +84,46 @@ namespace GameZero{
         void InitPipelineLayouts();
         /// init pipelines
         void InitPipelines();
+        /// create empty geometry buffers for all vertex formats
+        void InitGeometryBuffers();
         /// init mesh
         void InitMesh();
         /// Init Descriptors
         void InitDescriptors();
         /// load images
         void LoadImages();
+        /// one draw call and the state it needs, sorted before recording to bind each state as few times as possible
+        struct DrawCommand{
+            vk::Pipeline pipeline;
+            Material* material = nullptr;
+            const RenderObject* object = nullptr;
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+        };
+        /// cull meshlets of a submesh and add draw commands for the visible ones at full detail
+        void AddMeshletDraws(DrawCommand draw, const Submesh& submesh, const Frustum& frustum, const glm::vec3& cameraPosition);
+        /// allocate texture set of material and write texture to it
+        void WriteTextureSet(Material& material, const Texture& texture);
+        /// write texture of material to its texture set with sampler of current mipmap setting
+        void UpdateTextureSet(const Material& material);
+        /// create geometry buffer of a vertex format with given capacity, moving meshes already in it
+        void ResizeGeometryBuffer(VertexFormat format, uint32_t vertexCapacity, uint32_t indexCapacity);
+        /// free ranges of released meshes that no frame in flight reads anymore, or all of them
+        void ReleaseRetiredGeometry(bool all);
+        /// load and upload map with merged coplanar faces or with one quad per block face, nullptr on failure
+        Mesh* LoadMapMesh(bool mergedFaces);
+        /// write edits of all dynamic meshes to their copies for current frame
+        DynamicMeshUpload UpdateDynamicMeshes();
+        /// draw all dynamic meshes from their copies for current frame
+        void DrawDynamicMeshes(vk::CommandBuffer cmd, bool depthOnly);
+        /// create view of a loaded texture and add it to texture map, streamed textures get a streaming state
+        Texture* AddTexture(const std::string& filename, const Texture& loaded);
+        /// create view of all levels and layers of a texture image, caller destroys it
+        vk::ImageView CreateTextureView(const AllocatedImage& image);
+        /// swap in streamed texture images that are ready, and plan levels to load and evict for this frame
+        void UpdateTextureStreaming(vk::CommandBuffer cmd, FrameStatistics& statistics);
+        /// release replaced texture images that no frame in flight reads anymore, or all of them
+        void ReleaseRetiredTextures(bool all);
     public:
         /// window that this renderer renders to
         Window& window;
@@ -76,17 +151,54 @@ namespace GameZero{
         /// current frame number
         size_t frameNumber = 0;
 
+        /// statistics of last recorded frame
+        FrameStatistics frameStatistics;
+
+        /// cull meshlets against view frustum and by normal cone before drawing
+        bool enableMeshletCulling = true;
+
+        /// draw far objects with coarser levels of detail
+        bool enableLod = true;
+        /// largest error in pixels a level of detail may have to be selected
+        float lodErrorThreshold = 1.f;
+
+        /// draw depth of all objects with position only pipelines before shading them
+        bool enableDepthPrepass = false;
+
+        /// map is drawn with merged coplanar faces, change with SetMergedFaces
+        bool enableMergedFaces = true;
+
+        /// textures are sampled with their mip chains, change with SetMipmaps
+        bool enableMipmaps = true;
+
+        /// png textures are decoded by DecodePng, by stb_image when false, applies to textures decoded after it changes
+        bool enableFastPngDecoder = true;
+
+        /// most bytes of gpu memory textures may hold, finer levels of streamed textures are evicted to stay under it
+        uint64_t textureBudget = TextureStreamingBudget;
+
+        /// visible meshlet ranges of object being drawn, kept to avoid allocating every frame
+        std::vector<MeshletDrawRange> meshletDrawRanges;
+        /// draw commands of frame being recorded, kept to avoid allocating every frame
+        std::vector<DrawCommand> drawCommands;
+
         /// frame data for multiple buffering
         /// while gpu renders to one frame, renderer will prepare another frame to render to
         FrameData frames[FrameOverlapCount];
 
         /// default graphics pipeline
         vk::Pipeline pipeline;
+        /// default graphics pipeline for meshes with compact vertices
+        vk::Pipeline compactPipeline;
+        /// depth only pipeline, reads position stream of standard meshes only
+        vk::Pipeline depthPipeline;
+        /// depth only pipeline, reads position stream of compact meshes only
+        vk::Pipeline compactDepthPipeline;
         /// default graphics pipeline layout
         vk::PipelineLayout pipelineLayout;
 
-        /// simple mesh
-        Mesh mesh;
+        /// vertices and indices of all uploaded meshes, one geometry buffer per vertex format
+        GeometryBuffer geometryBuffers[VertexFormatCount];
 
         /// depth image : manually allocated
         AllocatedImage depthImage;
@@ -95,6 +207,8 @@ namespace GameZero{
         std::unordered_map<std::string, Material> materials;
         /// model/mesh map with their unique name
         std::unordered_map<std::string, Mesh> meshes;
+        /// meshes edited at runtime with their unique name, see CreateDynamicMesh
+        std::unordered_map<std::string, DynamicMesh> dynamicMeshes;
 
         /// renderable objects made from loaded meshes and materials
         std::vector<RenderObject> renderables;
@@ -103,6 +217,9 @@ namespace GameZero{
         vk::DescriptorSetLayout descriptorSetLayout;
         /// global descriptor pool for allocation of uniforms
         vk::DescriptorPool descriptorPool;
+        /// first texture sets of materials allocated from descriptor pool, pool holds MaxMaterialCount of them
+        /// and room for sets of streamed textures that replace them while frames in flight read old ones
+        uint32_t materialTextureSetCount = 0;
 
         /// camera data contains camera matrices : model, view, projection
         /// model is updated by renderer but view and projection are updated in main.cpp
@@ -115,9 +232,42 @@ namespace GameZero{
         /// descriptor set layout for uploading a single texture at a time
         vk::DescriptorSetLayout singleTextureSetLayout;
 
-        /// map of textures with their unique name
+        /// map of textures with their file path
         std::unordered_map<std::string, Texture> textures;
 
+        /// texture arrays indexed by Texture::arrayIndex
+        std::vector<TextureArray> textureArrays;
+
+        /// textures whose levels are streamed, indexed by Texture::streamIndex like their states
+        std::vector<Texture*> streamedTextures;
+        std::vector<StreamedTextureState> streamedTextureStates;
+        /// bytes of textures that are not streamed
+        uint64_t fixedTextureBytes = 0;
+        /// copies levels of streamed textures to staging memory
+        TextureStreamWorker textureStreamWorker;
+        /// uploads handed to worker and not landed yet
+        uint32_t pendingTextureUploads = 0;
+        /// texture images replaced by streaming, with the bytes they hold
+        std::vector<RetiredTexture> retiredTextures;
+        uint64_t retiredTextureBytes = 0;
+        /// last plan of streamed texture levels, kept to avoid allocating every frame
+        TextureResidencyPlan textureResidencyPlan;
+
+        /// sampler used by all textures, reads all mip levels
+        vk::Sampler blockySampler;
+        /// sampler used by all textures when mipmaps are disabled, reads level 0 alone
+        vk::Sampler blockyBaseLevelSampler;
+
+        /**
+         * @brief Create a graphics pipeline with default render state
+         * 
+         * @param vertShader : vertex shader module
+         * @param fragShader : fragment shader module, null for depth only pipelines that write no color
+         * @param vertexDescription : vertex layout expected by vertex shader
+         * @return vk::Pipeline : created pipeline, destroyed with renderer
+         */
+        vk::Pipeline CreatePipeline(vk::ShaderModule vertShader, vk::ShaderModule fragShader, const VertexInputDescription& vertexDescription);
+
         /// create material and add it to material map
         Material* CreateMaterial(vk::Pipeline pipeline, vk::PipelineLayout layout, const std::string& name);
 
@@ -127,6 +277,46 @@ namespace GameZero{
         /// get mesh using given name, return nullptr if not found
         Mesh* GetMesh(const std::string& name);
 
+        /**
+         * @brief Create a dynamic mesh with one host visible copy per frame in flight.
+         *        Edits made to it are written to the copy of a frame when that frame
+         *        starts, only in ranges that changed. Drawn with default material.
+         * 
+         * @param name : unique name of mesh
+         * @param vertexCapacity : most vertices mesh can hold
+         * @param indexCapacity : most indices mesh can hold
+         * @return DynamicMesh* : created mesh, nullptr if name is taken or capacity is 0
+         */
+        DynamicMesh* CreateDynamicMesh(const std::string& name, uint32_t vertexCapacity, uint32_t indexCapacity);
+
+        /// get dynamic mesh using given name, return nullptr if not found
+        DynamicMesh* GetDynamicMesh(const std::string& name);
+
+        /// draw map with merged coplanar faces or with one quad per block face, loading that version in place of the other
+        void SetMergedFaces(bool enable);
+
+        /// sample textures with their mip chains or from full size level alone, waits for gpu to be idle
+        void SetMipmaps(bool enable);
+
+        /// load texture from file, a texture is loaded only once, with usage of its first load. returns nullptr on failure
+        Texture* LoadTexture(const std::string& filename, ImageUsage usage = ImageUsage::Color);
+
+        /// load textures that are not loaded yet, decoded in parallel and uploaded in batches
+        /// usages tell what each file holds, files past its end are colors
+        /// returns number of textures loaded by this call
+        uint32_t LoadTextures(const std::vector<std::string>& filenames, const std::vector<ImageUsage>& usages = {});
+
+        /**
+         * @brief Create renderer materials for materials of a mesh.
+         *        Materials using the same texture share one renderer material,
+         *        so draws using them are batched without rebinding textures.
+         *        Materials without a loadable texture are left null and
+         *        are drawn with material of the render object.
+         * 
+         * @param mesh : mesh to fill renderMaterials of
+         */
+        void CreateMeshMaterials(Mesh& mesh);
+
         // get current frame
         FrameData& GetCurrentFrame(){
             return frames[frameNumber % FrameOverlapCount];
@@ -161,8 +351,9 @@ namespace GameZero{
          * @param cmd : command buffer to record draw commands to
          * @param firstObject : first object in an array
          * @param count : total number of objects to draw
+         * @param depthOnly : draw with depth only pipelines, binding position stream alone
          */
-        void DrawObjects(vk::CommandBuffer cmd, RenderObject* firstObject, uint32_t count);
+        void DrawObjects(vk::CommandBuffer cmd, RenderObject* firstObject, uint32_t count, bool depthOnly = false);
     
         /**
          * @brief Immediately submit a command buffer without any extra sync
@@ -172,11 +363,17 @@ namespace GameZero{
         void ImmediateSubmit(std::function<void(vk::CommandBuffer cmd)>&& function);
 
         /**
-         * @brief Upload a given mest to gpu
+         * @brief Upload a given mesh to geometry buffer of its vertex format.
+         *        Geometry buffers are gpu only, so data always goes through a staging buffer.
+         *        Vertex format of mesh must not change while it is uploaded.
          * 
-         * @param useStaging : use staging buffers for transferring data
+         * @param mesh : mesh to upload, its geometry range is set
+         * @return false if mesh has no geometry
          */
-        void UploadMeshToGPU(Mesh* mesh, bool useStaging = true);
+        bool UploadMeshToGPU(Mesh* mesh);
+
+        /// return vertex and index ranges of an uploaded mesh to its geometry buffer
+        void ReleaseMeshFromGPU(Mesh* mesh);
     };
 }
 
@@ -23,6 +23,30 @@ namespace GameZero{
         1;
     #endif
 
+    /// most materials renderer can create, each material owns a texture descriptor set
+    constexpr static uint32_t MaxMaterialCount = 128;
+
+    /// textures load levels of at most this many texels at startup, finer levels are streamed in when drawn close
+    constexpr static uint32_t TextureStreamingStartupSize = 128;
+    /// default bytes of gpu memory textures may hold, see Renderer::textureBudget
+    constexpr static uint64_t TextureStreamingBudget = 512ull * 1024 * 1024;
+    /// most bytes of finer texture levels started loading in one frame
+    constexpr static uint64_t TextureStreamingUploadLimit = 32ull * 1024 * 1024;
+
+    /// textures of at most this many texels that are not streamed are packed into texture arrays with others of same format and size
+    constexpr static uint32_t TextureArrayMaxSize = 512;
+    /// most layers of a texture array, device limit may be lower
+    constexpr static uint32_t TextureArrayMaxLayers = 256;
+
+    /// vertices each geometry buffer starts with, buffers double when meshes do not fit
+    constexpr static uint32_t GeometryBufferVertexCapacity = 1 << 20;
+    /// indices each geometry buffer starts with
+    constexpr static uint32_t GeometryBufferIndexCapacity = 1 << 22;
+
+    /// encode vertices and indices of mesh caches, see mesh_codec.hpp
+    /// caches get smaller but their geometry is decoded on load instead of being used in place
+    #define GAMEZERO_ENCODE_MESH_CACHE 1
+
     #define GAMEZERO_SETTING_GENERATE_LOG 1
 }
 
@@ -6,53 +6,120 @@
 #include "vulkan/vulkan_core.h"
 
 #include "renderer.hpp"
+#include "block_compression.hpp"
+#include "texture_array.hpp"
+#include "texture_cache.hpp"
+#include "texture_streaming.hpp"
+#include "utils/image.hpp"
+#include "utils/ktx2.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
 
-bool GameZero::LoadImageFromFile(Renderer* renderer, const char *filename, AllocatedImage &outImage){
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+using namespace GameZero;
 
-    if(!pixels){
-        LOG(ERROR, "Failed to read texture from file [ %s ]", filename);
-        return false;
-    }
+// number of levels down to 1x1, every level halves size rounding down
+uint32_t GameZero::GetMipLevelCount(uint32_t width, uint32_t height){
+    uint32_t levels = 1;
+    for(uint32_t size = std::max(width, height); size > 1; size >>= 1) levels++;
+    return levels;
+}
 
-    void* pixel_ptr = pixels;
-    vk::DeviceSize imageSize = texWidth * texHeight * 4;
+// fill levels 1 and up by blitting each level from the one above it
+// level 0 must be in transfer dst layout, all levels end up readable by fragment shaders
+static void RecordMipChain(vk::CommandBuffer cmd, vk::Image image, uint32_t width, uint32_t height, uint32_t mipLevels){
+    vk::ImageMemoryBarrier barrier = {};
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.levelCount = 1;
 
-    // 8bit pixel format
-    vk::Format imageFormat = vk::Format::eR8G8B8A8Srgb;
+    int32_t levelWidth = static_cast<int32_t>(width);
+    int32_t levelHeight = static_cast<int32_t>(height);
 
-    // allocate temporary buffer for holding data in cpu
-    AllocatedBuffer stagingBuffer = CreateBuffer(renderer->device.allocator, imageSize, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuOnly);
+    for(uint32_t level = 1; level < mipLevels; level++){
+        // previous level was just written, by copy or by last blit, and is now read
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &barrier);
 
-    // copy image data to temp buffer
-    void* dest;
-    CHECK_VK_RESULT(renderer->device.allocator.mapMemory(stagingBuffer.allocation, &dest), "Failed to map memory correctly");
-    memcpy(dest, pixel_ptr, static_cast<size_t>(imageSize));
-    renderer->device.allocator.unmapMemory(stagingBuffer.allocation);
+        int32_t nextWidth = std::max(levelWidth / 2, 1);
+        int32_t nextHeight = std::max(levelHeight / 2, 1);
+
+        // linear filter on an exact halving averages 2x2 texels
+        vk::ImageBlit blit = {};
+        blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.srcOffsets[1] = vk::Offset3D(levelWidth, levelHeight, 1);
+        blit.dstSubresource = blit.srcSubresource;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstOffsets[1] = vk::Offset3D(nextWidth, nextHeight, 1);
+        cmd.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, 1, &blit, vk::Filter::eLinear);
+
+        // previous level is final
+        barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+
+    // last level was only written
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+}
 
-    // release occupied memory
-    stbi_image_free(pixels);
 
+// create a sampled image that is filled by copies, and by blits between levels when generateMips is set
+// caller decides when image is destroyed
+static bool CreateSampledImage(Renderer* renderer, vk::Format imageFormat, uint32_t width, uint32_t height,
+                               uint32_t mipLevels, uint32_t arrayLayers, bool generateMips, AllocatedImage& outImage){
     vk::Extent3D imageExtent;
-    imageExtent.width = static_cast<uint32_t>(texWidth);
-    imageExtent.height = static_cast<uint32_t>(texHeight);
+    imageExtent.width = width;
+    imageExtent.height = height;
     imageExtent.depth = 1;
 
     // image create info
     vk::ImageCreateInfo imageInfo = {};
-    imageInfo.arrayLayers = 1;
+    imageInfo.arrayLayers = arrayLayers;
     imageInfo.format = imageFormat;
     imageInfo.imageType = vk::ImageType::e2D;
     imageInfo.extent = imageExtent;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.samples = vk::SampleCountFlagBits::e1;
     imageInfo.tiling = vk::ImageTiling::eOptimal;
     imageInfo.usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
-   
+    // levels are blitted from each other
+    if(generateMips) imageInfo.usage |= vk::ImageUsageFlagBits::eTransferSrc;
+
     // allocate new image
     AllocatedImage image;
+    image.format = imageFormat;
+    image.extent = imageExtent;
+    image.mipLevels = mipLevels;
+    image.arrayLayers = arrayLayers;
 
     vma::AllocationCreateInfo allocInfo = {};
     allocInfo.usage = vma::MemoryUsage::eGpuOnly;
@@ -60,71 +127,908 @@ bool GameZero::LoadImageFromFile(Renderer* renderer, const char *filename, Alloc
     // allocate
     CHECK_VK_RESULT(renderer->device.allocator.createImage(&imageInfo, &allocInfo, &image.image, &image.allocation, nullptr), "Failed to create Image")
 
+    outImage = image;
+    return true;
+}
+
+// destroy image with renderer
+static void PushImageDeletor(Renderer* renderer, const AllocatedImage& image){
+    renderer->PushFunction([=](){
+        renderer->device.allocator.destroyImage(image.image, image.allocation);
+    });
+}
+
+// every level and layer of an image
+static vk::ImageSubresourceRange GetImageRange(const AllocatedImage& image){
+    vk::ImageSubresourceRange range = {};
+    range.aspectMask = vk::ImageAspectFlagBits::eColor;
+    range.baseMipLevel = 0;
+    range.levelCount = image.mipLevels;
+    range.baseArrayLayer = 0;
+    range.layerCount = image.arrayLayers;
+    return range;
+}
+
+// make a new image writable by copies from staging buffers
+static void RecordImageUploadStart(vk::CommandBuffer cmd, const AllocatedImage& image){
+    vk::ImageSubresourceRange range = GetImageRange(image);
+
+    // barrier to change image layout to transfer dst bit
+    vk::ImageMemoryBarrier imageBarrier_toTransfer = {};
+    // initial layout of image is undefined
+    imageBarrier_toTransfer.oldLayout = vk::ImageLayout::eUndefined;
+    // final layout must be optimal for acting as a destination of a transfer op
+    imageBarrier_toTransfer.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    // this is the image we want to convert
+    imageBarrier_toTransfer.image = image.image;
+    imageBarrier_toTransfer.subresourceRange = range;
+    // source has no access
+    imageBarrier_toTransfer.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
+    // destination must be accesible for write operations
+    imageBarrier_toTransfer.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+    // image must be converted to given format before transfer ops
+    // because at transfer we need to write and for that image mem must be accessible for writing
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &imageBarrier_toTransfer);
+}
+
+// blit remaining levels when generateMips is set, image ends up readable by fragment shaders
+static void RecordImageUploadEnd(vk::CommandBuffer cmd, const AllocatedImage& image, bool generateMips){
+    // generate remaining levels from level 0
+    if(generateMips){
+        RecordMipChain(cmd, image.image, image.extent.width, image.extent.height, image.mipLevels);
+        return;
+    }
+
+    // barrier to change image to readeable optimal
+    vk::ImageMemoryBarrier imageBarrier_toReadable = {};
+    imageBarrier_toReadable.image = image.image;
+    imageBarrier_toReadable.subresourceRange = GetImageRange(image);
+    // old layout was optimal for acting as destination of a transfer op
+    imageBarrier_toReadable.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    // new layout must be optimal to be readable from shaders
+    imageBarrier_toReadable.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    // source's access was to be wriable
+    imageBarrier_toReadable.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    // destination must be readble by shader
+    imageBarrier_toReadable.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+    // the image must be converted between transfer ops and fragment shader ops
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
+}
+
+// record copy of stored levels from staging buffer to image, and blits of remaining levels when generateMips is set
+// image ends up readable by fragment shaders
+static void RecordImageUpload(vk::CommandBuffer cmd, const AllocatedImage& image, vk::Buffer stagingBuffer,
+                              const std::vector<vk::BufferImageCopy>& regions, bool generateMips){
+    RecordImageUploadStart(cmd, image);
+
+    // copy image data to image, one region per level that is stored
+    cmd.copyBufferToImage(stagingBuffer, image.image, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(regions.size()), regions.data());
+
+    RecordImageUploadEnd(cmd, image, generateMips);
+}
+
+// create a sampled image and fill it from staging buffer with one immediate submit
+// stored levels are copied with given regions, when generateMips is set levels 1 and up are blitted from level 0 instead
+static bool UploadImage(Renderer* renderer, const AllocatedBuffer& stagingBuffer, vk::Format imageFormat, uint32_t width, uint32_t height,
+                        uint32_t mipLevels, const std::vector<vk::BufferImageCopy>& regions, bool generateMips, AllocatedImage& outImage){
+    AllocatedImage image;
+    if(!CreateSampledImage(renderer, imageFormat, width, height, mipLevels, 1, generateMips, image)) return false;
+
     // submit for copy
     renderer->ImmediateSubmit([&](vk::CommandBuffer cmd){
-        vk::ImageSubresourceRange range = {};
-        range.aspectMask = vk::ImageAspectFlagBits::eColor;
-        range.baseMipLevel = 0;
-        range.levelCount = 1;
-        range.baseArrayLayer = 0;
-        range.layerCount = 1;
-
-        // barrier to change image layout to transfer dst bit
-        vk::ImageMemoryBarrier imageBarrier_toTransfer = {};
-        // initial layout of image is undefined
-        imageBarrier_toTransfer.oldLayout = vk::ImageLayout::eUndefined;
-        // final layout must be optimal for acting as a destination of a transfer op
-        imageBarrier_toTransfer.newLayout = vk::ImageLayout::eTransferDstOptimal;
-        // this is the image we want to convert
-        imageBarrier_toTransfer.image = image.image;
-        imageBarrier_toTransfer.subresourceRange = range;
-        // source has no access
-        imageBarrier_toTransfer.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
-        // destination must be accesible for write operations
-        imageBarrier_toTransfer.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-        // image must be converted to given format before transfer ops
-        // because at transfer we need to write and for that image mem must be accessible for writing
-        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &imageBarrier_toTransfer);
-
-        // buffer copy region
-        vk::BufferImageCopy copyRegion = {};
-        copyRegion.bufferImageHeight = 0;
-        copyRegion.bufferOffset = 0;
-        copyRegion.bufferRowLength = 0;
-        copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        copyRegion.imageSubresource.baseArrayLayer = 0;
-        copyRegion.imageSubresource.layerCount = 1;
-        copyRegion.imageSubresource.mipLevel = 0;
-        copyRegion.imageExtent = imageExtent;
-
-        // copy image data to image
-        cmd.copyBufferToImage(stagingBuffer.buffer, image.image, vk::ImageLayout::eTransferDstOptimal, 1, &copyRegion);
-    
-        // barrier to change image to readeable optimal
-        vk::ImageMemoryBarrier imageBarrier_toReadable = imageBarrier_toTransfer;
-        // old layout was optimal for acting as destination of a transfer op
-        imageBarrier_toReadable.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-        // new layout must be optimal to be readable from shaders
-        imageBarrier_toReadable.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        // source's access was to be wriable
-        imageBarrier_toReadable.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        // destination must be readble by shader
-        imageBarrier_toReadable.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-        // the image must be converted between transfer ops and fragment shader ops
-        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
+        RecordImageUpload(cmd, image, stagingBuffer.buffer, regions, generateMips);
     });
+    PushImageDeletor(renderer, image);
 
     outImage = image;
-    LOG(INFO, "Texture image [ %s ] successfully loaded", filename);
+    return true;
+}
 
-    // deletor
-    renderer->PushFunction([=](){
-        renderer->device.allocator.destroyImage(image.image, image.allocation);
-    });
+/**
+ * @brief Texels of an image read and decoded on cpu, with everything needed to create and fill its gpu image.
+ *        Decoding touches no gpu state, so images are decoded on worker threads.
+ */
+struct DecodedImage{
+    vk::Format format = vk::Format::eUndefined;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /// levels image is created with, more than stored levels when the rest are blitted on gpu
+    uint32_t mipLevels = 1;
+    bool generateMips = false;
+    /// stored levels, level 0 first, pointing into one of the owners below
+    std::vector<TextureLevel> levels;
+
+    /// mapped cache or KTX2 file, shared with streamed texture that keeps reading levels from it
+    std::shared_ptr<MappedFile> file;
+    /// staging buffer rgba levels are decoded and filtered into, at offsets BuildUploadRegions gives them
+    AllocatedBuffer stagingBuffer;
+    /// mapping of staging buffer, null when image has none
+    uint8_t* staging = nullptr;
+    vma::Allocator allocator;
+    /// texels decoded or packed here
+    std::vector<std::vector<uint8_t>> decodedLevels;
+    /// bytes saved by storing fewer channels than 8 bit rgba
+    vk::DeviceSize savedSize = 0;
+
+    DecodedImage() = default;
+    ~DecodedImage(){ DestroyStagingBuffer(); }
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator = (const DecodedImage&) = delete;
+
+    /// levels point into mapped file, so that they can be read again later
+    bool IsMapped() const{ return file && file->data && !staging && decodedLevels.empty(); }
+
+    /// unmap staging buffer and hand it over, whoever takes it destroys it once gpu has read it
+    AllocatedBuffer TakeStagingBuffer(){
+        allocator.unmapMemory(stagingBuffer.allocation);
+        staging = nullptr;
+        return stagingBuffer;
+    }
+
+    void DestroyStagingBuffer(){
+        if(!staging) return;
+        allocator.unmapMemory(stagingBuffer.allocation);
+        allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+        staging = nullptr;
+    }
+};
+
+// format images of a channel layout are stored in, normal maps hold vectors and are not sRGB encoded
+static vk::Format GetLayoutFormat(ImageChannelLayout layout, ImageUsage usage){
+    switch(layout){
+        case ImageChannelLayout::Gray: return vk::Format::eR8Srgb;
+        case ImageChannelLayout::GrayAlpha: return vk::Format::eR8G8Srgb;
+        case ImageChannelLayout::NormalMap: return vk::Format::eR8G8Unorm;
+        default: return usage == ImageUsage::NormalMap ? vk::Format::eR8G8B8A8Unorm : vk::Format::eR8G8B8A8Srgb;
+    }
+}
+
+// layout of a format images of given usage decoded here are stored in, false for other formats
+static bool GetFormatLayout(vk::Format format, ImageUsage usage, ImageChannelLayout& layout){
+    for(ImageChannelLayout candidate : {ImageChannelLayout::Gray, ImageChannelLayout::GrayAlpha, ImageChannelLayout::NormalMap, ImageChannelLayout::Rgba}){
+        // normal maps are never gray, only they take NormalMap layout
+        bool analyzed = usage == ImageUsage::NormalMap ? candidate == ImageChannelLayout::NormalMap || candidate == ImageChannelLayout::Rgba
+                                                       : candidate != ImageChannelLayout::NormalMap;
+        if(analyzed && GetLayoutFormat(candidate, usage) == format){
+            layout = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// narrow formats other than R8G8 unorm are optional, device must sample them with linear filtering
+static bool CanSampleFormat(Renderer* renderer, vk::Format format){
+    vk::FormatFeatureFlags features = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (renderer->device.physical.getFormatProperties(format).optimalTilingFeatures & features) == features;
+}
+
+vk::ComponentMapping GameZero::GetTextureSwizzle(vk::Format format){
+    using Swizzle = vk::ComponentSwizzle;
+    switch(format){
+        case vk::Format::eR8Srgb: return vk::ComponentMapping(Swizzle::eR, Swizzle::eR, Swizzle::eR, Swizzle::eOne);
+        case vk::Format::eR8G8Srgb: return vk::ComponentMapping(Swizzle::eR, Swizzle::eR, Swizzle::eR, Swizzle::eG);
+        // blue is rebuilt from red and green by shader.frag, see GPUMaterialData::normalMap
+        case vk::Format::eR8G8Unorm: return vk::ComponentMapping(Swizzle::eR, Swizzle::eG, Swizzle::eZero, Swizzle::eOne);
+        default: return vk::ComponentMapping(Swizzle::eIdentity, Swizzle::eIdentity, Swizzle::eIdentity, Swizzle::eIdentity);
+    }
+}
+
+// texture cache holds one of the layout formats of usage image is loaded with and a full mip chain, in a format this device samples
+static bool IsCachedImageValid(Renderer* renderer, const TextureCacheImage& image, ImageUsage usage){
+    ImageChannelLayout layout;
+    vk::Format format = static_cast<vk::Format>(image.format);
+    if(!GetFormatLayout(format, usage, layout) || !CanSampleFormat(renderer, format) || image.width == 0 || image.height == 0) return false;
+    if(image.levels.size() != GetMipLevelCount(image.width, image.height)) return false;
+
+    for(uint32_t level = 0; level < image.levels.size(); level++){
+        size_t size = size_t(std::max(image.width >> level, 1u)) * std::max(image.height >> level, 1u) * GetChannelLayoutSize(layout);
+        if(image.levels[level].size != size) return false;
+    }
+    return true;
+}
+
+// bytes of all levels of an image stored as 8 bit rgba
+static vk::DeviceSize GetRgbaSize(const std::vector<TextureLevel>& levels, uint32_t width, uint32_t height){
+    vk::DeviceSize size = 0;
+    for(uint32_t level = 0; level < levels.size(); level++) size += vk::DeviceSize(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+    return size;
+}
+
+// bytes of all levels of an image as it is stored
+static vk::DeviceSize GetStoredSize(const std::vector<TextureLevel>& levels){
+    vk::DeviceSize size = 0;
+    for(const TextureLevel& level : levels) size += level.size;
+    return size;
+}
+
+// block format of a vulkan format, false for formats that are not block compressed
+static bool GetBlockFormat(vk::Format format, BlockFormat& blockFormat, bool& srgb){
+    switch(format){
+        case vk::Format::eBc1RgbaUnormBlock: blockFormat = BlockFormat::BC1; srgb = false; return true;
+        case vk::Format::eBc1RgbaSrgbBlock: blockFormat = BlockFormat::BC1; srgb = true; return true;
+        case vk::Format::eBc3UnormBlock: blockFormat = BlockFormat::BC3; srgb = false; return true;
+        case vk::Format::eBc3SrgbBlock: blockFormat = BlockFormat::BC3; srgb = true; return true;
+        case vk::Format::eBc7UnormBlock: blockFormat = BlockFormat::BC7; srgb = false; return true;
+        case vk::Format::eBc7SrgbBlock: blockFormat = BlockFormat::BC7; srgb = true; return true;
+        default: return false;
+    }
+}
+
+// map a KTX2 file, levels stay in file when device samples its format and are decoded to rgba otherwise
+static bool DecodeKtx2(Renderer* renderer, const char* filename, DecodedImage& image){
+    Ktx2Image ktx;
+    image.file = std::make_shared<MappedFile>();
+    if(!image.file->Open(filename) || !ParseKtx2(image.file->data, image.file->size, ktx)){
+        LOG(ERROR, "Failed to read KTX2 texture from file [ %s ]", filename);
+        return false;
+    }
+
+    vk::Format fileFormat = static_cast<vk::Format>(ktx.header.vkFormat);
+    BlockFormat blockFormat;
+    bool srgb;
+    if(!GetBlockFormat(fileFormat, blockFormat, srgb)){
+        LOG(ERROR, "KTX2 texture [ %s ] has unsupported format %u", filename, ktx.header.vkFormat);
+        return false;
+    }
+
+    // every stored level must hold all of its blocks
+    uint32_t storedLevels = static_cast<uint32_t>(ktx.levels.size());
+    for(uint32_t level = 0; level < storedLevels; level++){
+        if(ktx.levels[level].byteLength < GetBlockCompressedSize(blockFormat, ktx.GetLevelWidth(level), ktx.GetLevelHeight(level))){
+            LOG(ERROR, "KTX2 texture [ %s ] level %u is truncated", filename, level);
+            return false;
+        }
+    }
+
+    // block compressed formats need a device feature, without it blocks are decoded to 8 bit rgba on cpu
+    bool compressed = renderer->device.enabledFeatures.textureCompressionBC &&
+        (renderer->device.physical.getFormatProperties(fileFormat).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+    image.format = compressed ? fileFormat : (srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm);
+    image.width = ktx.header.pixelWidth;
+    image.height = ktx.header.pixelHeight;
+    image.mipLevels = storedLevels;
+
+    vk::DeviceSize storedSize = 0, rgbaSize = 0;
+    for(uint32_t level = 0; level < storedLevels; level++){
+        uint32_t width = ktx.GetLevelWidth(level), height = ktx.GetLevelHeight(level);
+        if(compressed){
+            image.levels.push_back({ktx.GetLevelData(level), GetBlockCompressedSize(blockFormat, width, height)});
+        }else{
+            std::vector<uint8_t> texels(size_t(width) * height * 4);
+            DecodeBlocks(blockFormat, ktx.GetLevelData(level), width, height, texels.data());
+            image.decodedLevels.push_back(std::move(texels));
+            image.levels.push_back({image.decodedLevels.back().data(), image.decodedLevels.back().size()});
+        }
+        storedSize += image.levels.back().size;
+        rgbaSize += vk::DeviceSize(width) * height * 4;
+    }
+
+    // files without a mip chain get one generated, only possible for decoded images
+    image.generateMips = !compressed && storedLevels == 1;
+    vk::FormatFeatureFlags blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    if(image.generateMips && (renderer->device.physical.getFormatProperties(image.format).optimalTilingFeatures & blitFeatures) == blitFeatures){
+        image.mipLevels = GetMipLevelCount(image.width, image.height);
+    }else{
+        image.generateMips = false;
+    }
+
+    if(compressed){
+        LOG(INFO, "Texture image [ %s ] successfully loaded : %u levels, %.2f MB block compressed, %.1fx smaller than rgba",
+            filename, image.mipLevels, storedSize / (1024.f * 1024.f), float(rgbaSize) / float(storedSize));
+    }else{
+        LOG(INFO, "Texture image [ %s ] successfully loaded : %u levels, decoded to rgba as device cannot sample its format", filename, image.mipLevels);
+    }
+    return true;
+}
+
+// mapped staging buffer for whole rgba mip chain of an image, created on a worker thread that decodes into it
+// cached memory is preferred, as levels are read back to analyze channels, filter mips and write texture cache
+static uint8_t* CreateDecodeStagingBuffer(Renderer* renderer, uint32_t width, uint32_t height, DecodedImage& image){
+    vk::BufferCreateInfo bufferInfo = {};
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    for(uint32_t level = 0; level < GetMipLevelCount(width, height); level++){
+        bufferInfo.size += GetStagingLevelSize(uint64_t(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4);
+    }
+
+    vma::AllocationCreateInfo allocInfo = {};
+    allocInfo.usage = vma::MemoryUsage::eCpuOnly;
+    allocInfo.preferredFlags = vk::MemoryPropertyFlagBits::eHostCached;
+
+    CHECK_VK_RESULT(renderer->device.allocator.createBuffer(&bufferInfo, &allocInfo, &image.stagingBuffer.buffer, &image.stagingBuffer.allocation, nullptr),
+                    "Failed to allocate Buffer");
+
+    void* dest;
+    CHECK_VK_RESULT(renderer->device.allocator.mapMemory(image.stagingBuffer.allocation, &dest), "Failed to map memory correctly");
+    image.allocator = renderer->device.allocator;
+    image.staging = static_cast<uint8_t*>(dest);
+    return image.staging;
+}
+
+// read any image LoadImageFromFile reads, mipThreadCount threads filter mips of images that are not cached yet
+// with mapLevels set, freshly decoded images are mapped back from their cache so that their levels can be streamed
+static bool DecodeImageFile(Renderer* renderer, const char* filename, ImageUsage usage, DecodedImage& image, uint32_t mipThreadCount, bool mapLevels){
+    // compressed textures come with their own mips
+    size_t length = strlen(filename);
+    if(length > 5 && strcmp(filename + length - 5, ".ktx2") == 0){
+        return DecodeKtx2(renderer, filename, image);
+    }
+
+    // texels and mips decoded by an earlier run are mapped and copied straight to staging buffer
+    TextureCacheImage cached;
+    image.file = std::make_shared<MappedFile>();
+    if(LoadTextureCache(filename, *image.file, cached)){
+        if(IsCachedImageValid(renderer, cached, usage)){
+            image.format = static_cast<vk::Format>(cached.format);
+            image.width = cached.width;
+            image.height = cached.height;
+            image.mipLevels = static_cast<uint32_t>(cached.levels.size());
+            image.levels = cached.levels;
+            image.savedSize = GetRgbaSize(image.levels, image.width, image.height) - GetStoredSize(image.levels);
+            LOG(INFO, "Texture image [ %s ] successfully loaded from cache as %s, %.2f MB saved against rgba",
+                filename, vk::to_string(image.format).c_str(), image.savedSize / (1024.f * 1024.f));
+            return true;
+        }
+        LOG(WARNING, "Texture cache of [ %s ] does not match its header and will be rebuilt", filename);
+    }
+    image.file->Close();
+
+    // texels are decoded straight into staging memory they are uploaded from
+    uint8_t* texels = LoadImageRgba(filename, image.width, image.height, [&](uint32_t width, uint32_t height){
+        return CreateDecodeStagingBuffer(renderer, width, height, image);
+    }, renderer->enableFastPngDecoder ? PngDecoder::Fast : PngDecoder::Stb);
+
+    if(!texels){
+        LOG(ERROR, "Failed to read texture from file [ %s ]", filename);
+        return false;
+    }
+
+    // narrowest format that keeps every texel, rgba when device cannot sample it
+    // R8G8 unorm of normal maps is sampled by every device
+    ImageChannelLayout layout = AnalyzeImageChannels(texels, size_t(image.width) * image.height, usage);
+    if(!CanSampleFormat(renderer, GetLayoutFormat(layout, usage))) layout = ImageChannelLayout::Rgba;
+    image.format = GetLayoutFormat(layout, usage);
+    bool srgb = usage == ImageUsage::Color;
+
+    // mips are filtered on cpu so that they are cached together with level 0, each one into staging memory after previous one
+    uint32_t width = image.width, height = image.height;
+    vk::DeviceSize offset = 0;
+    image.levels = {{texels, size_t(width) * height * 4}};
+    while(width > 1 || height > 1){
+        offset += GetStagingLevelSize(image.levels.back().size);
+        uint32_t levelWidth = GetDownsampledSize(width), levelHeight = GetDownsampledSize(height);
+        DownsampleImage(image.levels.back().data, width, height, image.staging + offset, srgb, mipThreadCount);
+        image.levels.push_back({image.staging + offset, size_t(levelWidth) * levelHeight * 4});
+        width = levelWidth;
+        height = levelHeight;
+    }
+    image.mipLevels = static_cast<uint32_t>(image.levels.size());
+
+    // levels are filtered as rgba and packed afterwards
+    if(layout != ImageChannelLayout::Rgba){
+        std::vector<std::vector<uint8_t>> packedLevels;
+        for(TextureLevel& level : image.levels){
+            size_t texelCount = level.size / 4;
+            packedLevels.emplace_back(texelCount * GetChannelLayoutSize(layout));
+            PackImageChannels(level.data, texelCount, layout, packedLevels.back().data());
+            level = {packedLevels.back().data(), packedLevels.back().size()};
+        }
+        image.decodedLevels = std::move(packedLevels);
+        image.DestroyStagingBuffer();
+    }else{
+        renderer->device.allocator.flushAllocation(image.stagingBuffer.allocation, 0, VK_WHOLE_SIZE);
+    }
+    image.savedSize = GetRgbaSize(image.levels, image.width, image.height) - GetStoredSize(image.levels);
+
+    bool cacheWritten = WriteTextureCache(filename, static_cast<uint32_t>(image.format), image.width, image.height, image.levels);
+
+    // cache pages are still in memory, texels decoded here are dropped
+    if(mapLevels && cacheWritten && LoadTextureCache(filename, *image.file, cached) && IsCachedImageValid(renderer, cached, usage)){
+        image.levels = cached.levels;
+        image.decodedLevels.clear();
+        image.DestroyStagingBuffer();
+    }
+
+    LOG(INFO, "Texture image [ %s ] successfully loaded as %s, %.2f MB saved against rgba",
+        filename, vk::to_string(image.format).c_str(), image.savedSize / (1024.f * 1024.f));
+    return true;
+}
+
+// one copy region per stored level from firstLevel on, firstLevel becomes level 0 of image
+// returns bytes of staging memory used by all levels
+static vk::DeviceSize BuildUploadRegions(const std::vector<TextureLevel>& levels, uint32_t width, uint32_t height, uint32_t firstLevel,
+                                         std::vector<vk::BufferImageCopy>& regions){
+    regions.resize(levels.size() - firstLevel);
+    vk::DeviceSize stagingSize = 0;
+    for(uint32_t level = firstLevel; level < levels.size(); level++){
+        vk::BufferImageCopy& region = regions[level - firstLevel];
+        region.bufferOffset = stagingSize;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        region.imageSubresource.mipLevel = level - firstLevel;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = vk::Extent3D(std::max(width >> level, 1u), std::max(height >> level, 1u), 1);
+
+        stagingSize += GetStagingLevelSize(levels[level].size);
+    }
+    return stagingSize;
+}
+
+// copy levels from firstLevel on to mapped staging memory at offsets of their regions
+static void CopyLevels(const std::vector<TextureLevel>& levels, uint32_t firstLevel, uint8_t* staging, const std::vector<vk::BufferImageCopy>& regions){
+    for(size_t level = firstLevel; level < levels.size(); level++){
+        memcpy(staging + regions[level - firstLevel].bufferOffset, levels[level].data, levels[level].size);
+    }
+}
+
+// upload a decoded image on its own, from staging buffer it was decoded into or through one sized for it
+static bool UploadDecodedImage(Renderer* renderer, const DecodedImage& image, AllocatedImage& outImage){
+    std::vector<vk::BufferImageCopy> regions;
+    vk::DeviceSize stagingSize = BuildUploadRegions(image.levels, image.width, image.height, 0, regions);
+    if(image.staging){
+        return UploadImage(renderer, image.stagingBuffer, image.format, image.width, image.height, image.mipLevels, regions, image.generateMips, outImage);
+    }
+
+    AllocatedBuffer stagingBuffer = CreateBuffer(renderer->device.allocator, stagingSize, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuOnly);
+
+    void* dest;
+    CHECK_VK_RESULT(renderer->device.allocator.mapMemory(stagingBuffer.allocation, &dest), "Failed to map memory correctly");
+    CopyLevels(image.levels, 0, static_cast<uint8_t*>(dest), regions);
+    renderer->device.allocator.unmapMemory(stagingBuffer.allocation);
+
+    bool uploaded = UploadImage(renderer, stagingBuffer, image.format, image.width, image.height, image.mipLevels, regions, image.generateMips, outImage);
+    renderer->device.allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+    return uploaded;
+}
+
+bool GameZero::LoadImageFromFile(Renderer* renderer, const char *filename, AllocatedImage &outImage, ImageUsage usage){
+    DecodedImage image;
+    if(!DecodeImageFile(renderer, filename, usage, image, 0, false)) return false;
+    return UploadDecodedImage(renderer, image, outImage);
+}
+
+bool GameZero::LoadImageFromKtx2(Renderer* renderer, const char* filename, AllocatedImage& outImage){
+    DecodedImage image;
+    if(!DecodeKtx2(renderer, filename, image)) return false;
+    return UploadDecodedImage(renderer, image, outImage);
+}
+
+bool GameZero::LoadImageFromPixels(Renderer* renderer, const void* pixels, uint32_t width, uint32_t height, AllocatedImage &outImage){
+    const void* pixel_ptr = pixels;
+    vk::DeviceSize imageSize = vk::DeviceSize(width) * height * 4;
+
+    // 8bit pixel format
+    vk::Format imageFormat = vk::Format::eR8G8B8A8Srgb;
+
+    // allocate temporary buffer for holding data in cpu
+    AllocatedBuffer stagingBuffer = CreateBuffer(renderer->device.allocator, imageSize, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuOnly);
+
+    // copy image data to temp buffer
+    void* dest;
+    CHECK_VK_RESULT(renderer->device.allocator.mapMemory(stagingBuffer.allocation, &dest), "Failed to map memory correctly");
+    memcpy(dest, pixel_ptr, static_cast<size_t>(imageSize));
+    renderer->device.allocator.unmapMemory(stagingBuffer.allocation);
+
+    // mips are blitted from each other with linear filtering, which format must support
+    uint32_t mipLevels = 1;
+    vk::FormatFeatureFlags blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    if((renderer->device.physical.getFormatProperties(imageFormat).optimalTilingFeatures & blitFeatures) == blitFeatures){
+        mipLevels = GetMipLevelCount(width, height);
+    }else{
+        LOG(WARNING, "Texture format does not support linear blits, mip chain is not generated");
+    }
+
+    // buffer copy region
+    vk::BufferImageCopy copyRegion = {};
+    copyRegion.bufferImageHeight = 0;
+    copyRegion.bufferOffset = 0;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount = 1;
+    copyRegion.imageSubresource.mipLevel = 0;
+    copyRegion.imageExtent = vk::Extent3D(width, height, 1);
+
+    bool uploaded = UploadImage(renderer, stagingBuffer, imageFormat, width, height, mipLevels, {copyRegion}, mipLevels > 1, outImage);
 
     // destroy temp buffer finally
     renderer->device.allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+    return uploaded;
+}
+
+/// staging memory of a batch, images bigger than this get a batch of their own size
+constexpr static vk::DeviceSize UploadBatchSize = 64 * 1024 * 1024;
+
+/**
+ * @brief Copies of many images recorded to one command buffer from one staging buffer and submitted together.
+ *        Two batches are used in turn, so that one is filled while gpu reads from the other.
+ */
+struct UploadBatch{
+    AllocatedBuffer stagingBuffer;
+    uint8_t* mapped = nullptr;
+    vk::DeviceSize capacity = 0;
+    vk::DeviceSize used = 0;
+
+    /// staging buffers images were decoded into, copied from directly and destroyed once gpu is done with batch
+    std::vector<AllocatedBuffer> ownedBuffers;
+    vk::DeviceSize ownedSize = 0;
+
+    vk::CommandPool commandPool;
+    vk::CommandBuffer cmd;
+    vk::Fence fence;
+
+    /// copies are being recorded to cmd
+    bool recording = false;
+    /// submitted and gpu may still read staging buffer
+    bool submitted = false;
+};
+
+static void CreateUploadBatch(Renderer* renderer, UploadBatch& batch){
+    vk::CommandPoolCreateInfo cmdPoolInfo({}, renderer->device.graphicsQueueIndex);
+    batch.commandPool = renderer->device.logical.createCommandPool(cmdPoolInfo);
+
+    vk::CommandBufferAllocateInfo cmdBuffAllocInfo(batch.commandPool, vk::CommandBufferLevel::ePrimary, 1);
+    batch.cmd = renderer->device.logical.allocateCommandBuffers(cmdBuffAllocInfo).front();
+    batch.fence = renderer->device.logical.createFence({});
+}
+
+// wait until gpu is done with a submitted batch, so that its staging buffer and command buffer can be reused
+static void WaitUploadBatch(Renderer* renderer, UploadBatch& batch){
+    if(!batch.submitted) return;
+    CHECK_VK_RESULT(renderer->device.logical.waitForFences(1, &batch.fence, VK_TRUE, UINT64_MAX), "Failed to wait for Fence");
+    CHECK_VK_RESULT(renderer->device.logical.resetFences(1, &batch.fence), "Failed to reset Fence");
+    renderer->device.logical.resetCommandPool(batch.commandPool);
+    batch.submitted = false;
+
+    for(const AllocatedBuffer& buffer : batch.ownedBuffers) renderer->device.allocator.destroyBuffer(buffer.buffer, buffer.allocation);
+    batch.ownedBuffers.clear();
+    batch.ownedSize = 0;
+}
+
+// start recording a batch with room for at least requiredSize bytes
+static void BeginUploadBatch(Renderer* renderer, UploadBatch& batch, vk::DeviceSize requiredSize){
+    WaitUploadBatch(renderer, batch);
+
+    if(batch.capacity < requiredSize){
+        if(batch.mapped){
+            renderer->device.allocator.unmapMemory(batch.stagingBuffer.allocation);
+            renderer->device.allocator.destroyBuffer(batch.stagingBuffer.buffer, batch.stagingBuffer.allocation);
+        }
+
+        batch.capacity = std::max(requiredSize, UploadBatchSize);
+        batch.stagingBuffer = CreateBuffer(renderer->device.allocator, batch.capacity, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuOnly);
+
+        void* dest;
+        CHECK_VK_RESULT(renderer->device.allocator.mapMemory(batch.stagingBuffer.allocation, &dest), "Failed to map memory correctly");
+        batch.mapped = static_cast<uint8_t*>(dest);
+    }
+
+    vk::CommandBufferBeginInfo cmdBeginInfo;
+    cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    batch.cmd.begin(cmdBeginInfo);
+
+    batch.used = 0;
+    batch.recording = true;
+}
+
+static void SubmitUploadBatch(Renderer* renderer, UploadBatch& batch){
+    batch.cmd.end();
+
+    vk::SubmitInfo submitInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.cmd;
+
+    CHECK_VK_RESULT(renderer->device.graphicsQueue.submit(1, &submitInfo, batch.fence), "Failed to submit Command Buffer");
+    batch.recording = false;
+    batch.submitted = true;
+}
+
+// put stored levels of an image where a recording batch copies them from, regions are moved to where levels ended up
+// levels are copied to staging memory of batch, or batch takes staging buffer image was decoded into
+static vk::Buffer StageBatchedImage(UploadBatch& batch, DecodedImage& image, uint32_t firstLevel, vk::DeviceSize stagingSize,
+                                    std::vector<vk::BufferImageCopy>& regions){
+    if(image.staging){
+        batch.ownedBuffers.push_back(image.TakeStagingBuffer());
+        batch.ownedSize += stagingSize;
+        return batch.ownedBuffers.back().buffer;
+    }
+
+    for(vk::BufferImageCopy& region : regions) region.bufferOffset += batch.used;
+    CopyLevels(image.levels, firstLevel, batch.mapped, regions);
+    batch.used += stagingSize;
+    return batch.stagingBuffer.buffer;
+}
+
+static void DestroyUploadBatch(Renderer* renderer, UploadBatch& batch){
+    WaitUploadBatch(renderer, batch);
+    if(batch.mapped){
+        renderer->device.allocator.unmapMemory(batch.stagingBuffer.allocation);
+        renderer->device.allocator.destroyBuffer(batch.stagingBuffer.buffer, batch.stagingBuffer.allocation);
+    }
+    renderer->device.logical.destroyFence(batch.fence);
+    renderer->device.logical.destroyCommandPool(batch.commandPool);
+}
+
+uint32_t GameZero::LoadTexturesFromFiles(Renderer* renderer, const std::vector<std::string>& files, std::vector<Texture>& outTextures,
+                                         uint32_t streamedSize, uint32_t threadCount, const std::vector<ImageUsage>& usages, std::vector<TextureArray>* outArrays){
+    outTextures.assign(files.size(), Texture());
+    if(files.empty()) return 0;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    if(threadCount == 0) threadCount = GetWorkerThreadCount();
+    threadCount = static_cast<uint32_t>(std::min<size_t>(threadCount, files.size()));
+
+    // images are decoded in parallel, so mips of one image are filtered on one thread unless there are spare threads
+    uint32_t mipThreadCount = files.size() >= GetWorkerThreadCount() ? 1 : 0;
+
+    // decoded images wait here for render thread, null when decoding failed
+    // workers stop decoding while as many images as there are workers are waiting, which bounds memory used
+    std::vector<std::unique_ptr<DecodedImage>> decoded(files.size());
+    std::deque<size_t> ready;
+    std::mutex mutex;
+    std::condition_variable readyCondition, spaceCondition;
+
+    std::thread decoder([&](){
+        ParallelFor(files.size(), [&](size_t i){
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                spaceCondition.wait(lock, [&](){ return ready.size() < threadCount; });
+            }
+
+            std::unique_ptr<DecodedImage> image(new DecodedImage());
+            ImageUsage usage = i < usages.size() ? usages[i] : ImageUsage::Color;
+            if(!DecodeImageFile(renderer, files[i].c_str(), usage, *image, mipThreadCount, streamedSize > 0)) image.reset();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded[i] = std::move(image);
+            ready.push_back(i);
+            readyCondition.notify_one();
+        }, threadCount);
+    });
+
+    UploadBatch batches[2];
+    for(UploadBatch& batch : batches) CreateUploadBatch(renderer, batch);
+    uint32_t currentBatch = 0, submitCount = 0, loadedCount = 0, streamedCount = 0, packedCount = 0;
+    vk::DeviceSize savedSize = 0;
+
+    // batch that takes copiedSize more bytes of its own staging memory and ownedSize more bytes of staging buffers images were decoded into
+    // when current one is full, gpu copies it while the other one is filled
+    auto ReserveBatch = [&](vk::DeviceSize copiedSize, vk::DeviceSize ownedSize) -> UploadBatch& {
+        UploadBatch* batch = &batches[currentBatch];
+        if(batch->recording && (batch->used + copiedSize > batch->capacity || batch->ownedSize + ownedSize > UploadBatchSize)){
+            SubmitUploadBatch(renderer, *batch);
+            currentBatch ^= 1;
+            submitCount++;
+            batch = &batches[currentBatch];
+        }
+        if(!batch->recording) BeginUploadBatch(renderer, *batch, copiedSize);
+        return *batch;
+    };
+
+    auto FillTexture = [&](Texture& texture, const DecodedImage& image, uint32_t firstLevel, vk::DeviceSize stagingSize){
+        texture.width = image.width;
+        texture.height = image.height;
+        texture.levelCount = image.mipLevels;
+        texture.residentLevel = firstLevel;
+        // blitted levels add a third of level 0
+        texture.size = stagingSize + (image.generateMips ? stagingSize / 3 : 0);
+        savedSize += image.savedSize;
+        loadedCount++;
+    };
+
+    // image of its own for a texture, with levels from firstLevel on
+    std::vector<vk::BufferImageCopy> regions;
+    auto UploadTexture = [&](size_t index, DecodedImage& image, uint32_t firstLevel){
+        vk::DeviceSize stagingSize = BuildUploadRegions(image.levels, image.width, image.height, firstLevel, regions);
+        UploadBatch& batch = ReserveBatch(image.staging ? 0 : stagingSize, image.staging ? stagingSize : 0);
+        vk::Buffer stagingBuffer = StageBatchedImage(batch, image, firstLevel, stagingSize, regions);
+
+        Texture& texture = outTextures[index];
+        uint32_t width = std::max(image.width >> firstLevel, 1u), height = std::max(image.height >> firstLevel, 1u);
+        if(!CreateSampledImage(renderer, image.format, width, height, image.mipLevels - firstLevel, 1, image.generateMips, texture.image)) return;
+        RecordImageUpload(batch.cmd, texture.image, stagingBuffer, regions, image.generateMips);
+        FillTexture(texture, image, firstLevel, stagingSize);
+    };
+
+    // one array image for textures of a group, each copied straight into its layer
+    // all copies go to one batch, so that array is made writable and readable again around them
+    auto UploadTextureArray = [&](const std::vector<std::unique_ptr<DecodedImage>>& images, const TextureArrayGroup& group){
+        std::vector<std::vector<vk::BufferImageCopy>> layerRegions(group.textures.size());
+        std::vector<vk::DeviceSize> layerSizes(group.textures.size());
+        vk::DeviceSize copiedSize = 0, ownedSize = 0;
+        for(uint32_t layer = 0; layer < group.textures.size(); layer++){
+            const DecodedImage& image = *images[group.textures[layer]];
+            layerSizes[layer] = BuildUploadRegions(image.levels, image.width, image.height, 0, layerRegions[layer]);
+            for(vk::BufferImageCopy& region : layerRegions[layer]) region.imageSubresource.baseArrayLayer = layer;
+            (image.staging ? ownedSize : copiedSize) += layerSizes[layer];
+        }
+
+        const DecodedImage& first = *images[group.textures.front()];
+        TextureArray array;
+        uint32_t layerCount = static_cast<uint32_t>(group.textures.size());
+        if(!CreateSampledImage(renderer, first.format, first.width, first.height, first.mipLevels, layerCount, false, array.image)) return false;
+
+        UploadBatch& batch = ReserveBatch(copiedSize, ownedSize);
+        RecordImageUploadStart(batch.cmd, array.image);
+        for(uint32_t layer = 0; layer < layerCount; layer++){
+            DecodedImage& image = *images[group.textures[layer]];
+            std::vector<vk::BufferImageCopy>& copies = layerRegions[layer];
+            vk::Buffer stagingBuffer = StageBatchedImage(batch, image, 0, layerSizes[layer], copies);
+            batch.cmd.copyBufferToImage(stagingBuffer, array.image.image, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(copies.size()), copies.data());
+
+            Texture& texture = outTextures[group.textures[layer]];
+            texture.image = array.image;
+            texture.arrayIndex = static_cast<int32_t>(outArrays->size());
+            texture.layer = layer;
+            FillTexture(texture, image, 0, layerSizes[layer]);
+        }
+        RecordImageUploadEnd(batch.cmd, array.image, false);
+
+        outArrays->push_back(array);
+        packedCount += layerCount;
+        return true;
+    };
+
+    // render thread creates images and copies their texels to staging memory in order they finish decoding
+    // small textures that stay whole on gpu wait until all are decoded, to be grouped into texture arrays
+    std::vector<std::unique_ptr<DecodedImage>> packable(outArrays ? files.size() : 0);
+    for(size_t taken = 0; taken < files.size(); taken++){
+        std::unique_ptr<DecodedImage> image;
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // nothing to copy yet, hand what is recorded to gpu instead of letting it idle
+            if(ready.empty() && batches[currentBatch].recording){
+                lock.unlock();
+                SubmitUploadBatch(renderer, batches[currentBatch]);
+                currentBatch ^= 1;
+                submitCount++;
+                lock.lock();
+            }
+            readyCondition.wait(lock, [&](){ return !ready.empty(); });
+            index = ready.front();
+            ready.pop_front();
+            image = std::move(decoded[index]);
+        }
+        spaceCondition.notify_one();
+        if(!image) continue;
+
+        // levels of streamed images that are larger than streamedSize are left in file for now
+        bool streamed = streamedSize > 0 && image->IsMapped() && !image->generateMips && std::max(image->width, image->height) > streamedSize &&
+                        image->levels.size() <= MaxStreamedLevelCount;
+        uint32_t firstLevel = 0;
+        while(streamed && firstLevel + 1 < image->levels.size() && std::max(image->width >> firstLevel, image->height >> firstLevel) > streamedSize) firstLevel++;
+
+        if(outArrays && !streamed && !image->generateMips && std::max(image->width, image->height) <= TextureArrayMaxSize){
+            packable[index] = std::move(image);
+            continue;
+        }
+
+        UploadTexture(index, *image, firstLevel);
+
+        // streamed images are replaced when their levels change
+        if(streamed && outTextures[index].image.image){
+            outTextures[index].file = image->file;
+            outTextures[index].levels = image->levels;
+            streamedCount++;
+        }
+    }
+    decoder.join();
+
+    // textures of same format, size and levels become layers of one array, others get images of their own after all
+    if(outArrays){
+        std::vector<TextureArrayKey> keys(files.size());
+        std::vector<bool> grouped(files.size());
+        for(size_t i = 0; i < files.size(); i++){
+            if(!packable[i]) continue;
+            keys[i] = {static_cast<uint32_t>(packable[i]->format), packable[i]->width, packable[i]->height, packable[i]->mipLevels};
+            grouped[i] = true;
+        }
+
+        uint32_t maxLayers = std::min(TextureArrayMaxLayers, renderer->device.physical.getProperties().limits.maxImageArrayLayers);
+        std::vector<TextureArrayGroup> groups;
+        GroupTextureArrays(keys, grouped, maxLayers, groups);
+        for(const TextureArrayGroup& group : groups){
+            if(!UploadTextureArray(packable, group)) continue;
+            for(uint32_t index : group.textures) packable[index].reset();
+        }
+        for(size_t i = 0; i < files.size(); i++){
+            if(packable[i]) UploadTexture(i, *packable[i], 0);
+        }
+    }
+
+    if(batches[currentBatch].recording){
+        SubmitUploadBatch(renderer, batches[currentBatch]);
+        submitCount++;
+    }
+    for(UploadBatch& batch : batches) DestroyUploadBatch(renderer, batch);
+
+    auto stopTime = std::chrono::high_resolution_clock::now();
+    LOG(INFO, "Loaded %u of %zu texture images in %.2fms : %u decode threads, %u submissions, %u with levels above %u texels left for streaming, "
+        "%u packed into texture arrays, %.2f MB saved by narrow formats", loadedCount, files.size(), std::chrono::duration<float, std::milli>(stopTime - startTime).count(),
+        threadCount, submitCount, streamedCount, streamedSize, packedCount, savedSize / (1024.f * 1024.f));
+    return loadedCount;
+}
+
+void GameZero::BeginTextureStreamUpload(Renderer* renderer, Texture& texture, uint32_t level, TextureStreamUpload& upload){
+    upload.texture = &texture;
+    upload.level = level;
+    upload.size = BuildUploadRegions(texture.levels, texture.width, texture.height, level, upload.regions);
+    upload.stagingBuffer = CreateBuffer(renderer->device.allocator, upload.size, vk::BufferUsageFlagBits::eTransferSrc, vma::MemoryUsage::eCpuOnly);
+
+    void* dest;
+    CHECK_VK_RESULT(renderer->device.allocator.mapMemory(upload.stagingBuffer.allocation, &dest), "Failed to map memory correctly");
+    upload.mapped = static_cast<uint8_t*>(dest);
+}
+
+bool GameZero::RecordTextureStreamUpload(Renderer* renderer, vk::CommandBuffer cmd, const TextureStreamUpload& upload, AllocatedImage& outImage){
+    const Texture& texture = *upload.texture;
+    uint32_t width = std::max(texture.width >> upload.level, 1u), height = std::max(texture.height >> upload.level, 1u);
+    if(!CreateSampledImage(renderer, texture.image.format, width, height, texture.levelCount - upload.level, 1, false, outImage)) return false;
+
+    RecordImageUpload(cmd, outImage, upload.stagingBuffer.buffer, upload.regions, false);
     return true;
 }
+
+void GameZero::ReleaseTextureStreamUpload(Renderer* renderer, TextureStreamUpload& upload){
+    if(!upload.mapped) return;
+    renderer->device.allocator.unmapMemory(upload.stagingBuffer.allocation);
+    renderer->device.allocator.destroyBuffer(upload.stagingBuffer.buffer, upload.stagingBuffer.allocation);
+    upload.mapped = nullptr;
+}
+
+void GameZero::TextureStreamWorker::Start(){
+    stopping = false;
+    thread = std::thread([this](){ Run(); });
+}
+
+std::vector<TextureStreamUpload> GameZero::TextureStreamWorker::Stop(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_one();
+    if(thread.joinable()) thread.join();
+
+    std::vector<TextureStreamUpload> remaining(std::make_move_iterator(queued.begin()), std::make_move_iterator(queued.end()));
+    remaining.insert(remaining.end(), std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.end()));
+    queued.clear();
+    finished.clear();
+    return remaining;
+}
+
+void GameZero::TextureStreamWorker::Push(TextureStreamUpload&& upload){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(std::move(upload));
+    }
+    condition.notify_one();
+}
+
+void GameZero::TextureStreamWorker::TakeFinished(std::vector<TextureStreamUpload>& uploads){
+    std::lock_guard<std::mutex> lock(mutex);
+    uploads.insert(uploads.end(), std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.end()));
+    finished.clear();
+}
+
+// copy levels in order they were asked for, reading them may fault pages of file in from disk
+void GameZero::TextureStreamWorker::Run(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true){
+        condition.wait(lock, [&](){ return stopping || !queued.empty(); });
+        if(stopping) return;
+
+        TextureStreamUpload upload = std::move(queued.front());
+        queued.pop_front();
+        lock.unlock();
+
+        CopyLevels(upload.texture->levels, upload.level, upload.mapped, upload.regions);
+
+        lock.lock();
+        finished.push_back(std::move(upload));
+    }
+}
@@ -2,17 +2,166 @@
 #define GAMEZERO_TEXTURE_HPP
 
 #include "common.hpp"
+#include "texture_cache.hpp"
 #include "vulkan/types.hpp"
 #include "vulkan/image.hpp"
+#include "utils/image.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace GameZero{
 
-    bool LoadImageFromFile(struct Renderer* renderer, const char* file, AllocatedImage& outImage);
-
     struct Texture{
         AllocatedImage image;
+
+        /// size of level 0 and number of levels, image may hold only the coarser ones
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levelCount = 1;
+        /// finest level held by image, it is level 0 of image
+        uint32_t residentLevel = 0;
+        /// bytes of texels held by image
+        uint64_t size = 0;
+
+        /// texels of every level, kept mapped so that finer levels can be streamed in later
+        /// file is null when texture is not streamed, image then holds all levels for as long as renderer lives
+        std::shared_ptr<MappedFile> file;
+        std::vector<TextureLevel> levels;
+        /// index of streaming state in renderer, -1 when texture is not streamed
+        int32_t streamIndex = -1;
+        /// index of texture array in renderer and layer of texture in it, -1 when texture has an image of its own
+        /// image is then the array image, shared by all of its layers
+        int32_t arrayIndex = -1;
+        uint32_t layer = 0;
+    };
+
+    /// small textures of same format and size packed into one image, so that their materials share one texture set
+    struct TextureArray{
+        AllocatedImage image;
+        vk::DescriptorSet textureSet = VK_NULL_HANDLE;
+    };
+
+    /// number of mip levels of a full chain down to 1x1 for given size
+    uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+    /// bytes a level takes in staging memory, offsets of levels stay multiples of 16 byte blocks and of every texel size
+    inline uint64_t GetStagingLevelSize(uint64_t size){ return (size + 15) / 16 * 16; }
+
+    /// swizzle of views of a texture format, so that narrow formats read like rgba
+    /// R8 is gray, R8G8 srgb is gray and alpha, R8G8 unorm is a normal map whose blue reads 0 and is rebuilt by shader.frag
+    vk::ComponentMapping GetTextureSwizzle(vk::Format format);
+
+    /// load png, jpg and other stb_image formats, or KTX2 files when file ends with .ktx2
+    /// images are stored in narrowest of R8, R8G8 and R8G8B8A8 that keeps all of their channels, see AnalyzeImageChannels
+    /// only images loaded as normal maps are stored linear, and as R8G8 when opaque
+    /// decoded texels and their mips are cached beside image and mapped on later loads, see texture_cache.hpp
+    bool LoadImageFromFile(struct Renderer* renderer, const char* file, AllocatedImage& outImage, ImageUsage usage = ImageUsage::Color);
+
+    /**
+     * @brief Load a BC1, BC3 or BC7 KTX2 texture with all of its stored mip levels,
+     *        uploaded with one copy that has a region per level.
+     *        If device cannot sample the format, blocks are decoded to 8 bit rgba instead.
+     *
+     * @param renderer : renderer that owns image
+     * @param file : KTX2 file
+     * @param outImage : receives uploaded image, format tells whether it stayed compressed
+     * @return false if file cannot be read or holds an unsupported format
+     */
+    bool LoadImageFromKtx2(struct Renderer* renderer, const char* file, AllocatedImage& outImage);
+
+    /**
+     * @brief Load many textures the way LoadImageFromFile does, in one pipeline.
+     *        Worker threads decode images while render thread copies finished ones to staging memory,
+     *        copies of many images are recorded to one command buffer and submitted together,
+     *        and one batch of copies is filled while gpu transfers the one before it.
+     *
+     * @param renderer : renderer that owns images
+     * @param files : image files
+     * @param outTextures : receives one texture per file, textures that failed to load have a null image handle
+     *                      caller destroys images of textures that are not streamed or in an array
+     * @param streamedSize : when not 0, textures whose levels stay mapped in a file only get levels
+     *                       of at most this many texels uploaded, and keep file to stream the rest
+     * @param threadCount : number of decode threads, 0 means one per core
+     * @param usages : what each file holds, files past its end are colors
+     * @param outArrays : when not null, textures of at most TextureArrayMaxSize texels that are not streamed are grouped by
+     *                    GroupTextureArrays and copied straight into layers of arrays appended here, arrayIndex of their textures
+     *                    is position of their array in outArrays, caller destroys array images
+     * @return number of textures loaded
+     */
+    uint32_t LoadTexturesFromFiles(struct Renderer* renderer, const std::vector<std::string>& files, std::vector<Texture>& outTextures,
+                                   uint32_t streamedSize = 0, uint32_t threadCount = 0, const std::vector<ImageUsage>& usages = {},
+                                   std::vector<TextureArray>* outArrays = nullptr);
+
+    /// upload tightly packed 8 bit rgba pixels to a new gpu image
+    /// full mip chain is generated on gpu by blitting each level from the one above it
+    bool LoadImageFromPixels(struct Renderer* renderer, const void* pixels, uint32_t width, uint32_t height, AllocatedImage& outImage);
+
+    /// levels of a streamed texture from given level on, copied to staging memory by TextureStreamWorker
+    /// and from there to a new image by render thread
+    struct TextureStreamUpload{
+        Texture* texture = nullptr;
+        /// finest level of new image
+        uint32_t level = 0;
+        /// bytes of staging memory and of new image
+        uint64_t size = 0;
+
+        AllocatedBuffer stagingBuffer;
+        uint8_t* mapped = nullptr;
+        std::vector<vk::BufferImageCopy> regions;
+    };
+
+    /// create and map staging buffer of an upload of texture levels from given level on
+    void BeginTextureStreamUpload(struct Renderer* renderer, Texture& texture, uint32_t level, TextureStreamUpload& upload);
+
+    /// create new image of a filled upload and record its copy, image is readable by fragment shaders after cmd
+    /// caller destroys image, staging buffer must live until cmd has executed
+    bool RecordTextureStreamUpload(struct Renderer* renderer, vk::CommandBuffer cmd, const TextureStreamUpload& upload, AllocatedImage& outImage);
+
+    /// destroy staging buffer of an upload
+    void ReleaseTextureStreamUpload(struct Renderer* renderer, TextureStreamUpload& upload);
+
+    /**
+     * @brief Thread that copies levels of streamed textures to staging memory,
+     *        so that a frame never waits for texels to be read from disk.
+     */
+    class TextureStreamWorker{
+    public:
+        void Start();
+        /// stop thread and return uploads it was given that were not taken, their staging buffers still need releasing
+        std::vector<TextureStreamUpload> Stop();
+
+        /// queue upload whose staging buffer is created and mapped
+        void Push(TextureStreamUpload&& upload);
+        /// append uploads whose staging memory is filled
+        void TakeFinished(std::vector<TextureStreamUpload>& uploads);
+
+    private:
+        void Run();
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<TextureStreamUpload> queued;
+        std::vector<TextureStreamUpload> finished;
+        bool stopping = false;
+    };
+
+    /// texture image and texture sets replaced by streaming, released once no frame in flight reads them
+    struct RetiredTexture{
+        /// frame that stopped using them
+        uint64_t frame = 0;
+        AllocatedImage image;
+        uint64_t size = 0;
+        std::vector<vk::DescriptorSet> textureSets;
+        /// upload that made the replacing image, its staging buffer is read by that frame
+        TextureStreamUpload upload;
     };
 
 }
 
-#endif//GAMEZERO_TEXTURE_HPP
\ No newline at end of file
+#endif//GAMEZERO_TEXTURE_HPP
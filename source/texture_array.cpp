@@ -0,0 +1,42 @@
+#include "texture_array.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace GameZero;
+
+uint32_t GameZero::GroupTextureArrays(const std::vector<TextureArrayKey>& keys, const std::vector<bool>& packable, uint32_t maxLayers,
+                                      std::vector<TextureArrayGroup>& groups){
+    groups.clear();
+    if(maxLayers < 2) return 0;
+
+    // textures with equal keys end up next to each other, in their own order
+    std::vector<uint32_t> order;
+    for(uint32_t i = 0; i < keys.size(); i++){
+        if(packable[i]) order.push_back(i);
+    }
+    auto tie = [&](uint32_t i){ return std::make_tuple(keys[i].format, keys[i].width, keys[i].height, keys[i].levelCount, i); };
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return tie(a) < tie(b); });
+
+    uint32_t packedCount = 0;
+    for(size_t first = 0; first < order.size();){
+        size_t last = first + 1;
+        while(last < order.size() && keys[order[last]] == keys[order[first]]) last++;
+
+        // split evenly so that a long run does not leave a lone texture at its end
+        size_t count = last - first;
+        size_t arrayCount = (count + maxLayers - 1) / maxLayers;
+        for(size_t a = 0; a < arrayCount && count >= 2; a++){
+            size_t begin = first + count * a / arrayCount, end = first + count * (a + 1) / arrayCount;
+            TextureArrayGroup group;
+            group.key = keys[order[first]];
+            group.textures.assign(order.begin() + begin, order.begin() + end);
+            packedCount += static_cast<uint32_t>(group.textures.size());
+            groups.push_back(std::move(group));
+        }
+        first = last;
+    }
+
+    std::sort(groups.begin(), groups.end(), [](const TextureArrayGroup& a, const TextureArrayGroup& b){ return a.textures.front() < b.textures.front(); });
+    return packedCount;
+}
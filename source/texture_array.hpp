@@ -0,0 +1,55 @@
+/**
+ * @file texture_array.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief groups small textures of same format and size into texture arrays
+ * @version 0.1
+ * @date 2021-07-08
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_TEXTURE_ARRAY_HPP
+#define GAMEZERO_TEXTURE_ARRAY_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace GameZero{
+
+    /// what decides whether two textures can be layers of one array
+    struct TextureArrayKey{
+        /// vulkan format of texels
+        uint32_t format = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levelCount = 0;
+
+        bool operator == (const TextureArrayKey& other) const noexcept{
+            return format == other.format && width == other.width && height == other.height && levelCount == other.levelCount;
+        }
+    };
+
+    /// textures packed into one array, layer of each texture is its position
+    struct TextureArrayGroup{
+        TextureArrayKey key;
+        std::vector<uint32_t> textures;
+    };
+
+    /**
+     * @brief Group textures whose format, size and level count match into arrays.
+     *        Groups larger than maxLayers are split, and textures left without
+     *        a compatible partner stay on their own.
+     *
+     * @param keys : key of each texture
+     * @param packable : whether each texture may be packed, streamed and large textures keep images of their own
+     * @param maxLayers : most layers of an array, at least 2
+     * @param groups : receives arrays of at least 2 textures, in order of their first texture
+     * @return uint32_t : number of textures packed
+     */
+    uint32_t GroupTextureArrays(const std::vector<TextureArrayKey>& keys, const std::vector<bool>& packable, uint32_t maxLayers,
+                                std::vector<TextureArrayGroup>& groups);
+
+}
+
+#endif//GAMEZERO_TEXTURE_ARRAY_HPP
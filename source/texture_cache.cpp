@@ -0,0 +1,72 @@
+#include "texture_cache.hpp"
+#include "settings.hpp"
+#include "utils/log.hpp"
+#include "utils/mapped_file.hpp"
+
+std::string GameZero::GetTextureCachePath(const char* sourceFilename){
+    return GetCacheFilePath(sourceFilename, ".gztex");
+}
+
+// map texture cache if it is up to date
+bool GameZero::LoadTextureCache(const char* sourceFilename, MappedFile& file, TextureCacheImage& image){
+    std::string cachePath = GetTextureCachePath(sourceFilename);
+
+    if(!OpenCacheFile(sourceFilename, cachePath, TextureCacheMagic, TextureCacheVersion, sizeof(TextureCacheHeader), "Texture", file)) return false;
+    const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(file.data);
+
+    // level table comes right after header
+    uint64_t levelTableEnd = sizeof(TextureCacheHeader) + uint64_t(header->levelCount) * sizeof(TextureCacheLevel);
+    if(header->levelCount == 0 || header->levelCount > 32 || levelTableEnd > file.size){
+        LOG(WARNING, "Texture cache [ %s ] is truncated", cachePath.c_str());
+        return false;
+    }
+    const TextureCacheLevel* levels = reinterpret_cast<const TextureCacheLevel*>(file.data + sizeof(TextureCacheHeader));
+
+    image.levels.resize(header->levelCount);
+    for(uint32_t i = 0; i < header->levelCount; i++){
+        // every level must lie completely inside file
+        if(levels[i].offset > file.size || levels[i].size > file.size - levels[i].offset){
+            LOG(WARNING, "Texture cache [ %s ] is truncated", cachePath.c_str());
+            return false;
+        }
+        image.levels[i].data = file.data + levels[i].offset;
+        image.levels[i].size = levels[i].size;
+    }
+
+    image.format = header->format;
+    image.width = header->width;
+    image.height = header->height;
+
+    // texels are read once from start to end while they are copied to staging buffer
+    file.PrefetchSequential();
+    return true;
+}
+
+// write texture cache beside source file
+bool GameZero::WriteTextureCache(const char* sourceFilename, uint32_t format, uint32_t width, uint32_t height, const std::vector<TextureLevel>& levels){
+    std::string cachePath = GetTextureCachePath(sourceFilename);
+
+    TextureCacheHeader header = {};
+    if(!MakeCacheFileHeader(sourceFilename, TextureCacheMagic, TextureCacheVersion, header.file)) return false;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+
+    // lay out levels one after another, after header and level table
+    std::vector<TextureCacheLevel> levelTable(levels.size());
+    std::vector<CacheFileBlob> blobs = {
+        {0, &header, sizeof(header)},
+        {sizeof(header), levelTable.data(), levelTable.size() * sizeof(TextureCacheLevel)}
+    };
+    uint64_t offset = sizeof(TextureCacheHeader) + levelTable.size() * sizeof(TextureCacheLevel);
+    for(size_t i = 0; i < levels.size(); i++){
+        offset = AlignCacheOffset(offset, TextureCacheAlignment);
+        levelTable[i].offset = offset;
+        levelTable[i].size = levels[i].size;
+        blobs.push_back({offset, levels[i].data, levels[i].size});
+        offset += levels[i].size;
+    }
+
+    return WriteCacheFile(cachePath, blobs.data(), blobs.size(), "Texture");
+}
@@ -0,0 +1,103 @@
+/**
+ * @file texture_cache.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief cache of decoded texels and mips written beside source images
+ * @version 0.1
+ * @date 2021-07-05
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_TEXTURE_CACHE_HPP
+#define GAMEZERO_TEXTURE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "utils/cache_file.hpp"
+
+namespace GameZero{
+
+    class MappedFile;
+
+    /// "GZTC" in little endian
+    constexpr static uint32_t TextureCacheMagic = 0x43545A47;
+    /// bump this whenever layout of cache or processing of stored texels changes
+    constexpr static uint32_t TextureCacheVersion = 4;
+
+    /// where one mip level lives in cache file
+    struct TextureCacheLevel{
+        /// offset from start of file in bytes
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    /**
+     * @brief Header at the start of every texture cache file.
+     *        Header is followed by levelCount number of TextureCacheLevel, level 0 first,
+     *        and then texels of every level, each aligned to TextureCacheAlignment bytes.
+     */
+    struct TextureCacheHeader{
+        /// format of cache and source it was made from
+        CacheFileHeader file;
+
+        /// VkFormat of texels, ready to be copied to an image of that format
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+    };
+
+    /// alignment of each level in file, enough for any texel block
+    constexpr static uint64_t TextureCacheAlignment = 16;
+
+    /// texels of one mip level
+    struct TextureLevel{
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    /// cached texture, levels point into mapped cache file
+    struct TextureCacheImage{
+        uint32_t format = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        /// level 0 is full size
+        std::vector<TextureLevel> levels;
+    };
+
+    /**
+     * @brief Get path of cache file for a given source image
+     *
+     * @param sourceFilename : source image file (eg : png file)
+     */
+    std::string GetTextureCachePath(const char* sourceFilename);
+
+    /**
+     * @brief Map texture cache of a source image if cache is up to date with source.
+     *        Texels are not copied, image levels point into file which must stay open while they are used.
+     *
+     * @param sourceFilename : source image file (eg : png file)
+     * @param file : receives mapping of cache file
+     * @param image : receives format, size and levels
+     * @return true if cache was valid and mapped
+     */
+    bool LoadTextureCache(const char* sourceFilename, MappedFile& file, TextureCacheImage& image);
+
+    /**
+     * @brief Write texture cache beside source image.
+     *
+     * @param sourceFilename : source image file that texels were decoded from
+     * @param format : VkFormat of texels
+     * @param width : width of level 0
+     * @param height : height of level 0
+     * @param levels : texels of every level, level 0 first
+     * @return true on success
+     */
+    bool WriteTextureCache(const char* sourceFilename, uint32_t format, uint32_t width, uint32_t height, const std::vector<TextureLevel>& levels);
+
+}
+
+#endif//GAMEZERO_TEXTURE_CACHE_HPP
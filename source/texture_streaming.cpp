@@ -0,0 +1,127 @@
+#include "texture_streaming.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+using namespace GameZero;
+
+void GameZero::PlanTextureResidency(std::vector<StreamedTextureState>& textures, uint64_t fixedBytes, uint64_t budget,
+                                    uint64_t uploadLimit, TextureResidencyPlan& plan){
+    plan.changes.clear();
+    plan.uploadBytes = 0;
+    plan.loadedLevels = 0;
+    plan.evictedLevels = 0;
+
+    uint64_t residentBytes = fixedBytes;
+    std::vector<uint32_t> growing, evictable;
+    std::vector<uint32_t> planned(textures.size());
+    for(uint32_t i = 0; i < textures.size(); i++){
+        const StreamedTextureState& texture = textures[i];
+        residentBytes += texture.GetImageSize(texture.residentLevel);
+        planned[i] = texture.residentLevel;
+        if(texture.pending) continue;
+
+        // wants finer levels, or holds finer levels than it needs and is allowed to drop them
+        if(texture.requestedLevel < texture.residentLevel) growing.push_back(i);
+        else if(texture.residentLevel < std::min(texture.requestedLevel, texture.minResidentLevel)) evictable.push_back(i);
+    }
+
+    // largest shortfall first, recently used textures before others
+    std::sort(growing.begin(), growing.end(), [&](uint32_t a, uint32_t b){
+        uint32_t shortfallA = textures[a].residentLevel - textures[a].requestedLevel;
+        uint32_t shortfallB = textures[b].residentLevel - textures[b].requestedLevel;
+        if(shortfallA != shortfallB) return shortfallA > shortfallB;
+        if(textures[a].lastUsedFrame != textures[b].lastUsedFrame) return textures[a].lastUsedFrame > textures[b].lastUsedFrame;
+        return a < b;
+    });
+
+    // least recently used first, finer levels first within a frame
+    std::sort(evictable.begin(), evictable.end(), [&](uint32_t a, uint32_t b){
+        return std::make_tuple(textures[a].lastUsedFrame, textures[a].residentLevel, a) < std::make_tuple(textures[b].lastUsedFrame, textures[b].residentLevel, b);
+    });
+
+    // drop finest level of least recently used texture that still holds levels it does not need
+    size_t nextEvictable = 0;
+    auto evictLevel = [&](){
+        for(; nextEvictable < evictable.size(); nextEvictable++){
+            const StreamedTextureState& texture = textures[evictable[nextEvictable]];
+            uint32_t& level = planned[evictable[nextEvictable]];
+            if(level < std::min(texture.requestedLevel, texture.minResidentLevel)){
+                residentBytes -= texture.levelSizes[level];
+                level++;
+                plan.evictedLevels++;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // budget may have been lowered since last frame
+    while(residentBytes > budget && evictLevel()){}
+
+    for(uint32_t index : growing){
+        const StreamedTextureState& texture = textures[index];
+        uint32_t level = texture.residentLevel - 1;
+        uint64_t uploadSize = texture.GetImageSize(level);
+        if(plan.uploadBytes > 0 && plan.uploadBytes + uploadSize > uploadLimit) break;
+
+        while(residentBytes + texture.levelSizes[level] > budget && evictLevel()){}
+        // smaller levels of other textures may still fit
+        if(residentBytes + texture.levelSizes[level] > budget) continue;
+
+        residentBytes += texture.levelSizes[level];
+        planned[index] = level;
+        plan.uploadBytes += uploadSize;
+        plan.loadedLevels++;
+    }
+
+    for(uint32_t i = 0; i < textures.size(); i++){
+        StreamedTextureState& texture = textures[i];
+        if(planned[i] == texture.residentLevel) continue;
+
+        // evicted textures get a smaller image too
+        if(planned[i] > texture.residentLevel) plan.uploadBytes += texture.GetImageSize(planned[i]);
+        texture.residentLevel = planned[i];
+        texture.pending = true;
+        plan.changes.push_back({i, planned[i]});
+    }
+    plan.residentBytes = residentBytes;
+}
+
+// area weighted, so that many small triangles and few large ones give the same density
+float GameZero::ComputeUvDensity(const Vertex* vertices, const uint32_t* indices, size_t indexCount){
+    double surfaceArea = 0, uvArea = 0;
+    for(size_t i = 0; i + 2 < indexCount; i += 3){
+        const Vertex& a = vertices[indices[i]];
+        const Vertex& b = vertices[indices[i + 1]];
+        const Vertex& c = vertices[indices[i + 2]];
+
+        surfaceArea += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+        glm::vec2 ab = b.uv - a.uv, ac = c.uv - a.uv;
+        uvArea += std::fabs(ab.x * ac.y - ab.y * ac.x);
+    }
+    if(surfaceArea <= 0) return 0.f;
+    return static_cast<float>(std::sqrt(uvArea / surfaceArea));
+}
+
+uint32_t GameZero::SelectTextureMipLevel(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition,
+                                         float projectionScale, float texelDensity, uint32_t levelCount){
+    if(levelCount <= 1 || texelDensity <= 0.f) return 0;
+
+    // largest axis scale of transform, texels are spread over more world units as it grows
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+    glm::vec3 center = glm::vec3(transform * glm::vec4(mesh.boundingSphere.center, 1.f));
+    float radius = mesh.boundingSphere.radius * scale;
+
+    // distance to closest point of bounding sphere, camera inside needs full size
+    float distance = glm::length(center - cameraPosition) - radius;
+    if(distance <= 0.f) return 0;
+
+    // every level halves texels per pixel
+    float texelsPerPixel = texelDensity * distance / (scale * projectionScale);
+    if(!(texelsPerPixel > 1.f)) return 0;
+    return std::min(static_cast<uint32_t>(std::log2(texelsPerPixel)), levelCount - 1);
+}
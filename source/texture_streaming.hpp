@@ -0,0 +1,118 @@
+/**
+ * @file texture_streaming.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief picks mip levels of streamed textures that stay on gpu under a memory budget
+ * @version 0.1
+ * @date 2021-07-06
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_TEXTURE_STREAMING_HPP
+#define GAMEZERO_TEXTURE_STREAMING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace GameZero{
+
+    struct Vertex;
+    class Mesh;
+
+    /// most mip levels a streamed texture can have, a full chain of a 32768 texel texture
+    constexpr static uint32_t MaxStreamedLevelCount = 16;
+
+    /**
+     * @brief Residency of one streamed texture.
+     *        Image of texture holds residentLevel and all coarser levels,
+     *        levels from minResidentLevel on are loaded at startup and never evicted.
+     */
+    struct StreamedTextureState{
+        /// bytes of each level on gpu, level 0 first
+        uint64_t levelSizes[MaxStreamedLevelCount] = {};
+        uint32_t levelCount = 0;
+        /// coarsest level image is ever reduced to
+        uint32_t minResidentLevel = 0;
+        /// finest level image holds, or will hold once its pending change has landed
+        uint32_t residentLevel = 0;
+        /// finest level needed by last frame, levelCount when texture was not drawn
+        uint32_t requestedLevel = 0;
+        /// frame texture was last drawn in, textures unused for longest are evicted first
+        uint64_t lastUsedFrame = 0;
+        /// residentLevel was changed and new image is not on gpu yet, texture is left alone until it is
+        bool pending = false;
+
+        /// bytes of an image holding given level and all coarser ones
+        uint64_t GetImageSize(uint32_t level) const noexcept{
+            uint64_t size = 0;
+            for(uint32_t i = level; i < levelCount; i++) size += levelSizes[i];
+            return size;
+        }
+    };
+
+    /// new resident level of a texture
+    struct TextureResidencyChange{
+        /// index of texture in planned textures
+        uint32_t texture;
+        uint32_t level;
+    };
+
+    /// what PlanTextureResidency decided for a frame
+    struct TextureResidencyPlan{
+        std::vector<TextureResidencyChange> changes;
+        /// bytes all textures hold once changes have landed, including fixed bytes
+        uint64_t residentBytes = 0;
+        /// bytes of new images that changes upload
+        uint64_t uploadBytes = 0;
+        /// levels made resident and evicted
+        uint32_t loadedLevels = 0;
+        uint32_t evictedLevels = 0;
+    };
+
+    /**
+     * @brief Choose levels to load and evict this frame so that textures stay under budget.
+     *        Textures drawn at finer levels than they hold get one level finer each frame,
+     *        largest shortfall first. Room for them is made by evicting levels textures hold
+     *        but no longer need, least recently used texture first. Textures that do not fit
+     *        stay coarser until room is freed. Planned textures get their new residentLevel
+     *        and are marked pending.
+     *
+     * @param textures : all streamed textures
+     * @param fixedBytes : bytes of textures that are not streamed and of images not released yet
+     * @param budget : most bytes textures may hold
+     * @param uploadLimit : most bytes of finer images loaded per frame, a single larger image is still loaded
+     * @param plan : receives changes
+     */
+    void PlanTextureResidency(std::vector<StreamedTextureState>& textures, uint64_t fixedBytes, uint64_t budget,
+                              uint64_t uploadLimit, TextureResidencyPlan& plan);
+
+    /**
+     * @brief Texture coordinate units per mesh space unit of a triangle list,
+     *        square root of ratio of total texture coordinate area to total surface area.
+     *
+     * @return float : 0 when triangles have no area
+     */
+    float ComputeUvDensity(const Vertex* vertices, const uint32_t* indices, size_t indexCount);
+
+    /**
+     * @brief Pick finest mip level worth sampling on a mesh, where one texel covers
+     *        at least one pixel, using mesh bounds as distance estimate.
+     *
+     * @param mesh : mesh drawn with texture
+     * @param transform : mesh to world transform
+     * @param cameraPosition : camera position in world space
+     * @param projectionScale : pixels covered by one world unit at unit distance,
+     *                          half viewport height times proj[1][1]
+     * @param texelDensity : texels per mesh space unit, uv density times texture size
+     * @param levelCount : number of levels of texture
+     * @return uint32_t : mip level, 0 is full size
+     */
+    uint32_t SelectTextureMipLevel(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition,
+                                   float projectionScale, float texelDensity, uint32_t levelCount);
+
+}
+
+#endif//GAMEZERO_TEXTURE_STREAMING_HPP
@@ -0,0 +1,113 @@
+#include "cache_file.hpp"
+#include "hash.hpp"
+#include "../settings.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace GameZero;
+
+// only strip extension if it belongs to the filename
+std::string GameZero::GetCacheFilePath(const char* sourceFilename, const char* extension){
+    std::string path(sourceFilename);
+    size_t dot = path.find_last_of('.');
+    size_t directory = path.find_last_of('/');
+
+    if(dot != std::string::npos && (directory == std::string::npos || dot > directory)){
+        path.resize(dot);
+    }
+
+    return path + extension;
+}
+
+bool GameZero::OpenCacheFile(const char* sourceFilename, const std::string& cachePath, uint32_t magic, uint32_t version, size_t headerSize, const char* kind, MappedFile& file){
+    // source must exist for us to validate the cache
+    FileInfo sourceInfo;
+    if(!GetFileInfo(sourceFilename, sourceInfo)) return false;
+
+    // no cache yet, this is a cold start
+    if(!file.Open(cachePath.c_str())) return false;
+
+    if(file.size < headerSize){
+        LOG(WARNING, "%s cache [ %s ] is truncated", kind, cachePath.c_str());
+        return false;
+    }
+
+    const CacheFileHeader* header = reinterpret_cast<const CacheFileHeader*>(file.data);
+    if(header->magic != magic || header->version != version){
+        LOG(INFO, "%s cache [ %s ] has an old format and will be rebuilt", kind, cachePath.c_str());
+        return false;
+    }
+
+    // source changed size, definitely stale
+    if(header->sourceSize != sourceInfo.size){
+        LOG(INFO, "%s cache [ %s ] is stale and will be rebuilt", kind, cachePath.c_str());
+        return false;
+    }
+
+    // source was touched, but contents might still be same (eg : fresh checkout)
+    // in that case compare contents hash before rebuilding
+    if(header->sourceModifiedTime != sourceInfo.modifiedTime){
+        MappedFile source;
+        if(!source.Open(sourceFilename)) return false;
+        source.PrefetchSequential();
+
+        if(HashBytes(source.data, source.size) != header->sourceHash){
+            LOG(INFO, "%s cache [ %s ] is stale and will be rebuilt", kind, cachePath.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// hash source so that a touched but unchanged source does not invalidate cache
+bool GameZero::MakeCacheFileHeader(const char* sourceFilename, uint32_t magic, uint32_t version, CacheFileHeader& header){
+    FileInfo sourceInfo;
+    if(!GetFileInfo(sourceFilename, sourceInfo)) return false;
+
+    MappedFile source;
+    if(!source.Open(sourceFilename)) return false;
+    source.PrefetchSequential();
+
+    header.magic = magic;
+    header.version = version;
+    header.sourceSize = sourceInfo.size;
+    header.sourceModifiedTime = sourceInfo.modifiedTime;
+    header.sourceHash = HashBytes(source.data, source.size);
+    return true;
+}
+
+bool GameZero::WriteCacheFile(const std::string& cachePath, const CacheFileBlob* blobs, size_t blobCount, const char* kind){
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){
+        LOG(WARNING, "Failed to write %s cache [ %s ]", kind, cachePath.c_str());
+        return false;
+    }
+
+    const char padding[64] = {};
+    uint64_t written = 0;
+    for(size_t i = 0; i < blobCount; i++){
+        while(written < blobs[i].offset){
+            uint64_t gap = std::min<uint64_t>(blobs[i].offset - written, sizeof(padding));
+            file.write(padding, gap);
+            written += gap;
+        }
+        file.write(static_cast<const char*>(blobs[i].data), blobs[i].size);
+        written += blobs[i].size;
+    }
+
+    file.close();
+    if(!file || std::rename(tempPath.c_str(), cachePath.c_str()) != 0){
+        LOG(WARNING, "Failed to write %s cache [ %s ]", kind, cachePath.c_str());
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    LOG(INFO, "%s cache [ %s ] written (%.2f MB)", kind, cachePath.c_str(), written / (1024.f * 1024.f));
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef GAMEZERO_UTILS_CACHE_FILE_HPP
+#define GAMEZERO_UTILS_CACHE_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace GameZero{
+
+    class MappedFile;
+
+    /**
+     * @brief Start of every cache file written beside a source file.
+     *        Tells format of cache and which version of source it was made from.
+     */
+    struct CacheFileHeader{
+        uint32_t magic;
+        uint32_t version;
+
+        /// size of source file when cache was written
+        uint64_t sourceSize;
+        /// modification time of source file when cache was written
+        int64_t sourceModifiedTime;
+        /// hash of source file contents
+        uint64_t sourceHash;
+    };
+
+    /// a run of bytes written at an offset of cache file
+    struct CacheFileBlob{
+        /// offset from start of file in bytes, not less than end of previous blob
+        uint64_t offset;
+        const void* data;
+        uint64_t size;
+    };
+
+    /// round offset up to a power of two alignment
+    inline uint64_t AlignCacheOffset(uint64_t offset, uint64_t alignment){
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    /**
+     * @brief Get path of cache file for a source file, placed beside it with a different extension
+     *
+     * @param sourceFilename : source file (eg : obj or png file)
+     * @param extension : extension of cache file including the dot
+     */
+    std::string GetCacheFilePath(const char* sourceFilename, const char* extension);
+
+    /**
+     * @brief Map a cache file if it is of given format and up to date with source.
+     *        A source that was touched but has same size is compared by contents hash,
+     *        so that eg a fresh checkout keeps its caches.
+     *
+     * @param sourceFilename : source file cache was made from
+     * @param cachePath : cache file
+     * @param magic : magic of cache format
+     * @param version : version of cache format
+     * @param headerSize : size of whole header of cache format, starting with CacheFileHeader
+     * @param kind : name of cache in log messages (eg : "Mesh")
+     * @param file : receives mapping of cache file, header is at its start
+     * @return true if cache is valid
+     */
+    bool OpenCacheFile(const char* sourceFilename, const std::string& cachePath, uint32_t magic, uint32_t version, size_t headerSize, const char* kind, MappedFile& file);
+
+    /**
+     * @brief Fill header with format of cache and size, time and hash of source
+     *
+     * @param sourceFilename : source file cache is made from
+     * @param magic : magic of cache format
+     * @param version : version of cache format
+     * @param header : receives magic, version and source info
+     * @return true if source could be read
+     */
+    bool MakeCacheFileHeader(const char* sourceFilename, uint32_t magic, uint32_t version, CacheFileHeader& header);
+
+    /**
+     * @brief Write blobs to a cache file, gaps between them are zero filled.
+     *        File is written to a temporary file first and renamed over cache,
+     *        so that a crash never leaves a broken cache behind.
+     *
+     * @param cachePath : cache file
+     * @param blobs : bytes to write, in order of offset
+     * @param blobCount : number of blobs
+     * @param kind : name of cache in log messages (eg : "Mesh")
+     * @return true on success
+     */
+    bool WriteCacheFile(const std::string& cachePath, const CacheFileBlob* blobs, size_t blobCount, const char* kind);
+
+}
+
+#endif//GAMEZERO_UTILS_CACHE_FILE_HPP
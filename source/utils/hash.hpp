@@ -0,0 +1,100 @@
+#ifndef GAMEZERO_UTILS_HASH_HPP
+#define GAMEZERO_UTILS_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace GameZero{
+
+    /// seed for a new hash
+    constexpr static uint64_t HashSeed = 14695981039346656037ull;
+
+    namespace HashDetail{
+        constexpr static uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+        constexpr static uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+        constexpr static uint64_t Prime3 = 0x165667B19E3779F9ull;
+        constexpr static uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+        constexpr static uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+        inline uint64_t Rotate(uint64_t value, int bits) noexcept{
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        inline uint64_t Read64(const uint8_t* bytes) noexcept{
+            uint64_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t Read32(const uint8_t* bytes) noexcept{
+            uint32_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+
+        inline uint64_t Round(uint64_t lane, uint64_t word) noexcept{
+            return Rotate(lane + word * Prime2, 31) * Prime1;
+        }
+
+        inline uint64_t Merge(uint64_t hash, uint64_t lane) noexcept{
+            return (hash ^ Round(0, lane)) * Prime1 + Prime4;
+        }
+    }
+
+    /**
+     * @brief Hash given bytes using 64 bit xxHash.
+     *        Bytes are consumed a word at a time in four independent lanes,
+     *        so hashing a whole source file runs at memory speed.
+     *        Pass previous hash as seed to continue hashing.
+     *
+     * @param data : bytes to hash
+     * @param size : number of bytes
+     * @param seed : previous hash value
+     * @return uint64_t : hash value
+     */
+    inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HashSeed) noexcept{
+        using namespace HashDetail;
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        const uint8_t* end = bytes + size;
+        uint64_t hash;
+
+        if(size >= 32){
+            uint64_t lanes[4] = {seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1};
+            for(; end - bytes >= 32; bytes += 32){
+                lanes[0] = Round(lanes[0], Read64(bytes));
+                lanes[1] = Round(lanes[1], Read64(bytes + 8));
+                lanes[2] = Round(lanes[2], Read64(bytes + 16));
+                lanes[3] = Round(lanes[3], Read64(bytes + 24));
+            }
+            hash = Rotate(lanes[0], 1) + Rotate(lanes[1], 7) + Rotate(lanes[2], 12) + Rotate(lanes[3], 18);
+            for(uint64_t lane : lanes) hash = Merge(hash, lane);
+        }else{
+            hash = seed + Prime5;
+        }
+        hash += size;
+
+        // tail shorter than a stripe
+        for(; end - bytes >= 8; bytes += 8){
+            hash = Rotate(hash ^ Round(0, Read64(bytes)), 27) * Prime1 + Prime4;
+        }
+        if(end - bytes >= 4){
+            hash = Rotate(hash ^ (Read32(bytes) * Prime1), 23) * Prime2 + Prime3;
+            bytes += 4;
+        }
+        for(; bytes < end; bytes++){
+            hash = Rotate(hash ^ (*bytes * Prime5), 11) * Prime1;
+        }
+
+        // avalanche so that every input bit affects every output bit
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+}
+
+#endif//GAMEZERO_UTILS_HASH_HPP
@@ -0,0 +1,151 @@
+#include "image.hpp"
+#include "image_kernels.hpp"
+#include "../settings.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "png.hpp"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace GameZero;
+
+uint8_t* GameZero::LoadImageRgba(const char* filename, uint32_t& width, uint32_t& height, uint32_t* fileChannels, PngDecoder pngDecoder){
+    // stb_image frees with free, so texels allocated here are freed the same way as ones it returns
+    MappedFile file;
+    PngImage png;
+    if(pngDecoder == PngDecoder::Fast && file.Open(filename) && ParsePng(file.data, file.size, png)){
+        file.PrefetchSequential();
+        uint8_t* rgba = static_cast<uint8_t*>(std::malloc(size_t(png.width) * png.height * 4));
+        if(rgba && DecodePng(png, rgba, size_t(png.width) * 4)){
+            width = png.width;
+            height = png.height;
+            if(fileChannels) *fileChannels = png.channelCount;
+            return rgba;
+        }
+        std::free(rgba);
+        LOG(WARNING, "Failed to decode png [ %s ], decoding it with stb_image instead", filename);
+    }
+    file.Close();
+
+    int w, h, channels;
+    stbi_uc* pixels = stbi_load(filename, &w, &h, &channels, 0);
+    if(!pixels) return nullptr;
+    width = uint32_t(w);
+    height = uint32_t(h);
+    if(fileChannels) *fileChannels = uint32_t(channels);
+    if(channels == 4) return pixels;
+
+    size_t texelCount = size_t(width) * height;
+    uint8_t* rgba = static_cast<uint8_t*>(std::malloc(texelCount * 4));
+    if(rgba) ExpandToRgba(pixels, texelCount, uint32_t(channels), rgba);
+    stbi_image_free(pixels);
+    return rgba;
+}
+
+uint8_t* GameZero::LoadImageRgba(const char* filename, uint32_t& width, uint32_t& height, const ImageAllocator& allocate, PngDecoder pngDecoder){
+    // memory is asked for once, a png DecodePng fails on is decoded again by stb_image into same memory
+    uint8_t* rgba = nullptr;
+    MappedFile file;
+    PngImage png;
+    if(pngDecoder == PngDecoder::Fast && file.Open(filename) && ParsePng(file.data, file.size, png)){
+        file.PrefetchSequential();
+        rgba = allocate(png.width, png.height);
+        if(!rgba) return nullptr;
+        if(DecodePng(png, rgba, size_t(png.width) * 4)){
+            width = png.width;
+            height = png.height;
+            return rgba;
+        }
+        LOG(WARNING, "Failed to decode png [ %s ], decoding it with stb_image instead", filename);
+    }
+    file.Close();
+
+    int w, h, channels;
+    stbi_uc* pixels = stbi_load(filename, &w, &h, &channels, 0);
+    if(!pixels) return nullptr;
+
+    // size of memory already given must match
+    if(rgba && (uint32_t(w) != png.width || uint32_t(h) != png.height)) rgba = nullptr;
+    else if(!rgba) rgba = allocate(uint32_t(w), uint32_t(h));
+    if(rgba){
+        width = uint32_t(w);
+        height = uint32_t(h);
+        ExpandToRgba(pixels, size_t(width) * height, uint32_t(channels), rgba);
+    }
+    stbi_image_free(pixels);
+    return rgba;
+}
+
+void GameZero::DownsampleImage(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, bool srgb, uint32_t threadCount){
+    uint32_t levelWidth = GetDownsampledSize(width);
+    uint32_t levelHeight = GetDownsampledSize(height);
+
+    ParallelFor(levelHeight, [&](size_t y){
+        uint32_t y0 = std::min(uint32_t(y) * 2, height - 1), y1 = std::min(uint32_t(y) * 2 + 1, height - 1);
+        DownsampleRow(source + size_t(y0) * width * 4, source + size_t(y1) * width * 4, width, destination + y * levelWidth * 4, srgb);
+    }, threadCount);
+}
+
+std::vector<std::vector<uint8_t>> GameZero::GenerateMipChain(const uint8_t* texels, uint32_t width, uint32_t height, bool srgb, uint32_t threadCount){
+    std::vector<std::vector<uint8_t>> levels;
+    while(width > 1 || height > 1){
+        uint32_t levelWidth = GetDownsampledSize(width), levelHeight = GetDownsampledSize(height);
+        std::vector<uint8_t> level(size_t(levelWidth) * levelHeight * 4);
+        DownsampleImage(texels, width, height, level.data(), srgb, threadCount);
+
+        levels.push_back(std::move(level));
+        texels = levels.back().data();
+        width = levelWidth;
+        height = levelHeight;
+    }
+    return levels;
+}
+
+uint32_t GameZero::GetChannelLayoutSize(ImageChannelLayout layout){
+    switch(layout){
+        case ImageChannelLayout::Gray: return 1;
+        case ImageChannelLayout::GrayAlpha: return 2;
+        case ImageChannelLayout::NormalMap: return 2;
+        default: return 4;
+    }
+}
+
+// one pass over texels, each check is dropped once a texel breaks it
+ImageChannelLayout GameZero::AnalyzeImageChannels(const uint8_t* texels, size_t texelCount, ImageUsage usage){
+    // gray layouts are sRGB, normal maps stay linear and only need to be opaque
+    bool gray = usage == ImageUsage::Color, opaque = true;
+    for(size_t i = 0; i < texelCount && (gray || opaque); i++, texels += 4){
+        gray = gray && texels[0] == texels[1] && texels[1] == texels[2];
+        opaque = opaque && texels[3] == 255;
+    }
+
+    if(gray) return opaque ? ImageChannelLayout::Gray : ImageChannelLayout::GrayAlpha;
+    return usage == ImageUsage::NormalMap && opaque ? ImageChannelLayout::NormalMap : ImageChannelLayout::Rgba;
+}
+
+void GameZero::PackImageChannels(const uint8_t* texels, size_t texelCount, ImageChannelLayout layout, uint8_t* destination){
+    switch(layout){
+        case ImageChannelLayout::Gray:
+            for(size_t i = 0; i < texelCount; i++) destination[i] = texels[i * 4];
+            break;
+        case ImageChannelLayout::GrayAlpha:
+            for(size_t i = 0; i < texelCount; i++){
+                destination[i * 2] = texels[i * 4];
+                destination[i * 2 + 1] = texels[i * 4 + 3];
+            }
+            break;
+        case ImageChannelLayout::NormalMap:
+            for(size_t i = 0; i < texelCount; i++){
+                destination[i * 2] = texels[i * 4];
+                destination[i * 2 + 1] = texels[i * 4 + 1];
+            }
+            break;
+        default:
+            std::copy(texels, texels + texelCount * 4, destination);
+            break;
+    }
+}
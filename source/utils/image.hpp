@@ -0,0 +1,125 @@
+#ifndef GAMEZERO_UTILS_IMAGE_HPP
+#define GAMEZERO_UTILS_IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace GameZero{
+
+    /// size of next mip level, every level halves size rounding down
+    inline uint32_t GetDownsampledSize(uint32_t size){ return size > 1 ? size / 2 : 1; }
+
+    /// decoders of png files, other formats are always decoded by stb_image
+    enum class PngDecoder{
+        /// DecodePng, files it does not accept are decoded by stb_image
+        Fast,
+        Stb
+    };
+
+    /**
+     * @brief Decode a png, jpg or other stb_image file to tightly packed 8 bit rgba.
+     *        Files are decoded with the channels they store and widened with ExpandToRgba.
+     *
+     * @param filename : image file
+     * @param width : receives width in texels
+     * @param height : receives height in texels
+     * @param fileChannels : when not null, receives number of channels stored in file
+     * @param pngDecoder : decoder of png files
+     * @return texels freed with stbi_image_free, null when file cannot be decoded
+     */
+    uint8_t* LoadImageRgba(const char* filename, uint32_t& width, uint32_t& height, uint32_t* fileChannels = nullptr,
+                           PngDecoder pngDecoder = PngDecoder::Fast);
+
+    /// gives memory for width * height * 4 bytes of texels, null to stop decoding
+    using ImageAllocator = std::function<uint8_t*(uint32_t width, uint32_t height)>;
+
+    /**
+     * @brief Decode an image file to tightly packed 8 bit rgba in memory given by caller, eg a mapped staging buffer.
+     *        Pngs DecodePng accepts are decoded straight into it, other files are decoded by stb_image and widened into it.
+     *
+     * @param filename : image file
+     * @param width : receives width in texels
+     * @param height : receives height in texels
+     * @param allocate : called once size of image is known, at most once
+     * @param pngDecoder : decoder of png files
+     * @return texels given by allocate, null when file cannot be decoded
+     */
+    uint8_t* LoadImageRgba(const char* filename, uint32_t& width, uint32_t& height, const ImageAllocator& allocate,
+                           PngDecoder pngDecoder = PngDecoder::Fast);
+
+    /**
+     * @brief Halve a tightly packed 8 bit rgba image with a 2x2 box filter, like a linear blit does.
+     *        sRGB colors are averaged in linear space so that mips do not darken, alpha is always linear.
+     *        Odd sizes drop their last row or column, a side of size 1 repeats its texel.
+     *        Rows are filtered by DownsampleRow.
+     *
+     * @param source : width * height * 4 bytes
+     * @param width : source width in texels
+     * @param height : source height in texels
+     * @param destination : receives GetDownsampledSize(width) * GetDownsampledSize(height) * 4 bytes
+     * @param srgb : colors are sRGB encoded
+     * @param threadCount : number of threads to use, 0 means one per core
+     */
+    void DownsampleImage(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, bool srgb, uint32_t threadCount = 0);
+
+    /**
+     * @brief Filter levels 1 and up of a full mip chain down to 1x1, each level from the one above it.
+     *
+     * @param texels : level 0, width * height * 4 bytes
+     * @param width : width of level 0
+     * @param height : height of level 0
+     * @param srgb : colors are sRGB encoded
+     * @param threadCount : number of threads to use, 0 means one per core
+     * @return texels of levels 1 and up, level i is at index i - 1
+     */
+    std::vector<std::vector<uint8_t>> GenerateMipChain(const uint8_t* texels, uint32_t width, uint32_t height, bool srgb, uint32_t threadCount = 0);
+
+    /// what texels of an image hold, given by whoever imports it since texels alone cannot tell
+    enum class ImageUsage{
+        /// sRGB encoded colors
+        Color,
+        /// unit length normals in red, green and blue, linear
+        NormalMap
+    };
+
+    /// channels an 8 bit rgba image needs, narrowest first
+    /// opaque color has no layout of its own, 3 byte formats cannot be sampled from optimal tiling images on most devices
+    enum class ImageChannelLayout{
+        /// red, green and blue are equal and alpha is opaque, stored as red alone
+        Gray,
+        /// red, green and blue are equal, stored as red and green holding alpha
+        GrayAlpha,
+        /// opaque normals, stored as red and green with blue rebuilt from them by shaders
+        NormalMap,
+        Rgba
+    };
+
+    /// bytes per texel of a layout
+    uint32_t GetChannelLayoutSize(ImageChannelLayout layout);
+
+    /**
+     * @brief Find narrowest layout that keeps every texel of a tightly packed 8 bit rgba image.
+     *        Only images imported as normal maps take NormalMap layout, their blue is rebuilt from red and green,
+     *        which loses no more than 8 bit quantization does.
+     *
+     * @param texels : texelCount * 4 bytes
+     * @param texelCount : number of texels
+     * @param usage : what texels hold
+     */
+    ImageChannelLayout AnalyzeImageChannels(const uint8_t* texels, size_t texelCount, ImageUsage usage);
+
+    /**
+     * @brief Copy channels of a layout out of a tightly packed 8 bit rgba image.
+     *
+     * @param texels : texelCount * 4 bytes
+     * @param texelCount : number of texels
+     * @param layout : layout to pack to
+     * @param destination : receives texelCount * GetChannelLayoutSize(layout) bytes
+     */
+    void PackImageChannels(const uint8_t* texels, size_t texelCount, ImageChannelLayout layout, uint8_t* destination);
+
+}
+
+#endif//GAMEZERO_UTILS_IMAGE_HPP
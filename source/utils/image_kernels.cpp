@@ -0,0 +1,260 @@
+#include "image_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// paths are picked at compile time, sse2 is always there on x64, ssse3 and avx2 need GAMEZERO_NATIVE_ARCH
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GAMEZERO_IMAGE_SSE2 1
+#endif
+#if defined(__SSSE3__) || defined(__AVX2__)
+    #include <tmmintrin.h>
+    #define GAMEZERO_IMAGE_SSSE3 1
+#endif
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define GAMEZERO_IMAGE_AVX2 1
+#endif
+
+using namespace GameZero;
+
+GameZero::SrgbTables::SrgbTables(){
+    for(uint32_t i = 0; i < 256; i++){
+        float s = i / 255.0f;
+        toLinear[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+    }
+    for(uint32_t i = 0; i <= LinearToSrgbSize; i++){
+        float l = float(i) / LinearToSrgbSize;
+        float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+        toSrgb[i] = uint8_t(std::lround(s * 255.0f));
+    }
+    // only 256 values and 256 alphas, so every pair is looked up instead of computed
+    for(uint32_t a = 0; a < 256; a++){
+        for(uint32_t i = 0; i < 256; i++){
+            toLinearPairSum[a * 256 + i] = uint16_t(std::lround(toLinear[a] * LinearFixedScale) + std::lround(toLinear[i] * LinearFixedScale));
+            premultiplied[a * 256 + i] = toSrgb[uint32_t(toLinear[i] * (a * (1.f / 255.f)) * float(LinearToSrgbSize) + 0.5f)];
+        }
+    }
+}
+
+// linear to sRGB table index of a sum of four fixed point linear values, round(sum / 16)
+static uint32_t GetFixedSumSrgbIndex(uint32_t sum){
+    static_assert(LinearFixedScale * 4 <= 0xFFFF && (LinearFixedScale * 4 + 8) / 16 == LinearToSrgbSize, "fixed point sums must fit 16 bits and map onto linear to sRGB table");
+    return (sum + 8) >> 4;
+}
+
+const SrgbTables& GameZero::GetSrgbTables(){
+    static const SrgbTables tables;
+    return tables;
+}
+
+const char* GameZero::GetImageKernelTarget(){
+#if defined(GAMEZERO_IMAGE_AVX2)
+    return "avx2";
+#elif defined(GAMEZERO_IMAGE_SSSE3)
+    return "ssse3";
+#elif defined(GAMEZERO_IMAGE_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void GameZero::ExpandToRgba(const uint8_t* source, size_t texelCount, uint32_t channelCount, uint8_t* destination){
+    size_t i = 0;
+    switch(channelCount){
+        case 1:
+#if defined(GAMEZERO_IMAGE_SSE2)
+            // 16 texels a step, gray byte doubled twice fills red, green and blue
+            for(const __m128i alpha = _mm_set1_epi32(int32_t(0xFF000000)); i + 16 <= texelCount; i += 16){
+                __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+                __m128i low = _mm_unpacklo_epi8(gray, gray), high = _mm_unpackhi_epi8(gray, gray);
+                __m128i* out = reinterpret_cast<__m128i*>(destination + i * 4);
+                _mm_storeu_si128(out, _mm_or_si128(_mm_unpacklo_epi16(low, low), alpha));
+                _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(low, low), alpha));
+                _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(high, high), alpha));
+                _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(high, high), alpha));
+            }
+#endif
+            for(; i < texelCount; i++){
+                uint8_t* out = destination + i * 4;
+                out[0] = out[1] = out[2] = source[i];
+                out[3] = 255;
+            }
+            break;
+        case 2:
+#if defined(GAMEZERO_IMAGE_SSE2)
+            // 8 texels a step, doubled gray interleaved with gray and alpha pairs
+            for(const __m128i grayMask = _mm_set1_epi16(0xFF); i + 8 <= texelCount; i += 8){
+                __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+                __m128i gray = _mm_or_si128(_mm_and_si128(texels, grayMask), _mm_slli_epi16(texels, 8));
+                __m128i* out = reinterpret_cast<__m128i*>(destination + i * 4);
+                _mm_storeu_si128(out, _mm_unpacklo_epi16(gray, texels));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gray, texels));
+            }
+#endif
+            for(; i < texelCount; i++){
+                uint8_t* out = destination + i * 4;
+                out[0] = out[1] = out[2] = source[i * 2];
+                out[3] = source[i * 2 + 1];
+            }
+            break;
+        case 3:
+#if defined(GAMEZERO_IMAGE_AVX2)
+            // 8 texels a step from two overlapping loads, each lane shuffles 12 bytes to 16
+            for(const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                         0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+                               alpha = _mm256_set1_epi32(int32_t(0xFF000000)); i + 10 <= texelCount; i += 8){
+                __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+                __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 12));
+                __m256i texels = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(texels, shuffle), alpha));
+            }
+#elif defined(GAMEZERO_IMAGE_SSSE3)
+            // 4 texels a step, load reads 4 bytes past them
+            for(const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+                              alpha = _mm_set1_epi32(int32_t(0xFF000000)); i + 6 <= texelCount; i += 4){
+                __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(_mm_shuffle_epi8(texels, shuffle), alpha));
+            }
+#endif
+            for(; i < texelCount; i++){
+                uint8_t* out = destination + i * 4;
+                out[0] = source[i * 3];
+                out[1] = source[i * 3 + 1];
+                out[2] = source[i * 3 + 2];
+                out[3] = 255;
+            }
+            break;
+        default:
+            std::memcpy(destination, source, texelCount * 4);
+            break;
+    }
+}
+
+// one filtered texel from texels x0 and x1 of both rows, sRGB colors are averaged in fixed point like the simd path
+static void DownsampleTexel(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* out, bool srgb, const SrgbTables& tables){
+    for(uint32_t c = 0; c < 3; c++){
+        if(srgb){
+            uint32_t sum = tables.toLinearPairSum[row0[x0 + c] << 8 | row1[x0 + c]] + tables.toLinearPairSum[row0[x1 + c] << 8 | row1[x1 + c]];
+            out[c] = tables.toSrgb[GetFixedSumSrgbIndex(sum)];
+        }else{
+            out[c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+        }
+    }
+    out[3] = uint8_t((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) / 4);
+}
+
+#if defined(GAMEZERO_IMAGE_SSE2)
+// sums of channels of 2 horizontal texel pairs of both rows, 16 bit lanes, first pair low
+static __m128i SumTexelPairs(const uint8_t* row0, const uint8_t* row1){
+    const __m128i zero = _mm_setzero_si128();
+    __m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+    __m128i lower = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+    __m128i first = _mm_add_epi16(_mm_unpacklo_epi8(upper, zero), _mm_unpacklo_epi8(lower, zero));
+    __m128i second = _mm_add_epi16(_mm_unpackhi_epi8(upper, zero), _mm_unpackhi_epi8(lower, zero));
+    first = _mm_add_epi16(first, _mm_srli_si128(first, 8));
+    second = _mm_add_epi16(second, _mm_srli_si128(second, 8));
+    return _mm_unpacklo_epi64(first, second);
+}
+
+// vertical pair sums of red, green and blue of texels 0 and 2 or 1 and 3 of 4 texels, 16 bit lanes, alpha lanes are zero
+// pairs holds upper row byte over lower row byte of 2 texels of each row
+template<int First>
+static __m128i LookupLinearPairSums(__m128i pairs01, __m128i pairs23, const uint16_t* toLinearPairSum){
+    return _mm_setr_epi16(
+        int16_t(toLinearPairSum[_mm_extract_epi16(pairs01, First + 0)]), int16_t(toLinearPairSum[_mm_extract_epi16(pairs01, First + 1)]),
+        int16_t(toLinearPairSum[_mm_extract_epi16(pairs01, First + 2)]), 0,
+        int16_t(toLinearPairSum[_mm_extract_epi16(pairs23, First + 0)]), int16_t(toLinearPairSum[_mm_extract_epi16(pairs23, First + 1)]),
+        int16_t(toLinearPairSum[_mm_extract_epi16(pairs23, First + 2)]), 0);
+}
+
+// write sRGB colors of 2 filtered texels from 2 horizontal texel pairs of both rows, alpha is left as it is
+static void DownsampleSrgbPair(const uint8_t* row0, const uint8_t* row1, uint8_t* out, const SrgbTables& tables){
+    __m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+    __m128i lower = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+    // each 16 bit lane indexes pair sum table with same channel of a texel in both rows
+    __m128i pairs01 = _mm_unpacklo_epi8(lower, upper), pairs23 = _mm_unpackhi_epi8(lower, upper);
+    __m128i sum = _mm_add_epi16(LookupLinearPairSums<0>(pairs01, pairs23, tables.toLinearPairSum), LookupLinearPairSums<4>(pairs01, pairs23, tables.toLinearPairSum));
+    // round(sum / 16) as (sum / 8 + 1) / 2, sums use all 16 bits so adding 8 first could overflow
+    __m128i index = _mm_avg_epu16(_mm_srli_epi16(sum, 3), _mm_setzero_si128());
+
+    out[0] = tables.toSrgb[_mm_extract_epi16(index, 0)];
+    out[1] = tables.toSrgb[_mm_extract_epi16(index, 1)];
+    out[2] = tables.toSrgb[_mm_extract_epi16(index, 2)];
+    out[4] = tables.toSrgb[_mm_extract_epi16(index, 4)];
+    out[5] = tables.toSrgb[_mm_extract_epi16(index, 5)];
+    out[6] = tables.toSrgb[_mm_extract_epi16(index, 6)];
+}
+#endif
+
+void GameZero::DownsampleRow(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* destination, bool srgb){
+    const SrgbTables& tables = GetSrgbTables();
+    // texels whose pair lies fully inside row, last one of odd widths is dropped
+    uint32_t pairCount = width / 2;
+    uint32_t x = 0;
+
+#if defined(GAMEZERO_IMAGE_SSE2)
+    // 4 texels a step, (a + b + c + d + 2) / 4 in 16 bit lanes is exact
+    // sRGB colors are then replaced by ones averaged in linear space, from table lookups of two samples at once
+    const __m128i two = _mm_set1_epi16(2);
+    for(; x + 4 <= pairCount; x += 4){
+        __m128i first = _mm_srli_epi16(_mm_add_epi16(SumTexelPairs(row0 + x * 8, row1 + x * 8), two), 2);
+        __m128i second = _mm_srli_epi16(_mm_add_epi16(SumTexelPairs(row0 + x * 8 + 16, row1 + x * 8 + 16), two), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x * 4), _mm_packus_epi16(first, second));
+        if(srgb){
+            DownsampleSrgbPair(row0 + x * 8, row1 + x * 8, destination + x * 4, tables);
+            DownsampleSrgbPair(row0 + x * 8 + 16, row1 + x * 8 + 16, destination + x * 4 + 8, tables);
+        }
+    }
+#endif
+
+    uint32_t levelWidth = width > 1 ? width / 2 : 1;
+    for(; x < levelWidth; x++){
+        uint32_t x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+        DownsampleTexel(row0, row1, x0, x1, destination + x * 4, srgb, tables);
+    }
+}
+
+void GameZero::PremultiplyAlpha(uint8_t* texels, size_t texelCount, bool srgb){
+    const SrgbTables& tables = GetSrgbTables();
+    size_t i = 0;
+
+    // one lookup per color, table holds every alpha and value pair
+    if(srgb){
+        for(; i < texelCount; i++){
+            uint8_t* texel = texels + i * 4;
+            const uint8_t* premultiplied = tables.premultiplied + texel[3] * 256;
+            texel[0] = premultiplied[texel[0]];
+            texel[1] = premultiplied[texel[1]];
+            texel[2] = premultiplied[texel[2]];
+        }
+        return;
+    }
+
+#if defined(GAMEZERO_IMAGE_SSE2)
+    // 4 texels a step in 16 bit lanes, alpha multiplies itself by 255 so it is kept
+    const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(128);
+    const __m128i colorMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0), opaque = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    auto premultiply = [&](__m128i channels){
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(channels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i product = _mm_add_epi16(_mm_mullo_epi16(channels, _mm_or_si128(_mm_and_si128(alpha, colorMask), opaque)), round);
+        return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+    };
+    for(; i + 4 <= texelCount; i += 4){
+        __m128i* block = reinterpret_cast<__m128i*>(texels + i * 4);
+        __m128i channels = _mm_loadu_si128(block);
+        _mm_storeu_si128(block, _mm_packus_epi16(premultiply(_mm_unpacklo_epi8(channels, zero)), premultiply(_mm_unpackhi_epi8(channels, zero))));
+    }
+#endif
+    // exact c * a / 255 rounded to nearest
+    for(; i < texelCount; i++){
+        uint8_t* texel = texels + i * 4;
+        for(uint32_t c = 0; c < 3; c++){
+            uint32_t product = uint32_t(texel[c]) * texel[3] + 128;
+            texel[c] = uint8_t((product + (product >> 8)) >> 8);
+        }
+    }
+}
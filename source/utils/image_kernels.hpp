@@ -0,0 +1,69 @@
+#ifndef GAMEZERO_UTILS_IMAGE_KERNELS_HPP
+#define GAMEZERO_UTILS_IMAGE_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GameZero{
+
+    /// linear to sRGB table is sampled finely enough that dark values still round correctly
+    constexpr static uint32_t LinearToSrgbSize = 4096;
+    /// scale of 16 bit linear values, four of them add up without overflowing
+    constexpr static uint32_t LinearFixedScale = 16383;
+
+    /// conversion tables between sRGB and linear, built on first use
+    struct SrgbTables{
+        float toLinear[256];
+        /// sum of linear values of two sRGB values, each times LinearFixedScale and rounded, indexed by first * 256 + second
+        /// so that box filters look up two samples at once and sum them in 16 bit lanes
+        uint16_t toLinearPairSum[256 * 256];
+        /// indexed by linear value times LinearToSrgbSize, rounded
+        uint8_t toSrgb[LinearToSrgbSize + 1];
+        /// sRGB value multiplied by alpha in linear space, indexed by alpha * 256 + value
+        uint8_t premultiplied[256 * 256];
+
+        SrgbTables();
+    };
+
+    const SrgbTables& GetSrgbTables();
+
+    /// instruction set image kernels were compiled for, "avx2", "ssse3", "sse2" or "scalar"
+    /// kernels pick their path at compile time, build with GAMEZERO_NATIVE_ARCH for avx2
+    const char* GetImageKernelTarget();
+
+    /**
+     * @brief Widen tightly packed 8 bit texels of 1 to 4 channels to rgba, the way stb_image does.
+     *        Gray is copied to red, green and blue, missing alpha is opaque.
+     *
+     * @param source : texelCount * channelCount bytes
+     * @param texelCount : number of texels
+     * @param channelCount : 1 gray, 2 gray and alpha, 3 rgb, 4 rgba
+     * @param destination : receives texelCount * 4 bytes, must not overlap source
+     */
+    void ExpandToRgba(const uint8_t* source, size_t texelCount, uint32_t channelCount, uint8_t* destination);
+
+    /**
+     * @brief Filter one row of a halved 8 bit rgba image from two source rows with a 2x2 box,
+     *        sRGB colors are averaged in linear space, alpha is always linear.
+     *
+     * @param row0 : upper source row, width * 4 bytes
+     * @param row1 : lower source row, same as row0 when source has a single row
+     * @param width : source width in texels, odd widths drop their last texel and a width of 1 repeats it
+     * @param destination : receives GetDownsampledSize(width) * 4 bytes
+     * @param srgb : colors are sRGB encoded
+     */
+    void DownsampleRow(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* destination, bool srgb);
+
+    /**
+     * @brief Multiply colors of tightly packed 8 bit rgba texels by their alpha, in place.
+     *        sRGB colors are multiplied in linear space and encoded again.
+     *
+     * @param texels : texelCount * 4 bytes
+     * @param texelCount : number of texels
+     * @param srgb : colors are sRGB encoded
+     */
+    void PremultiplyAlpha(uint8_t* texels, size_t texelCount, bool srgb);
+
+}
+
+#endif//GAMEZERO_UTILS_IMAGE_KERNELS_HPP
@@ -0,0 +1,159 @@
+#include "ktx2.hpp"
+#include "../settings.hpp"
+#include "log.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace GameZero;
+
+/// identifier, header and index come before level index
+constexpr static size_t Ktx2LevelIndexOffset = sizeof(Ktx2Identifier) + 9 * sizeof(uint32_t) + 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+bool GameZero::ParseKtx2(const uint8_t* data, size_t size, Ktx2Image& image){
+    if(size < Ktx2LevelIndexOffset || memcmp(data, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0) return false;
+
+    // fields are read one by one, header struct has padding before 64 bit members on some abis
+    const uint8_t* p = data + sizeof(Ktx2Identifier);
+    auto read32 = [&p](uint32_t& value){ memcpy(&value, p, sizeof(value)); p += sizeof(value); };
+    auto read64 = [&p](uint64_t& value){ memcpy(&value, p, sizeof(value)); p += sizeof(value); };
+
+    Ktx2Header& header = image.header;
+    read32(header.vkFormat);
+    read32(header.typeSize);
+    read32(header.pixelWidth);
+    read32(header.pixelHeight);
+    read32(header.pixelDepth);
+    read32(header.layerCount);
+    read32(header.faceCount);
+    read32(header.levelCount);
+    read32(header.supercompressionScheme);
+    read32(header.dfdByteOffset);
+    read32(header.dfdByteLength);
+    read32(header.kvdByteOffset);
+    read32(header.kvdByteLength);
+    read64(header.sgdByteOffset);
+    read64(header.sgdByteLength);
+
+    if(header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1) return false;
+    if(header.layerCount > 1 || header.faceCount != 1) return false;
+    if(header.supercompressionScheme != 0){
+        LOG(WARNING, "KTX2 supercompression scheme %u is not supported", header.supercompressionScheme);
+        return false;
+    }
+
+    // level count 0 still stores level 0
+    uint32_t levelCount = header.levelCount ? header.levelCount : 1;
+    if(levelCount > 32 || (Ktx2LevelIndexOffset + levelCount * sizeof(Ktx2Level)) > size) return false;
+
+    image.levels.resize(levelCount);
+    for(Ktx2Level& level : image.levels){
+        read64(level.byteOffset);
+        read64(level.byteLength);
+        read64(level.uncompressedByteLength);
+        if(level.byteOffset > size || level.byteLength > size - level.byteOffset) return false;
+    }
+
+    image.data = data;
+    image.size = size;
+    return true;
+}
+
+std::vector<uint8_t> GameZero::BuildKtx2BlockDfd(uint8_t colorModel, bool srgb, uint8_t bytesPerBlock, const std::vector<Ktx2Sample>& samples, bool premultiplied){
+    // basic descriptor block is 24 bytes followed by 16 bytes per sample
+    uint32_t blockSize = 24 + 16 * uint32_t(samples.size());
+    uint32_t totalSize = 4 + blockSize;
+
+    std::vector<uint8_t> dfd(totalSize, 0);
+    uint8_t* p = dfd.data();
+    auto write32 = [&p](uint32_t value){ memcpy(p, &value, sizeof(value)); p += sizeof(value); };
+
+    write32(totalSize);
+    // vendor id and descriptor type are both 0 for khronos basic descriptor
+    write32(0);
+    // version 2 of data format specification
+    write32(2 | (blockSize << 16));
+    // color model, BT.709 primaries, transfer function and straight or premultiplied alpha
+    write32(colorModel | (1 << 8) | ((srgb ? 2u : 1u) << 16) | ((premultiplied ? 1u : 0u) << 24));
+    // texel block dimensions minus 1
+    write32(3 | (3 << 8));
+    write32(bytesPerBlock);
+    write32(0);
+
+    for(const Ktx2Sample& sample : samples){
+        write32(sample.bitOffset | (uint32_t(sample.bitLength) << 16) | (uint32_t(sample.channelType) << 24));
+        write32(0);
+        write32(0);
+        write32(UINT32_MAX);
+    }
+    return dfd;
+}
+
+bool GameZero::WriteKtx2(const char* filename, uint32_t vkFormat, uint32_t width, uint32_t height, const std::vector<uint8_t>& dfd,
+                         const std::vector<std::vector<uint8_t>>& levels, uint32_t levelAlignment){
+    uint32_t levelCount = uint32_t(levels.size());
+    uint32_t dfdOffset = uint32_t(Ktx2LevelIndexOffset + levelCount * sizeof(Ktx2Level));
+
+    // levels are stored smallest first, so that streaming can start with low resolution data
+    std::vector<Ktx2Level> index(levelCount);
+    uint64_t offset = dfdOffset + dfd.size();
+    for(uint32_t i = levelCount; i-- > 0;){
+        offset = (offset + levelAlignment - 1) / levelAlignment * levelAlignment;
+        index[i].byteOffset = offset;
+        index[i].byteLength = levels[i].size();
+        index[i].uncompressedByteLength = levels[i].size();
+        offset += levels[i].size();
+    }
+
+    std::string tempPath = std::string(filename) + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){
+        LOG(WARNING, "Failed to write KTX2 file [ %s ]", filename);
+        return false;
+    }
+
+    auto write32 = [&file](uint32_t value){ file.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+    auto write64 = [&file](uint64_t value){ file.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+    file.write(reinterpret_cast<const char*>(Ktx2Identifier), sizeof(Ktx2Identifier));
+    write32(vkFormat);
+    // block compressed data has no endianness
+    write32(1);
+    write32(width);
+    write32(height);
+    write32(0);
+    write32(0);
+    write32(1);
+    write32(levelCount);
+    write32(0);
+    write32(dfdOffset);
+    write32(uint32_t(dfd.size()));
+    write32(0);
+    write32(0);
+    write64(0);
+    write64(0);
+    for(const Ktx2Level& level : index){
+        write64(level.byteOffset);
+        write64(level.byteLength);
+        write64(level.uncompressedByteLength);
+    }
+    file.write(reinterpret_cast<const char*>(dfd.data()), dfd.size());
+
+    const std::vector<char> padding(levelAlignment, 0);
+    uint64_t written = dfdOffset + dfd.size();
+    for(uint32_t i = levelCount; i-- > 0;){
+        file.write(padding.data(), index[i].byteOffset - written);
+        file.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+        written = index[i].byteOffset + levels[i].size();
+    }
+
+    file.close();
+    if(!file || std::rename(tempPath.c_str(), filename) != 0){
+        LOG(WARNING, "Failed to write KTX2 file [ %s ]", filename);
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef GAMEZERO_UTILS_KTX2_HPP
+#define GAMEZERO_UTILS_KTX2_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GameZero{
+
+    /// first 12 bytes of every KTX2 file
+    constexpr static uint8_t Ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    /// fixed size header that follows identifier, all fields little endian
+    struct Ktx2Header{
+        /// VkFormat of texel data
+        uint32_t vkFormat;
+        /// size of data type for endian conversion, 1 for block compressed formats
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        /// 0 asks loader to generate mips from level 0
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+
+        /// data format descriptor, key value data and supercompression global data
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    /// where one mip level lives in file
+    struct Ktx2Level{
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    /// 2D KTX2 image parsed in place, level data points into parsed bytes
+    struct Ktx2Image{
+        Ktx2Header header;
+        /// level 0 is full size, as many levels as image stores
+        std::vector<Ktx2Level> levels;
+        /// whole file
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+
+        uint32_t GetLevelWidth(uint32_t level) const{ return header.pixelWidth >> level ? header.pixelWidth >> level : 1; }
+        uint32_t GetLevelHeight(uint32_t level) const{ return header.pixelHeight >> level ? header.pixelHeight >> level : 1; }
+        const uint8_t* GetLevelData(uint32_t level) const{ return data + levels[level].byteOffset; }
+    };
+
+    /**
+     * @brief Parse a KTX2 file already in memory, without copying level data.
+     *        Only single 2D images without supercompression are accepted,
+     *        which is what texture loading and texture baker produce and consume.
+     *
+     * @param data : file contents, must outlive image
+     * @param size : size of file in bytes
+     * @param image : receives header and level index
+     * @return false if file is not a KTX2 file, is truncated or holds something other than a 2D image
+     */
+    bool ParseKtx2(const uint8_t* data, size_t size, Ktx2Image& image);
+
+    /// one sample of a data format descriptor, tells which bits of a texel block hold which channel
+    struct Ktx2Sample{
+        uint16_t bitOffset;
+        /// number of bits minus 1
+        uint8_t bitLength;
+        /// channel id of color model in low 4 bits, qualifiers in high 4 bits
+        uint8_t channelType;
+    };
+
+    /**
+     * @brief Build basic data format descriptor of a 4x4 block compressed format,
+     *        including leading total size that KTX2 stores before descriptor blocks.
+     *
+     * @param colorModel : khronos data format color model, 128 is BC1, 130 is BC3 and 134 is BC7
+     * @param srgb : true for sRGB transfer function, linear otherwise
+     * @param bytesPerBlock : bytes of one 4x4 block
+     * @param samples : samples of a block
+     * @param premultiplied : colors are multiplied by alpha
+     * @return descriptor ready to be written to file
+     */
+    std::vector<uint8_t> BuildKtx2BlockDfd(uint8_t colorModel, bool srgb, uint8_t bytesPerBlock, const std::vector<Ktx2Sample>& samples, bool premultiplied = false);
+
+    /**
+     * @brief Write a 2D KTX2 file without supercompression or key value data.
+     *        Written to a temporary file first and renamed, so a failed bake never leaves a broken file.
+     *
+     * @param filename : path of file to write
+     * @param vkFormat : VkFormat of level data
+     * @param width : width of level 0
+     * @param height : height of level 0
+     * @param dfd : data format descriptor from BuildKtx2BlockDfd
+     * @param levels : data of every level, level 0 first
+     * @param levelAlignment : offset of every level is a multiple of this, least common multiple of block size and 4
+     * @return false if file could not be written
+     */
+    bool WriteKtx2(const char* filename, uint32_t vkFormat, uint32_t width, uint32_t height, const std::vector<uint8_t>& dfd,
+                   const std::vector<std::vector<uint8_t>>& levels, uint32_t levelAlignment);
+
+}
+
+#endif//GAMEZERO_UTILS_KTX2_HPP
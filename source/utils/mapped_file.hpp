@@ -0,0 +1,108 @@
+#ifndef GAMEZERO_UTILS_MAPPED_FILE_HPP
+#define GAMEZERO_UTILS_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../settings.hpp"
+#include "log.hpp"
+
+namespace GameZero{
+
+    /// size and last modification time of a file on disk
+    struct FileInfo{
+        uint64_t size = 0;
+        /// modification time in nanoseconds
+        int64_t modifiedTime = 0;
+    };
+
+    /**
+     * @brief Get size and modification time of a file
+     * 
+     * @param filename : file to query
+     * @param info : filled with file info on success
+     * @return true if file exists
+     */
+    [[nodiscard]] inline bool GetFileInfo(const char* filename, FileInfo& info){
+        struct stat st;
+        if(stat(filename, &st) != 0) return false;
+
+        info.size = static_cast<uint64_t>(st.st_size);
+        info.modifiedTime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000ll + st.st_mtim.tv_nsec;
+        return true;
+    }
+
+    /**
+     * @brief Read only memory mapped file.
+     *        File stays mapped until Close() is called or object is destroyed.
+     */
+    class MappedFile{
+    public:
+        MappedFile() = default;
+        ~MappedFile(){ Close(); }
+
+        // mapping is owned by only one object
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        /// mapped bytes
+        const uint8_t* data = nullptr;
+        /// number of mapped bytes
+        size_t size = 0;
+
+        /**
+         * @brief Map a file into memory for reading
+         * 
+         * @param filename : file to map
+         * @return true on success
+         */
+        [[nodiscard]] bool Open(const char* filename){
+            Close();
+
+            int fd = open(filename, O_RDONLY);
+            if(fd < 0) return false;
+
+            struct stat st;
+            if(fstat(fd, &st) != 0 || st.st_size == 0){
+                close(fd);
+                return false;
+            }
+
+            void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            // mapping keeps its own reference to file
+            close(fd);
+
+            if(mapping == MAP_FAILED){
+                LOG(ERROR, "Failed to map file [ %s ]", filename);
+                return false;
+            }
+
+            data = static_cast<const uint8_t*>(mapping);
+            size = static_cast<size_t>(st.st_size);
+            return true;
+        }
+
+        /// unmap file if mapped
+        void Close(){
+            if(data) munmap(const_cast<uint8_t*>(data), size);
+            data = nullptr;
+            size = 0;
+        }
+
+        /// hint kernel that whole file will be read sequentially, and soon
+        /// advice values are not flags, so each one is given on its own
+        void PrefetchSequential() const{
+            if(!data) return;
+            madvise(const_cast<uint8_t*>(data), size, MADV_SEQUENTIAL);
+            madvise(const_cast<uint8_t*>(data), size, MADV_WILLNEED);
+        }
+    };
+
+}
+
+#endif//GAMEZERO_UTILS_MAPPED_FILE_HPP
@@ -0,0 +1,532 @@
+#include "obj_parser.hpp"
+#include "../settings.hpp"
+#include "log.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+using namespace GameZero;
+
+// marks a corner attribute that was not present in file
+constexpr static int32_t MissingIndex = INT32_MIN;
+
+// flags marking which attributes of a raw corner are chunk relative
+enum RelativeIndexFlags : uint32_t{
+    RelativePosition = 1 << 0,
+    RelativeNormal = 1 << 1,
+    RelativeTexcoord = 1 << 2
+};
+
+// corner before indices are made global
+// negative obj indices count back from attributes seen so far, which
+// depends on previous chunks, so they are stored chunk relative and
+// fixed up once all chunks are parsed
+struct RawObjIndex{
+    int32_t position;
+    int32_t normal;
+    int32_t texcoord;
+    uint32_t relative;
+};
+
+// results of parsing one chunk of file
+struct ObjChunk{
+    const char* begin;
+    const char* end;
+
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+
+    /// number of corners of each polygon
+    std::vector<uint32_t> faceSizes;
+    /// corners of all polygons
+    std::vector<RawObjIndex> corners;
+    /// number of corners after triangulation
+    size_t triangulatedCornerCount = 0;
+
+    /// usemtl names with number of triangulated corners before them in this chunk
+    std::vector<std::pair<size_t, std::string>> materialSwitches;
+    /// mtllib names, in file order
+    std::vector<std::string> materialLibraries;
+
+    /// attribute counts of all previous chunks
+    size_t positionBase = 0;
+    size_t normalBase = 0;
+    size_t texcoordBase = 0;
+    size_t indexBase = 0;
+
+    /// malformed or out of range data found
+    bool failed = false;
+};
+
+// exact powers of ten that fit in a double
+static const double PowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool IsDigit(char c){
+    return static_cast<unsigned>(c - '0') < 10;
+}
+
+static inline const char* SkipSpaces(const char* p, const char* end){
+    while(p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static inline const char* SkipLine(const char* p, const char* end){
+    const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+    return newline ? newline + 1 : end;
+}
+
+// rest of line without surrounding spaces, names can contain spaces
+static std::string ParseName(const char* p, const char* end){
+    p = SkipSpaces(p, end);
+    const char* nameEnd = p;
+    while(nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r') nameEnd++;
+    while(nameEnd > p && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t')) nameEnd--;
+    return std::string(p, nameEnd);
+}
+
+// check that line starts with a keyword followed by a space
+static inline bool IsKeyword(const char* p, const char* end, const char* keyword, size_t length){
+    return size_t(end - p) > length && memcmp(p, keyword, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+}
+
+// directory part of a path including trailing slash, empty for bare filenames
+static std::string GetDirectory(const char* filename){
+    std::string path(filename);
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// parse a float without locale or stream overhead
+// digits are accumulated in an integer and scaled once, which is exact
+// for the short decimal numbers that mesh exporters write
+static const char* ParseFloat(const char* p, const char* end, float& value){
+    p = SkipSpaces(p, end);
+
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')){
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    const char* start = p;
+
+    // integer part
+    for(; p < end && IsDigit(*p); p++){
+        if(digits < 19){
+            mantissa = mantissa * 10 + (*p - '0');
+            // leading zeros are not significant
+            if(mantissa) digits++;
+        }else{
+            exponent++;
+        }
+    }
+
+    // fraction part
+    if(p < end && *p == '.'){
+        for(p++; p < end && IsDigit(*p); p++){
+            if(digits < 19){
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa) digits++;
+                exponent--;
+            }
+        }
+    }
+
+    // not a number
+    if(p == start){
+        value = 0.f;
+        return p;
+    }
+
+    // exponent part
+    if(p < end && (*p == 'e' || *p == 'E')){
+        p++;
+        bool negativeExponent = false;
+        if(p < end && (*p == '-' || *p == '+')){
+            negativeExponent = *p == '-';
+            p++;
+        }
+
+        int explicitExponent = 0;
+        for(; p < end && IsDigit(*p); p++){
+            if(explicitExponent < 10000) explicitExponent = explicitExponent * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    double result = static_cast<double>(mantissa);
+    if(exponent < 0){
+        result = -exponent <= 22 ? result / PowersOfTen[-exponent] : result * std::pow(10.0, exponent);
+    }else if(exponent > 0){
+        result = exponent <= 22 ? result * PowersOfTen[exponent] : result * std::pow(10.0, exponent);
+    }
+
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+// parse an obj index, store MissingIndex if there is none
+static const char* ParseIndex(const char* p, const char* end, int32_t& index){
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')){
+        negative = *p == '-';
+        p++;
+    }
+
+    if(p >= end || !IsDigit(*p)){
+        index = MissingIndex;
+        return p;
+    }
+
+    int64_t value = 0;
+    for(; p < end && IsDigit(*p); p++){
+        if(value < INT32_MAX) value = value * 10 + (*p - '0');
+    }
+
+    if(value > INT32_MAX) value = INT32_MAX;
+    index = static_cast<int32_t>(negative ? -value : value);
+    return p;
+}
+
+// parse a number of floats on a line into given array
+static const char* ParseFloats(const char* p, const char* end, std::vector<float>& values, int count){
+    for(int i = 0; i < count; i++){
+        float value;
+        p = ParseFloat(p, end, value);
+        values.push_back(value);
+    }
+    return p;
+}
+
+// obj indices are 1 based, negative indices count back from attributes seen so far
+// positive indices become 0 based, negative indices become chunk relative
+static inline int32_t ToChunkIndex(int32_t index, size_t chunkCount, uint32_t flag, uint32_t& relative){
+    if(index == MissingIndex || index == 0) return MissingIndex;
+    if(index > 0) return index - 1;
+
+    relative |= flag;
+    return static_cast<int32_t>(chunkCount) + index;
+}
+
+// make a chunk index global and check that it is in range
+// missing attributes become -1, out of range attributes fail
+static inline bool ResolveIndex(int32_t& index, bool relative, size_t base, size_t count){
+    if(index == MissingIndex){
+        index = -1;
+        return true;
+    }
+
+    int64_t global = relative ? static_cast<int64_t>(base) + index : index;
+    if(global < 0 || global >= static_cast<int64_t>(count)) return false;
+
+    index = static_cast<int32_t>(global);
+    return true;
+}
+
+// squared distance between two positions
+static inline float DistanceSquared(const std::vector<float>& positions, int32_t a, int32_t b){
+    float dx = positions[3 * b + 0] - positions[3 * a + 0];
+    float dy = positions[3 * b + 1] - positions[3 * a + 1];
+    float dz = positions[3 * b + 2] - positions[3 * a + 2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// parse one chunk of lines
+static void ParseChunk(ObjChunk& chunk){
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+
+    // these are rough guesses to avoid most reallocations
+    size_t estimatedLines = (end - p) / 24;
+    chunk.positions.reserve(estimatedLines);
+    chunk.corners.reserve(estimatedLines);
+
+    while(p < end){
+        p = SkipSpaces(p, end);
+        if(p >= end) break;
+
+        if(p[0] == 'v' && p + 1 < end){
+            if(p[1] == ' ' || p[1] == '\t'){
+                // position, extra components (w or vertex color) are ignored
+                ParseFloats(p + 1, end, chunk.positions, 3);
+            }else if(p[1] == 'n'){
+                ParseFloats(p + 2, end, chunk.normals, 3);
+            }else if(p[1] == 't'){
+                ParseFloats(p + 2, end, chunk.texcoords, 2);
+            }
+        }else if(IsKeyword(p, end, "usemtl", 6)){
+            chunk.materialSwitches.emplace_back(chunk.triangulatedCornerCount, ParseName(p + 6, end));
+        }else if(IsKeyword(p, end, "mtllib", 6)){
+            chunk.materialLibraries.push_back(ParseName(p + 6, end));
+        }else if(p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')){
+            p++;
+
+            // counts seen so far in this chunk, for negative indices
+            size_t positionCount = chunk.positions.size() / 3;
+            size_t normalCount = chunk.normals.size() / 3;
+            size_t texcoordCount = chunk.texcoords.size() / 2;
+
+            uint32_t faceSize = 0;
+            for(;;){
+                p = SkipSpaces(p, end);
+                if(p >= end || *p == '\n' || *p == '\r' || *p == '#') break;
+
+                RawObjIndex corner = {MissingIndex, MissingIndex, MissingIndex, 0};
+                const char* cornerStart = p;
+
+                // v, v/vt, v//vn or v/vt/vn
+                p = ParseIndex(p, end, corner.position);
+                if(p < end && *p == '/'){
+                    p++;
+                    if(p < end && *p != '/') p = ParseIndex(p, end, corner.texcoord);
+                    if(p < end && *p == '/') p = ParseIndex(p + 1, end, corner.normal);
+                }
+
+                // garbage in face, skip rest of the line
+                if(p == cornerStart || corner.position == MissingIndex){
+                    chunk.failed = true;
+                    break;
+                }
+
+                corner.position = ToChunkIndex(corner.position, positionCount, RelativePosition, corner.relative);
+                corner.normal = ToChunkIndex(corner.normal, normalCount, RelativeNormal, corner.relative);
+                corner.texcoord = ToChunkIndex(corner.texcoord, texcoordCount, RelativeTexcoord, corner.relative);
+
+                chunk.corners.push_back(corner);
+                faceSize++;
+            }
+
+            // faces must have at least 3 corners
+            if(faceSize < 3){
+                chunk.corners.resize(chunk.corners.size() - faceSize);
+            }else{
+                chunk.faceSizes.push_back(faceSize);
+                chunk.triangulatedCornerCount += 3 * (faceSize - 2);
+            }
+        }
+
+        p = SkipLine(p, end);
+    }
+}
+
+bool GameZero::ParseOBJ(const char* filename, ObjData& data, uint32_t threadCount){
+    MappedFile file;
+    if(!file.Open(filename)){
+        LOG(ERROR, "Failed to open OBJ file [ %s ]", filename);
+        return false;
+    }
+    file.PrefetchSequential();
+
+    const char* begin = reinterpret_cast<const char*>(file.data);
+    const char* end = begin + file.size;
+
+    // split file into chunks at line boundaries
+    // more chunks than threads keeps all threads busy till the end
+    if(threadCount == 0) threadCount = GetWorkerThreadCount();
+    constexpr size_t MinChunkSize = 256 * 1024;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount * 4, file.size / MinChunkSize));
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* chunkBegin = begin;
+    for(size_t i = 0; i < chunkCount; i++){
+        const char* chunkEnd = end;
+        if(i + 1 < chunkCount){
+            chunkEnd = begin + file.size * (i + 1) / chunkCount;
+            chunkEnd = chunkEnd < chunkBegin ? chunkBegin : SkipLine(chunkEnd, end);
+        }
+
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    ParallelFor(chunkCount, [&](size_t i){ ParseChunk(chunks[i]); }, threadCount);
+
+    // chunk bases are running totals of previous chunks
+    size_t positionCount = 0, normalCount = 0, texcoordCount = 0, indexCount = 0;
+    for(ObjChunk& chunk : chunks){
+        if(chunk.failed){
+            LOG(WARNING, "OBJ file [ %s ] has malformed faces, they were skipped", filename);
+        }
+
+        chunk.positionBase = positionCount;
+        chunk.normalBase = normalCount;
+        chunk.texcoordBase = texcoordCount;
+        chunk.indexBase = indexCount;
+
+        positionCount += chunk.positions.size() / 3;
+        normalCount += chunk.normals.size() / 3;
+        texcoordCount += chunk.texcoords.size() / 2;
+        indexCount += chunk.triangulatedCornerCount;
+    }
+
+    data.positions.resize(positionCount * 3);
+    data.normals.resize(normalCount * 3);
+    data.texcoords.resize(texcoordCount * 2);
+    data.indices.resize(indexCount);
+
+    // attributes must be in place before triangulation can look at positions
+    ParallelFor(chunkCount, [&](size_t i){
+        ObjChunk& chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + chunk.positionBase * 3);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + chunk.normalBase * 3);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), data.texcoords.begin() + chunk.texcoordBase * 2);
+
+        // chunk data is not needed anymore
+        std::vector<float>().swap(chunk.positions);
+        std::vector<float>().swap(chunk.normals);
+        std::vector<float>().swap(chunk.texcoords);
+    }, threadCount);
+
+    std::atomic<bool> outOfRange{false};
+    ParallelFor(chunkCount, [&](size_t i){
+        ObjChunk& chunk = chunks[i];
+
+        ObjIndex* out = data.indices.data() + chunk.indexBase;
+        const RawObjIndex* corner = chunk.corners.data();
+        std::vector<ObjIndex> polygon;
+
+        for(uint32_t faceSize : chunk.faceSizes){
+            // resolve corners of this face
+            polygon.resize(faceSize);
+            for(uint32_t c = 0; c < faceSize; c++){
+                const RawObjIndex& raw = corner[c];
+                ObjIndex& index = polygon[c];
+
+                index.position = raw.position;
+                index.normal = raw.normal;
+                index.texcoord = raw.texcoord;
+
+                bool valid = ResolveIndex(index.position, raw.relative & RelativePosition, chunk.positionBase, positionCount) &&
+                             ResolveIndex(index.normal, raw.relative & RelativeNormal, chunk.normalBase, normalCount) &&
+                             ResolveIndex(index.texcoord, raw.relative & RelativeTexcoord, chunk.texcoordBase, texcoordCount);
+
+                // position is mandatory
+                if(!valid || index.position < 0){
+                    outOfRange = true;
+                    return;
+                }
+            }
+            corner += faceSize;
+
+            if(faceSize == 3){
+                *out++ = polygon[0];
+                *out++ = polygon[1];
+                *out++ = polygon[2];
+            }else if(faceSize == 4){
+                // split quad along its shorter diagonal, same as tinyobj
+                float d02 = DistanceSquared(data.positions, polygon[0].position, polygon[2].position);
+                float d13 = DistanceSquared(data.positions, polygon[1].position, polygon[3].position);
+
+                if(d02 < d13){
+                    *out++ = polygon[0]; *out++ = polygon[1]; *out++ = polygon[2];
+                    *out++ = polygon[0]; *out++ = polygon[2]; *out++ = polygon[3];
+                }else{
+                    *out++ = polygon[0]; *out++ = polygon[1]; *out++ = polygon[3];
+                    *out++ = polygon[1]; *out++ = polygon[2]; *out++ = polygon[3];
+                }
+            }else{
+                // triangle fan
+                for(uint32_t c = 1; c + 1 < faceSize; c++){
+                    *out++ = polygon[0];
+                    *out++ = polygon[c];
+                    *out++ = polygon[c + 1];
+                }
+            }
+        }
+    }, threadCount);
+
+    if(outOfRange){
+        LOG(ERROR, "OBJ file [ %s ] has faces with out of range indices", filename);
+        data = ObjData();
+        return false;
+    }
+
+    // material libraries are relative to obj file
+    std::string directory = GetDirectory(filename);
+    for(const ObjChunk& chunk : chunks){
+        for(const std::string& library : chunk.materialLibraries){
+            ParseMTL((directory + library).c_str(), data.materials);
+        }
+    }
+
+    std::unordered_map<std::string, int32_t> materialIndices;
+    for(size_t i = 0; i < data.materials.size(); i++){
+        materialIndices.emplace(data.materials[i].name, static_cast<int32_t>(i));
+    }
+
+    // usemtl switches become runs of corners, chunks are in file order
+    for(const ObjChunk& chunk : chunks){
+        for(const auto& [cornerOffset, name] : chunk.materialSwitches){
+            auto it = materialIndices.find(name);
+            if(it == materialIndices.end()){
+                LOG(WARNING, "OBJ file [ %s ] uses undefined material [ %s ]", filename, name.c_str());
+                it = materialIndices.emplace(name, static_cast<int32_t>(data.materials.size())).first;
+                data.materials.push_back({name, std::string()});
+            }
+
+            // faces before first usemtl have no material
+            size_t firstIndex = chunk.indexBase + cornerOffset;
+            if(data.materialRanges.empty() && firstIndex > 0){
+                data.materialRanges.push_back({0, -1});
+            }
+
+            // switch without faces in between replaces previous run
+            if(!data.materialRanges.empty() && data.materialRanges.back().firstIndex == firstIndex){
+                data.materialRanges.pop_back();
+            }
+
+            // same material again continues previous run
+            if(!data.materialRanges.empty() && data.materialRanges.back().material == it->second) continue;
+            data.materialRanges.push_back({firstIndex, it->second});
+        }
+    }
+
+    return true;
+}
+
+bool GameZero::ParseMTL(const char* filename, std::vector<ObjMaterial>& materials){
+    MappedFile file;
+    if(!file.Open(filename)){
+        LOG(ERROR, "Failed to open MTL file [ %s ]", filename);
+        return false;
+    }
+
+    const char* p = reinterpret_cast<const char*>(file.data);
+    const char* end = p + file.size;
+
+    // textures are relative to mtl file
+    std::string directory = GetDirectory(filename);
+    ObjMaterial* material = nullptr;
+
+    while(p < end){
+        p = SkipSpaces(p, end);
+        if(p >= end) break;
+
+        if(IsKeyword(p, end, "newmtl", 6)){
+            materials.push_back({ParseName(p + 6, end), std::string()});
+            material = &materials.back();
+        }else if(material && IsKeyword(p, end, "map_Kd", 6)){
+            // options such as -s or -o before texture name are not supported
+            material->diffuseTexture = directory + ParseName(p + 6, end);
+        }
+
+        p = SkipLine(p, end);
+    }
+
+    return true;
+}
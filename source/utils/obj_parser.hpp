@@ -0,0 +1,79 @@
+#ifndef GAMEZERO_UTILS_OBJ_PARSER_HPP
+#define GAMEZERO_UTILS_OBJ_PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace GameZero{
+
+    /// attribute indices of one face corner, 0 based. -1 means attribute is missing
+    struct ObjIndex{
+        int32_t position;
+        int32_t normal;
+        int32_t texcoord;
+    };
+
+    /// material from a mtl file, only what renderer uses is kept
+    struct ObjMaterial{
+        /// name used by usemtl
+        std::string name;
+        /// map_Kd path relative to working directory, empty if material has no diffuse texture
+        std::string diffuseTexture;
+    };
+
+    /// run of face corners using one material
+    struct ObjMaterialRange{
+        /// first face corner of run in ObjData::indices
+        size_t firstIndex;
+        /// index into ObjData::materials, -1 for faces before any usemtl
+        int32_t material;
+    };
+
+    /// raw contents of an obj file with all faces triangulated
+    struct ObjData{
+        /// 3 floats per position
+        std::vector<float> positions;
+        /// 3 floats per normal
+        std::vector<float> normals;
+        /// 2 floats per texcoord
+        std::vector<float> texcoords;
+
+        /// face corners, every 3 make a triangle, in file order
+        std::vector<ObjIndex> indices;
+
+        /// materials of all mtllib files, followed by materials used but not defined in them
+        std::vector<ObjMaterial> materials;
+        /// material runs in file order covering all indices, empty if file has no usemtl
+        std::vector<ObjMaterialRange> materialRanges;
+    };
+
+    /**
+     * @brief Parse an obj file using multiple threads.
+     *        File is memory mapped and split at line boundaries into chunks
+     *        which are parsed in parallel and merged in file order.
+     *        Triangles and quads are triangulated same way tinyobj does,
+     *        polygons with more corners are triangulated as fans.
+     *        Material libraries named by mtllib are parsed too.
+     *
+     * @param filename : obj file to parse
+     * @param data : parsed data
+     * @param threadCount : number of threads to use, 0 means one per core
+     * @return true on success
+     */
+    bool ParseOBJ(const char* filename, ObjData& data, uint32_t threadCount = 0);
+
+    /**
+     * @brief Parse a mtl file and append its materials.
+     *        Texture paths are made relative to working directory.
+     *
+     * @param filename : mtl file to parse
+     * @param materials : materials are appended here
+     * @return true on success
+     */
+    bool ParseMTL(const char* filename, std::vector<ObjMaterial>& materials);
+
+}
+
+#endif//GAMEZERO_UTILS_OBJ_PARSER_HPP
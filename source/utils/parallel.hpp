@@ -0,0 +1,56 @@
+#ifndef GAMEZERO_UTILS_PARALLEL_HPP
+#define GAMEZERO_UTILS_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace GameZero{
+
+    /// number of threads to use for parallel work, never zero
+    inline uint32_t GetWorkerThreadCount() noexcept{
+        uint32_t count = std::thread::hardware_concurrency();
+        return count ? count : 1;
+    }
+
+    /**
+     * @brief Call function(i) for every i in [0, count) using multiple threads.
+     *        Items are handed out one at a time so uneven items balance themselves.
+     *        Calling thread also does work and returns only when all items are done.
+     * 
+     * @param count : number of items
+     * @param function : called once per item with item index
+     * @param threadCount : number of threads to use, 0 means one per core
+     */
+    template<typename Function>
+    inline void ParallelFor(size_t count, Function&& function, uint32_t threadCount = 0){
+        if(threadCount == 0) threadCount = GetWorkerThreadCount();
+        threadCount = static_cast<uint32_t>(std::min<size_t>(threadCount, count));
+
+        // not worth spawning threads
+        if(threadCount <= 1){
+            for(size_t i = 0; i < count; i++) function(i);
+            return;
+        }
+
+        std::atomic<size_t> nextItem{0};
+        auto worker = [&](){
+            for(size_t i = nextItem.fetch_add(1); i < count; i = nextItem.fetch_add(1)){
+                function(i);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for(uint32_t t = 1; t < threadCount; t++) threads.emplace_back(worker);
+
+        worker();
+        for(std::thread& thread : threads) thread.join();
+    }
+
+}
+
+#endif//GAMEZERO_UTILS_PARALLEL_HPP
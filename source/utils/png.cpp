@@ -0,0 +1,709 @@
+#include "png.hpp"
+#include "image_kernels.hpp"
+#include "../settings.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GAMEZERO_PNG_SSE2 1
+#endif
+
+using namespace GameZero;
+
+static uint32_t ReadBigEndian32(const uint8_t* p){
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+}
+
+bool GameZero::ParsePng(const uint8_t* data, size_t size, PngImage& image){
+    if(size < sizeof(PngSignature) || memcmp(data, PngSignature, sizeof(PngSignature)) != 0) return false;
+
+    image.dataChunks.clear();
+    bool hasHeader = false, hasTransparency = false;
+    uint8_t bitDepth = 0, interlace = 0;
+    uint32_t paletteSize = 0;
+
+    // chunk is length, type, payload and crc, crc is not checked just like stb_image does not
+    size_t offset = sizeof(PngSignature);
+    while(offset + 12 <= size){
+        uint32_t length = ReadBigEndian32(data + offset);
+        const uint8_t* type = data + offset + 4;
+        const uint8_t* payload = data + offset + 8;
+        if(length > size - offset - 12) return false;
+        offset += 12 + size_t(length);
+
+        if(memcmp(type, "IHDR", 4) == 0){
+            if(length < 13) return false;
+            image.width = ReadBigEndian32(payload);
+            image.height = ReadBigEndian32(payload + 4);
+            bitDepth = payload[8];
+            image.colorType = payload[9];
+            interlace = payload[12];
+            // only deflate compression and adaptive filtering exist
+            if(payload[10] != 0 || payload[11] != 0) return false;
+            hasHeader = true;
+        }else if(!hasHeader){
+            return false;
+        }else if(memcmp(type, "PLTE", 4) == 0){
+            if(length % 3 != 0 || length / 3 > 256) return false;
+            paletteSize = length / 3;
+            for(uint32_t i = 0; i < paletteSize; i++){
+                memcpy(image.palette + i * 4, payload + i * 3, 3);
+                image.palette[i * 4 + 3] = 255;
+            }
+        }else if(memcmp(type, "tRNS", 4) == 0){
+            hasTransparency = true;
+            if(image.colorType == 3){
+                if(length > paletteSize) return false;
+                for(uint32_t i = 0; i < length; i++) image.palette[i * 4 + 3] = payload[i];
+            }
+        }else if(memcmp(type, "IDAT", 4) == 0){
+            image.dataChunks.push_back({payload, length});
+        }else if(memcmp(type, "IEND", 4) == 0){
+            break;
+        }
+    }
+
+    if(!hasHeader || image.dataChunks.empty()) return false;
+    if(image.width == 0 || image.height == 0 || image.width > (1u << 24) || image.height > (1u << 24)) return false;
+    // 16 bit, low bit depth, interlaced and color keyed images are left to stb_image
+    if(bitDepth != 8 || interlace != 0) return false;
+    if(hasTransparency && (image.colorType == 0 || image.colorType == 2)) return false;
+
+    switch(image.colorType){
+        case 0: image.channelCount = 1; break;
+        case 2: image.channelCount = 3; break;
+        case 3:
+            if(paletteSize == 0) return false;
+            image.channelCount = hasTransparency ? 4 : 3;
+            break;
+        case 4: image.channelCount = 2; break;
+        case 6: image.channelCount = 4; break;
+        default: return false;
+    }
+    return true;
+}
+
+/// bits of a code looked up at once, longer codes are decoded bit by bit
+constexpr static uint32_t HuffmanFastBits = 11;
+
+// table entry holds value in bits 16 and up, kind in bits 8 and 9, number of extra bits in bits 4 to 7
+// and code length in bits 0 to 3, code length of 0 means code is longer than fast bits or not part of table
+constexpr static uint32_t EntryLiteral = 0 << 8;
+constexpr static uint32_t EntryLength = 1 << 8;
+constexpr static uint32_t EntryEnd = 2 << 8;
+constexpr static uint32_t EntryInvalid = 3 << 8;
+constexpr static uint32_t EntryKindMask = 3 << 8;
+
+/// canonical huffman code of a deflate block
+struct HuffmanTable{
+    uint32_t fast[1 << HuffmanFastBits];
+    /// number of codes of each length and symbols ordered by code, for codes longer than fast bits
+    uint16_t counts[16];
+    uint16_t symbols[288];
+    /// entry of each symbol, without code length
+    uint32_t entries[288];
+};
+
+/// what symbols of a table stand for
+enum class HuffmanAlphabet{
+    CodeLength,
+    LiteralLength,
+    Distance
+};
+
+static const uint16_t LengthBases[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LengthExtraBits[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DistanceBases[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                                           4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DistanceExtraBits[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t CodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// lengths and distances carry their base and extra bits, so that decoding them needs no second lookup
+static uint32_t GetSymbolEntry(HuffmanAlphabet alphabet, uint32_t symbol){
+    switch(alphabet){
+        case HuffmanAlphabet::CodeLength:
+            return symbol << 16;
+        case HuffmanAlphabet::LiteralLength:
+            if(symbol < 256) return symbol << 16 | EntryLiteral;
+            if(symbol == 256) return EntryEnd;
+            if(symbol < 286) return uint32_t(LengthBases[symbol - 257]) << 16 | uint32_t(LengthExtraBits[symbol - 257]) << 4 | EntryLength;
+            return EntryInvalid;
+        default:
+            if(symbol < 30) return uint32_t(DistanceBases[symbol]) << 16 | uint32_t(DistanceExtraBits[symbol]) << 4;
+            return EntryInvalid;
+    }
+}
+
+static uint32_t ReverseBits(uint32_t code, uint32_t length){
+    uint32_t reversed = 0;
+    for(uint32_t i = 0; i < length; i++, code >>= 1) reversed = reversed << 1 | (code & 1);
+    return reversed;
+}
+
+// false when lengths describe more codes than fit, incomplete codes are kept and fail when a missing code is read
+static bool BuildHuffmanTable(const uint8_t* lengths, uint32_t count, HuffmanAlphabet alphabet, HuffmanTable& table){
+    memset(table.counts, 0, sizeof(table.counts));
+    for(uint32_t i = 0; i < count; i++) table.counts[lengths[i]]++;
+    table.counts[0] = 0;
+
+    int32_t left = 1;
+    for(uint32_t length = 1; length < 16; length++){
+        left = left * 2 - table.counts[length];
+        if(left < 0) return false;
+    }
+
+    uint16_t offsets[16] = {};
+    for(uint32_t length = 1; length < 15; length++) offsets[length + 1] = offsets[length] + table.counts[length];
+    for(uint32_t symbol = 0; symbol < count; symbol++){
+        table.entries[symbol] = GetSymbolEntry(alphabet, symbol);
+        if(lengths[symbol]) table.symbols[offsets[lengths[symbol]]++] = uint16_t(symbol);
+    }
+
+    // codes of a length count up from where shorter codes end, deflate stores them bit reversed
+    memset(table.fast, 0, sizeof(table.fast));
+    uint32_t code = 0, index = 0;
+    for(uint32_t length = 1; length <= HuffmanFastBits; length++, code <<= 1){
+        for(uint32_t i = 0; i < table.counts[length]; i++, index++, code++){
+            uint32_t entry = table.entries[table.symbols[index]] | length;
+            for(uint32_t j = ReverseBits(code, length); j < (1u << HuffmanFastBits); j += 1u << length) table.fast[j] = entry;
+        }
+    }
+    return true;
+}
+
+// one bit at a time through canonical code, only reached by codes longer than fast bits
+static uint32_t DecodeSlow(const HuffmanTable& table, uint64_t bits){
+    uint32_t code = 0, first = 0, index = 0;
+    for(uint32_t length = 1; length < 16; length++, bits >>= 1){
+        code |= uint32_t(bits & 1);
+        uint32_t count = table.counts[length];
+        if(code >= first && code - first < count) return table.entries[table.symbols[index + code - first]] | length;
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return EntryInvalid;
+}
+
+/// codes of fixed huffman blocks, built on first use
+struct FixedHuffmanTables{
+    HuffmanTable literals;
+    HuffmanTable distances;
+
+    FixedHuffmanTables(){
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        BuildHuffmanTable(lengths, 288, HuffmanAlphabet::LiteralLength, literals);
+        memset(lengths, 5, 32);
+        BuildHuffmanTable(lengths, 32, HuffmanAlphabet::Distance, distances);
+    }
+};
+
+/// position in compressed input and in inflated output
+struct Inflater{
+    const uint8_t* in = nullptr;
+    const uint8_t* inEnd = nullptr;
+    /// bits not consumed yet, lowest bit first, bits above bitCount may hold input that is counted again later
+    uint64_t bits = 0;
+    uint32_t bitCount = 0;
+    /// zero bytes read past end of input
+    uint32_t overrun = 0;
+
+    /// output window, matches reach back to outStart and output may not pass outEnd
+    uint8_t* outStart = nullptr;
+    uint8_t* out = nullptr;
+    uint8_t* outEnd = nullptr;
+    /// inflating pauses once output passes this, so that window can be emptied
+    uint8_t* outFlush = nullptr;
+
+    /// buffer at least 56 bits, little endian hosts load 8 bytes at once
+    void Refill(){
+        if(inEnd - in >= 8){
+            uint64_t word;
+            memcpy(&word, in, sizeof(word));
+            bits |= word << bitCount;
+            in += (63 - bitCount) >> 3;
+            bitCount |= 56;
+            return;
+        }
+        while(bitCount < 56){
+            uint64_t byte = 0;
+            if(in < inEnd) byte = *in++;
+            else overrun++;
+            bits |= byte << bitCount;
+            bitCount += 8;
+        }
+    }
+
+    void Consume(uint32_t count){
+        bits >>= count;
+        bitCount -= count;
+    }
+
+    uint32_t Read(uint32_t count){
+        uint32_t value = uint32_t(bits & ((1ull << count) - 1));
+        Consume(count);
+        return value;
+    }
+
+    uint32_t Decode(const HuffmanTable& table) const{
+        uint32_t entry = table.fast[bits & ((1u << HuffmanFastBits) - 1)];
+        return entry & 15 ? entry : DecodeSlow(table, bits);
+    }
+};
+
+/// zlib stream inflated a window at a time, blocks resume where they paused
+struct ZlibStream{
+    Inflater inflater;
+
+    enum class Block{
+        /// next block header is read
+        None,
+        Stored,
+        Huffman
+    };
+    Block block = Block::None;
+    bool finalBlock = false;
+    /// bytes of stored block still to be copied
+    uint32_t storedLeft = 0;
+    const HuffmanTable* literals = nullptr;
+    const HuffmanTable* distances = nullptr;
+    HuffmanTable dynamicLiterals;
+    HuffmanTable dynamicDistances;
+};
+
+enum class InflateStatus{
+    Failed,
+    /// output passed flush point, window must be emptied before inflating goes on
+    Full,
+    Done
+};
+
+// copy of earlier output, may write up to 7 bytes past match
+static inline void CopyMatch(uint8_t* out, uint32_t distance, uint32_t length){
+    const uint8_t* from = out - distance;
+    if(distance >= 8){
+        uint8_t* end = out + length;
+        do{
+            uint64_t word;
+            memcpy(&word, from, sizeof(word));
+            memcpy(out, &word, sizeof(word));
+            out += 8;
+            from += 8;
+        }while(out < end);
+    }else if(distance == 1){
+        memset(out, *from, length);
+    }else{
+        // first 8 bytes one at a time, then from a whole number of repeats back that is at least 8 bytes away
+        uint32_t head = length < 8 ? length : 8;
+        for(uint32_t i = 0; i < head; i++) out[i] = from[i];
+        if(length > 8) CopyMatch(out + 8, distance * ((8 + distance - 1) / distance), length - 8);
+    }
+}
+
+static bool ReadStoredHeader(ZlibStream& stream){
+    // rewind to first byte not consumed, bytes buffered after it are read again
+    Inflater& s = stream.inflater;
+    s.Consume(s.bitCount & 7);
+    uint32_t buffered = s.bitCount / 8;
+    if(buffered < s.overrun) return false;
+    s.in -= buffered - s.overrun;
+    s.overrun = 0;
+    s.bits = 0;
+    s.bitCount = 0;
+
+    if(s.inEnd - s.in < 4) return false;
+    uint32_t length = uint32_t(s.in[0]) | uint32_t(s.in[1]) << 8;
+    uint32_t inverted = uint32_t(s.in[2]) | uint32_t(s.in[3]) << 8;
+    if(length != (~inverted & 0xFFFF)) return false;
+    s.in += 4;
+    stream.storedLeft = length;
+    return true;
+}
+
+static InflateStatus CopyStoredBlock(ZlibStream& stream){
+    Inflater& s = stream.inflater;
+    size_t room = s.outEnd - s.out;
+    size_t count = stream.storedLeft < room ? stream.storedLeft : room;
+    if(size_t(s.inEnd - s.in) < count) return InflateStatus::Failed;
+
+    memcpy(s.out, s.in, count);
+    s.in += count;
+    s.out += count;
+    stream.storedLeft -= uint32_t(count);
+    if(stream.storedLeft == 0) return InflateStatus::Done;
+    // output ended before block did, only a full window may do that
+    return s.out > s.outFlush ? InflateStatus::Full : InflateStatus::Failed;
+}
+
+static bool ReadDynamicTables(Inflater& stream, HuffmanTable& literals, HuffmanTable& distances){
+    stream.Refill();
+    uint32_t literalCount = stream.Read(5) + 257;
+    uint32_t distanceCount = stream.Read(5) + 1;
+    uint32_t codeLengthCount = stream.Read(4) + 4;
+    if(literalCount > 286 || distanceCount > 30) return false;
+
+    uint8_t codeLengthLengths[19] = {};
+    for(uint32_t i = 0; i < codeLengthCount; i++){
+        stream.Refill();
+        codeLengthLengths[CodeLengthOrder[i]] = uint8_t(stream.Read(3));
+    }
+    HuffmanTable codeLengths;
+    if(!BuildHuffmanTable(codeLengthLengths, 19, HuffmanAlphabet::CodeLength, codeLengths)) return false;
+
+    // literal and distance lengths are one sequence, repeats may cross from one to other
+    uint8_t lengths[286 + 30];
+    uint32_t total = literalCount + distanceCount;
+    for(uint32_t i = 0; i < total;){
+        stream.Refill();
+        uint32_t entry = stream.Decode(codeLengths);
+        if((entry & 15) == 0) return false;
+        stream.Consume(entry & 15);
+
+        uint32_t symbol = entry >> 16;
+        if(symbol < 16){
+            lengths[i++] = uint8_t(symbol);
+            continue;
+        }
+
+        uint8_t value = 0;
+        uint32_t repeat;
+        if(symbol == 16){
+            if(i == 0) return false;
+            value = lengths[i - 1];
+            repeat = 3 + stream.Read(2);
+        }else if(symbol == 17){
+            repeat = 3 + stream.Read(3);
+        }else{
+            repeat = 11 + stream.Read(7);
+        }
+        if(total - i < repeat) return false;
+        memset(lengths + i, value, repeat);
+        i += repeat;
+    }
+
+    // block must be able to end
+    if(lengths[256] == 0) return false;
+    return BuildHuffmanTable(lengths, literalCount, HuffmanAlphabet::LiteralLength, literals) &&
+           BuildHuffmanTable(lengths + literalCount, distanceCount, HuffmanAlphabet::Distance, distances);
+}
+
+// one refill covers longest length and distance pair, 15 + 5 + 15 + 13 bits
+static InflateStatus InflateBlock(Inflater& stream, const HuffmanTable& literals, const HuffmanTable& distances){
+    // local copy stays in registers, stores to output could alias stream otherwise
+    Inflater s = stream;
+    InflateStatus status = InflateStatus::Failed;
+    for(;;){
+        // pauses between symbols, so that nothing but position has to be kept
+        if(s.out > s.outFlush){
+            status = InflateStatus::Full;
+            break;
+        }
+
+        s.Refill();
+        uint32_t entry = s.Decode(literals);
+        uint32_t codeLength = entry & 15, kind = entry & EntryKindMask;
+        if(codeLength == 0 || kind == EntryInvalid) return InflateStatus::Failed;
+
+        if(kind == EntryLiteral){
+            if(s.out == s.outEnd) return InflateStatus::Failed;
+            *s.out++ = uint8_t(entry >> 16);
+            s.Consume(codeLength);
+            continue;
+        }
+        if(kind == EntryEnd){
+            s.Consume(codeLength);
+            status = InflateStatus::Done;
+            break;
+        }
+
+        uint32_t extraBits = (entry >> 4) & 15;
+        uint32_t length = (entry >> 16) + (uint32_t(s.bits >> codeLength) & ((1u << extraBits) - 1));
+        s.Consume(codeLength + extraBits);
+
+        entry = s.Decode(distances);
+        codeLength = entry & 15;
+        if(codeLength == 0 || (entry & EntryKindMask) == EntryInvalid) return InflateStatus::Failed;
+        extraBits = (entry >> 4) & 15;
+        uint32_t distance = (entry >> 16) + (uint32_t(s.bits >> codeLength) & ((1u << extraBits) - 1));
+        s.Consume(codeLength + extraBits);
+
+        if(size_t(s.out - s.outStart) < distance || size_t(s.outEnd - s.out) < length) return InflateStatus::Failed;
+        CopyMatch(s.out, distance, length);
+        s.out += length;
+    }
+    stream = s;
+    return status;
+}
+
+// zlib header, adler checksum at end is not checked just like stb_image does not
+static bool BeginZlibStream(ZlibStream& stream, const uint8_t* data, size_t size){
+    if(size < 2) return false;
+    uint32_t method = data[0], flags = data[1];
+    if((method & 15) != 8 || (method * 256 + flags) % 31 != 0 || (flags & 32)) return false;
+    stream.inflater.in = data + 2;
+    stream.inflater.inEnd = data + size;
+    return true;
+}
+
+// inflate blocks until output passes flush point or last block ends
+static InflateStatus Inflate(ZlibStream& stream){
+    static const FixedHuffmanTables fixedTables;
+    Inflater& s = stream.inflater;
+
+    for(;;){
+        if(stream.block == ZlibStream::Block::None){
+            if(stream.finalBlock){
+                // zeros read past end of input must not have been consumed
+                return s.overrun * 8 <= s.bitCount ? InflateStatus::Done : InflateStatus::Failed;
+            }
+
+            s.Refill();
+            stream.finalBlock = s.Read(1) != 0;
+            uint32_t type = s.Read(2);
+            if(type == 0){
+                if(!ReadStoredHeader(stream)) return InflateStatus::Failed;
+                stream.block = ZlibStream::Block::Stored;
+            }else if(type == 1){
+                stream.literals = &fixedTables.literals;
+                stream.distances = &fixedTables.distances;
+                stream.block = ZlibStream::Block::Huffman;
+            }else if(type == 2){
+                if(!ReadDynamicTables(s, stream.dynamicLiterals, stream.dynamicDistances)) return InflateStatus::Failed;
+                stream.literals = &stream.dynamicLiterals;
+                stream.distances = &stream.dynamicDistances;
+                stream.block = ZlibStream::Block::Huffman;
+            }else{
+                return InflateStatus::Failed;
+            }
+        }
+
+        InflateStatus status = stream.block == ZlibStream::Block::Stored ? CopyStoredBlock(stream) : InflateBlock(s, *stream.literals, *stream.distances);
+        if(status != InflateStatus::Done) return status;
+        stream.block = ZlibStream::Block::None;
+    }
+}
+
+static uint8_t PaethPredictor(int32_t left, int32_t up, int32_t upperLeft){
+    int32_t distanceLeft = std::abs(up - upperLeft);
+    int32_t distanceUp = std::abs(left - upperLeft);
+    int32_t distanceUpperLeft = std::abs(left + up - 2 * upperLeft);
+    if(distanceLeft <= distanceUp && distanceLeft <= distanceUpperLeft) return uint8_t(left);
+    return uint8_t(distanceUp <= distanceUpperLeft ? up : upperLeft);
+}
+
+#if defined(GAMEZERO_PNG_SSE2)
+// texels of 3 and 4 bytes are filtered one at a time in low lanes, each depends on one before it
+template<uint32_t PixelSize>
+static __m128i LoadPixel(const uint8_t* p){
+    int32_t value = 0;
+    memcpy(&value, p, PixelSize);
+    return _mm_cvtsi32_si128(value);
+}
+
+template<uint32_t PixelSize>
+static void StorePixel(uint8_t* p, __m128i pixel){
+    int32_t value = _mm_cvtsi128_si32(pixel);
+    memcpy(p, &value, PixelSize);
+}
+
+template<uint32_t PixelSize>
+static void UnfilterSub(const uint8_t* filtered, uint8_t* row, size_t begin, size_t end){
+    __m128i left = begin ? LoadPixel<PixelSize>(row + begin - PixelSize) : _mm_setzero_si128();
+    for(size_t i = begin; i < end; i += PixelSize, filtered += PixelSize){
+        left = _mm_add_epi8(LoadPixel<PixelSize>(filtered), left);
+        StorePixel<PixelSize>(row + i, left);
+    }
+}
+
+// average rounding down is pavgb rounding up minus carry of odd sums
+template<uint32_t PixelSize>
+static void UnfilterAverage(const uint8_t* filtered, uint8_t* row, const uint8_t* prior, size_t begin, size_t end){
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i left = begin ? LoadPixel<PixelSize>(row + begin - PixelSize) : _mm_setzero_si128();
+    for(size_t i = begin; i < end; i += PixelSize, filtered += PixelSize){
+        __m128i up = LoadPixel<PixelSize>(prior + i);
+        __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), one));
+        left = _mm_add_epi8(LoadPixel<PixelSize>(filtered), average);
+        StorePixel<PixelSize>(row + i, left);
+    }
+}
+
+// predictor distances in 16 bit lanes, nearest of left, up and upper left in that order of preference
+template<uint32_t PixelSize>
+static void UnfilterPaeth(const uint8_t* filtered, uint8_t* row, const uint8_t* prior, size_t begin, size_t end){
+    const __m128i zero = _mm_setzero_si128();
+    auto Abs = [&zero](__m128i value){ return _mm_max_epi16(value, _mm_sub_epi16(zero, value)); };
+    auto Select = [](__m128i mask, __m128i a, __m128i b){ return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); };
+
+    __m128i left = begin ? _mm_unpacklo_epi8(LoadPixel<PixelSize>(row + begin - PixelSize), zero) : zero;
+    __m128i upperLeft = begin ? _mm_unpacklo_epi8(LoadPixel<PixelSize>(prior + begin - PixelSize), zero) : zero;
+    for(size_t i = begin; i < end; i += PixelSize, filtered += PixelSize){
+        __m128i up = _mm_unpacklo_epi8(LoadPixel<PixelSize>(prior + i), zero);
+        __m128i towardsUp = _mm_sub_epi16(up, upperLeft), towardsLeft = _mm_sub_epi16(left, upperLeft);
+        __m128i distanceLeft = Abs(towardsUp), distanceUp = Abs(towardsLeft), distanceUpperLeft = Abs(_mm_add_epi16(towardsUp, towardsLeft));
+        __m128i nearest = _mm_min_epi16(distanceUpperLeft, _mm_min_epi16(distanceLeft, distanceUp));
+
+        __m128i predictor = Select(_mm_cmpeq_epi16(distanceUp, nearest), up, upperLeft);
+        predictor = Select(_mm_cmpeq_epi16(distanceLeft, nearest), left, predictor);
+        __m128i pixel = _mm_add_epi8(LoadPixel<PixelSize>(filtered), _mm_packus_epi16(predictor, predictor));
+        StorePixel<PixelSize>(row + i, pixel);
+
+        upperLeft = up;
+        left = _mm_unpacklo_epi8(pixel, zero);
+    }
+}
+#endif
+
+// unfilter bytes begin to end of a row from filtered bytes starting at begin, prior is row above once unfiltered
+// begin and end are whole pixels, bytes of row before begin are already unfiltered
+static void UnfilterRow(uint8_t filter, const uint8_t* filtered, uint8_t* row, const uint8_t* prior, size_t begin, size_t end, uint32_t pixelSize){
+    filtered -= begin;
+    switch(filter){
+        case 0:
+            memcpy(row + begin, filtered + begin, end - begin);
+            break;
+        case 1:
+#if defined(GAMEZERO_PNG_SSE2)
+            if(pixelSize == 4){ UnfilterSub<4>(filtered + begin, row, begin, end); break; }
+            if(pixelSize == 3){ UnfilterSub<3>(filtered + begin, row, begin, end); break; }
+#endif
+            for(size_t i = begin; i < end; i++) row[i] = filtered[i] + (i >= pixelSize ? row[i - pixelSize] : 0);
+            break;
+        case 2:{
+            size_t i = begin;
+#if defined(GAMEZERO_PNG_SSE2)
+            for(; i + 16 <= end; i += 16){
+                __m128i sum = _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(filtered + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), sum);
+            }
+#endif
+            for(; i < end; i++) row[i] = filtered[i] + prior[i];
+            break;
+        }
+        case 3:
+#if defined(GAMEZERO_PNG_SSE2)
+            if(pixelSize == 4){ UnfilterAverage<4>(filtered + begin, row, prior, begin, end); break; }
+            if(pixelSize == 3){ UnfilterAverage<3>(filtered + begin, row, prior, begin, end); break; }
+#endif
+            for(size_t i = begin; i < end; i++) row[i] = filtered[i] + uint8_t(((i >= pixelSize ? row[i - pixelSize] : 0) + prior[i]) >> 1);
+            break;
+        default:
+#if defined(GAMEZERO_PNG_SSE2)
+            if(pixelSize == 4){ UnfilterPaeth<4>(filtered + begin, row, prior, begin, end); break; }
+            if(pixelSize == 3){ UnfilterPaeth<3>(filtered + begin, row, prior, begin, end); break; }
+#endif
+            for(size_t i = begin; i < end; i++){
+                row[i] = filtered[i] + (i >= pixelSize ? PaethPredictor(row[i - pixelSize], prior[i], prior[i - pixelSize]) : prior[i]);
+            }
+            break;
+    }
+}
+
+/// farthest back a deflate match reaches
+constexpr static size_t PngHistorySize = 32768;
+/// inflated bytes held at once, small enough to stay in cache while rows are unfiltered from it
+constexpr static size_t PngWindowSize = 256 * 1024;
+
+bool GameZero::DecodePng(const PngImage& image, uint8_t* destination, size_t rowPitch){
+    // chunks are one zlib stream, joined when there are several
+    std::vector<uint8_t> joined;
+    const uint8_t* compressed = image.dataChunks[0].data;
+    size_t compressedSize = image.dataChunks[0].size;
+    if(image.dataChunks.size() > 1){
+        for(const PngImage::Chunk& chunk : image.dataChunks) joined.insert(joined.end(), chunk.data, chunk.data + chunk.size);
+        compressed = joined.data();
+        compressedSize = joined.size();
+    }
+
+    std::unique_ptr<ZlibStream> stream(new ZlibStream());
+    if(!BeginZlibStream(*stream, compressed, compressedSize)){
+        LOG(WARNING, "Compressed data of png is not a zlib stream");
+        return false;
+    }
+
+    // slack lets matches be copied 8 bytes at a time up to end of window
+    std::unique_ptr<uint8_t[]> window(new uint8_t[PngWindowSize + 8]);
+    Inflater& s = stream->inflater;
+    s.outStart = s.out = window.get();
+    s.outFlush = window.get() + PngWindowSize - 258;
+
+    // row being unfiltered and row above it, first row has a row of zeros above it
+    size_t rowSize = image.GetRowSize();
+    uint32_t pixelSize = image.colorType == 3 ? 1 : image.channelCount;
+    std::vector<uint8_t> rows(rowSize * 2, 0);
+    uint8_t* prior = rows.data();
+    uint8_t* row = rows.data() + rowSize;
+
+    // rows are unfiltered as their bytes are inflated and written to destination once complete
+    uint64_t inflatedLeft = uint64_t(rowSize + 1) * image.height;
+    const uint8_t* unfiltered = window.get();
+    uint32_t y = 0;
+    size_t rowPosition = 0;
+    uint8_t filter = 0;
+    for(;;){
+        // window never takes more than rows still hold, so that broken streams cannot write past last row
+        size_t windowLeft = PngWindowSize - size_t(s.out - window.get());
+        s.outEnd = s.out + (inflatedLeft < windowLeft ? size_t(inflatedLeft) : windowLeft);
+        uint8_t* inflatedStart = s.out;
+        InflateStatus status = Inflate(*stream);
+        if(status == InflateStatus::Failed) break;
+        inflatedLeft -= s.out - inflatedStart;
+
+        while(y < image.height){
+            // first byte of each row picks its filter
+            if(rowPosition == 0){
+                if(unfiltered == s.out) break;
+                filter = *unfiltered++;
+                if(filter > 4){
+                    LOG(WARNING, "Row %u of png has unknown filter %u", y, filter);
+                    return false;
+                }
+                rowPosition = 1;
+            }
+
+            size_t begin = rowPosition - 1;
+            size_t count = std::min(size_t(s.out - unfiltered), rowSize - begin);
+            // bytes of a pixel split across windows wait for the rest of it
+            count -= count % pixelSize;
+            if(count == 0) break;
+            UnfilterRow(filter, unfiltered, row, prior, begin, begin + count, pixelSize);
+            unfiltered += count;
+            rowPosition += count;
+
+            if(begin + count == rowSize){
+                uint8_t* out = destination + y * rowPitch;
+                if(image.colorType == 3){
+                    for(uint32_t x = 0; x < image.width; x++) memcpy(out + x * 4, image.palette + row[x] * 4, 4);
+                }else{
+                    ExpandToRgba(row, image.width, image.channelCount, out);
+                }
+                std::swap(prior, row);
+                rowPosition = 0;
+                y++;
+            }
+        }
+
+        if(status == InflateStatus::Done){
+            if(y == image.height) return true;
+            break;
+        }
+
+        // keep reach of matches and bytes of a split pixel, everything before is unfiltered
+        size_t kept = std::min(size_t(s.out - window.get()), std::max(PngHistorySize, size_t(s.out - unfiltered)));
+        memmove(window.get(), s.out - kept, kept);
+        unfiltered = window.get() + kept - (s.out - unfiltered);
+        s.out = window.get() + kept;
+    }
+
+    LOG(WARNING, "Compressed data of png does not hold its %u rows", image.height);
+    return false;
+}
@@ -0,0 +1,62 @@
+#ifndef GAMEZERO_UTILS_PNG_HPP
+#define GAMEZERO_UTILS_PNG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GameZero{
+
+    /// first 8 bytes of every PNG file
+    constexpr static uint8_t PngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    /// PNG image parsed in place, compressed data points into parsed bytes
+    struct PngImage{
+        uint32_t width = 0;
+        uint32_t height = 0;
+        /// 0 gray, 2 rgb, 3 palette, 4 gray and alpha, 6 rgba
+        uint8_t colorType = 0;
+        /// channels of a texel once palette is applied, alpha of palette images counts when they have one
+        uint32_t channelCount = 0;
+        /// palette as rgba, opaque unless file has transparency for it
+        uint8_t palette[256 * 4] = {};
+
+        /// payloads of IDAT chunks, together they are one zlib stream
+        struct Chunk{
+            const uint8_t* data;
+            size_t size;
+        };
+        std::vector<Chunk> dataChunks;
+
+        /// bytes of one stored row, without its filter byte
+        size_t GetRowSize() const{ return size_t(width) * (colorType == 3 ? 1 : channelCount); }
+    };
+
+    /**
+     * @brief Parse a PNG file already in memory, without copying compressed data.
+     *        Only 8 bit images that are not interlaced and have no transparent color key are accepted,
+     *        which is what texture tools write. Other files are left to stb_image.
+     *
+     * @param data : file contents, must outlive image
+     * @param size : size of file in bytes
+     * @param image : receives header, palette and data chunks
+     * @return false if file is not a PNG file, is truncated or is not accepted
+     */
+    bool ParsePng(const uint8_t* data, size_t size, PngImage& image);
+
+    /**
+     * @brief Decode a parsed PNG image to 8 bit rgba, the way stb_image does.
+     *        Data is inflated with a table driven decoder reading 64 bits at a time into a small window,
+     *        rows are unfiltered from it with simd as they arrive and written to destination once, widened to rgba on the way.
+     *        Destination is only written to, so it can be mapped staging memory.
+     *
+     * @param image : image parsed with ParsePng
+     * @param destination : receives height rows of width * 4 bytes
+     * @param rowPitch : bytes between starts of rows in destination, at least width * 4
+     * @return false if compressed data is broken or does not hold exactly the rows of image
+     */
+    bool DecodePng(const PngImage& image, uint8_t* destination, size_t rowPitch);
+
+}
+
+#endif//GAMEZERO_UTILS_PNG_HPP
@@ -0,0 +1,218 @@
+/**
+ * @file vertex_layout.hpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief vertex layouts declared as type lists, turned into vertex input descriptions at compile time
+ * @version 0.1
+ * @date 2021-07-02
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ */
+
+#ifndef GAMEZERO_VERTEX_LAYOUT_HPP
+#define GAMEZERO_VERTEX_LAYOUT_HPP
+
+#include "vulkan/vulkan.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace GameZero{
+
+    /// vertex shader input locations, must match layout(location = ...) in shaders/*.vert
+    namespace VertexLocation{
+        constexpr static uint32_t Position = 0;
+        constexpr static uint32_t Normal = 1;
+        constexpr static uint32_t Color = 2;
+        constexpr static uint32_t TexCoord = 3;
+        /// number of locations shaders read
+        constexpr static uint32_t Count = 4;
+
+        /// mask with a bit for each given location
+        template<typename... Locations>
+        constexpr uint32_t MaskOf(Locations... locations){
+            return ((1u << locations) | ... | 0u);
+        }
+    }
+
+    /**
+     * @brief Vertex input description for pipeline creation.
+     *        Does not own its arrays, they are static arrays of a VertexLayout
+     *        so that creating a pipeline does not allocate.
+     */
+    struct VertexInputDescription{
+        const vk::VertexInputBindingDescription* bindings = nullptr;
+        uint32_t bindingCount = 0;
+        const vk::VertexInputAttributeDescription* attributes = nullptr;
+        uint32_t attributeCount = 0;
+
+        vk::PipelineVertexInputStateCreateFlags flags = {};
+    };
+
+    /// size in bytes of a vertex attribute format, 0 for formats no layout uses yet
+    constexpr uint32_t GetVertexFormatSize(vk::Format format){
+        switch(format){
+            case vk::Format::eR32G32B32A32Sfloat: return 16;
+            case vk::Format::eR32G32B32Sfloat: return 12;
+            case vk::Format::eR32G32Sfloat: return 8;
+            case vk::Format::eR16G16B16A16Unorm: return 8;
+            case vk::Format::eR16G16B16A16Snorm: return 8;
+            case vk::Format::eR16G16Snorm: return 4;
+            case vk::Format::eR16G16Unorm: return 4;
+            case vk::Format::eR16G16Sfloat: return 4;
+            case vk::Format::eR8G8B8A8Unorm: return 4;
+            case vk::Format::eR8G8B8A8Snorm: return 4;
+            default: return 0;
+        }
+    }
+
+    /**
+     * @brief One vertex attribute, read by shaders at Location in given Format.
+     *        Type is the cpu side type of attribute and decides its size and alignment.
+     */
+    template<uint32_t Location, vk::Format Format, typename Type>
+    struct VertexAttribute{
+        static_assert(Location < VertexLocation::Count, "vertex attribute location is not read by any shader");
+        static_assert(GetVertexFormatSize(Format) == sizeof(Type), "vertex attribute format does not match size of its type");
+
+        constexpr static uint32_t location = Location;
+        constexpr static vk::Format format = Format;
+        constexpr static uint32_t size = sizeof(Type);
+        constexpr static uint32_t alignment = alignof(Type);
+    };
+
+    namespace Detail{
+
+        /// offsets of members laid out in order with natural alignment, like in a struct
+        template<size_t N>
+        constexpr std::array<uint32_t, N> ComputeVertexOffsets(const std::array<uint32_t, N>& sizes, const std::array<uint32_t, N>& alignments){
+            std::array<uint32_t, N> offsets = {};
+            uint32_t end = 0;
+            for(size_t i = 0; i < N; i++){
+                offsets[i] = (end + alignments[i] - 1) / alignments[i] * alignments[i];
+                end = offsets[i] + sizes[i];
+            }
+            return offsets;
+        }
+
+        /// size of a struct with given members, padded to its widest alignment
+        template<size_t N>
+        constexpr uint32_t ComputeVertexStride(const std::array<uint32_t, N>& sizes, const std::array<uint32_t, N>& alignments){
+            std::array<uint32_t, N> offsets = ComputeVertexOffsets(sizes, alignments);
+            uint32_t alignment = 1;
+            for(uint32_t a : alignments) alignment = a > alignment ? a : alignment;
+            uint32_t end = offsets[N - 1] + sizes[N - 1];
+            return (end + alignment - 1) / alignment * alignment;
+        }
+
+        template<size_t N, size_t M, size_t... I, size_t... J>
+        constexpr std::array<vk::VertexInputAttributeDescription, N + M> ConcatenateAttributes(
+            const std::array<vk::VertexInputAttributeDescription, N>& a, const std::array<vk::VertexInputAttributeDescription, M>& b,
+            std::index_sequence<I...>, std::index_sequence<J...>){
+            return {{a[I]..., b[J]...}};
+        }
+
+        template<size_t N>
+        constexpr std::array<vk::VertexInputAttributeDescription, N> JoinAttributes(const std::array<vk::VertexInputAttributeDescription, N>& a){
+            return a;
+        }
+
+        /// attributes of all arrays, in order
+        template<size_t N, size_t M, typename... Rest>
+        constexpr auto JoinAttributes(const std::array<vk::VertexInputAttributeDescription, N>& a, const std::array<vk::VertexInputAttributeDescription, M>& b, const Rest&... rest){
+            return JoinAttributes(ConcatenateAttributes(a, b, std::make_index_sequence<N>(), std::make_index_sequence<M>()), rest...);
+        }
+
+        template<size_t N>
+        constexpr bool HasUniqueLocations(const std::array<vk::VertexInputAttributeDescription, N>& attributes){
+            for(size_t i = 0; i < N; i++){
+                for(size_t j = i + 1; j < N; j++){
+                    if(attributes[i].location == attributes[j].location) return false;
+                }
+            }
+            return true;
+        }
+
+        template<size_t N>
+        constexpr uint32_t ComputeLocationMask(const std::array<vk::VertexInputAttributeDescription, N>& attributes){
+            uint32_t mask = 0;
+            for(size_t i = 0; i < N; i++){
+                mask |= 1u << attributes[i].location;
+            }
+            return mask;
+        }
+
+        template<size_t N>
+        constexpr bool HasOrderedBindings(const std::array<vk::VertexInputBindingDescription, N>& bindings){
+            for(size_t i = 0; i < N; i++){
+                if(bindings[i].binding != i) return false;
+            }
+            return true;
+        }
+
+        template<uint32_t Binding, typename... Attributes, size_t... I>
+        constexpr std::array<vk::VertexInputAttributeDescription, sizeof...(Attributes)> BuildAttributes(
+            const std::array<uint32_t, sizeof...(Attributes)>& offsets, std::index_sequence<I...>){
+            return {{vk::VertexInputAttributeDescription{Attributes::location, Binding, Attributes::format, offsets[I]}...}};
+        }
+
+    }
+
+    /**
+     * @brief Attributes read from one vertex buffer binding.
+     *        Attributes are laid out in order with natural alignment,
+     *        exactly like members of a struct declared in same order.
+     */
+    template<uint32_t Binding, typename... Attributes>
+    struct VertexBinding{
+        static_assert(sizeof...(Attributes) > 0, "vertex binding without attributes");
+
+        constexpr static uint32_t binding = Binding;
+        constexpr static size_t attributeCount = sizeof...(Attributes);
+
+        /// byte offset of each attribute in a vertex
+        constexpr static std::array<uint32_t, attributeCount> offsets =
+            Detail::ComputeVertexOffsets<attributeCount>({{Attributes::size...}}, {{Attributes::alignment...}});
+
+        /// bytes per vertex in this binding
+        constexpr static uint32_t stride =
+            Detail::ComputeVertexStride<attributeCount>({{Attributes::size...}}, {{Attributes::alignment...}});
+
+        constexpr static vk::VertexInputBindingDescription description = {Binding, stride, vk::VertexInputRate::eVertex};
+
+        constexpr static std::array<vk::VertexInputAttributeDescription, attributeCount> attributes =
+            Detail::BuildAttributes<Binding, Attributes...>(offsets, std::make_index_sequence<attributeCount>());
+    };
+
+    /**
+     * @brief Vertex layout made of bindings, numbered from 0 in order.
+     *        Binding and attribute descriptions are static arrays built at compile time,
+     *        locations are checked to be unique so that shaders see every attribute once.
+     */
+    template<typename... Bindings>
+    struct VertexLayout{
+        constexpr static size_t bindingCount = sizeof...(Bindings);
+        constexpr static size_t attributeCount = (Bindings::attributeCount + ...);
+
+        constexpr static std::array<vk::VertexInputBindingDescription, bindingCount> bindings = {{Bindings::description...}};
+
+        /// attributes of all bindings, in binding order
+        constexpr static std::array<vk::VertexInputAttributeDescription, attributeCount> attributes =
+            Detail::JoinAttributes(Bindings::attributes...);
+
+        static_assert(Detail::HasOrderedBindings(bindings), "vertex layout bindings must be numbered from 0 in order");
+        static_assert(Detail::HasUniqueLocations(attributes), "vertex layout reads a shader location twice");
+
+        /// bit per shader location read by layout, compared against inputs of shaders
+        constexpr static uint32_t locationMask = Detail::ComputeLocationMask(attributes);
+
+        /// description pointing into static arrays of this layout
+        static VertexInputDescription GetDescription(){
+            return {bindings.data(), uint32_t(bindingCount), attributes.data(), uint32_t(attributeCount)};
+        }
+    };
+
+}
+
+#endif//GAMEZERO_VERTEX_LAYOUT_HPP
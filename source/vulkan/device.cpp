@@ -200,12 +200,18 @@ void GameZero::Device::CreateDevice(const Surface& surface){
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
                
+    // optional features are enabled only where device has them, users check enabledFeatures
+    vk::PhysicalDeviceFeatures supportedFeatures = physical.getFeatures();
+    enabledFeatures = vk::PhysicalDeviceFeatures();
+    enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
     // device create info
     vk::DeviceCreateInfo deviceCreateInfo(
         {}, /* flags */
         queueCreateInfos.size(), queueCreateInfos.data(),
         0, nullptr, /* layers */
-        deviceExtensions.size(), deviceExtensions.data()
+        deviceExtensions.size(), deviceExtensions.data(),
+        &enabledFeatures /* features */
     );
     
     // create device
@@ -55,6 +55,9 @@ namespace GameZero{
         /// device memory allocator
         vma::Allocator allocator;
 
+        /// optional features enabled on logical device
+        vk::PhysicalDeviceFeatures enabledFeatures;
+
         /// graphics queue handle
         vk::Queue graphicsQueue;
         /// graphics queue index
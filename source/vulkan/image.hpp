@@ -24,6 +24,10 @@ namespace GameZero{
 		vk::Extent3D extent;
 		vk::Image image;
 		vk::ImageView view;
+		/// number of mip levels, level 0 is full size
+		uint32_t mipLevels = 1;
+		/// number of layers, more than 1 for texture arrays
+		uint32_t arrayLayers = 1;
 	};
 	
 	/// represents manually allocated image
@@ -6,6 +6,7 @@
 #include <vulkan/vulkan.hpp>
 #include "vk_mem_alloc.hpp"
 #include "glm/ext/matrix_transform.hpp"
+#include "../math/bounds.hpp"
 
 
 namespace GameZero{
@@ -37,25 +38,74 @@ namespace GameZero{
     /// material
     struct Material{
         vk::DescriptorSet textureSet = VK_NULL_HANDLE;
+        /// image view bound to texture set, kept so that set can be written again with another sampler
+        vk::ImageView textureView = VK_NULL_HANDLE;
+        /// texture of texture set, its image view changes when levels are streamed
+        const struct Texture* texture = nullptr;
+        /// layer of texture in its image, texture set is shared by materials of all layers of a texture array
+        uint32_t textureLayer = 0;
+        /// texture is a normal map stored as red and green, see GetTextureSwizzle
+        bool normalMap = false;
         vk::Pipeline pipeline;
         vk::PipelineLayout pipelineLayout;
+
+        /// push constants of fragment shader for this material
+        struct GPUMaterialData GetGPUMaterialData() const;
     };
 
     /// render object
     struct RenderObject{
-        struct Mesh* mesh;
-        Material* material;
-
+        /// change mesh with SetMesh to keep world bounds in sync
+        struct Mesh* mesh = nullptr;
+        Material* material = nullptr;
+
+        /// world space bounds of mesh, refreshed only when mesh or transform is set
+        BoundingBox worldBounds;
+        BoundingSphere worldSphere;
+
+        /// set transform and move mesh bounds to world space with it
+        void SetTransform(const glm::mat4& newTransform);
+        /// set mesh and move its bounds to world space with current transform
+        void SetMesh(struct Mesh* newMesh);
         /// transform or model matrix
+        const glm::mat4& GetTransform() const{ return transform; }
+
+    private:
         glm::mat4 transform = glm::mat4(1.0f);
+
+        void UpdateWorldBounds();
     };
 
-struct GPUCameraData{
-            glm::mat4 model;
+    /// camera data written to uniform buffer once per frame, before its commands are recorded
+    struct GPUCameraData{
             glm::mat4 view;
             glm::mat4 proj;
         };
 
+    /// per object data sent as push constants, recorded with each draw unlike camera uniform buffer
+    struct GPUMeshData{
+        /// transform of object drawn
+        glm::mat4 model;
+        /// compact positions are decoded as offset + position * scale
+        glm::vec4 positionOffset;
+        glm::vec4 positionScale;
+        /// xy is atlas tile size, z is tile stride of tiled texture coordinates, 0 when they are plain
+        glm::vec4 uvTiling;
+    };
+
+    /// per material data sent as push constants to fragment shader, after GPUMeshData
+    struct GPUMaterialData{
+        /// layer of texture array sampled
+        uint32_t textureLayer;
+        /// 1 when texture holds x and y of normals, blue is rebuilt as z of unit length normal
+        uint32_t normalMap;
+    };
+
+    inline GPUMaterialData Material::GetGPUMaterialData() const{ return { textureLayer, normalMap ? 1u : 0u }; }
+
+    /// every device has at least 128 bytes of push constants
+    static_assert(sizeof(GPUMeshData) + sizeof(GPUMaterialData) <= 128, "push constants do not fit in 128 bytes");
+
     /// frame data
     struct FrameData{
         vk::Semaphore renderSemaphore, presentSemaphore;
@@ -0,0 +1,1212 @@
+/**
+ * @file benchmark.cpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief offline benchmarks for asset loading and processing
+ * @version 0.1
+ * @date 2021-06-25
+ * 
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ * 
+ * Run from build directory, same as GameZero executable.
+ * Usage : GameZeroBench [benchmark names...]
+ *         runs all benchmarks when no name is given
+ */
+
+#include "dynamic_mesh.hpp"
+#include "face_merger.hpp"
+#include "geometry_buffer.hpp"
+#include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_codec.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet.hpp"
+#include "mesh_simplifier.hpp"
+#include "texture_array.hpp"
+#include "texture_cache.hpp"
+#include "texture_streaming.hpp"
+#include "glm/ext/matrix_clip_space.hpp"
+#include "glm/ext/matrix_transform.hpp"
+#include "utils/image.hpp"
+#include "utils/image_kernels.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/obj_parser.hpp"
+#include "utils/parallel.hpp"
+#include "utils/png.hpp"
+#include "utils/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace GameZero;
+
+/// bundled meshes used by mesh benchmarks
+static const char* BenchmarkMeshes[] = {
+    "../mesh/lost_empire.obj",
+    "../mesh/GunBike-0-GunBike.obj"
+};
+
+/// bundled textures used by texture benchmarks
+static const char* BenchmarkTextures[] = {
+    "../assets/textures/lost_empire-RGBA.png",
+    "../assets/textures/Grass 2.png"
+};
+
+/// time a function in milliseconds
+template<typename Function>
+static float TimeMilliseconds(Function&& function){
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
+// cold start parses obj and writes cache, warm start maps the cache
+static void BenchmarkMeshCache(){
+    for(const char* filename : BenchmarkMeshes){
+        std::remove(GetMeshCachePath(filename).c_str());
+
+        Mesh cold;
+        bool loaded = false;
+        float coldTime = TimeMilliseconds([&](){ loaded = cold.LoadMeshFromOBJ(filename); });
+        if(!loaded){
+            printf("[ mesh_cache ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        Mesh warm;
+        float warmTime = TimeMilliseconds([&](){ warm.LoadMeshFromOBJ(filename); });
+
+        // touching data makes sure pages are actually read from disk
+        uint64_t checksum = 0;
+        float touchTime = TimeMilliseconds([&](){
+            checksum = HashBytes(warm.GetIndexData(), warm.GetIndexCount() * sizeof(uint32_t));
+        });
+
+        printf("[ mesh_cache ] %-36s cold : %8.2fms  warm : %8.2fms (+%.2fms first touch)  speedup : %.1fx  [%016lx]\n",
+            filename, coldTime, warmTime, touchTime, coldTime / (warmTime + touchTime), checksum);
+    }
+}
+
+// memory of indexed meshes against one vertex per triangle corner, loaded without cache
+static void BenchmarkMeshIndexing(){
+    for(const char* filename : BenchmarkMeshes){
+        std::remove(GetMeshCachePath(filename).c_str());
+
+        Mesh mesh;
+        bool loaded = false;
+        float loadTime = TimeMilliseconds([&](){ loaded = mesh.LoadMeshFromOBJ(filename); });
+        if(!loaded){
+            printf("[ indexing ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        // coarser levels of detail are appended after full detail indices, a flat mesh would have none
+        size_t cornerCount = mesh.GetLod(0).indexCount;
+        float flatSize = cornerCount * sizeof(Vertex) / (1024.f * 1024.f);
+        float indexedSize = (mesh.GetVertexCount() * sizeof(Vertex) + cornerCount * sizeof(uint32_t)) / (1024.f * 1024.f);
+
+        printf("[ indexing ] %-36s %8zu unique vertices for %8zu corners  flat : %7.2f MB  indexed : %7.2f MB (%.1f%%)  load : %8.2fms\n",
+            filename, mesh.GetVertexCount(), cornerCount, flatSize, indexedSize, 100.f * indexedSize / flatSize, loadTime);
+    }
+}
+
+/// generated obj used to measure parser throughput on a production sized file
+static const char* SyntheticObjFilename = "benchmark_grid.obj";
+
+// write a grid of textured quads with normals, roughly 120 MB on disk for gridSize 1024
+static void WriteSyntheticObj(const char* filename, uint32_t gridSize){
+    std::ofstream file(filename);
+    char line[128];
+
+    for(uint32_t y = 0; y <= gridSize; y++){
+        for(uint32_t x = 0; x <= gridSize; x++){
+            float height = 0.25f * float((x * 7 + y * 13) % 17);
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\n", float(x), height, float(y), x / float(gridSize), y / float(gridSize));
+            file << line;
+        }
+    }
+    file << "vn 0 1 0\n";
+
+    for(uint32_t y = 0; y < gridSize; y++){
+        for(uint32_t x = 0; x < gridSize; x++){
+            uint32_t i0 = y * (gridSize + 1) + x + 1;
+            uint32_t i1 = i0 + 1;
+            uint32_t i2 = i1 + gridSize + 1;
+            uint32_t i3 = i0 + gridSize + 1;
+            snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", i0, i0, i1, i1, i2, i2, i3, i3);
+            file << line;
+        }
+    }
+}
+
+// compare obj parser throughput and check both parsers build identical meshes
+static void BenchmarkObjParser(){
+    WriteSyntheticObj(SyntheticObjFilename, 1024);
+
+    std::vector<const char*> filenames(std::begin(BenchmarkMeshes), std::end(BenchmarkMeshes));
+    filenames.push_back(SyntheticObjFilename);
+
+    for(const char* filename : filenames){
+        FileInfo info;
+        if(!GetFileInfo(filename, info)){
+            printf("[ obj_parser ] %-36s skipped, file not found\n", filename);
+            continue;
+        }
+        float megabytes = info.size / (1024.f * 1024.f);
+
+        float tinyObjTime = TimeMilliseconds([&](){
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
+            tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, "../mesh/");
+        });
+
+        ObjData single, parallel;
+        float singleTime = TimeMilliseconds([&](){ ParseOBJ(filename, single, 1); });
+        float parallelTime = TimeMilliseconds([&](){ ParseOBJ(filename, parallel); });
+
+        printf("[ obj_parser ] %-36s %7.2f MB  tinyobj : %8.1f MB/s  native x1 : %8.1f MB/s  native x%u : %8.1f MB/s\n",
+            filename, megabytes, megabytes / (tinyObjTime / 1000.f), megabytes / (singleTime / 1000.f),
+            GetWorkerThreadCount(), megabytes / (parallelTime / 1000.f));
+
+        // both parsers must produce same mesh
+        std::remove(GetMeshCachePath(filename).c_str());
+        Mesh native;
+        native.LoadMeshFromOBJ(filename, ObjParser::Native);
+
+        std::remove(GetMeshCachePath(filename).c_str());
+        Mesh reference;
+        reference.LoadMeshFromOBJ(filename, ObjParser::TinyObj);
+
+        bool identical = native.GetVertexCount() == reference.GetVertexCount() &&
+                         native.GetIndexCount() == reference.GetIndexCount() &&
+                         memcmp(native.GetVertexData(), reference.GetVertexData(), native.GetVertexCount() * sizeof(Vertex)) == 0 &&
+                         memcmp(native.GetIndexData(), reference.GetIndexData(), native.GetIndexCount() * sizeof(uint32_t)) == 0;
+
+        printf("[ obj_parser ] %-36s output identical to tinyobj : %s\n", filename, identical ? "yes" : "NO");
+    }
+
+    std::remove(GetMeshCachePath(SyntheticObjFilename).c_str());
+    std::remove(SyntheticObjFilename);
+}
+
+// vertex cache efficiency of obj triangle order against optimized order
+static void BenchmarkMeshOptimizer(){
+    for(const char* filename : BenchmarkMeshes){
+        ObjData obj;
+        if(!ParseOBJ(filename, obj)){
+            printf("[ mesh_optimizer ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        Mesh mesh;
+        mesh.LoadMeshFromOBJData(obj);
+        MeshOptimizationStatistics statistics = OptimizeMesh(mesh);
+
+        printf("[ mesh_optimizer ] %-36s %8lu triangles  ACMR : %.3f -> %.3f  ATVR : %.3f -> %.3f  in %.2fms\n",
+            filename, mesh.GetIndexCount() / 3, statistics.before.acmr, statistics.after.acmr,
+            statistics.before.atvr, statistics.after.atvr, statistics.time);
+    }
+}
+
+// meshlet build time and how much of a mesh per meshlet culling removes from a few viewpoints
+static void BenchmarkMeshlets(){
+    for(const char* filename : BenchmarkMeshes){
+        ObjData obj;
+        if(!ParseOBJ(filename, obj)){
+            printf("[ meshlets ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        Mesh mesh;
+        mesh.LoadMeshFromOBJData(obj);
+        OptimizeMesh(mesh);
+        float buildTime = TimeMilliseconds([&](){ BuildMeshlets(mesh); });
+
+        size_t usableCones = 0;
+        for(const Meshlet& meshlet : mesh.meshlets){
+            usableCones += meshlet.coneCutoff < 1.f;
+        }
+
+        printf("[ meshlets ] %-36s %6lu meshlets  %.1f triangles each  %.1f%% usable cones  built in %.2fms\n",
+            filename, mesh.meshlets.size(), mesh.GetIndexCount() / 3.f / mesh.meshlets.size(),
+            100.f * usableCones / mesh.meshlets.size(), buildTime);
+
+        // same projection as main.cpp, views from inside mesh center and from around it
+        glm::mat4 proj = glm::perspective(glm::radians(70.f), 800.f / 600.f, 0.1f, 200.f);
+        glm::vec3 center = mesh.bounds.GetCenter();
+        float distance = glm::length(mesh.bounds.GetExtent()) * 1.5f;
+
+        const char* viewNames[] = {"inside", "outside"};
+        for(uint32_t view = 0; view < 2; view++){
+            constexpr uint32_t directionCount = 8;
+            uint64_t culledTriangles = 0;
+            uint32_t frustumCulled = 0, backfaceCulled = 0;
+            size_t drawCount = 0;
+            std::vector<MeshletDrawRange> ranges;
+
+            float cullTime = TimeMilliseconds([&](){
+                for(uint32_t d = 0; d < directionCount; d++){
+                    float angle = glm::radians(360.f * d / directionCount);
+                    glm::vec3 direction(std::cos(angle), -0.25f, std::sin(angle));
+
+                    glm::vec3 eye = view == 0 ? center : center - glm::normalize(direction) * distance;
+                    glm::mat4 viewMatrix = glm::lookAt(eye, eye + direction, glm::vec3(0.f, 1.f, 0.f));
+
+                    Frustum frustum = Frustum::FromMatrix(proj * viewMatrix);
+                    MeshletCullStatistics culled = CullMeshlets(mesh.GetMeshletData(), mesh.GetMeshletCount(), frustum, eye, ranges);
+
+                    culledTriangles += culled.culledTriangles;
+                    frustumCulled += culled.frustumCulled;
+                    backfaceCulled += culled.backfaceCulled;
+                    drawCount += ranges.size();
+                }
+            });
+
+            float meshletTotal = float(mesh.meshlets.size()) * directionCount;
+            printf("[ meshlets ] %-36s %-8s culled : %5.1f%% triangles  %5.1f%% meshlets by frustum  %5.1f%% by cone  %6.1f draws  %.3fms per view\n",
+                filename, viewNames[view], 100.f * culledTriangles / (mesh.GetIndexCount() / 3.f * directionCount),
+                100.f * frustumCulled / meshletTotal, 100.f * backfaceCulled / meshletTotal,
+                float(drawCount) / directionCount, cullTime / directionCount);
+        }
+    }
+}
+
+// level of detail chain, and triangles a field of instances needs with and without levels of detail
+// frame time with levels of detail on and off is shown by GameZero itself, toggled with L
+static void BenchmarkLod(){
+    for(const char* filename : BenchmarkMeshes){
+        ObjData obj;
+        if(!ParseOBJ(filename, obj)){
+            printf("[ lod ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        Mesh mesh;
+        mesh.LoadMeshFromOBJData(obj);
+        OptimizeMesh(mesh);
+        BuildMeshlets(mesh);
+        float buildTime = TimeMilliseconds([&](){ BuildMeshLods(mesh); });
+
+        printf("[ lod ] %-36s %lu levels built in %.2fms :", filename, mesh.lods.size(), buildTime);
+        for(const MeshLod& lod : mesh.lods){
+            printf("  %u (%.3f)", lod.indexCount / 3, lod.error);
+        }
+        printf("\n");
+
+        // instances on a grid in front of camera, reaching far plane of main.cpp projection
+        constexpr uint32_t gridSize = 16;
+        float spacing = 200.f / gridSize;
+        float scale = spacing * 0.5f / std::max(glm::length(mesh.bounds.max - mesh.bounds.min), 1e-6f);
+
+        glm::mat4 proj = glm::perspective(glm::radians(70.f), 800.f / 600.f, 0.1f, 200.f);
+        float projectionScale = std::fabs(proj[1][1]) * 600.f * 0.5f;
+        glm::vec3 cameraPosition(0.f, spacing, -spacing);
+
+        uint64_t fullTriangles = 0, lodTriangles = 0;
+        uint32_t levelCounts[MeshMaxLodCount] = {};
+        float selectTime = TimeMilliseconds([&](){
+            for(uint32_t z = 0; z < gridSize; z++){
+                for(uint32_t x = 0; x < gridSize; x++){
+                    glm::mat4 transform(scale);
+                    transform[3] = glm::vec4((x - gridSize / 2.f) * spacing, 0.f, z * spacing, 1.f);
+
+                    uint32_t lod = SelectMeshLod(mesh, transform, cameraPosition, projectionScale, 1.f);
+                    fullTriangles += mesh.GetLod(0).indexCount / 3;
+                    lodTriangles += mesh.GetLod(lod).indexCount / 3;
+                    levelCounts[lod]++;
+                }
+            }
+        });
+
+        printf("[ lod ] %-36s %u instances  triangles lod off : %lu  lod on : %lu (%.1f%%)  instances per level :",
+            filename, gridSize * gridSize, fullTriangles, lodTriangles, 100.f * lodTriangles / fullTriangles);
+        for(uint32_t level = 0; level < mesh.lods.size(); level++){
+            printf(" %u", levelCounts[level]);
+        }
+        printf("  selected in %.3fms\n", selectTime);
+    }
+}
+
+// distinct 64 byte cache lines a draw touches when reading stride bytes per vertex
+static size_t CountFetchedCacheLines(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t stride, size_t fetchSize){
+    std::vector<bool> touched((vertexCount * stride + 63) / 64, false);
+    size_t lineCount = 0;
+    for(size_t i = 0; i < indexCount; i++){
+        size_t first = indices[i] * stride / 64;
+        size_t last = (indices[i] * stride + fetchSize - 1) / 64;
+        for(size_t line = first; line <= last; line++){
+            lineCount += !touched[line];
+            touched[line] = true;
+        }
+    }
+    return lineCount;
+}
+
+// gather positions through index buffer like a depth only draw, components of type T
+template<typename T>
+static float GatherPositions(const uint8_t* stream, size_t stride, const uint32_t* indices, size_t indexCount){
+    float sum = 0.f;
+    for(size_t i = 0; i < indexCount; i++){
+        T position[3];
+        memcpy(position, stream + indices[i] * stride, sizeof(position));
+        sum += float(position[0]) + float(position[1]) + float(position[2]);
+    }
+    return sum;
+}
+
+// memory a depth only draw reads with interleaved vertices against position stream alone
+static void BenchmarkVertexStreams(){
+    std::vector<std::pair<std::string, Mesh>> meshes;
+    for(const char* filename : BenchmarkMeshes){
+        Mesh mesh;
+        if(!mesh.LoadMeshFromOBJ(filename)){
+            printf("[ vertex_streams ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+        meshes.emplace_back(filename, std::move(mesh));
+    }
+
+    // large enough to not fit in cpu caches, so gather time follows memory traffic
+    constexpr uint32_t gridSize = 512;
+    Mesh grid;
+    for(uint32_t y = 0; y < gridSize; y++){
+        for(uint32_t x = 0; x < gridSize; x++){
+            Vertex vertex = {};
+            vertex.position = glm::vec3(float(x), std::sin(x * 0.1f) * std::cos(y * 0.1f), float(y));
+            vertex.normal = glm::vec3(0.f, 1.f, 0.f);
+            vertex.color = vertex.normal;
+            vertex.uv = glm::vec2(x, y) / float(gridSize);
+            grid.vertices.push_back(vertex);
+        }
+    }
+    for(uint32_t y = 0; y + 1 < gridSize; y++){
+        for(uint32_t x = 0; x + 1 < gridSize; x++){
+            uint32_t i0 = y * gridSize + x, i1 = i0 + 1, i2 = i0 + gridSize, i3 = i2 + 1;
+            grid.indices.insert(grid.indices.end(), {i0, i2, i1, i1, i2, i3});
+        }
+    }
+    grid.bounds = {glm::vec3(0.f, -1.f, 0.f), glm::vec3(gridSize - 1.f, 1.f, gridSize - 1.f)};
+    OptimizeMesh(grid);
+    meshes.emplace_back("generated grid", std::move(grid));
+
+    for(auto& [name, mesh] : meshes){
+        for(VertexFormat format : {VertexFormat::Standard, VertexFormat::Compact}){
+            mesh.vertexFormat = format;
+            VertexStreams streams = mesh.BuildVertexStreams();
+            bool compact = format == VertexFormat::Compact;
+
+            // same vertices interleaved, as they were uploaded before streams were split
+            size_t interleavedStride = streams.positionStride + streams.attributeStride;
+            size_t vertexCount = mesh.GetVertexCount();
+            std::vector<uint8_t> interleaved(vertexCount * interleavedStride);
+            for(size_t i = 0; i < vertexCount; i++){
+                memcpy(&interleaved[i * interleavedStride], &streams.data[i * streams.positionStride], streams.positionStride);
+                memcpy(&interleaved[i * interleavedStride + streams.positionStride], &streams.data[streams.attributeOffset + i * streams.attributeStride], streams.attributeStride);
+            }
+
+            const uint32_t* indices = mesh.GetIndexData();
+            size_t indexCount = mesh.GetIndexCount();
+            size_t positionSize = compact ? 3 * sizeof(uint16_t) : sizeof(glm::vec3);
+
+            size_t interleavedLines = CountFetchedCacheLines(indices, indexCount, vertexCount, interleavedStride, positionSize);
+            size_t streamLines = CountFetchedCacheLines(indices, indexCount, vertexCount, streams.positionStride, positionSize);
+
+            constexpr uint32_t repeatCount = 10;
+            float sum = 0.f;
+            float interleavedTime = TimeMilliseconds([&](){
+                for(uint32_t r = 0; r < repeatCount; r++){
+                    sum += compact ? GatherPositions<uint16_t>(interleaved.data(), interleavedStride, indices, indexCount)
+                                   : GatherPositions<float>(interleaved.data(), interleavedStride, indices, indexCount);
+                }
+            }) / repeatCount;
+            float streamTime = TimeMilliseconds([&](){
+                for(uint32_t r = 0; r < repeatCount; r++){
+                    sum += compact ? GatherPositions<uint16_t>(streams.data.data(), streams.positionStride, indices, indexCount)
+                                   : GatherPositions<float>(streams.data.data(), streams.positionStride, indices, indexCount);
+                }
+            }) / repeatCount;
+
+            printf("[ vertex_streams ] %-36s %-8s depth draw fetches interleaved : %8.1f KB  position stream : %8.1f KB (%4.1f%%)  gather : %6.2fms -> %6.2fms  [%.0f]\n",
+                name.c_str(), compact ? "compact" : "standard", interleavedLines * 64 / 1024.f, streamLines * 64 / 1024.f,
+                100.f * streamLines / interleavedLines, interleavedTime, streamTime, sum);
+        }
+    }
+}
+
+// bounds of bundled meshes, and SIMD bounds against a plain glm loop on a vertex array larger than cpu caches
+static void BenchmarkBounds(){
+    for(const char* filename : BenchmarkMeshes){
+        Mesh mesh;
+        if(!mesh.LoadMeshFromOBJ(filename)){
+            printf("[ bounds ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        // sphere around box would reach box corners
+        float boxRadius = glm::length(mesh.bounds.GetExtent());
+        printf("[ bounds ] %-36s sphere radius : %.3f  sphere around box : %.3f (%.1f%% of its volume)\n",
+            filename, mesh.boundingSphere.radius, boxRadius, 100.f * std::pow(mesh.boundingSphere.radius / boxRadius, 3.f));
+    }
+
+    constexpr size_t vertexCount = 1 << 22;
+    std::vector<Vertex> vertices(vertexCount);
+    for(size_t i = 0; i < vertexCount; i++){
+        vertices[i] = {};
+        vertices[i].position = glm::vec3(std::sin(i * 0.001f) * i, std::cos(i * 0.003f) * 100.f, float(i % 4093) - 2000.f);
+    }
+
+    constexpr uint32_t repeatCount = 10;
+    BoundingBox scalarBox, simdBox;
+    float scalarTime = TimeMilliseconds([&](){
+        for(uint32_t r = 0; r < repeatCount; r++){
+            scalarBox.min = scalarBox.max = vertices[0].position;
+            for(const Vertex& vertex : vertices){
+                scalarBox.min = glm::min(scalarBox.min, vertex.position);
+                scalarBox.max = glm::max(scalarBox.max, vertex.position);
+            }
+        }
+    }) / repeatCount;
+    float simdTime = TimeMilliseconds([&](){
+        for(uint32_t r = 0; r < repeatCount; r++){
+            simdBox = ComputeVertexBounds(vertices.data(), vertices.size());
+        }
+    }) / repeatCount;
+
+    bool same = scalarBox.min == simdBox.min && scalarBox.max == simdBox.max;
+    float gigabytes = vertexCount * sizeof(Vertex) / (1024.f * 1024.f * 1024.f);
+    printf("[ bounds ] %u vertices  glm box : %6.2fms (%5.2f GB/s)  simd box : %6.2fms (%5.2f GB/s)  same box : %s\n",
+        uint32_t(vertexCount), scalarTime, gigabytes / (scalarTime / 1000.f), simdTime, gigabytes / (simdTime / 1000.f), same ? "yes" : "no");
+}
+
+// meshes streaming in and out of a geometry buffer, how fast ranges are handed out and how fragmented it gets
+static void BenchmarkGeometryBuffer(){
+    constexpr uint64_t capacity = 1 << 22;
+    constexpr uint32_t operationCount = 200000;
+
+    RangeAllocator allocator;
+    allocator.Reset(capacity);
+
+    // live ranges, replaced at random once buffer is about three quarters full
+    std::vector<std::pair<uint64_t, uint64_t>> live;
+    uint32_t seed = 12345;
+    auto random = [&seed](){ seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+    uint32_t failed = 0;
+    float time = TimeMilliseconds([&](){
+        for(uint32_t i = 0; i < operationCount; i++){
+            if(!live.empty() && (allocator.GetUsed() > capacity * 3 / 4 || random() % 2 == 0)){
+                size_t index = random() % live.size();
+                allocator.Free(live[index].first, live[index].second);
+                live[index] = live.back();
+                live.pop_back();
+                continue;
+            }
+
+            // mostly small props with an occasional large mesh
+            uint64_t size = random() % 16 == 0 ? 20000 + random() % 60000 : 100 + random() % 4000;
+            uint64_t offset;
+            if(allocator.Allocate(size, offset)) live.emplace_back(offset, size);
+            else failed++;
+        }
+    });
+
+    printf("[ geometry_buffer ] %u allocations and frees in %.2fms (%.0f ns each)  used : %.1f%%  free ranges : %lu  largest free : %.1f%% of free  failed : %u\n",
+        operationCount, time, time * 1e6f / operationCount, 100.f * allocator.GetUsed() / capacity, allocator.GetFreeRangeCount(),
+        100.f * allocator.GetLargestFreeRange() / std::max<uint64_t>(capacity - allocator.GetUsed(), 1), failed);
+
+    // everything returned must merge back into one range
+    for(const auto& [offset, size] : live) allocator.Free(offset, size);
+    printf("[ geometry_buffer ] after freeing all ranges : %lu free range of %lu elements\n", allocator.GetFreeRangeCount(), allocator.GetLargestFreeRange());
+}
+
+/// generated voxel terrain used when lost_empire is not around
+static const char* SyntheticVoxelFilename = "benchmark_voxels.obj";
+
+// write a heightmap of unit blocks as one textured quad per visible block face, like voxel map exporters do
+// texture coordinates use tiles of a 16x16 atlas, inset by a little to avoid bleeding
+static void WriteSyntheticVoxelObj(const char* filename, int32_t size){
+    std::ofstream file(filename);
+    char line[256];
+
+    auto Height = [size](int32_t x, int32_t z){
+        if(x < 0 || z < 0 || x >= size || z >= size) return 0;
+        return 4 + int32_t(3.f * std::sin(x * 0.11f) + 3.f * std::cos(z * 0.07f) + 2.f * std::sin((x + z) * 0.03f));
+    };
+
+    // v and vt are written per face, exporters rarely share them
+    uint32_t faceCount = 0;
+    auto WriteFace = [&](const glm::vec3 corners[4], const glm::vec3& normal, int32_t tile){
+        float inset = 0.5f / 8192.f;
+        float u0 = (tile % 16) / 16.f + inset, u1 = (tile % 16 + 1) / 16.f - inset;
+        float v0 = (tile / 16) / 16.f + inset, v1 = (tile / 16 + 1) / 16.f - inset;
+        const float uvs[4][2] = {{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}};
+        for(int c = 0; c < 4; c++){
+            snprintf(line, sizeof(line), "v %g %g %g\nvt %.6f %.6f\n", corners[c].x, corners[c].y, corners[c].z, uvs[c][0], uvs[c][1]);
+            file << line;
+        }
+        snprintf(line, sizeof(line), "vn %g %g %g\n", normal.x, normal.y, normal.z);
+        file << line;
+
+        uint32_t v = faceCount * 4 + 1, n = faceCount + 1;
+        snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", v, v, n, v + 1, v + 1, n, v + 2, v + 2, n, v + 3, v + 3, n);
+        file << line;
+        faceCount++;
+    };
+
+    for(int32_t z = 0; z < size; z++){
+        for(int32_t x = 0; x < size; x++){
+            int32_t height = Height(x, z);
+            float fx = float(x), fz = float(z), top = float(height);
+
+            // grass on top, dirt and stone on the sides, counter clockwise seen from outside
+            const glm::vec3 topFace[4] = {{fx, top, fz}, {fx, top, fz + 1}, {fx + 1, top, fz + 1}, {fx + 1, top, fz}};
+            WriteFace(topFace, glm::vec3(0, 1, 0), height > 6 ? 1 : 0);
+
+            const int32_t neighbours[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+            for(const auto& offset : neighbours){
+                for(int32_t y = Height(x + offset[0], z + offset[1]); y < height; y++){
+                    float y0 = float(y), y1 = float(y + 1);
+                    int32_t tile = y + 1 == height ? 2 : 3;
+                    glm::vec3 face[4];
+                    if(offset[0] == 1)       { face[0] = {fx + 1, y0, fz + 1}; face[1] = {fx + 1, y0, fz}; face[2] = {fx + 1, y1, fz}; face[3] = {fx + 1, y1, fz + 1}; }
+                    else if(offset[0] == -1) { face[0] = {fx, y0, fz}; face[1] = {fx, y0, fz + 1}; face[2] = {fx, y1, fz + 1}; face[3] = {fx, y1, fz}; }
+                    else if(offset[1] == 1)  { face[0] = {fx, y0, fz + 1}; face[1] = {fx + 1, y0, fz + 1}; face[2] = {fx + 1, y1, fz + 1}; face[3] = {fx, y1, fz + 1}; }
+                    else                     { face[0] = {fx + 1, y0, fz}; face[1] = {fx, y0, fz}; face[2] = {fx, y1, fz}; face[3] = {fx + 1, y1, fz}; }
+                    WriteFace(face, glm::vec3(float(offset[0]), 0.f, float(offset[1])), tile);
+                }
+            }
+        }
+    }
+}
+
+// triangles and vertices saved by merging block faces, frame time is shown by GameZero itself, toggled with M
+static void BenchmarkFaceMerging(){
+    WriteSyntheticVoxelObj(SyntheticVoxelFilename, 256);
+
+    for(const char* filename : {BenchmarkMeshes[0], SyntheticVoxelFilename}){
+        ObjData obj;
+        if(!ParseOBJ(filename, obj)){
+            printf("[ face_merging ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        Mesh mesh;
+        mesh.LoadMeshFromOBJData(obj);
+        size_t blockBytes = mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+
+        FaceMergeStatistics merge = MergeCoplanarFaces(mesh);
+        if(!mesh.uvTiling.IsEnabled()){
+            printf("[ face_merging ] %-36s skipped, texture coordinates do not follow an atlas grid\n", filename);
+            continue;
+        }
+        size_t mergedBytes = mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+
+        printf("[ face_merging ] %-36s %ux%u atlas  quads : %u -> %u  triangles : %u -> %u (%.1f%%)  vertices : %u -> %u  memory : %.2f MB -> %.2f MB  in %.2fms\n",
+            filename, merge.tilesU, merge.tilesV, merge.quadsBefore, merge.quadsAfter, merge.trianglesBefore, merge.trianglesAfter,
+            100.f * merge.trianglesAfter / std::max(merge.trianglesBefore, 1u), merge.verticesBefore, merge.verticesAfter,
+            blockBytes / (1024.f * 1024.f), mergedBytes / (1024.f * 1024.f), merge.time);
+    }
+
+    std::remove(SyntheticVoxelFilename);
+}
+
+// edit 1% of a large grid every frame and write frame copies, ranged against writing whole mesh
+static void BenchmarkDynamicMesh(){
+    constexpr uint32_t gridSize = 1024;
+    constexpr uint32_t frameCount = 300;
+    constexpr uint32_t vertexCount = gridSize * gridSize;
+    constexpr uint32_t indexCount = (gridSize - 1) * (gridSize - 1) * 6;
+    // side of a square brush covering 1% of vertices
+    const uint32_t brushSize = uint32_t(std::sqrt(vertexCount / 100.f));
+
+    std::vector<Vertex> vertices(vertexCount);
+    for(uint32_t z = 0; z < gridSize; z++){
+        for(uint32_t x = 0; x < gridSize; x++){
+            Vertex& vertex = vertices[z * gridSize + x];
+            vertex.position = glm::vec3(float(x), 0.f, float(z));
+            vertex.normal = glm::vec3(0.f, 1.f, 0.f);
+            vertex.color = vertex.normal;
+            vertex.uv = glm::vec2(x / float(gridSize), z / float(gridSize));
+        }
+    }
+    std::vector<uint32_t> indices;
+    indices.reserve(indexCount);
+    for(uint32_t z = 0; z + 1 < gridSize; z++){
+        for(uint32_t x = 0; x + 1 < gridSize; x++){
+            uint32_t v = z * gridSize + x;
+            indices.insert(indices.end(), {v, v + gridSize, v + 1, v + 1, v + gridSize, v + gridSize + 1});
+        }
+    }
+
+    uint32_t seed = 12345;
+    auto random = [&seed](){ seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+    // terrain brush raises a square, each row of it is a separate range
+    auto Brush = [&](DynamicMesh& mesh){
+        uint32_t x0 = random() % (gridSize - brushSize), z0 = random() % (gridSize - brushSize);
+        for(uint32_t z = z0; z < z0 + brushSize; z++){
+            Vertex* row = mesh.EditVertices(z * gridSize + x0, brushSize);
+            for(uint32_t x = 0; x < brushSize; x++) row[x].position.y += 0.1f;
+        }
+    };
+    // single vertices all over the grid, worst case for ranges
+    auto Scatter = [&](DynamicMesh& mesh){
+        for(uint32_t i = 0; i < vertexCount / 100; i++){
+            mesh.EditVertices(random() % vertexCount, 1)->position.y += 0.1f;
+        }
+    };
+
+    struct Case{
+        const char* name;
+        std::function<void(DynamicMesh&)> edit;
+        bool full;
+    };
+    const Case cases[] = {
+        {"brush, whole mesh", Brush, true},
+        {"brush, dirty ranges", Brush, false},
+        {"scatter, dirty ranges", Scatter, false},
+    };
+
+    for(const Case& test : cases){
+        DynamicMesh mesh;
+        mesh.SetCapacity(vertexCount, indexCount);
+        mesh.SetVertices(0, vertices.data(), vertexCount);
+        mesh.SetIndices(0, indices.data(), indexCount);
+        mesh.SetIndexCount(indexCount);
+
+        // host memory stands in for mapped gpu buffers
+        std::vector<std::vector<uint8_t>> vertexCopies(FrameOverlapCount, std::vector<uint8_t>(mesh.GetVertexBufferSize()));
+        std::vector<std::vector<uint32_t>> indexCopies(FrameOverlapCount, std::vector<uint32_t>(indexCount));
+        for(size_t f = 0; f < FrameOverlapCount; f++){
+            mesh.frames[f].vertexData = vertexCopies[f].data();
+            mesh.frames[f].indexData = indexCopies[f].data();
+            mesh.WriteFrame(f);
+        }
+
+        uint64_t bytes = 0, ranges = 0;
+        float time = TimeMilliseconds([&](){
+            for(uint32_t frame = 0; frame < frameCount; frame++){
+                test.edit(mesh);
+                // whole mesh is marked changed, as an upload once mesh would have to do
+                if(test.full) mesh.EditVertices(0, vertexCount);
+                DynamicMeshUpload upload = mesh.WriteFrame(frame % FrameOverlapCount);
+                bytes += upload.bytes;
+                ranges += upload.vertexRanges + upload.indexRanges;
+            }
+        });
+
+        // let remaining copies catch up, all of them must match latest vertices
+        for(uint32_t frame = frameCount; frame < frameCount + FrameOverlapCount; frame++) mesh.WriteFrame(frame % FrameOverlapCount);
+        bool match = true;
+        for(size_t f = 0; f < FrameOverlapCount; f++){
+            const glm::vec3* positions = reinterpret_cast<const glm::vec3*>(vertexCopies[f].data());
+            for(uint32_t v = 0; v < vertexCount && match; v++) match = positions[v].y == mesh.GetVertexData()[v].position.y;
+        }
+
+        printf("[ dynamic_mesh ] %-26s %.3fms per frame  %.2f MB per frame in %.0f ranges  (%u vertices, %lu frame copies)  copies match : %s\n",
+            test.name, time / frameCount, bytes / (1024.f * 1024.f) / frameCount, float(ranges) / frameCount, vertexCount, FrameOverlapCount, match ? "yes" : "no");
+    }
+}
+
+// encoded size of mesh geometry and how fast it decodes, best of a few runs so that decoding works from cache
+static void BenchmarkMeshCodec(){
+    constexpr int runCount = 20;
+
+    for(const char* filename : BenchmarkMeshes){
+        Mesh mesh;
+        if(!mesh.LoadMeshFromOBJ(filename)){
+            printf("[ mesh_codec ] %-36s skipped, failed to load\n", filename);
+            continue;
+        }
+
+        struct Stream{
+            const char* name;
+            const void* data;
+            size_t count;
+            size_t stride;
+        };
+        const Stream streams[] = {
+            {"vertices", mesh.GetVertexData(), mesh.GetVertexCount(), sizeof(Vertex)},
+            {"indices", mesh.GetIndexData(), mesh.GetIndexCount(), sizeof(uint32_t)}
+        };
+
+        for(const Stream& stream : streams){
+            size_t rawSize = stream.count * stream.stride;
+            bool isIndices = stream.stride == sizeof(uint32_t);
+
+            std::vector<uint8_t> encoded;
+            float encodeTime = TimeMilliseconds([&](){
+                encoded = isIndices ? EncodeIndexBuffer(static_cast<const uint32_t*>(stream.data), stream.count)
+                                    : EncodeVertexBuffer(stream.data, stream.count, stream.stride);
+            });
+
+            std::vector<uint8_t> decoded(rawSize);
+            bool valid = true;
+            float decodeTime = 1e9f;
+            for(int run = 0; run < runCount; run++){
+                decodeTime = std::min(decodeTime, TimeMilliseconds([&](){
+                    valid &= isIndices ? DecodeIndexBuffer(reinterpret_cast<uint32_t*>(decoded.data()), stream.count, encoded.data(), encoded.size())
+                                       : DecodeVertexBuffer(decoded.data(), stream.count, stream.stride, encoded.data(), encoded.size());
+                }));
+            }
+            valid &= memcmp(decoded.data(), stream.data, rawSize) == 0;
+
+            printf("[ mesh_codec ] %-36s %-8s : %7.2f MB -> %7.2f MB (%.2fx)  encode : %7.2fms  decode : %6.2fms (%.2f GB/s)  lossless : %s\n",
+                filename, stream.name, rawSize / (1024.f * 1024.f), encoded.size() / (1024.f * 1024.f), double(rawSize) / std::max<size_t>(encoded.size(), 1),
+                encodeTime, decodeTime, rawSize / (decodeTime * 1e6f), valid ? "yes" : "no");
+        }
+    }
+}
+
+// cold start decodes png, filters mips and writes cache, warm start maps the cache
+// both end by copying all levels into a buffer, as they are copied into a staging buffer on load
+static void BenchmarkTextureCache(){
+    for(const char* filename : BenchmarkTextures){
+        std::remove(GetTextureCachePath(filename).c_str());
+
+        std::vector<uint8_t> staging;
+        auto CopyLevels = [&staging](const std::vector<TextureLevel>& levels){
+            size_t size = 0;
+            for(const TextureLevel& level : levels) size += level.size;
+            staging.resize(size);
+            size_t offset = 0;
+            for(const TextureLevel& level : levels){
+                memcpy(staging.data() + offset, level.data, level.size);
+                offset += level.size;
+            }
+        };
+
+        bool decoded = false;
+        float decodeTime = 0, mipTime = 0, writeTime = 0;
+        float coldTime = TimeMilliseconds([&](){
+            int width, height, channels;
+            stbi_uc* pixels = nullptr;
+            decodeTime = TimeMilliseconds([&](){ pixels = stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha); });
+            if(!pixels) return;
+            decoded = true;
+
+            std::vector<std::vector<uint8_t>> mips;
+            mipTime = TimeMilliseconds([&](){ mips = GenerateMipChain(pixels, uint32_t(width), uint32_t(height), true); });
+            std::vector<TextureLevel> levels = {{pixels, size_t(width) * height * 4}};
+            for(const std::vector<uint8_t>& mip : mips) levels.push_back({mip.data(), mip.size()});
+
+            writeTime = TimeMilliseconds([&](){ WriteTextureCache(filename, static_cast<uint32_t>(vk::Format::eR8G8B8A8Srgb), uint32_t(width), uint32_t(height), levels); });
+            CopyLevels(levels);
+            stbi_image_free(pixels);
+        });
+        if(!decoded){
+            printf("[ texture_cache ] %-40s skipped, failed to load\n", filename);
+            continue;
+        }
+        uint64_t coldChecksum = HashBytes(staging.data(), staging.size());
+
+        MappedFile file;
+        TextureCacheImage image;
+        bool loaded = false;
+        float warmTime = TimeMilliseconds([&](){
+            loaded = LoadTextureCache(filename, file, image);
+            if(loaded) CopyLevels(image.levels);
+        });
+        bool match = loaded && HashBytes(staging.data(), staging.size()) == coldChecksum;
+        // renderer keeps valid caches, an rgba one left here would keep it from choosing a narrower format
+        file.Close();
+        std::remove(GetTextureCachePath(filename).c_str());
+
+        printf("[ texture_cache ] %-40s cold : %8.2fms (decode %.2fms, mips %.2fms, write %.2fms)  warm : %7.2fms  speedup : %.1fx  %.2f MB  match : %s\n",
+            filename, coldTime, decodeTime, mipTime, writeTime, warmTime, coldTime / warmTime, staging.size() / (1024.f * 1024.f), match ? "yes" : "no");
+    }
+}
+
+// bundled images and synthetic ones of each channel layout, with bytes of their mip chains as rgba and as packed
+static void BenchmarkTextureFormats(){
+    const char* layoutNames[] = {"gray", "gray alpha", "normal map", "rgba"};
+    struct FormatImage{
+        std::string name;
+        uint32_t width, height;
+        std::vector<uint8_t> texels;
+        ImageUsage usage = ImageUsage::Color;
+    };
+    std::vector<FormatImage> images;
+
+    for(const char* filename : BenchmarkTextures){
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
+        if(!pixels){
+            printf("[ texture_formats ] %-40s skipped, failed to load\n", filename);
+            continue;
+        }
+        images.push_back({filename, uint32_t(width), uint32_t(height), std::vector<uint8_t>(pixels, pixels + size_t(width) * height * 4)});
+        stbi_image_free(pixels);
+    }
+
+    // mask, mask with alpha, bumps facing out of a plane, and opaque color
+    constexpr uint32_t size = 1024;
+    const char* syntheticNames[] = {"synthetic mask", "synthetic mask with alpha", "synthetic normal map", "synthetic opaque color"};
+    for(uint32_t kind = 0; kind < 4; kind++){
+        FormatImage image = {syntheticNames[kind], size, size, std::vector<uint8_t>(size_t(size) * size * 4), kind == 2 ? ImageUsage::NormalMap : ImageUsage::Color};
+        for(uint32_t y = 0; y < size; y++){
+            for(uint32_t x = 0; x < size; x++){
+                uint8_t* texel = &image.texels[(size_t(y) * size + x) * 4];
+                float u = x / float(size), v = y / float(size);
+                uint8_t value = uint8_t(255.f * (0.5f + 0.5f * std::sin(u * 20.f) * std::cos(v * 20.f)));
+                if(kind == 2){
+                    glm::vec3 normal = glm::normalize(glm::vec3(0.4f * std::cos(u * 20.f), -0.4f * std::sin(v * 20.f), 1.f));
+                    texel[0] = uint8_t(std::lround((normal.x * 0.5f + 0.5f) * 255.f));
+                    texel[1] = uint8_t(std::lround((normal.y * 0.5f + 0.5f) * 255.f));
+                    texel[2] = uint8_t(std::lround((normal.z * 0.5f + 0.5f) * 255.f));
+                }else{
+                    texel[0] = value;
+                    texel[1] = kind == 3 ? uint8_t(x) : value;
+                    texel[2] = kind == 3 ? uint8_t(y) : value;
+                }
+                texel[3] = kind == 1 ? uint8_t(255 - value) : 255;
+            }
+        }
+        images.push_back(std::move(image));
+    }
+
+    uint64_t allRgbaBytes = 0, allPackedBytes = 0;
+    for(const FormatImage& image : images){
+        size_t texelCount = size_t(image.width) * image.height;
+        ImageChannelLayout layout;
+        float analyzeTime = TimeMilliseconds([&](){ layout = AnalyzeImageChannels(image.texels.data(), texelCount, image.usage); });
+
+        std::vector<std::vector<uint8_t>> mips = GenerateMipChain(image.texels.data(), image.width, image.height, image.usage == ImageUsage::Color);
+        uint64_t rgbaBytes = image.texels.size();
+        for(const std::vector<uint8_t>& mip : mips) rgbaBytes += mip.size();
+        uint64_t packedBytes = rgbaBytes / 4 * GetChannelLayoutSize(layout);
+
+        std::vector<uint8_t> packed(texelCount * GetChannelLayoutSize(layout));
+        float packTime = TimeMilliseconds([&](){ PackImageChannels(image.texels.data(), texelCount, layout, packed.data()); });
+
+        printf("[ texture_formats ] %-40s %-10s  analyze : %6.2fms  pack : %6.2fms  %6.2f MB -> %6.2f MB  saved : %6.2f MB\n",
+            image.name.c_str(), layoutNames[int(layout)], analyzeTime, packTime, rgbaBytes / (1024.f * 1024.f), packedBytes / (1024.f * 1024.f),
+            (rgbaBytes - packedBytes) / (1024.f * 1024.f));
+        allRgbaBytes += rgbaBytes;
+        allPackedBytes += packedBytes;
+    }
+    printf("[ texture_formats ] all images %.2f MB -> %.2f MB\n", allRgbaBytes / (1024.f * 1024.f), allPackedBytes / (1024.f * 1024.f));
+}
+
+// camera flies over a grid of textured quads holding far more texels than budget allows
+static void BenchmarkTextureStreaming(){
+    constexpr uint32_t gridSize = 32, textureSize = 2048, frameCount = 600;
+    constexpr float spacing = 4.f;
+    constexpr uint64_t budget = 512ull * 1024 * 1024, uploadLimit = 32ull * 1024 * 1024;
+
+    // quad of side 2 with texture stretched over it once
+    Mesh quad;
+    quad.boundingSphere.center = glm::vec3(0.f);
+    quad.boundingSphere.radius = std::sqrt(2.f);
+    float texelDensity = 0.5f * textureSize;
+
+    uint32_t levelCount = 1;
+    while((textureSize >> levelCount) > 0) levelCount++;
+    std::vector<StreamedTextureState> textures(gridSize * gridSize);
+    uint64_t allBytes = 0;
+    for(StreamedTextureState& texture : textures){
+        texture.levelCount = levelCount;
+        for(uint32_t level = 0; level < levelCount; level++){
+            uint64_t size = std::max(textureSize >> level, 1u);
+            texture.levelSizes[level] = (size * size * 4 + 15) & ~uint64_t(15);
+        }
+        // startup levels of at most 128 texels are never evicted
+        while((textureSize >> texture.minResidentLevel) > 128) texture.minResidentLevel++;
+        texture.residentLevel = texture.minResidentLevel;
+        allBytes += texture.GetImageSize(0);
+    }
+
+    glm::mat4 proj = glm::perspective(glm::radians(70.f), 800.f / 600.f, 0.1f, 200.f);
+    float projectionScale = std::fabs(proj[1][1]) * 600.f * 0.5f;
+
+    TextureResidencyPlan plan;
+    uint64_t peakBytes = 0, settledPeakBytes = 0, uploadedBytes = 0, loadedLevels = 0, evictedLevels = 0;
+    float planTime = 0, maxPlanTime = 0;
+    for(uint32_t frame = 0; frame < frameCount; frame++){
+        // changes planned last frame have landed, images they replaced are released
+        for(StreamedTextureState& texture : textures) texture.pending = false;
+
+        // low pass over grid, diagonally from one corner to the other, seeing quads ahead of it
+        float t = float(frame) / frameCount;
+        glm::vec3 cameraPosition = glm::vec3(t * gridSize * spacing, 1.f, t * gridSize * spacing);
+        glm::vec3 cameraFront = glm::normalize(glm::vec3(1.f, 0.f, 1.f));
+
+        float time = TimeMilliseconds([&](){
+            for(uint32_t i = 0; i < textures.size(); i++){
+                glm::mat4 transform(1.f);
+                transform[3] = glm::vec4((i % gridSize) * spacing, 0.f, (i / gridSize) * spacing, 1.f);
+
+                StreamedTextureState& texture = textures[i];
+                glm::vec3 toQuad = glm::vec3(transform[3]) - cameraPosition;
+                if(glm::dot(toQuad, cameraFront) < -quad.boundingSphere.radius || glm::length(toQuad) > 60.f){
+                    texture.requestedLevel = levelCount;
+                    continue;
+                }
+                texture.requestedLevel = SelectTextureMipLevel(quad, transform, cameraPosition, projectionScale, texelDensity, levelCount);
+                texture.lastUsedFrame = frame;
+            }
+            PlanTextureResidency(textures, 0, budget, uploadLimit, plan);
+        });
+        planTime += time;
+        maxPlanTime = std::max(maxPlanTime, time);
+
+        // old images of changed textures are held until their new ones land
+        uint64_t replacedBytes = 0;
+        for(const TextureResidencyChange& change : plan.changes) replacedBytes += textures[change.texture].GetImageSize(change.level);
+        peakBytes = std::max(peakBytes, plan.residentBytes + replacedBytes);
+        settledPeakBytes = std::max(settledPeakBytes, plan.residentBytes);
+        uploadedBytes += plan.uploadBytes;
+        loadedLevels += plan.loadedLevels;
+        evictedLevels += plan.evictedLevels;
+    }
+
+    const float MB = 1024.f * 1024.f;
+    printf("[ texture_streaming ] %u textures of %u texels  all levels : %.0f MB  budget : %.0f MB  settled peak : %.1f MB (%s)  peak with replaced images : %.1f MB\n",
+        gridSize * gridSize, textureSize, allBytes / MB, budget / MB, settledPeakBytes / MB, settledPeakBytes <= budget ? "within budget" : "over budget", peakBytes / MB);
+    printf("[ texture_streaming ] %u frames  levels loaded : %lu  evicted : %lu  uploaded : %.1f MB  plan : %.3fms average  %.3fms worst\n",
+        frameCount, loadedLevels, evictedLevels, uploadedBytes / MB, planTime / frameCount, maxPlanTime);
+}
+
+// many small textures of a few sizes and formats, drawn by objects that each use one of them
+static void BenchmarkTextureArrays(){
+    constexpr uint32_t textureCount = 600, objectCount = 5000;
+    const uint32_t sizes[] = {32, 64, 128, 256, 1024};
+    // 8 bit srgb rgba and BC7 srgb
+    const uint32_t formats[] = {43, 146};
+
+    std::vector<TextureArrayKey> keys(textureCount);
+    std::vector<bool> packable(textureCount);
+    uint32_t seed = 1;
+    auto Random = [&seed](){ seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    for(uint32_t i = 0; i < textureCount; i++){
+        uint32_t size = sizes[Random() % 5];
+        keys[i] = {formats[Random() % 2], size, size, 0};
+        for(uint32_t level = size; level > 0; level >>= 1) keys[i].levelCount++;
+        packable[i] = size <= 512;
+    }
+
+    std::vector<TextureArrayGroup> groups;
+    uint32_t packedCount = 0;
+    float groupTime = TimeMilliseconds([&](){ packedCount = GroupTextureArrays(keys, packable, 256, groups); });
+
+    // texture set of each texture, its own or that of its array
+    std::vector<uint32_t> textureSets(textureCount);
+    for(uint32_t i = 0; i < textureCount; i++) textureSets[i] = textureCount + i;
+    for(uint32_t g = 0; g < groups.size(); g++){
+        for(uint32_t index : groups[g].textures) textureSets[index] = g;
+    }
+
+    // draws sorted by texture set, set is bound whenever it changes, like Renderer::DrawObjects
+    std::vector<uint32_t> objectTextures(objectCount);
+    for(uint32_t& texture : objectTextures) texture = Random() % textureCount;
+    auto CountBinds = [&](bool packed){
+        std::vector<uint32_t> sets;
+        for(uint32_t texture : objectTextures) sets.push_back(packed ? textureSets[texture] : texture);
+        std::sort(sets.begin(), sets.end());
+        return uint32_t(std::unique(sets.begin(), sets.end()) - sets.begin());
+    };
+
+    printf("[ texture_arrays ] %u textures  packed : %u into %zu arrays in %.3fms  texture set binds for %u objects : %u separate  %u packed\n",
+        textureCount, packedCount, groups.size(), groupTime, objectCount, CountBinds(false), CountBinds(true));
+}
+
+// each import kernel against the plain loop it replaced, stb_image's channel conversion for expansion
+static void BenchmarkImageKernels(){
+    constexpr uint32_t size = 2048, repeatCount = 5;
+    constexpr size_t texelCount = size_t(size) * size;
+    const SrgbTables& tables = GetSrgbTables();
+
+    // smooth color with noise, alpha fading out across image
+    std::vector<uint8_t> image(texelCount * 4);
+    uint32_t seed = 7;
+    auto Random = [&seed](){ seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+    for(uint32_t y = 0; y < size; y++){
+        for(uint32_t x = 0; x < size; x++){
+            uint8_t* texel = &image[(size_t(y) * size + x) * 4];
+            texel[0] = uint8_t(x + Random() % 16);
+            texel[1] = uint8_t(y + Random() % 16);
+            texel[2] = uint8_t(128.f + 127.f * std::sin(x * 0.01f + y * 0.02f));
+            texel[3] = uint8_t(255 - x * 255 / size);
+        }
+    }
+    printf("[ image_kernels ] %ux%u rgba, %s kernels\n", size, size, GetImageKernelTarget());
+
+    // prepare runs before each pair of timed runs and is not timed, outputs of both are compared afterwards
+    auto Compare = [&](const char* name, const char* referenceName, size_t bytes, const std::vector<uint8_t>& referenceOutput, const std::vector<uint8_t>& kernelOutput,
+                       const std::function<void()>& prepare, const std::function<void()>& reference, const std::function<void()>& kernel){
+        float referenceTime = 0, kernelTime = 0;
+        for(uint32_t r = 0; r < repeatCount; r++){
+            prepare();
+            referenceTime += TimeMilliseconds(reference);
+            kernelTime += TimeMilliseconds(kernel);
+        }
+        referenceTime /= repeatCount;
+        kernelTime /= repeatCount;
+
+        int maxDifference = 0;
+        for(size_t i = 0; i < referenceOutput.size(); i++) maxDifference = std::max(maxDifference, std::abs(int(referenceOutput[i]) - int(kernelOutput[i])));
+        float megabytes = bytes / (1024.f * 1024.f);
+        printf("[ image_kernels ] %-22s %-6s : %6.2fms (%7.1f MB/s)  kernel : %6.2fms (%7.1f MB/s)  speedup : %4.1fx  max difference : %d\n",
+            name, referenceName, referenceTime, megabytes / (referenceTime / 1000.f), kernelTime, megabytes / (kernelTime / 1000.f), referenceTime / kernelTime, maxDifference);
+    };
+
+    // same per texel loop stbi_load converts with when asked for rgba
+    std::vector<uint8_t> referenceOutput(texelCount * 4), kernelOutput(texelCount * 4);
+    const char* expandNames[] = {"expand gray", "expand gray alpha", "expand rgb"};
+    const uint32_t expandChannels[][4] = {{0}, {0, 3}, {0, 1, 2}};
+    for(uint32_t channelCount = 1; channelCount <= 3; channelCount++){
+        std::vector<uint8_t> source(texelCount * channelCount);
+        for(size_t i = 0; i < texelCount; i++){
+            for(uint32_t c = 0; c < channelCount; c++) source[i * channelCount + c] = image[i * 4 + expandChannels[channelCount - 1][c]];
+        }
+        Compare(expandNames[channelCount - 1], "stb", texelCount * 4, referenceOutput, kernelOutput, [](){}, [&](){
+            const uint8_t* in = source.data();
+            uint8_t* out = referenceOutput.data();
+            for(size_t i = 0; i < texelCount; i++, in += channelCount, out += 4){
+                switch(channelCount){
+                    case 1: out[0] = out[1] = out[2] = in[0]; out[3] = 255; break;
+                    case 2: out[0] = out[1] = out[2] = in[0]; out[3] = in[1]; break;
+                    default: out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = 255; break;
+                }
+            }
+        }, [&](){ ExpandToRgba(source.data(), texelCount, channelCount, kernelOutput.data()); });
+    }
+
+    // 2x2 box of whole image on one thread, the way DownsampleImage filtered before it used DownsampleRow
+    uint32_t levelSize = GetDownsampledSize(size);
+    referenceOutput.resize(size_t(levelSize) * levelSize * 4);
+    kernelOutput.resize(referenceOutput.size());
+    for(bool srgb : {false, true}){
+        Compare(srgb ? "downsample srgb" : "downsample linear", "scalar", image.size(), referenceOutput, kernelOutput, [](){}, [&](){
+            for(uint32_t y = 0; y < levelSize; y++){
+                const uint8_t* row0 = image.data() + size_t(y * 2) * size * 4;
+                const uint8_t* row1 = row0 + size * 4;
+                uint8_t* out = referenceOutput.data() + size_t(y) * levelSize * 4;
+                for(uint32_t x = 0; x < levelSize; x++, out += 4){
+                    uint32_t x0 = x * 8, x1 = x * 8 + 4;
+                    for(uint32_t c = 0; c < 3; c++){
+                        if(srgb){
+                            float sum = tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] + tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]];
+                            out[c] = tables.toSrgb[uint32_t(sum * (LinearToSrgbSize / 4.0f) + 0.5f)];
+                        }else{
+                            out[c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                        }
+                    }
+                    out[3] = uint8_t((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) / 4);
+                }
+            }
+        }, [&](){ DownsampleImage(image.data(), size, size, kernelOutput.data(), srgb, 1); });
+    }
+
+    // in place, both start from a fresh copy of image
+    referenceOutput.resize(image.size());
+    kernelOutput.resize(image.size());
+    for(bool srgb : {false, true}){
+        Compare(srgb ? "premultiply srgb" : "premultiply linear", "scalar", image.size(), referenceOutput, kernelOutput, [&](){
+            referenceOutput = image;
+            kernelOutput = image;
+        }, [&](){
+            uint8_t* texel = referenceOutput.data();
+            for(size_t i = 0; i < texelCount; i++, texel += 4){
+                for(uint32_t c = 0; c < 3; c++){
+                    if(srgb) texel[c] = tables.toSrgb[uint32_t(tables.toLinear[texel[c]] * (texel[3] / 255.f) * float(LinearToSrgbSize) + 0.5f)];
+                    else texel[c] = uint8_t((texel[c] * texel[3] + 127) / 255);
+                }
+            }
+        }, [&](){ PremultiplyAlpha(kernelOutput.data(), texelCount, srgb); });
+    }
+}
+
+// bundled pngs decoded by stb_image and by DecodePng, to a new buffer and to one that already exists like staging memory
+static void BenchmarkPngDecoder(){
+    constexpr uint32_t repeatCount = 2;
+    for(const char* filename : BenchmarkTextures){
+        MappedFile file;
+        PngImage png;
+        if(!file.Open(filename) || !ParsePng(file.data, file.size, png)){
+            printf("[ png_decoder ] %-40s skipped, not a png DecodePng accepts\n", filename);
+            continue;
+        }
+        size_t size = size_t(png.width) * png.height * 4;
+        std::vector<uint8_t> reference, decoded, staging(size);
+
+        // fastest of a few runs, first one also reads file from disk
+        float stbTime = 0, fastTime = 0, stagingTime = 0;
+        bool loaded = true;
+        for(uint32_t r = 0; r < repeatCount; r++){
+            int width, height, channels;
+            stbi_uc* pixels = nullptr;
+            float time = TimeMilliseconds([&](){ pixels = stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha); });
+            stbTime = r ? std::min(stbTime, time) : time;
+            if(pixels) reference.assign(pixels, pixels + size);
+            else loaded = false;
+            stbi_image_free(pixels);
+
+            uint32_t fastWidth, fastHeight;
+            uint8_t* texels = nullptr;
+            time = TimeMilliseconds([&](){ texels = LoadImageRgba(filename, fastWidth, fastHeight, nullptr, PngDecoder::Fast); });
+            fastTime = r ? std::min(fastTime, time) : time;
+            if(texels) decoded.assign(texels, texels + size);
+            else loaded = false;
+            stbi_image_free(texels);
+
+            time = TimeMilliseconds([&](){ loaded = DecodePng(png, staging.data(), size_t(png.width) * 4) && loaded; });
+            stagingTime = r ? std::min(stagingTime, time) : time;
+        }
+
+        bool match = loaded && reference == decoded && reference == staging;
+        float megabytes = size / (1024.f * 1024.f);
+        printf("[ png_decoder ] %-40s stb : %8.2fms (%6.1f MB/s)  fast : %8.2fms (%6.1f MB/s)  into staging : %8.2fms  speedup : %.1fx  match : %s\n",
+            filename, stbTime, megabytes / (stbTime / 1000.f), fastTime, megabytes / (fastTime / 1000.f), stagingTime, stbTime / fastTime, match ? "yes" : "no");
+    }
+}
+
+/// a named benchmark
+struct Benchmark{
+    const char* name;
+    std::function<void()> function;
+};
+
+int main(int argc, char** argv){
+    std::vector<Benchmark> benchmarks = {
+        {"mesh_cache", BenchmarkMeshCache},
+        {"indexing", BenchmarkMeshIndexing},
+        {"obj_parser", BenchmarkObjParser},
+        {"mesh_optimizer", BenchmarkMeshOptimizer},
+        {"meshlets", BenchmarkMeshlets},
+        {"lod", BenchmarkLod},
+        {"vertex_streams", BenchmarkVertexStreams},
+        {"bounds", BenchmarkBounds},
+        {"geometry_buffer", BenchmarkGeometryBuffer},
+        {"face_merging", BenchmarkFaceMerging},
+        {"dynamic_mesh", BenchmarkDynamicMesh},
+        {"mesh_codec", BenchmarkMeshCodec},
+        {"texture_cache", BenchmarkTextureCache},
+        {"texture_formats", BenchmarkTextureFormats},
+        {"texture_streaming", BenchmarkTextureStreaming},
+        {"texture_arrays", BenchmarkTextureArrays},
+        {"image_kernels", BenchmarkImageKernels},
+        {"png_decoder", BenchmarkPngDecoder}
+    };
+
+    for(const Benchmark& benchmark : benchmarks){
+        // run selected benchmarks only
+        bool selected = argc <= 1;
+        for(int i = 1; i < argc; i++){
+            if(strcmp(argv[i], benchmark.name) == 0) selected = true;
+        }
+
+        if(selected) benchmark.function();
+    }
+
+    return 0;
+}
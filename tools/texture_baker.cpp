@@ -0,0 +1,230 @@
+/**
+ * @file texture_baker.cpp
+ * @author Siddharth Mishra (bshock665@gmail.com)
+ * @brief offline encoder that bakes images to block compressed KTX2 textures with mip chains
+ * @version 0.1
+ * @date 2021-07-04
+ *
+ * @copyright Copyright (c) 2021 Siddharth Mishra. All Rights Reserved.
+ *
+ * Run from build directory, same as GameZero executable.
+ * Usage : GameZeroTextureBaker [--format bc1|bc7] [--quality fast|normal|slow] [--linear] [--premultiply] [--stb-png] [--threads n] [images...]
+ *         bakes every png in ../assets/textures when no image is given,
+ *         every image.png is written beside it as image.ktx2 which renderer then loads instead
+ */
+
+#include "block_compression.hpp"
+#include "vulkan/vulkan.hpp"
+#include "utils/image.hpp"
+#include "utils/image_kernels.hpp"
+#include "utils/ktx2.hpp"
+#include "utils/parallel.hpp"
+#include "utils/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <vector>
+
+using namespace GameZero;
+
+/// directory baked when no image is given
+static const char* TextureDirectory = "../assets/textures";
+
+/// settings from command line
+struct BakeSettings{
+    BlockFormat format = BlockFormat::BC7;
+    BlockEncodeQuality quality = BlockEncodeQuality::Normal;
+    /// color textures are sRGB, data like normal maps is linear
+    bool srgb = true;
+    /// colors are multiplied by alpha before mips are filtered, so that transparent texels do not bleed into them
+    bool premultiply = false;
+    /// decoder of png images, stb_image is kept to compare against
+    PngDecoder pngDecoder = PngDecoder::Fast;
+    uint32_t threadCount = 0;
+};
+
+/// rgba image, tightly packed
+struct BakeImage{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> texels;
+};
+
+/// time a function in milliseconds
+template<typename Function>
+static float TimeMilliseconds(Function&& function){
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
+// peak signal to noise ratio of decoded texels against source over given channels,
+// colors of fully transparent texels are never seen and are left out of color channels
+static float ComputePSNR(const uint8_t* source, const uint8_t* decoded, size_t texelCount, uint32_t firstChannel, uint32_t channelCount){
+    double squaredError = 0;
+    size_t counted = 0;
+    for(size_t i = 0; i < texelCount; i++){
+        if(firstChannel < 3 && source[i * 4 + 3] == 0) continue;
+        for(uint32_t c = firstChannel; c < firstChannel + channelCount; c++){
+            double difference = double(source[i * 4 + c]) - double(decoded[i * 4 + c]);
+            squaredError += difference * difference;
+        }
+        counted++;
+    }
+    if(squaredError == 0) return INFINITY;
+    double meanSquaredError = squaredError / (double(counted) * channelCount);
+    return float(10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+}
+
+static vk::Format GetBakeFormat(const BakeSettings& settings){
+    if(settings.format == BlockFormat::BC1) return settings.srgb ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
+    return settings.srgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+}
+
+// descriptor of BC1 with alpha has one sample flagged as having alpha, BC7 one sample of all 128 bits
+static std::vector<uint8_t> GetBakeDfd(const BakeSettings& settings){
+    if(settings.format == BlockFormat::BC1) return BuildKtx2BlockDfd(128, settings.srgb, 8, {{0, 63, 1}}, settings.premultiply);
+    return BuildKtx2BlockDfd(134, settings.srgb, 16, {{0, 127, 0}}, settings.premultiply);
+}
+
+static bool BakeTexture(const std::string& filename, const BakeSettings& settings){
+    uint32_t width, height;
+    uint8_t* pixels = LoadImageRgba(filename.c_str(), width, height, nullptr, settings.pngDecoder);
+    if(!pixels){
+        printf("[ texture_baker ] %-40s skipped, failed to load\n", filename.c_str());
+        return false;
+    }
+
+    std::vector<BakeImage> levels(1);
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].texels.assign(pixels, pixels + size_t(width) * height * 4);
+    stbi_image_free(pixels);
+    if(settings.premultiply) PremultiplyAlpha(levels[0].texels.data(), size_t(width) * height, settings.srgb);
+
+    float mipTime = TimeMilliseconds([&](){
+        std::vector<std::vector<uint8_t>> mips = GenerateMipChain(levels[0].texels.data(), levels[0].width, levels[0].height, settings.srgb, settings.threadCount);
+        for(std::vector<uint8_t>& mip : mips){
+            BakeImage level;
+            level.width = GetDownsampledSize(levels.back().width);
+            level.height = GetDownsampledSize(levels.back().height);
+            level.texels = std::move(mip);
+            levels.push_back(std::move(level));
+        }
+    });
+
+    // every level is encoded with all threads, small levels finish quickly anyway
+    std::vector<std::vector<uint8_t>> blocks(levels.size());
+    size_t texelCount = 0, compressedSize = 0;
+    float encodeTime = TimeMilliseconds([&](){
+        for(size_t i = 0; i < levels.size(); i++){
+            const BakeImage& level = levels[i];
+            blocks[i].resize(GetBlockCompressedSize(settings.format, level.width, level.height));
+            EncodeBlocks(settings.format, level.texels.data(), level.width, level.height, blocks[i].data(), settings.quality, settings.threadCount);
+            texelCount += size_t(level.width) * level.height;
+            compressedSize += blocks[i].size();
+        }
+    });
+
+    // quality of full size level, decoded exactly as gpu samples it
+    const BakeImage& base = levels[0];
+    std::vector<uint8_t> decoded(base.texels.size());
+    DecodeBlocks(settings.format, blocks[0].data(), base.width, base.height, decoded.data());
+    float colorPSNR = ComputePSNR(base.texels.data(), decoded.data(), size_t(base.width) * base.height, 0, 3);
+    float alphaPSNR = ComputePSNR(base.texels.data(), decoded.data(), size_t(base.width) * base.height, 3, 1);
+
+    std::string outputFilename = filename.substr(0, filename.find_last_of('.')) + ".ktx2";
+    uint32_t alignment = settings.format == BlockFormat::BC1 ? 8 : 16;
+    if(!WriteKtx2(outputFilename.c_str(), uint32_t(GetBakeFormat(settings)), base.width, base.height, GetBakeDfd(settings), blocks, alignment)){
+        printf("[ texture_baker ] %-40s failed to write [ %s ]\n", filename.c_str(), outputFilename.c_str());
+        return false;
+    }
+
+    printf("[ texture_baker ] %-40s %5ux%-5u %2zu levels  mips : %8.2fms  encode : %9.2fms  %7.2f Mtexels/s  psnr rgb : %6.2f dB  alpha : %6.2f dB  %.2f MB -> %.2f MB\n",
+        filename.c_str(), base.width, base.height, levels.size(), mipTime, encodeTime, texelCount / (encodeTime * 1000.0f),
+        colorPSNR, alphaPSNR, texelCount * 4 / (1024.f * 1024.f), compressedSize / (1024.f * 1024.f));
+    return true;
+}
+
+// every png in directory, sorted so output order is stable
+static std::vector<std::string> ListImages(const char* directory){
+    std::vector<std::string> images;
+    DIR* dir = opendir(directory);
+    if(!dir) return images;
+
+    for(dirent* entry = readdir(dir); entry; entry = readdir(dir)){
+        size_t length = strlen(entry->d_name);
+        if(length > 4 && strcmp(entry->d_name + length - 4, ".png") == 0){
+            images.push_back(std::string(directory) + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(images.begin(), images.end());
+    return images;
+}
+
+static void PrintUsage(){
+    printf("Usage : GameZeroTextureBaker [--format bc1|bc7] [--quality fast|normal|slow] [--linear] [--premultiply] [--stb-png] [--threads n] [images...]\n");
+}
+
+int main(int argc, char** argv){
+    BakeSettings settings;
+    std::vector<std::string> images;
+
+    for(int i = 1; i < argc; i++){
+        const char* argument = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if(strcmp(argument, "--format") == 0){
+            if(strcmp(value, "bc1") == 0) settings.format = BlockFormat::BC1;
+            else if(strcmp(value, "bc7") == 0) settings.format = BlockFormat::BC7;
+            else{ PrintUsage(); return 1; }
+            i++;
+        }else if(strcmp(argument, "--quality") == 0){
+            if(strcmp(value, "fast") == 0) settings.quality = BlockEncodeQuality::Fast;
+            else if(strcmp(value, "normal") == 0) settings.quality = BlockEncodeQuality::Normal;
+            else if(strcmp(value, "slow") == 0) settings.quality = BlockEncodeQuality::Slow;
+            else{ PrintUsage(); return 1; }
+            i++;
+        }else if(strcmp(argument, "--linear") == 0){
+            settings.srgb = false;
+        }else if(strcmp(argument, "--premultiply") == 0){
+            settings.premultiply = true;
+        }else if(strcmp(argument, "--stb-png") == 0){
+            settings.pngDecoder = PngDecoder::Stb;
+        }else if(strcmp(argument, "--threads") == 0){
+            settings.threadCount = uint32_t(atoi(value));
+            i++;
+        }else if(argument[0] == '-'){
+            PrintUsage();
+            return 1;
+        }else{
+            images.push_back(argument);
+        }
+    }
+
+    if(images.empty()) images = ListImages(TextureDirectory);
+    if(images.empty()){
+        printf("[ texture_baker ] no images found in [ %s ]\n", TextureDirectory);
+        return 1;
+    }
+
+    const char* qualityNames[] = {"fast", "normal", "slow"};
+    printf("[ texture_baker ] %s %s %s%s, %u threads, %s image kernels\n", settings.format == BlockFormat::BC1 ? "bc1" : "bc7",
+        qualityNames[uint32_t(settings.quality)], settings.srgb ? "srgb" : "linear", settings.premultiply ? " premultiplied" : "",
+        settings.threadCount ? settings.threadCount : GetWorkerThreadCount(), GetImageKernelTarget());
+
+    int failures = 0;
+    for(const std::string& image : images){
+        if(!BakeTexture(image, settings)) failures++;
+    }
+    return failures ? 1 : 0;
+}